@@ -186,6 +186,47 @@ void AudioPort::transfer(float* dest, long frames, int channels)
 	}
 }
 
+/**
+ * Build the interleaved buffer for one port from a pair of
+ * channel buffers.  Used by APIs like JACK that don't interleave.
+ * For a mono port pass the same buffer for both sides.
+ */
+float* AudioPort::interleave(float* left, float* right, long frames)
+{
+	if (!mPrepared) {
+		float* dest = mBuffer;
+		for (int i = 0 ; i < frames ; i++) {
+			*dest++ = left[i];
+			*dest++ = right[i];
+		}
+		mPrepared = true;
+	}
+	return mBuffer;
+}
+
+/**
+ * Split the contents of one port's output into a pair of channel
+ * buffers.  If the port was never prepared the handler didn't use it
+ * and the channels are cleared.  Right may be NULL for a mono port.
+ */
+void AudioPort::deinterleave(float* left, float* right, long frames)
+{
+	if (!mPrepared) {
+		memset(left, 0, sizeof(float) * frames);
+		if (right != NULL)
+		  memset(right, 0, sizeof(float) * frames);
+	}
+	else {
+		float* src = mBuffer;
+		for (int i = 0 ; i < frames ; i++) {
+			left[i] = *src++;
+			if (right != NULL)
+			  right[i] = *src;
+			src++;
+		}
+	}
+}
+
 /****************************************************************************
  *                                                                          *
  *   								STREAM                                  *
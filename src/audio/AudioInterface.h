@@ -98,7 +98,8 @@ typedef enum {
     API_MME,
     API_DIRECT_SOUND,
     API_ASIO,
-	API_CORE_AUDIO
+	API_CORE_AUDIO,
+    API_JACK
 
 } AudioApi;
 
@@ -142,6 +143,7 @@ class AudioDevice {
             case API_DIRECT_SOUND: name = "Direct Sound"; break;
             case API_ASIO: name = "ASIO"; break;
             case API_CORE_AUDIO: name = "Core Audio"; break;
+            case API_JACK: name = "JACK"; break;
 			// xcode 5 whines if we don't have this for API_UNKNOW
 			default: name="unknown"; break;
         }
@@ -356,6 +358,10 @@ class AudioPort {
 	float* prepare(long frames);
 	void transfer(float* dest, long frames, int channels);
 
+    // for APIs that give us a buffer per channel
+    float* interleave(float* left, float* right, long frames);
+    void deinterleave(float* left, float* right, long frames);
+
   protected:
 
     /**
@@ -0,0 +1,736 @@
+/*
+ * Copyright (c) 2010 Jeffrey S. Larson  <jeff@circularlabs.com>
+ * All rights reserved.
+ * See the LICENSE file for the full copyright and license declaration.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Linux AudioInterface implemented on top of JACK.
+ *
+ * There is only one "device", the JACK server.  We register a JACK
+ * port for every channel and connect them to the physical ports in order,
+ * after that they can be rewired with any JACK patchbay.
+ *
+ * JACK gives us a separate buffer for each channel, but the
+ * AudioHandler expects interleaved stereo ports.  Rather than building
+ * a device wide interleaved buffer like the PortAudio streams,
+ * each port is interleaved directly from the JACK buffers when the
+ * handler asks for it, and output ports are split directly back into
+ * the JACK buffers.  Ports the handler never touches cost nothing.
+ *
+ * The process thread is created by JACK.  If the server is running
+ * with realtime scheduling it will already be SCHED_FIFO, if not we
+ * try to raise it ourselves.
+ *
+ * To test without hardware, run the server with the dummy driver:
+ *
+ *    jackd -R -d dummy -r 44100 -p 64
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <jack/jack.h>
+#include <jack/transport.h>
+
+#include "Trace.h"
+#include "util.h"
+#include "AudioInterface.h"
+
+/**
+ * Name we register with the JACK server.  If there is already a client
+ * with this name JACK will make it unique.
+ */
+#define JACK_CLIENT_NAME "Mobius"
+
+/**
+ * Priority we ask for if the server didn't give us realtime scheduling.
+ */
+#define JACK_RT_PRIORITY 70
+
+/**
+ * Number of channels we assume if we can't talk to the server
+ * while enumerating devices.
+ */
+#define JACK_DEFAULT_CHANNELS 2
+
+/**
+ * Maximum number of JACK ports in each direction.
+ */
+#define JACK_MAX_CHANNELS (AUDIO_MAX_PORTS * 2)
+
+AUDIO_BEGIN_NAMESPACE
+
+//////////////////////////////////////////////////////////////////////
+//
+// Classes
+//
+//////////////////////////////////////////////////////////////////////
+
+class JackAudioInterface : public AbstractAudioInterface {
+  public:
+
+	JackAudioInterface();
+	~JackAudioInterface();
+
+	AudioDevice** getDevices();
+	AudioStream* getStream();
+	void terminate();
+
+  private:
+
+	int countPhysicalPorts(jack_client_t* client, unsigned long flags);
+
+};
+
+class JackAudioStream : public AbstractAudioStream {
+
+  public:
+
+	JackAudioStream(JackAudioInterface* ai);
+	~JackAudioStream();
+
+	bool open();
+	void close();
+
+    double getStreamTime();
+    double getLastInterruptStreamTime();
+
+	// AudioHandler callbacks
+
+	AudioTime* getTime();
+	long getInterruptFrames();
+	void getInterruptBuffers(int inport, float** inbuf,
+							 int outport, float** outbuf);
+
+	// JACK callbacks
+	int processBuffers(jack_nframes_t frames);
+	void updateLatency();
+	void xrun();
+	void shutdown();
+
+  private:
+
+	void registerPorts();
+	void connectPorts();
+	void checkScheduling();
+	void updateTime(jack_nframes_t frames);
+
+	jack_client_t* mClient;
+
+	jack_port_t* mJackInputs[JACK_MAX_CHANNELS];
+	jack_port_t* mJackOutputs[JACK_MAX_CHANNELS];
+
+	// buffers for the current process cycle
+	float* mInputBuffers[JACK_MAX_CHANNELS];
+	float* mOutputBuffers[JACK_MAX_CHANNELS];
+
+	// transport state, valid only if the timebase master gives us BBT
+	AudioTime mTime;
+	bool mTimeValid;
+
+    double mLastStreamTime;
+
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// Interface Factory
+//
+//////////////////////////////////////////////////////////////////////
+
+AudioInterface* AudioInterface::Interface = NULL;
+
+AudioInterface* AudioInterface::getInterface()
+{
+	if (Interface == NULL) {
+		Interface = new JackAudioInterface();
+	}
+	return Interface;
+}
+
+void AudioInterface::exit()
+{
+	if (Interface != NULL) {
+		Interface->terminate();
+		delete Interface;
+		Interface = NULL;
+	}
+}
+
+/****************************************************************************
+ *                                                                          *
+ *   							JACK CALLBACKS                              *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * This is normally on, but may want to turn it off when debugging
+ * so we can halt at the site of the exception.
+ */
+PUBLIC bool AudioInterfaceCatchExceptions = true;
+
+/**
+ * JACK process callback, called in the realtime thread.
+ * Same rules as the PortAudio callback, do NOT allocate memory.
+ */
+static int jackProcess(jack_nframes_t frames, void* arg)
+{
+	JackAudioStream* stream = (JackAudioStream*)arg;
+
+	if (!AudioInterfaceCatchExceptions) {
+		stream->processBuffers(frames);
+	}
+	else {
+
+		static bool ignoreAfterException = true;
+		static int exceptionsCaught = 0;
+
+		try {
+			if (exceptionsCaught == 0 || !ignoreAfterException)
+			  stream->processBuffers(frames);
+		}
+		catch (...) {
+			exceptionsCaught++;
+			if (exceptionsCaught <= 100) {
+				printf("Exception in audio interrupt!\n");
+				fflush(stdout);
+				Trace(1, "Caught exception in audio interrupt!\n");
+			}
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Called by JACK in a non-realtime thread whenever the graph changes
+ * in a way that may change port latency.
+ */
+static void jackLatency(jack_latency_callback_mode_t mode, void* arg)
+{
+	JackAudioStream* stream = (JackAudioStream*)arg;
+	stream->updateLatency();
+}
+
+static int jackXrun(void* arg)
+{
+	JackAudioStream* stream = (JackAudioStream*)arg;
+	stream->xrun();
+	return 0;
+}
+
+static void jackShutdown(void* arg)
+{
+	JackAudioStream* stream = (JackAudioStream*)arg;
+	stream->shutdown();
+}
+
+/****************************************************************************
+ *                                                                          *
+ *   							  INTERRUPT                                 *
+ *                                                                          *
+ ****************************************************************************/
+
+PUBLIC int JackAudioStream::processBuffers(jack_nframes_t frames)
+{
+	int i;
+
+	mInterrupts++;
+	mFrames = frames;
+    mLastStreamTime = (double)jack_last_frame_time(mClient) /
+        (double)mSampleRate;
+
+	for (i = 0 ; i < mInputChannels ; i++)
+	  mInputBuffers[i] = (float*)jack_port_get_buffer(mJackInputs[i], frames);
+
+	for (i = 0 ; i < mOutputChannels ; i++)
+	  mOutputBuffers[i] = (float*)jack_port_get_buffer(mJackOutputs[i], frames);
+
+	if (mHandler == NULL || frames > AUDIO_MAX_FRAMES_PER_BUFFER) {
+		if (mHandler != NULL)
+		  Trace(1, "JACK buffer too large %ld\n", (long)frames);
+		for (i = 0 ; i < mOutputChannels ; i++)
+		  memset(mOutputBuffers[i], 0, sizeof(float) * frames);
+	}
+	else {
+		updateTime(frames);
+
+		for (i = 0 ; i < mInputPorts ; i++)
+		  mInputs[i].reset();
+
+		for (i = 0 ; i < mOutputPorts ; i++)
+		  mOutputs[i].reset();
+
+		// this will make calls to getInterruptBuffers
+		mHandler->processAudioBuffers(this);
+
+		// split the ports the handler used back into the JACK
+		// buffers, the rest are cleared
+		for (i = 0 ; i < mOutputPorts ; i++) {
+			int channel = i * 2;
+			mOutputs[i].deinterleave(mOutputBuffers[channel],
+									 mOutputBuffers[channel + 1], frames);
+		}
+
+		// an odd channel left over isn't part of a port
+		if (mOutputChannels > mOutputPorts * 2)
+		  memset(mOutputBuffers[mOutputChannels - 1], 0,
+				 sizeof(float) * frames);
+	}
+
+	return 0;
+}
+
+long JackAudioStream::getInterruptFrames()
+{
+	return mFrames;
+}
+
+void JackAudioStream::getInterruptBuffers(int inport, float** inbuf,
+										  int outport, float** outbuf)
+{
+	if (inbuf != NULL) {
+		if (mInputPorts == 0) {
+			// no input ports, give them silence
+			*inbuf = mInputs[0].prepare(mFrames);
+		}
+		else {
+			// if the port is out of range, use the first one
+			if (inport < 0 || inport >= mInputPorts)
+			  inport = 0;
+
+			int channel = inport * 2;
+			float* left = mInputBuffers[channel];
+			float* right = left;
+			// the last port on a device may have only one
+			if (channel + 1 < mInputChannels)
+			  right = mInputBuffers[channel + 1];
+
+			*inbuf = mInputs[inport].interleave(left, right, mFrames);
+		}
+	}
+
+	if (outbuf != NULL) {
+		if (outport < 0 || outport >= mOutputPorts)
+		  outport = 0;
+
+		*outbuf = mOutputs[outport].prepare(mFrames);
+	}
+}
+
+/****************************************************************************
+ *                                                                          *
+ *                                TRANSPORT                                 *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Capture the JACK transport for host sync.  This is only meaningful
+ * if some client is acting as timebase master and providing
+ * bar/beat/tick, otherwise getTime returns NULL.
+ */
+PRIVATE void JackAudioStream::updateTime(jack_nframes_t frames)
+{
+	jack_position_t pos;
+	jack_transport_state_t state = jack_transport_query(mClient, &pos);
+
+	mTimeValid = ((pos.valid & JackPositionBBT) != 0);
+	if (mTimeValid) {
+		double position = ((pos.bar - 1) * pos.beats_per_bar) +
+			(pos.beat - 1);
+		if (pos.ticks_per_beat > 0)
+		  position += (double)pos.tick / pos.ticks_per_beat;
+
+		mTime.tempo = pos.beats_per_minute;
+		mTime.beatPosition = position;
+		mTime.playing = (state == JackTransportRolling);
+		mTime.beatsPerBar = (int)pos.beats_per_bar;
+		mTime.beatBoundary = false;
+		mTime.barBoundary = false;
+		mTime.boundaryOffset = 0;
+		mTime.beat = (int)floor(position);
+
+		if (mTime.playing && mTime.tempo > 0.0) {
+			double beatsPerFrame = mTime.tempo / (60.0 * pos.frame_rate);
+			double range = position + (beatsPerFrame * (frames - 1));
+			long base = (long)floor(position);
+			long last = (long)floor(range);
+
+			if (position == (double)base) {
+				// first frame is exactly on the beat
+				mTime.beatBoundary = true;
+			}
+			else if (last != base) {
+				mTime.beatBoundary = true;
+				mTime.boundaryOffset = (long)
+					(((double)last - position) / beatsPerFrame);
+				mTime.beat = (int)last;
+			}
+
+			if (mTime.beatBoundary && mTime.beatsPerBar > 0)
+			  mTime.barBoundary = ((mTime.beat % mTime.beatsPerBar) == 0);
+		}
+	}
+}
+
+AudioTime* JackAudioStream::getTime()
+{
+	return (mTimeValid) ? &mTime : NULL;
+}
+
+/**
+ * JACK frame time is a running count of frames since the server
+ * started, that is our stream time.  jack_frame_time may be called
+ * from any thread and estimates the current frame.
+ */
+PUBLIC double JackAudioStream::getStreamTime()
+{
+	double time = 0.0;
+	if (mClient != NULL)
+	  time = (double)jack_frame_time(mClient) / (double)mSampleRate;
+	return time;
+}
+
+PUBLIC double JackAudioStream::getLastInterruptStreamTime()
+{
+    return mLastStreamTime;
+}
+
+/****************************************************************************
+ *                                                                          *
+ *                                 LATENCY                                  *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Ask JACK for the latency of our ports.  The capture latency of our
+ * inputs is everything upstream of us, the playback latency of our outputs
+ * is everything downstream.  If there are several paths take the longest.
+ */
+PUBLIC void JackAudioStream::updateLatency()
+{
+	jack_latency_range_t range;
+	int input = 0;
+	int output = 0;
+	int i;
+
+	for (i = 0 ; i < mInputChannels ; i++) {
+		jack_port_get_latency_range(mJackInputs[i], JackCaptureLatency, &range);
+		if ((int)range.max > input)
+		  input = (int)range.max;
+	}
+
+	for (i = 0 ; i < mOutputChannels ; i++) {
+		jack_port_get_latency_range(mJackOutputs[i], JackPlaybackLatency, &range);
+		if ((int)range.max > output)
+		  output = (int)range.max;
+	}
+
+	if (input != mInputLatency || output != mOutputLatency)
+	  Trace(2, "JACK latency input %ld output %ld\n",
+			(long)input, (long)output);
+
+	mInputLatency = input;
+	mOutputLatency = output;
+}
+
+PUBLIC void JackAudioStream::xrun()
+{
+	if (mTraceDropouts)
+	  Trace(1, "JACK xrun!\n");
+	mOutputUnderflows++;
+}
+
+/**
+ * Called if the server goes away.  The client is no longer usable,
+ * all we can do is forget it.
+ */
+PUBLIC void JackAudioStream::shutdown()
+{
+	Trace(1, "JACK server shut down\n");
+	sprintf(mError, "JACK server shut down");
+	mClient = NULL;
+	mStream = NULL;
+	mStreamStarted = false;
+}
+
+/****************************************************************************
+ *                                                                          *
+ *   								STREAM                                  *
+ *                                                                          *
+ ****************************************************************************/
+
+JackAudioStream::JackAudioStream(JackAudioInterface* ai)
+{
+	setInterface(ai);
+	mClient = NULL;
+	for (int i = 0 ; i < JACK_MAX_CHANNELS ; i++) {
+		mJackInputs[i] = NULL;
+		mJackOutputs[i] = NULL;
+		mInputBuffers[i] = NULL;
+		mOutputBuffers[i] = NULL;
+	}
+	mTime.init();
+	mTimeValid = false;
+    mLastStreamTime = 0.0;
+}
+
+JackAudioStream::~JackAudioStream()
+{
+	close();
+}
+
+/**
+ * Connect to the server and activate the client.  Return false if we
+ * could not and leave an error in mError.
+ *
+ * There is only one device so if the devices weren't specified
+ * we'll just use it.  The sample rate is whatever the server is
+ * running, it can't be changed from here.
+ */
+bool JackAudioStream::open()
+{
+	if (mClient == NULL) {
+		strcpy(mError, "");
+
+		if (mInputDevice == -1)
+		  setInputDevice(0);
+		if (mOutputDevice == -1)
+		  setOutputDevice(0);
+
+		jack_status_t status;
+		mClient = jack_client_open(JACK_CLIENT_NAME, JackNoStartServer,
+								   &status);
+		if (mClient == NULL) {
+			sprintf(mError, "Unable to connect to JACK server, status %x",
+					(int)status);
+			Trace(1, "%s\n", mError);
+		}
+		else {
+			mStream = mClient;
+			mSampleRate = (int)jack_get_sample_rate(mClient);
+
+			registerPorts();
+
+			jack_set_process_callback(mClient, jackProcess, this);
+			jack_set_latency_callback(mClient, jackLatency, this);
+			jack_set_xrun_callback(mClient, jackXrun, this);
+			jack_on_shutdown(mClient, jackShutdown, this);
+
+			if (jack_activate(mClient) != 0) {
+				sprintf(mError, "Unable to activate JACK client");
+				Trace(1, "%s\n", mError);
+				jack_client_close(mClient);
+				mClient = NULL;
+				mStream = NULL;
+			}
+			else {
+				mStreamStarted = true;
+				connectPorts();
+				checkScheduling();
+				updateLatency();
+			}
+		}
+	}
+
+	return (mClient != NULL);
+}
+
+/**
+ * Register one JACK port for each channel.
+ */
+PRIVATE void JackAudioStream::registerPorts()
+{
+	char name[64];
+	int i;
+
+	if (mInputChannels > JACK_MAX_CHANNELS)
+	  mInputChannels = JACK_MAX_CHANNELS;
+	if (mOutputChannels > JACK_MAX_CHANNELS)
+	  mOutputChannels = JACK_MAX_CHANNELS;
+
+	for (i = 0 ; i < mInputChannels ; i++) {
+		sprintf(name, "in_%d", i + 1);
+		mJackInputs[i] = jack_port_register(mClient, name,
+											JACK_DEFAULT_AUDIO_TYPE,
+											JackPortIsInput, 0);
+	}
+
+	for (i = 0 ; i < mOutputChannels ; i++) {
+		sprintf(name, "out_%d", i + 1);
+		mJackOutputs[i] = jack_port_register(mClient, name,
+											 JACK_DEFAULT_AUDIO_TYPE,
+											 JackPortIsOutput, 0);
+	}
+}
+
+/**
+ * Connect our ports to the physical ports in order.  Failure isn't
+ * an error, they can always be connected by hand.
+ */
+PRIVATE void JackAudioStream::connectPorts()
+{
+	const char** ports;
+	int i;
+
+	ports = jack_get_ports(mClient, NULL, JACK_DEFAULT_AUDIO_TYPE,
+						   JackPortIsPhysical | JackPortIsOutput);
+	if (ports != NULL) {
+		for (i = 0 ; i < mInputChannels && ports[i] != NULL ; i++)
+		  jack_connect(mClient, ports[i], jack_port_name(mJackInputs[i]));
+		jack_free(ports);
+	}
+
+	ports = jack_get_ports(mClient, NULL, JACK_DEFAULT_AUDIO_TYPE,
+						   JackPortIsPhysical | JackPortIsInput);
+	if (ports != NULL) {
+		for (i = 0 ; i < mOutputChannels && ports[i] != NULL ; i++)
+		  jack_connect(mClient, jack_port_name(mJackOutputs[i]), ports[i]);
+		jack_free(ports);
+	}
+}
+
+/**
+ * Make sure the process thread is running SCHED_FIFO.
+ */
+PRIVATE void JackAudioStream::checkScheduling()
+{
+	jack_native_thread_t thread = jack_client_thread_id(mClient);
+
+	if (!jack_is_realtime(mClient)) {
+		// server isn't running with -R, try to raise it ourselves
+		if (jack_acquire_real_time_scheduling(thread, JACK_RT_PRIORITY) != 0)
+		  Trace(1, "JACK: Unable to get realtime scheduling, check rtprio limits\n");
+	}
+
+	int policy;
+	struct sched_param param;
+	if (pthread_getschedparam(thread, &policy, &param) == 0) {
+		if (policy == SCHED_FIFO)
+		  Trace(2, "JACK: Process thread SCHED_FIFO priority %ld\n",
+				(long)param.sched_priority);
+		else
+		  Trace(1, "JACK: Process thread is not SCHED_FIFO!\n");
+	}
+}
+
+/**
+ * Close the stream.
+ */
+void JackAudioStream::close()
+{
+	if (mClient != NULL) {
+		jack_deactivate(mClient);
+		jack_client_close(mClient);
+		mClient = NULL;
+		mStream = NULL;
+        mStreamStarted = false;
+
+		for (int i = 0 ; i < JACK_MAX_CHANNELS ; i++) {
+			mJackInputs[i] = NULL;
+			mJackOutputs[i] = NULL;
+		}
+		mTimeValid = false;
+
+		mInterrupts = 0;
+		mAverageLatency = 0;
+		mInputUnderflows = 0;
+		mInputOverflows = 0;
+		mOutputUnderflows = 0;
+		mOutputOverflows = 0;
+	}
+}
+
+/****************************************************************************
+ *                                                                          *
+ *   							  INTERFACE                                 *
+ *                                                                          *
+ ****************************************************************************/
+
+JackAudioInterface::JackAudioInterface()
+{
+}
+
+JackAudioInterface::~JackAudioInterface()
+{
+}
+
+AudioStream* JackAudioInterface::getStream()
+{
+	return new JackAudioStream(this);
+}
+
+void JackAudioInterface::terminate()
+{
+}
+
+/**
+ * There is one device representing the JACK server.  If the server
+ * is running we open a temporary client to count the physical ports
+ * so we know how many channels to register.
+ */
+AudioDevice** JackAudioInterface::getDevices()
+{
+	if (mDevices == NULL) {
+		int inputs = JACK_DEFAULT_CHANNELS;
+		int outputs = JACK_DEFAULT_CHANNELS;
+
+		jack_status_t status;
+		jack_client_t* client = jack_client_open(JACK_CLIENT_NAME "Probe",
+												 JackNoStartServer, &status);
+		if (client != NULL) {
+			int count = countPhysicalPorts(client, JackPortIsOutput);
+			if (count > 0)
+			  inputs = count;
+			count = countPhysicalPorts(client, JackPortIsInput);
+			if (count > 0)
+			  outputs = count;
+			jack_client_close(client);
+		}
+
+		if (inputs > JACK_MAX_CHANNELS)
+		  inputs = JACK_MAX_CHANNELS;
+		if (outputs > JACK_MAX_CHANNELS)
+		  outputs = JACK_MAX_CHANNELS;
+
+		AudioDevice* dev = new AudioDevice();
+		dev->setApi(API_JACK);
+		dev->setId(0);
+		dev->setName("JACK");
+		dev->setInputChannels(inputs);
+		dev->setOutputChannels(outputs);
+		dev->setDefaultInput(true);
+		dev->setDefaultOutput(true);
+
+		mDeviceCount = 1;
+		mDevices = new AudioDevice*[mDeviceCount + 1];
+		mDevices[0] = dev;
+		mDevices[1] = NULL;
+	}
+	return mDevices;
+}
+
+PRIVATE int JackAudioInterface::countPhysicalPorts(jack_client_t* client,
+												   unsigned long flags)
+{
+	int count = 0;
+	const char** ports = jack_get_ports(client, NULL, JACK_DEFAULT_AUDIO_TYPE,
+										JackPortIsPhysical | flags);
+	if (ports != NULL) {
+		while (ports[count] != NULL)
+		  count++;
+		jack_free(ports);
+	}
+	return count;
+}
+
+AUDIO_END_NAMESPACE
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
@@ -114,6 +114,9 @@ class MacMidiInput : public MidiInput
 
 	MIDIPortRef mInputPort;
 	MIDIEndpointRef mSource;
+
+	// last channel status byte for running status
+	int mRunningStatus;
 };
 
 class MacMidiOutput : public MidiOutput 
@@ -128,10 +131,12 @@ class MacMidiOutput : public MidiOutput
 	bool isConnected();
 	void send(int msg);
     int sendSysex(const unsigned char *buffer, int length);
+	void sendDelayed(int msg, float delay);
 
   private:
 
 	MIDIClientRef getClient();
+	void send(int msg, MIDITimeStamp time);
 
 	MIDIPortRef mOutputPort;
 	MIDIEndpointRef mDestination;
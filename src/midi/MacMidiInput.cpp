@@ -30,6 +30,7 @@ PUBLIC MacMidiInput::MacMidiInput(MacMidiEnv* env, MidiPort* port) :
 {
 	mSource = 0;
 	mInputPort = 0;
+	mRunningStatus = 0;
 }
 
 PUBLIC MacMidiInput::~MacMidiInput()
@@ -183,16 +184,36 @@ PRIVATE void MacMidiInput::processPackets(const MIDIPacketList* packets,
 			// if you're twisting more than one knob at the same time
 			// !! in theory realtime (>= 0xF8) can be interleaved
 			// within other multi-byte messages, not handling that
+			// Running status is decoded here in the packet rather than
+			// making a copy, a data byte where we expect a status
+			// means we reuse the last channel status.
 
 			while (psn < length) {
 				
-				int statusChannel = data[psn++];
+				int statusChannel = data[psn];
+				if (statusChannel & 0x80) {
+					psn++;
+					if (statusChannel < 0xF0)
+					  mRunningStatus = statusChannel;
+					else if (statusChannel < 0xF8)
+					  // system common cancels running status, 
+					  // realtime does not
+					  mRunningStatus = 0;
+				}
+				else if (mRunningStatus != 0) {
+					// leave psn on the data byte
+					statusChannel = mRunningStatus;
+				}
+				else {
+					// a data byte without a status, leave psn where it is,
+					// the check below will ignore the rest
+				}
+
 				int status = statusChannel & 0xF0;
 				int dataBytes = 0;
 
 				if (status < 0x80) {
-					// we're either in the middle of a sysex or running
-					// status is being used
+					// we're in the middle of a sysex
 					Trace(1, "Unexpected data byte, ignoring MIDI packet!\n");
 					dataBytes = -1;
 				}
@@ -11,6 +11,8 @@
 
 #include <stdio.h>
 
+#include <CoreAudio/HostTime.h>
+
 #include "Util.h"
 #include "Trace.h"
 #include "Thread.h"
@@ -101,6 +103,29 @@ PUBLIC bool MacMidiOutput::isConnected()
  * Send a short message.
  */
 PUBLIC void MacMidiOutput::send(int msg)
+{
+	send(msg, 0);
+}
+
+/**
+ * Send a short message in the future.  CoreMIDI will schedule
+ * it for us, this is how scheduled MIDI clocks get better than
+ * millisecond accuracy.
+ */
+PUBLIC void MacMidiOutput::sendDelayed(int msg, float delay)
+{
+	MIDITimeStamp time = 0;
+	if (delay > 0.0f) {
+		UInt64 nanos = (UInt64)(delay * 1000000.0f);
+		time = AudioGetCurrentHostTime() + AudioConvertNanosToHostTime(nanos);
+	}
+	send(msg, time);
+}
+
+/**
+ * Send a short message with a host timestamp, zero means now.
+ */
+PRIVATE void MacMidiOutput::send(int msg, MIDITimeStamp time)
 {
 	if (mOutputPort != NULL && mDestination != NULL) {
 		
@@ -121,7 +146,7 @@ PUBLIC void MacMidiOutput::send(int msg)
 		MIDIPacket* packet = &(packets.packet[0]);
 		Byte* data = &(packet->data[0]);
 		packets.numPackets = 1;
-		packet->timeStamp = 0;
+		packet->timeStamp = time;
 
 		// sigh, have to undo some of the work MidiOutput::send does
 		int status = msg & 0xFF;
@@ -10,8 +10,10 @@
  * 
  * On Windows we cannot do much MIDI event processing directly 
  * in the interrupt handler, instead we immediately convert the received
- * MIDI bytes into a MidiEvent, leave it on a list, and notify a monitor thread
- * to process the list.  Because of the possible delay between the time we 
+ * MIDI bytes into a MidiEvent, leave it in a ring, and notify a monitor thread
+ * to process the ring.  The MidiEvents live in the ring so nothing is
+ * allocated in the handler, and since there is one writer and one reader
+ * the ring needs no critical section.  Because of the possible delay between the time we 
  * receive an event and the time the application callback ends up running we
  * normally have a MidiTimer object that we use to immediately timestamp 
  * the event.
@@ -29,6 +31,7 @@
 
 #include "MidiEnv.h"
 #include "MidiEvent.h"
+#include "MidiListener.h"
 #include "MidiMap.h"
 #include "MidiTimer.h"
 #include "MidiOutput.h"
@@ -62,8 +65,12 @@ PUBLIC MidiInput::MidiInput(MidiEnv* env, MidiPort* port)
 	mEchoDevice 		= NULL;
     mEchoMap            = NULL;
 
-	mEvents 			= NULL;
-	mLastEvent			= NULL;
+	mRing				= new MidiEvent[MIDI_INPUT_RING_SIZE];
+	mRingHead			= 0;
+	mRingTail			= 0;
+	mCoalesce			= true;
+	for (int i = 0 ; i < 16 * 128 ; i++)
+	  mLastControl[i] = -1;
 
 	mListener			= NULL;
 	mInInterruptHandler = 0;
@@ -74,6 +81,11 @@ PUBLIC MidiInput::MidiInput(MidiEnv* env, MidiPort* port)
 	mEventOverflows		= 0;
 	mInterruptOverruns	= 0;
 	mLongOverflows		= 0;
+	mDroppedEvents		= 0;
+	mCoalescedEvents	= 0;
+	mMaxLatency			= 0;
+	mTotalLatency		= 0;
+	mLatencyEvents		= 0;
 }
 
 /**
@@ -87,11 +99,10 @@ PUBLIC MidiInput::~MidiInput(void)
 	// from a destructor, make sure the subclass does...
 	//disconnect();
 
-	if (mEvents != NULL)
-	  mEvents->free();
-
 	printWarnings();
 
+	delete [] mRing;
+
 	delete mCsect;
 	delete mInputMap;
 	delete mEchoMap;
@@ -189,6 +200,9 @@ PUBLIC void MidiInput::printWarnings(void)
 				   mInterruptOverruns);
 	if (mLongOverflows)
 	  printf("%d sysex overflows in MIDI input!\n", mLongOverflows);
+
+	if (mDroppedEvents)
+	  printf("%d events dropped in MIDI input!\n", mDroppedEvents);
 }
 
 /****************************************************************************
@@ -507,7 +521,7 @@ PRIVATE void MidiInput::processShortMessage(int msg)
 					mEchoDevice->send(msg);
 
 				if (mListener != NULL)
-				  event = mEnv->newMidiEvent(status, 0, byte1, byte2);
+				  event = reserveEvent(status, 0, byte1, byte2);
 			}
 		}
 		else {
@@ -547,7 +561,7 @@ PRIVATE void MidiInput::processShortMessage(int msg)
 				// create an event if there is further processing to be done
 				if (mListener != NULL) {
 
-					event = mEnv->newMidiEvent(status, channel, byte1, byte2);
+					event = reserveEvent(status, channel, byte1, byte2);
 
 					// formerly used the "drum" flag of the map to 
 					// set event duration to 1, is that still
@@ -556,7 +570,7 @@ PRIVATE void MidiInput::processShortMessage(int msg)
 			}
 		}
 
-		// process the event object if we created one,
+		// process the event object if we reserved one,
 		// should only have done this if callback was non-null
 
 		if (event != NULL) {
@@ -569,29 +583,16 @@ PRIVATE void MidiInput::processShortMessage(int msg)
 					event->getStatus(), event->getKey());
 #endif
 
-			if (mListener == NULL) {
-				// shouldn't be here, but just in case we need to
-				// create events for some special processing, free them here
-				event->free();
-			}
-			else {
-				// captured the clock earlier
-				event->setClock(clock);
-
-				// Add it to the list
-				enterCriticalSection();
-				if (mLastEvent != NULL)
-				  mLastEvent->setNext(event);
-				else
-				  mEvents = event;
-				mLastEvent = event;
-				leaveCriticalSection();
-
-				// notify the monitor thread
-				//if (mMonitorThread)
-				//mMonitorThread->signal();
-				notifyEventsReceived();
-			}
+			// captured the clock earlier
+			event->setClock(clock);
+
+			// make it visible to the listener
+			commitEvent();
+
+			// notify the monitor thread
+			//if (mMonitorThread)
+			//mMonitorThread->signal();
+			notifyEventsReceived();
 		}
 
 		mInInterruptHandler = 0;
@@ -644,32 +645,193 @@ PUBLIC int MidiInput::getSmoothTempo()
 }
 
 /**
- * Returns the list of events that have accumulated since the
+ * Called in the interrupt handler to get the next free event in the ring.
+ * Returns NULL if the ring is full.  The event is not visible to the
+ * listener until commitEvent is called.
+ */
+PRIVATE MidiEvent* MidiInput::reserveEvent(int status, int channel, 
+										   int byte1, int byte2)
+{
+	MidiEvent* event = NULL;
+
+	int next = mRingHead + 1;
+	if (next >= MIDI_INPUT_RING_SIZE)
+	  next = 0;
+
+	if (next == mRingTail) {
+		// listener isn't keeping up
+		mDroppedEvents++;
+	}
+	else {
+		event = &mRing[mRingHead];
+		event->reinit();
+		event->setStatus(status);
+		event->setChannel(channel);
+		event->setKey(byte1);
+		event->setVelocity(byte2);
+	}
+
+	return event;
+}
+
+/**
+ * Advance the head past the event returned by reserveEvent.
+ */
+PRIVATE void MidiInput::commitEvent()
+{
+	int next = mRingHead + 1;
+	if (next >= MIDI_INPUT_RING_SIZE)
+	  next = 0;
+	mRingHead = next;
+}
+
+/**
+ * Called by the listener thread when it is done with the event at the 
+ * tail of the ring.  Here we also keep the latency statistics, this will
+ * be the time from reception to the end of listener processing.
+ */
+PRIVATE void MidiInput::releaseEvent(MidiEvent* e)
+{
+	if (mTimer != NULL) {
+		long latency = mTimer->getMilliseconds() - e->getClock();
+		if (latency >= 0) {
+			if (latency > mMaxLatency)
+			  mMaxLatency = latency;
+			mTotalLatency += latency;
+			mLatencyEvents++;
+		}
+	}
+
+	int next = mRingTail + 1;
+	if (next >= MIDI_INPUT_RING_SIZE)
+	  next = 0;
+	mRingTail = next;
+}
+
+PUBLIC bool MidiInput::hasEvents()
+{
+	return (mRingTail != mRingHead);
+}
+
+/**
+ * Returns a list of the events that have accumulated since the
  * interrupt handler was first invoked.  If the callback does something
- * really expensive, we can potentially keep adding things to the event
- * list until they finally call this function.
+ * really expensive, we can potentially keep adding things to the ring
+ * until they finally call this function.
+ *
+ * The ring events are copied into pooled events which the caller owns,
+ * this is used by the sequencer which keeps them.  Listeners that only
+ * need to look at events should use processEvents instead.
  */
 PUBLIC MidiEvent *MidiInput::getEvents(void) 
 {
-	MidiEvent *events = mEvents;
-
-	enterCriticalSection();
-	mEvents = NULL;
-	mLastEvent = NULL;
-	leaveCriticalSection();
+	MidiEvent* events = NULL;
+	MidiEvent* last = NULL;
+
+	int head = mRingHead;
+	while (mRingTail != head) {
+		MidiEvent* e = &mRing[mRingTail];
+		MidiEvent* copy = mEnv->newMidiEvent(e->getStatus(), e->getChannel(),
+											 e->getKey(), e->getVelocity());
+		copy->setClock(e->getClock());
+		if (last != NULL)
+		  last->setNext(copy);
+		else
+		  events = copy;
+		last = copy;
+
+		releaseEvent(e);
+	}
 
 	return events;
 }
 
+/**
+ * Pass each event that has accumulated in the ring to a listener.
+ * The events belong to the ring and must not be kept or freed.
+ * 
+ * If coalescing is enabled, a controller event is skipped if there 
+ * is a newer event for the same channel and controller waiting behind it.
+ * With controller-heavy surfaces this keeps a burst of knob movement from
+ * turning into a burst of actions when only the last value matters.
+ * Values 0 and 127 are never skipped since buttons send those and
+ * we can't miss the press.
+ *
+ * Returns the number of events passed to the listener.
+ */
+PUBLIC int MidiInput::processEvents(MidiEventListener* l)
+{
+	int processed = 0;
+
+	// anything added after this will wait for the next notification
+	int head = mRingHead;
+
+	if (mCoalesce) {
+		for (int i = mRingTail ; i != head ; ) {
+			MidiEvent* e = &mRing[i];
+			if (e->getStatus() == MS_CONTROL)
+			  mLastControl[(e->getChannel() & 0xF) * 128 + (e->getController() & 0x7F)] = i;
+			i++;
+			if (i >= MIDI_INPUT_RING_SIZE)
+			  i = 0;
+		}
+	}
+
+	while (mRingTail != head) {
+		MidiEvent* e = &mRing[mRingTail];
+
+		bool skip = false;
+		if (mCoalesce && e->getStatus() == MS_CONTROL) {
+			int value = e->getValue();
+			int key = (e->getChannel() & 0xF) * 128 + (e->getController() & 0x7F);
+			skip = (mLastControl[key] != mRingTail && 
+					value != 0 && value != 127);
+		}
+
+		if (skip)
+		  mCoalescedEvents++;
+		else {
+			if (l != NULL)
+			  l->midiEvent(e);
+			processed++;
+		}
+
+		releaseEvent(e);
+	}
+
+	return processed;
+}
+
 /**
  * Called internally if the listener decides to ignore the accumulated events.
  * ?? Can also be called by the listener?
  */
 PUBLIC void MidiInput::ignoreEvents(void)
 {
-	MidiEvent *events = getEvents();
-	if (events != NULL)
-	  events->free();
+	mRingTail = mRingHead;
+}
+
+PUBLIC int MidiInput::getDroppedEvents()
+{
+	return mDroppedEvents;
+}
+
+PUBLIC int MidiInput::getCoalescedEvents()
+{
+	return mCoalescedEvents;
+}
+
+PUBLIC long MidiInput::getMaxLatency()
+{
+	return mMaxLatency;
+}
+
+PUBLIC float MidiInput::getAverageLatency()
+{
+	float latency = 0.0f;
+	if (mLatencyEvents > 0)
+	  latency = (float)mTotalLatency / (float)mLatencyEvents;
+	return latency;
 }
 
 /**
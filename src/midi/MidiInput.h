@@ -12,6 +12,14 @@
 #ifndef MIDI_INPUT_H
 #define MIDI_INPUT_H
 
+/**
+ * The number of events that may be received before the listener
+ * gets around to processing them.  Events are stored directly in this
+ * ring so there is no allocation in the interrupt handler.  If the ring
+ * fills events are dropped and counted.
+ */
+#define MIDI_INPUT_RING_SIZE 1024
+
 /****************************************************************************
  *                                                                          *
  *                                 MIDI INPUT                               *
@@ -122,6 +130,18 @@ class MidiInput {
 
 	class MidiEvent *getEvents(void);
 	void ignoreEvents(void);
+	bool hasEvents();
+	int processEvents(class MidiEventListener* l);
+
+	void setCoalesce(bool b) {
+		mCoalesce = b;
+	}
+
+	// statistics
+	int getDroppedEvents();
+	int getCoalescedEvents();
+	long getMaxLatency();
+	float getAverageLatency();
 
 	void incShortErrors() {
 		mShortErrors++;
@@ -183,6 +203,10 @@ class MidiInput {
 	void enterCriticalSection(void);
 	void leaveCriticalSection(void);
 
+	class MidiEvent* reserveEvent(int status, int channel, int byte1, int byte2);
+	void commitEvent();
+	void releaseEvent(class MidiEvent* e);
+
 	class MidiEnv*		  mEnv;
 	MidiInput* 			  mNext;		// for MidiEnv's list
 	class MidiPort* 	  mPort;
@@ -202,9 +226,16 @@ class MidiInput {
 	class MidiOutput*	mEchoDevice;	// device to use for echo
     class MidiMap*      mEchoMap;       // echo mappings
 
-	// incomming event list
-	class MidiEvent* mEvents;
-	class MidiEvent* mLastEvent;
+	// incomming event ring, the interrupt handler adds at the head
+	// and the listener thread consumes from the tail
+	class MidiEvent* mRing;
+	int mRingHead;
+	int mRingTail;
+
+	// when set, CC events followed by a newer value for the same
+	// controller are dropped during processEvents
+	bool mCoalesce;
+	int mLastControl[16 * 128];
 
 	//
 	// Callback state
@@ -224,6 +255,13 @@ class MidiInput {
 	int mEventOverflows;
 	int mInterruptOverruns;
 	int mLongOverflows;
+	int mDroppedEvents;
+	int mCoalescedEvents;
+
+	// milliseconds between reception and the end of listener processing
+	long mMaxLatency;
+	long mTotalLatency;
+	long mLatencyEvents;
 
 };
 
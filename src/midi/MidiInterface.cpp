@@ -110,6 +110,7 @@ void AbstractMidiInterface::printStatistics()
 {
 }
 
+
 void AbstractMidiInterface::printEnvironment()
 {
 }
@@ -139,6 +140,8 @@ class CommonMidiInterface : public AbstractMidiInterface,
 
 	void startClocks(float tempo);
 	void stopClocks();
+	bool scheduleClock(double millisecond);
+	int getLateClocks();
 
 	MidiEvent* newEvent(int status, int chan, int value, int vel);
 	void send(MidiEvent* e);
@@ -159,6 +162,8 @@ class CommonMidiInterface : public AbstractMidiInterface,
 	// of needing MIDI clocks from midiStart
 	bool timerStart();
 
+	void printStatistics();
+
 	// these are mostly just for debugging
 	long getMilliseconds();
 	int getMidiClocks();
@@ -311,20 +316,32 @@ MidiPort* CommonMidiInterface::getOutputPorts()
  */
 void CommonMidiInterface::midiInputEvent(MidiInput* in)
 {
-	MidiEvent *events, *e;
-		
 	// ignore any sysex that may have come in
 	in->ignoreSysex();
 
-	// get the current event(s)
-	events = in->getEvents();
+	// pass the current event(s) directly from the input ring
+	if (mListener != NULL)
+	  in->processEvents(mListener);
+	else
+	  in->ignoreEvents();
+}
 
-	if (mListener != NULL) {
-		for (e = events ; e != NULL ; e = e->getNext())
-		  mListener->midiEvent(e);
-	}
+/**
+ * Input statistics, the latency is from reception until the listener
+ * has finished with the event.
+ */
+void CommonMidiInterface::printStatistics()
+{
+    for (MidiInput* in = mEnv->getInputs() ; in != NULL ; 
+         in = in->getNext()) {
 
-	events->free();
+		printf("MIDI input: %d dropped %d coalesced, latency max %ld average %ld (x100) msec\n",
+			   in->getDroppedEvents(),
+			   in->getCoalescedEvents(),
+			   in->getMaxLatency(),
+			   (long)(in->getAverageLatency() * 100));
+	}
+	fflush(stdout);
 }
 
 /**
@@ -525,6 +542,21 @@ void CommonMidiInterface::stopClocks()
 	}
 }
 
+/**
+ * Schedule the next MIDI clock at a time on the millisecond clock.
+ * Once clocks are being scheduled the timer stops deriving them
+ * from the tempo.
+ */
+bool CommonMidiInterface::scheduleClock(double millisecond)
+{
+	return mTimer->scheduleMidiClock(millisecond);
+}
+
+int CommonMidiInterface::getLateClocks()
+{
+	return mTimer->getLateClocks();
+}
+
 /**
  * Send StartSong and begin sending clocks.  
  * If we've already been sending clocks, timer must make sure the internal
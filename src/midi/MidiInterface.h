@@ -88,6 +88,8 @@ class MidiInterface {
 	virtual void midiContinue() = 0;
 	virtual void startClocks(float tempo) = 0;
 	virtual void stopClocks() = 0;
+	virtual bool scheduleClock(double millisecond) = 0;
+	virtual int getLateClocks() = 0;
 
 	// diagnostics
 
@@ -182,6 +182,23 @@ PUBLIC void MidiOutput::sendClock(void)
 	send(MS_CLOCK);
 }
 
+/**
+ * Sends a clock a fraction of a millisecond in the future.
+ * Used by MidiTimer when clocks are being scheduled.
+ */
+PUBLIC void MidiOutput::sendClock(float delay)
+{
+	sendDelayed(MS_CLOCK, delay);
+}
+
+/**
+ * Default implementation for devices that can't timestamp.
+ */
+PUBLIC void MidiOutput::sendDelayed(int msg, float delay)
+{
+	send(msg);
+}
+
 /**
  * Sends a song position.
  */
@@ -60,6 +60,7 @@ class MidiOutput {
     void sendStop(void);
     void sendContinue(void);
     void sendClock(void);
+    void sendClock(float delay);
     void sendSongPosition(int psn);
     void sendSongSelect(int song);
     void sendLocal(int channel, int onoff);
@@ -95,6 +96,13 @@ class MidiOutput {
      */
     virtual int sendSysex(const unsigned char *buffer, int length) = 0;
 
+    /**
+     * Send a message some number of milliseconds in the future.
+     * Only useful for devices that can timestamp, the default
+     * implementation sends it immediately.
+     */
+    virtual void sendDelayed(int msg, float delay);
+
 	//
 	// Diagnostics
 	//
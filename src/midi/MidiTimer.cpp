@@ -148,11 +148,48 @@ PUBLIC void MidiTimer::interrupt()
 		// necessary to do this now since we sometimes set tempo before 
 		// starting
 		setPendingTempo();
+
+		// anything scheduled before the restart is stale, the
+		// scheduler will start over relative to this clock
+		mScheduleTail = mScheduleHead;
 	}
 
-	// advance midi clock, ignore if not set up yet
-    // if we just sent START or CONTINUE do not advance yet
-	if (!restarted && mMidiMillisPerClock > 0.0) {
+	// If someone is scheduling clocks for us, send the ones that fall
+	// within this millisecond rather than counting ticks.  The fraction
+	// of a millisecond is passed along to outputs that can timestamp.
+	if (!restarted && isMidiClockScheduled()) {
+		while (mScheduleTail != mScheduleHead) {
+			double time = mSchedule[mScheduleTail];
+			if (time >= (double)(mMillis + 1))
+			  break;
+
+			float delay = (float)(time - (double)mMillis);
+			if (delay < 0.0f) {
+				// audio interrupt was late or the timer was
+				mLateClocks++;
+				delay = 0.0f;
+			}
+
+			if (mSendingClocks) {
+				if (mMidiSync)
+				  sendClock(delay);
+				if (mMidiClockListener != NULL)
+				  mMidiClockListener->midiClockEvent();
+				mMidiClocks++;
+			}
+
+			mScheduleTail++;
+			if (mScheduleTail >= TIMER_MAX_SCHEDULED_CLOCKS)
+			  mScheduleTail = 0;
+
+			// the tempo isn't used to generate clocks here but
+			// keep getTempo consistent
+			setPendingTempo();
+		}
+	}
+	else if (!restarted && mMidiMillisPerClock > 0.0) {
+		// advance midi clock, ignore if not set up yet
+		// if we just sent START or CONTINUE do not advance yet
 		mMidiTick += 1.0f;
 		if (mMidiTick >= mMidiMillisPerClock) {
 			// We're at or beyond the time to send a midi clock pulse
@@ -339,12 +376,20 @@ PUBLIC MidiTimer::MidiTimer(MidiEnv* env) {
 	mRestartTicks		= false;
 	mPendingTempo		= 0.0f;
 
+	mScheduleHead		= 0;
+	mScheduleTail		= 0;
+	mScheduleMillis		= -1;
+	for (int i = 0 ; i < TIMER_MAX_SCHEDULED_CLOCKS ; i++)
+	  mSchedule[i] = 0.0;
+
     // Interupt stats
 
     mEnabled            = true;
     mEntered            = false;
     mReentries          = 0;
     mOverflows          = 0;
+	mLateClocks			= 0;
+	mScheduleOverflows	= 0;
 
     clearRegisters();
 	resetMidiOutputs();
@@ -373,6 +418,12 @@ PUBLIC void MidiTimer::printWarnings()
 
 	if (mOverflows)
 	  printf("%d MidiTimer overflows!\n", mOverflows);
+
+	if (mLateClocks)
+	  printf("%d MidiTimer late scheduled clocks!\n", mLateClocks);
+
+	if (mScheduleOverflows)
+	  printf("%d MidiTimer clock schedule overflows!\n", mScheduleOverflows);
 }
 
 /**
@@ -557,6 +608,57 @@ PUBLIC bool MidiTimer::isSendingClocks()
 	return mSendingClocks;
 }
 
+/**
+ * Schedule a MIDI clock to be sent at a specific time on our millisecond
+ * clock.  The time may have a fractional component, outputs that support
+ * timestamps will use it to place the clock within the millisecond.
+ *
+ * This is intended to be called from the audio interrupt so that clocks
+ * follow the audio sample clock rather than our own notion of tempo, 
+ * which drifts.  While clocks are being scheduled the tempo no
+ * longer determines when clocks are sent, if the scheduling stops for
+ * longer than TIMER_SCHEDULE_TIMEOUT we go back to counting ticks.
+ *
+ * Clocks must be scheduled in order.  There is only one writer
+ * and one reader so the head and tail are not protected.
+ */
+PUBLIC bool MidiTimer::scheduleMidiClock(double millisecond)
+{
+	bool scheduled = false;
+
+	int next = mScheduleHead + 1;
+	if (next >= TIMER_MAX_SCHEDULED_CLOCKS)
+	  next = 0;
+
+	if (next == mScheduleTail) {
+		// timer interrupt must be stuck
+		mScheduleOverflows++;
+	}
+	else {
+		mSchedule[mScheduleHead] = millisecond;
+		mScheduleHead = next;
+		scheduled = true;
+	}
+
+	mScheduleMillis = mMillis;
+
+	return scheduled;
+}
+
+/**
+ * True if clocks are being sent from the schedule.
+ */
+PUBLIC bool MidiTimer::isMidiClockScheduled()
+{
+	return (mScheduleMillis >= 0 &&
+			(mMillis - mScheduleMillis) < TIMER_SCHEDULE_TIMEOUT);
+}
+
+PUBLIC int MidiTimer::getLateClocks()
+{
+	return mLateClocks;
+}
+
 /**
  * Send a MIDI StartSong event followed closely by a clock 
  * to make if official.  Spec says we're supposed to wait 1ms 
@@ -920,6 +1022,13 @@ PRIVATE void MidiTimer::sendClock()
 	}
 }
 
+PRIVATE void MidiTimer::sendClock(float delay)
+{
+	for (int i = 0 ; i < mMidiOutputCount ; i++) {
+		mMidiOutputs[i]->sendClock(delay);
+	}
+}
+
 PRIVATE void MidiTimer::sendStart()
 {
 	for (int i = 0 ; i < mMidiOutputCount ; i++) {
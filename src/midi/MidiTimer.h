@@ -28,6 +28,11 @@
  * The application just sets the tempo and MidiOutput device and the
  * Timer emits the clock events.
  *
+ * Alternately the application may schedule each MIDI clock itself
+ * with scheduleMidiClock, giving the time on our millisecond clock.
+ * This is how Mobius keeps the clocks locked to the audio stream,
+ * counting milliseconds will always drift relative to the sample clock.
+ *
  * The application receives notification of timer events by registering
  * a callback function and setting the user clock time at which it wants
  * to be called.  This is called the "signal clock".
@@ -99,6 +104,21 @@
  */
 #define TIMER_MAX_OUTPUTS 8
 
+/**
+ * The maximum number of MIDI clocks that may be scheduled in advance
+ * with scheduleMidiClock.  The audio interrupt schedules one block
+ * at a time so this only needs to hold a few blocks worth of clocks
+ * at the fastest tempo.
+ */
+#define TIMER_MAX_SCHEDULED_CLOCKS 64
+
+/**
+ * The number of milliseconds we will wait for scheduled clocks before
+ * deciding that whoever was scheduling them has gone away and we
+ * go back to generating clocks from the tempo.
+ */
+#define TIMER_SCHEDULE_TIMEOUT 100
+
 /**
  * A callback function that may be registered with the timer.
  * It will be called whenever the timer reaches a predefined "signal time".
@@ -168,6 +188,14 @@ class MidiTimer {
 	bool isMidiStarted();
 	bool isSendingClocks();
 
+	//
+	// Scheduled MIDI clocks
+	//
+
+	bool scheduleMidiClock(double millisecond);
+	bool isMidiClockScheduled();
+	int getLateClocks();
+
 	//
 	// Sequencer transport control
 	//
@@ -233,6 +261,7 @@ class MidiTimer {
 	void setTempoInternal(float tempo);
 
 	void sendClock();
+	void sendClock(float delay);
 	void sendStart();
 	void sendStop();
 	void sendContinue();
@@ -305,6 +334,17 @@ class MidiTimer {
 	bool    mRestartTicks;			// signal to interrupt to zero tick basis
 	float 	mPendingTempo;
 
+    //
+    // Clock schedule
+    // Filled from the head by the audio interrupt, consumed from the 
+    // tail by the timer interrupt.
+    //
+
+	double  mSchedule[TIMER_MAX_SCHEDULED_CLOCKS];
+	int     mScheduleHead;
+	int     mScheduleTail;
+	long    mScheduleMillis;		// millisecond of the last schedule
+
     //
     // Interrupt handler stats
     // These should all remain zero if things are working properly
@@ -314,6 +354,8 @@ class MidiTimer {
     bool    mEntered;               // true when in interrupt handler
 	int     mReentries;             // number of interrupt reentries
     int     mOverflows;             // number of missed callbacks
+	int     mLateClocks;            // scheduled clocks sent late
+	int     mScheduleOverflows;     // scheduled clocks dropped
 
 };
 
@@ -833,7 +833,7 @@ PUBLIC void WinMidiInput::processEventsReceived()
 		}
 
 		// notify the callback
-		if (mSysexProcessed == NULL && mEvents == NULL)
+		if (mSysexProcessed == NULL && !hasEvents())
 		  trace("WinMidiInput::processEventsReceived false alarm\n");
 
 		else if (mListener != NULL) {
@@ -139,6 +139,9 @@ PRIVATE void Sequencer::timerCallback(void)
 			if (debug_track_sweep)
 			  timer->setInterruptEnable(1);
 		}
+
+		// send everything the sweeps have staged for this clock
+		wheel->dispatch(now);
  
 		// Still going, see if there is a specific end clock set or if
 		// a deferred stop was requested.
@@ -154,11 +157,7 @@ PRIVATE void Sequencer::timerCallback(void)
 			// the next event, then we'll get signalled right away by the
 			// timer.
 
-			int nextclock = next_sweep_clock;
-			if (next_beat_clock < nextclock)
-			  nextclock = next_beat_clock;
-
-			timer->setNextSignalClock(nextclock);
+			timer->setNextSignalClock(getWakeClock());
 		}
 	}
 
@@ -809,7 +809,8 @@ PRIVATE void Sequencer::stopTracks(void)
  * SeqTrack::forceOff
  *
  * Arguments:
- *	e: event
+ *	    e: event
+ *	clock: absolute clock of the note on that replaces it
  *
  * Returns: none
  *
@@ -818,10 +819,14 @@ PRIVATE void Sequencer::stopTracks(void)
  * Force a note that was stacked on, off.
  * Used when a loop causes an event to be stacked again before
  * the first note off time was reached.
+ *
+ * The note off is staged in the timer wheel just ahead of the new
+ * note on, sending it now would cut the note short by up to one
+ * lookahead.
  * 
  ****************************************************************************/
 
-PRIVATE void SeqTrack::forceOff(MidiEvent *e)
+PRIVATE void SeqTrack::forceOff(MidiEvent *e, int clock)
 {
 	MidiEvent *o, *prev;
 	int ch;
@@ -836,7 +841,7 @@ PRIVATE void SeqTrack::forceOff(MidiEvent *e)
 		  prev->setStack(e->getStack());
 
 		ch = (channel < 0) ? e->getChannel() : channel;
-		out->sendNoteOff(ch, e->getKey());
+		sequencer->stageNoteOff(clock, out, ch, e->getKey());
 
 		// Inform the callback
 		processCallbacks(e, 0);
@@ -865,6 +870,11 @@ PRIVATE void SeqTrack::forceOff(MidiEvent *e)
  * As notes are played, they are added to the "on" list of the track
  * so they can be turned off later.
  *
+ * Events are not sent here, they are staged in the Sequencer's timer
+ * wheel at their absolute clock and sent when the timer reaches it.
+ * Since we're called up to one lookahead ahead of the timer the
+ * note callbacks fire slightly before the event is actually heard.
+ *
  * NOTE: 
  * Formerly, we would slam the track channel in each event before it
  * is sent in order to allow the track to override the channel that
@@ -877,18 +887,22 @@ PRIVATE void SeqTrack::forceOff(MidiEvent *e)
 PRIVATE void SeqTrack::sendEvents(int clock)
 {
 	MidiEvent *e, *o, *prev;
+	int abs_clock;
 
 	// send the events
 	for (e = events ; e != NULL && e->getClock() <= clock ; e = e->getNext()) {
 		if (!muted) {
+			// the wheel wants the absolute clock
+			abs_clock = e->getClock() + loop_adjust;
+
 			if (e->getStatus() != MS_NOTEON)
-			  out->send(e, channel);
+			  sequencer->stageEvent(abs_clock, out, e, channel);
 
 			else if (e->getDuration() == 0) {
 				// Duration is zero, drum note or unresolved record note.
 				// Send it but don't queue a note off event and don't 
 				// alert the callback.
-				out->send(e, channel);
+				sequencer->stageEvent(abs_clock, out, e, channel);
 			}
 			else {
 				// If this event has already been stacked and we're 
@@ -897,9 +911,9 @@ PRIVATE void SeqTrack::sendEvents(int clock)
 				// don't have any way to stack a note more than once.
 
 				if (e->getExtra())
-				  forceOff(e);
+				  forceOff(e, abs_clock);
 
-				out->send(e, channel);
+				sequencer->stageEvent(abs_clock, out, e, channel);
 
 				processCallbacks(e, 1);
 				
@@ -948,6 +962,10 @@ PRIVATE void SeqTrack::sendEvents(int clock)
  * The "off" time is stored in the value field for note events.
  * Note that the clock here is the absolute clock, not the normalized
  * track clock.
+ *
+ * The note offs are staged in the timer wheel at their off time
+ * like everything else, so the callbacks see them up to one lookahead
+ * early.
  * 
  ****************************************************************************/
 
@@ -960,7 +978,7 @@ PRIVATE void SeqTrack::endEvents(int clock)
 		nexte = e->getStack();
 
 		ch = (channel < 0) ? e->getChannel() : channel;
-		out->sendNoteOff(ch, e->getKey());
+		sequencer->stageNoteOff(e->getExtra(), out, ch, e->getKey());
 
 		processCallbacks(e, 0);
 
@@ -1041,6 +1059,77 @@ PUBLIC void SeqTrack::sweep(int clock)
 	sendEvents(tr_clock);
 }
 
+/****************************************************************************
+ * Sequencer::stageEvent
+ *
+ * Arguments:
+ *	clock: absolute clock to send on
+ *	  out: output device
+ *		e: event to send
+ *	channel: channel override
+ *
+ * Returns: none
+ *
+ * Description: 
+ * 
+ * Called by SeqTrack::sendEvents to put an event in the timer wheel.
+ * If the wheel is full, send it now rather than lose it.
+ ****************************************************************************/
+
+PRIVATE void Sequencer::stageEvent(int clock, MidiOut *out, MidiEvent *e,
+								   int channel)
+{
+	if (!wheel->schedule(clock, out, e, channel))
+	  out->send(e, channel);
+}
+
+/****************************************************************************
+ * Sequencer::stageNoteOff
+ *
+ * Arguments:
+ *	clock: absolute clock to send on
+ *	  out: output device
+ *	channel: channel
+ *	  key: key to turn off
+ *
+ * Returns: none
+ *
+ * Description: 
+ * 
+ * Called by SeqTrack::endEvents to put a note off in the timer wheel.
+ * If the wheel is full, send it now.
+ ****************************************************************************/
+
+PRIVATE void Sequencer::stageNoteOff(int clock, MidiOut *out, int channel,
+									 int key)
+{
+	if (!wheel->scheduleOff(clock, out, channel, key))
+	  out->sendNoteOff(channel, key);
+}
+
+/****************************************************************************
+ * Sequencer::getTrackSweepClock
+ *
+ * Arguments:
+ *	tr: track of interest
+ *
+ * Returns: timer clock on which the track needs to be swept
+ *
+ * Description: 
+ * 
+ * Tracks are swept "lookahead" clocks before their events are due.
+ ****************************************************************************/
+
+PRIVATE int Sequencer::getTrackSweepClock(SeqTrack *tr)
+{
+	int clock = tr->getNextClock();
+
+	if (clock != SEQ_CLOCK_INFINITE)
+	  clock -= lookahead;
+
+	return clock;
+}
+
 /****************************************************************************
  * Sequencer::sweepTracks
  *
@@ -1058,13 +1147,20 @@ PUBLIC void SeqTrack::sweep(int clock)
  * most of the clock calculations.  The nextclock returned from
  * this function will however have been de-normalized back into
  * an absolute clock.
+ *
+ * The tracks are swept "lookahead" clocks ahead of the timer and
+ * stage their events in the wheel, so the next clock for a track
+ * is when the timer needs to be that far behind it.
  * 
  ****************************************************************************/
 
 PRIVATE int Sequencer::sweepTracks(int clock)
 {
 	SeqTrack	*tr, *prev;
-	int 		nextclock, tr_nextclock;
+	int 		nextclock, tr_nextclock, sweep_clock;
+
+	// tracks are swept ahead of the timer, the events go in the wheel
+	sweep_clock = clock + lookahead;
 
 	// Check for various things during recording
 	nextclock = SEQ_CLOCK_INFINITE;
@@ -1109,8 +1205,8 @@ PRIVATE int Sequencer::sweepTracks(int clock)
 			// not disabled, process the track 
 			prev = tr;
 
-			tr->sweep(clock);
-			tr_nextclock = tr->getNextClock();
+			tr->sweep(sweep_clock);
+			tr_nextclock = getTrackSweepClock(tr);
 			
 			// maintain a running minimum for all tracks
 			if (tr_nextclock < nextclock)
@@ -1162,7 +1258,7 @@ PRIVATE int Sequencer::getFirstSweepClock(void)
 
 	// check each track
 	for (tr = playing ; tr != NULL ; tr = tr->getPlayLink()) {
-		tr_nextclock = tr->getNextClock();
+		tr_nextclock = getTrackSweepClock(tr);
 		if (tr_nextclock < nextclock)
 		  nextclock = tr_nextclock;
 	}
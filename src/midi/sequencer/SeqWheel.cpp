@@ -0,0 +1,523 @@
+/*
+ * Copyright (c) 2010 Jeffrey S. Larson  <jeff@circularlabs.com>
+ * All rights reserved.
+ * See the LICENSE file for the full copyright and license declaration.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Timer wheel for the sequencer.
+ *
+ * The track sweep runs a few milliseconds ahead of the timer and stages
+ * the events it finds here, the timer interrupt then dispatches
+ * everything that is due in one pass.  This keeps the per-track work
+ * out of the tight timing path, and lets us sleep until the next
+ * clock that actually has something on it.
+ *
+ */
+
+#include <stdio.h>
+#include <math.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#include "port.h"
+
+#include "MidiEnv.h"
+#include "Sequencer.h"
+
+/****************************************************************************
+ *                                                                          *
+ *   							  CONSTRUCTION                              *
+ *                                                                          *
+ ****************************************************************************/
+
+PUBLIC SeqWheel::SeqWheel(void)
+{
+	int i;
+
+	mEntries = new SeqWheelEntry[SEQ_WHEEL_ENTRIES];
+	mPool = NULL;
+	for (i = SEQ_WHEEL_ENTRIES - 1 ; i >= 0 ; i--) {
+		mEntries[i].next = mPool;
+		mPool = &mEntries[i];
+	}
+
+	for (i = 0 ; i < SEQ_WHEEL_SLOTS ; i++) {
+		mSlots[i] = NULL;
+		mSlotTails[i] = NULL;
+		mGroups[i] = NULL;
+		mGroupTails[i] = NULL;
+	}
+	mOverflow = NULL;
+	mClock = 0;
+	mCount = 0;
+	mTiming = 0;
+	mTimingClock = 0;
+	mTimingStart = 0.0;
+	mMsecPerClock = 0.0;
+
+	resetStatistics();
+}
+
+PUBLIC SeqWheel::~SeqWheel(void)
+{
+	delete[] mEntries;
+}
+
+PUBLIC void SeqWheel::resetStatistics(void)
+{
+	mDispatched = 0;
+	mBatches = 0;
+	mTotalLate = 0;
+	mMaxLate = 0;
+	mOverflows = 0;
+	mTimed = 0;
+	mTotalLateMsec = 0.0;
+	mTotalLateSquares = 0.0;
+	mMinLateMsec = 0.0;
+	mMaxLateMsec = 0.0;
+}
+
+/****************************************************************************
+ *                                                                          *
+ *   								TIMING                                  *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Milliseconds from the high resolution clock, with the fraction.
+ * The multimedia timer the sequencer runs on only has milliseconds.
+ */
+PRIVATE double getTimingMsec(void)
+{
+#ifdef _WIN32
+	static double ticksPerMsec = 0.0;
+	LARGE_INTEGER count;
+
+	if (ticksPerMsec == 0.0) {
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency(&freq);
+		ticksPerMsec = (double)freq.QuadPart / 1000.0;
+	}
+	QueryPerformanceCounter(&count);
+	return (double)count.QuadPart / ticksPerMsec;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return ((double)tv.tv_sec * 1000.0) + ((double)tv.tv_usec / 1000.0);
+#endif
+}
+
+/**
+ * Start timing sends, the given clock is due now.
+ */
+PUBLIC void SeqWheel::startTiming(int clock, float msecPerClock)
+{
+	mTimingClock = clock;
+	mMsecPerClock = msecPerClock;
+	mTimingStart = getTimingMsec();
+	mTiming = 1;
+}
+
+PUBLIC void SeqWheel::stopTiming(void)
+{
+	mTiming = 0;
+}
+
+PUBLIC double SeqWheel::getAverageLateMsec(void)
+{
+	return (mTimed > 0) ? (mTotalLateMsec / mTimed) : 0.0;
+}
+
+/**
+ * Standard deviation of the lateness.
+ */
+PUBLIC double SeqWheel::getJitterMsec(void)
+{
+	double jitter = 0.0;
+	if (mTimed > 0) {
+		double avg = mTotalLateMsec / mTimed;
+		double var = (mTotalLateSquares / mTimed) - (avg * avg);
+		if (var > 0.0)
+		  jitter = sqrt(var);
+	}
+	return jitter;
+}
+
+/**
+ * Called just after an entry is sent.
+ */
+PRIVATE void SeqWheel::time(SeqWheelEntry *e)
+{
+	double due = mTimingStart + 
+		((e->clock - mTimingClock) * mMsecPerClock);
+	double late = getTimingMsec() - due;
+
+	if (mTimed == 0 || late < mMinLateMsec)
+	  mMinLateMsec = late;
+	if (mTimed == 0 || late > mMaxLateMsec)
+	  mMaxLateMsec = late;
+	mTotalLateMsec += late;
+	mTotalLateSquares += late * late;
+	mTimed++;
+}
+
+/**
+ * Position the wheel at a new clock.
+ * Anything still scheduled is discarded, call flush first if you
+ * care about hanging notes.
+ */
+PUBLIC void SeqWheel::reset(int clock)
+{
+	if (mCount > 0)
+	  flush();
+	mClock = clock;
+}
+
+/****************************************************************************
+ *                                                                          *
+ *   							  SCHEDULING                                *
+ *                                                                          *
+ ****************************************************************************/
+
+PRIVATE SeqWheelEntry *SeqWheel::allocEntry(int clock)
+{
+	SeqWheelEntry *e = mPool;
+
+	if (e == NULL)
+	  mOverflows++;
+	else {
+		mPool = e->next;
+		e->next = NULL;
+		e->clock = clock;
+		e->out = NULL;
+		e->event = NULL;
+		e->channel = 0;
+		e->key = 0;
+	}
+	return e;
+}
+
+PRIVATE void SeqWheel::freeEntry(SeqWheelEntry *e)
+{
+	e->event = NULL;
+	e->out = NULL;
+	e->next = mPool;
+	mPool = e;
+}
+
+/**
+ * Schedule an event to be sent on the given clock.
+ * Returns zero if we ran out of entries, the caller is expected to
+ * send it immediately instead.
+ */
+PUBLIC int SeqWheel::schedule(int clock, MidiOut *out, MidiEvent *event,
+							  int channel)
+{
+	SeqWheelEntry *e = allocEntry(clock);
+	if (e != NULL) {
+		e->out = out;
+		e->event = event;
+		e->channel = channel;
+		insert(e);
+	}
+	return (e != NULL);
+}
+
+/**
+ * Schedule a note off.  These are kept separate from the events
+ * so we can send them when the sequencer stops, even if their
+ * clock has not arrived.
+ */
+PUBLIC int SeqWheel::scheduleOff(int clock, MidiOut *out, int channel,
+								 int key)
+{
+	SeqWheelEntry *e = allocEntry(clock);
+	if (e != NULL) {
+		e->out = out;
+		e->channel = channel;
+		e->key = key;
+		insert(e);
+	}
+	return (e != NULL);
+}
+
+PRIVATE void SeqWheel::append(SeqWheelEntry **heads, SeqWheelEntry **tails,
+							  int slot, SeqWheelEntry *e)
+{
+	e->next = NULL;
+	if (tails[slot] == NULL)
+	  heads[slot] = e;
+	else
+	  tails[slot]->next = e;
+	tails[slot] = e;
+}
+
+/**
+ * Put an entry in the right level.  The first level only holds
+ * clocks in the current group of SEQ_WHEEL_SLOTS, the second level only
+ * the groups in the current cycle.  Because of this a slot will never
+ * contain entries for two different clocks and the entries cascaded down
+ * from the second level always land in empty slots, so events on
+ * the same clock stay in the order they were scheduled.
+ *
+ * Events whose clock has already passed go on the current slot
+ * and will be sent on the next dispatch.
+ */
+PRIVATE void SeqWheel::insert(SeqWheelEntry *e)
+{
+	int clock = e->clock;
+
+	if (clock < mClock)
+	  clock = mClock;
+
+	if ((clock >> SEQ_WHEEL_BITS) == (mClock >> SEQ_WHEEL_BITS))
+	  append(mSlots, mSlotTails, clock & SEQ_WHEEL_MASK, e);
+
+	else if ((clock >> (SEQ_WHEEL_BITS * 2)) ==
+			 (mClock >> (SEQ_WHEEL_BITS * 2)))
+	  append(mGroups, mGroupTails,
+			 (clock >> SEQ_WHEEL_BITS) & SEQ_WHEEL_MASK, e);
+
+	else {
+		// pushed in reverse, cascade puts them back in order
+		e->next = mOverflow;
+		mOverflow = e;
+	}
+
+	mCount++;
+}
+
+/**
+ * Called as soon as the clock enters a new group, move the entries for
+ * this group down to the first level.  At the start of a new cycle
+ * the overflow list is redistributed first.
+ */
+PRIVATE void SeqWheel::cascade(void)
+{
+	SeqWheelEntry *e, *next, *list;
+	int group = (mClock >> SEQ_WHEEL_BITS) & SEQ_WHEEL_MASK;
+
+	if (group == 0 && mOverflow != NULL) {
+		list = NULL;
+		for (e = mOverflow ; e != NULL ; e = next) {
+			next = e->next;
+			e->next = list;
+			list = e;
+		}
+		mOverflow = NULL;
+		for (e = list ; e != NULL ; e = next) {
+			next = e->next;
+			mCount--;
+			insert(e);
+		}
+	}
+
+	e = mGroups[group];
+	mGroups[group] = NULL;
+	mGroupTails[group] = NULL;
+	for ( ; e != NULL ; e = next) {
+		next = e->next;
+		mCount--;
+		insert(e);
+	}
+}
+
+/****************************************************************************
+ *                                                                          *
+ *   							  DISPATCHING                               *
+ *                                                                          *
+ ****************************************************************************/
+
+PRIVATE void SeqWheel::send(SeqWheelEntry *e)
+{
+	if (e->event != NULL)
+	  e->out->send(e->event, e->channel);
+	else
+	  e->out->sendNoteOff(e->channel, e->key);
+}
+
+/**
+ * Send everything scheduled on or before the given clock.
+ * Returns the number of events sent.
+ */
+PUBLIC int SeqWheel::dispatch(int clock)
+{
+	SeqWheelEntry *e, *next;
+	int slot, late;
+	int sent = 0;
+
+	if (mCount == 0) {
+		// nothing to cascade, jump ahead
+		if (clock >= mClock)
+		  mClock = clock + 1;
+		return 0;
+	}
+
+	while (mClock <= clock) {
+
+		slot = mClock & SEQ_WHEEL_MASK;
+		e = mSlots[slot];
+		mSlots[slot] = NULL;
+		mSlotTails[slot] = NULL;
+		for ( ; e != NULL ; e = next) {
+			next = e->next;
+			send(e);
+			if (mTiming)
+			  time(e);
+
+			late = clock - e->clock;
+			mTotalLate += late;
+			if (late > mMaxLate)
+			  mMaxLate = late;
+
+			freeEntry(e);
+			mCount--;
+			sent++;
+		}
+
+		mClock++;
+
+		if (mCount == 0) {
+			if (mClock <= clock)
+			  mClock = clock + 1;
+			break;
+		}
+
+		// keep the first level holding the current group
+		if ((mClock & SEQ_WHEEL_MASK) == 0)
+		  cascade();
+	}
+
+	if (sent > 0) {
+		mDispatched += sent;
+		mBatches++;
+	}
+
+	return sent;
+}
+
+/**
+ * Return the next clock that needs a dispatch.  This is either the
+ * next occupied slot in the current group, or the start of the next
+ * group if we have to cascade.
+ */
+PUBLIC int SeqWheel::getNextClock(void)
+{
+	int clock, end;
+
+	if (mCount == 0)
+	  return SEQ_CLOCK_INFINITE;
+
+	end = ((mClock >> SEQ_WHEEL_BITS) + 1) << SEQ_WHEEL_BITS;
+	for (clock = mClock ; clock < end ; clock++) {
+		if (mSlots[clock & SEQ_WHEEL_MASK] != NULL)
+		  return clock;
+	}
+	return end;
+}
+
+/**
+ * Called when the sequencer stops.  Note ons that are still waiting are
+ * thrown away along with their note offs if those are waiting too.
+ * The remaining note offs belong to notes that are already sounding and
+ * are sent now so nothing hangs, everything else is thrown away.
+ * Notes whose offs haven't been staged yet are still on the track's "on"
+ * list and are turned off by SeqTrack::flushOn.
+ */
+PUBLIC void SeqWheel::flush(void)
+{
+	SeqWheelEntry *e, *o, *next, *list;
+	int i;
+
+	// gather everything in clock order
+	list = NULL;
+	for (i = 0 ; i < SEQ_WHEEL_SLOTS ; i++) {
+		gather(&list, mSlots[i]);
+		mSlots[i] = NULL;
+		mSlotTails[i] = NULL;
+		gather(&list, mGroups[i]);
+		mGroups[i] = NULL;
+		mGroupTails[i] = NULL;
+	}
+	// the overflow list is in reverse
+	for (e = mOverflow, o = NULL ; e != NULL ; e = next) {
+		next = e->next;
+		e->next = o;
+		o = e;
+	}
+	gather(&list, o);
+	mOverflow = NULL;
+
+	// a note on that was never sent cancels the first off that follows it
+	for (e = list ; e != NULL ; e = e->next) {
+		if (isNoteOn(e)) {
+			for (o = e->next ; o != NULL ; o = o->next) {
+				if (o->event == NULL && o->out == e->out && 
+					o->key == e->event->getKey() &&
+					o->channel == getChannel(e)) {
+					o->out = NULL;
+					break;
+				}
+			}
+		}
+	}
+
+	for (e = list ; e != NULL ; e = next) {
+		next = e->next;
+		if (e->event == NULL && e->out != NULL)
+		  send(e);
+		freeEntry(e);
+	}
+
+	mCount = 0;
+}
+
+/**
+ * Merge a chain of entries into a list ordered by clock.
+ * Entries on the same clock stay in the order they were scheduled.
+ * Only used by flush so it doesn't have to be fast.
+ */
+PRIVATE void SeqWheel::gather(SeqWheelEntry **list, SeqWheelEntry *chain)
+{
+	SeqWheelEntry *e, *next, *prev, *o;
+
+	for (e = chain ; e != NULL ; e = next) {
+		next = e->next;
+		for (o = *list, prev = NULL ; o != NULL && o->clock <= e->clock ;
+			 o = o->next)
+		  prev = o;
+		e->next = o;
+		if (prev == NULL)
+		  *list = e;
+		else
+		  prev->next = e;
+	}
+}
+
+/**
+ * True if this is a note on that will have an off staged for it.
+ * Zero duration notes never get one.
+ */
+PRIVATE int SeqWheel::isNoteOn(SeqWheelEntry *e)
+{
+	return (e->event != NULL && e->event->getStatus() == MS_NOTEON &&
+			e->event->getDuration() > 0);
+}
+
+/**
+ * The channel a staged event will go out on, the same way
+ * SeqTrack resolves the channel for its note offs.
+ */
+PRIVATE int SeqWheel::getChannel(SeqWheelEntry *e)
+{
+	return (e->channel < 0) ? e->event->getChannel() : e->channel;
+}
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
@@ -335,6 +335,8 @@ PRIVATE Sequencer::Sequencer()
 	next_beat_clock 	= 0;
 	next_sweep_clock 	= 0;
 	debug_track_sweep	= 1;
+	wheel				= NULL;
+	lookahead			= 1;
 
 	_echoInput			= NULL;
 	_sysexInput			= NULL;
@@ -384,6 +386,9 @@ INTERFACE Sequencer *Sequencer::create(SeqModule *mod)
 		s->metronome = new SeqMetronome;
 		s->metronome->init();
 
+		// output events are staged here by the track sweep
+		s->wheel = new SeqWheel;
+
 		// We Always have a timer & default IO device objects, though they
 		// may not always be active.
 
@@ -455,6 +460,7 @@ INTERFACE Sequencer::~Sequencer(void)
 	delete recording;
 	delete tracks;
 	delete metronome;
+	delete wheel;
 
 	delete timer;
 
@@ -714,6 +720,15 @@ PRIVATE void Sequencer::clockKickoff(void)
 
 	now = timer->getClock();
 
+	// Convert the sweep lookahead to clocks, at high tempos and
+	// resolutions this can be several clocks, never less than one.
+	lookahead = (int)((getTempo() * getResolution() * SEQ_LOOKAHEAD_MSEC) / 
+					  60000.0f);
+	if (lookahead < 1)
+	  lookahead = 1;
+
+	wheel->reset(now);
+
 	// determine the next time the tracks need attention
 	next_sweep_clock = getFirstSweepClock();
 
@@ -725,15 +740,15 @@ PRIVATE void Sequencer::clockKickoff(void)
 	else
 	  next_beat_clock = now + beat;
 
-	// take the smaller of the two important event times
-	nextclock = umin(next_sweep_clock, next_beat_clock);
+	// take the smaller of the important event times
+	nextclock = getWakeClock();
 
 	// If the current time is AFTER the time in which we needed to 
 	// do something call the timer callback as if we got a timer interrupt.
 
 	if (now >= nextclock) {
 		timerCallback();
-		nextclock = umin(next_sweep_clock, next_beat_clock);
+		nextclock = getWakeClock();
 	}
 
 	// If the callback turned the clock off, stop now, not sure under
@@ -744,6 +759,29 @@ PRIVATE void Sequencer::clockKickoff(void)
 	}
 }
 
+/****************************************************************************
+ * Sequencer::getWakeClock
+ *
+ * Arguments:
+ *
+ * Returns: next clock the timer needs to signal us
+ *
+ * Description: 
+ * 
+ * The earliest of the next beat, the next time the tracks need to 
+ * be swept, and the next event waiting in the wheel.
+ ****************************************************************************/
+
+PRIVATE int Sequencer::getWakeClock(void)
+{
+	int nextclock;
+
+	nextclock = umin(next_sweep_clock, next_beat_clock);
+	nextclock = umin(nextclock, wheel->getNextClock());
+
+	return nextclock;
+}
+
 /****************************************************************************
  * Sequencer::startInternal
  *
@@ -882,6 +920,9 @@ PRIVATE void Sequencer::stopInternal(int do_callback)
 			if (_inputs[_defaultInput] != NULL)
 			  _inputs[_defaultInput]->disable();
 
+			// send the note offs that were staged but not yet due
+			wheel->flush();
+
 			// clear up any run time state kept by the track sweeper
 			stopTracks();
 
@@ -370,6 +370,158 @@ class SeqMetronome {
 
 };
 
+/****************************************************************************
+ *                                                                          *
+ *   							 TIMER WHEEL                                *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Number of slots in each level of the timer wheel.
+ * Must be a power of two.
+ */
+#define SEQ_WHEEL_SLOTS 256
+#define SEQ_WHEEL_BITS 8
+#define SEQ_WHEEL_MASK (SEQ_WHEEL_SLOTS - 1)
+
+/**
+ * Number of entries preallocated for the timer wheel.  We're in the
+ * timer interrupt so we can't allocate more, if this runs out events
+ * are sent immediately rather than scheduled.
+ */
+#define SEQ_WHEEL_ENTRIES 4096
+
+/**
+ * How far ahead of the clock the tracks are swept, in milliseconds.
+ * Converted to clocks using the tempo when the sequencer starts.
+ */
+#define SEQ_LOOKAHEAD_MSEC 5
+
+/**
+ * An output event waiting in the timer wheel.
+ */
+class SeqWheelEntry {
+
+  public:
+
+	SeqWheelEntry *next;
+	int clock;
+	class MidiOut *out;
+	MidiEvent *event;		// NULL for a note off
+	int channel;
+	int key;				// for note off
+};
+
+/**
+ * A two level timer wheel holding output events staged by the track
+ * sweep until their clock arrives.
+ *
+ * The first level has a slot for each of the next SEQ_WHEEL_SLOTS clocks,
+ * the second has a slot for each of the next SEQ_WHEEL_SLOTS groups of
+ * SEQ_WHEEL_SLOTS clocks and is cascaded into the first as the clock
+ * advances.  Anything further out than that goes on an overflow list
+ * that is checked whenever the second level wraps.  Scheduling and 
+ * dispatching are constant time, tracks are only swept when they
+ * have something to stage rather than on every tick.
+ */
+class SeqWheel {
+
+  public:
+
+	INTERFACE SeqWheel(void);
+	INTERFACE ~SeqWheel(void);
+
+	void reset(int clock);
+	int schedule(int clock, class MidiOut *out, MidiEvent *e, int channel);
+	int scheduleOff(int clock, class MidiOut *out, int channel, int key);
+	int dispatch(int clock);
+	void flush(void);
+	int getNextClock(void);
+
+	//
+	// dispatch statistics, lateness is in clocks
+	//
+
+	INTERFACE void resetStatistics(void);
+
+	// Optional timing of each send against the time its clock was
+	// due, in milliseconds.  Clock lateness only shows whole clocks,
+	// this shows the jitter within one.  Assumes the tempo doesn't
+	// change while we're timing.
+	INTERFACE void startTiming(int clock, float msecPerClock);
+	INTERFACE void stopTiming(void);
+	INTERFACE double getAverageLateMsec(void);
+	INTERFACE double getJitterMsec(void);
+
+	int getTimed(void) {
+		return mTimed;
+	}
+	double getMinLateMsec(void) {
+		return mMinLateMsec;
+	}
+	double getMaxLateMsec(void) {
+		return mMaxLateMsec;
+	}
+
+	int getDispatched(void) {
+		return mDispatched;
+	}
+	int getBatches(void) {
+		return mBatches;
+	}
+	int getTotalLate(void) {
+		return mTotalLate;
+	}
+	int getMaxLate(void) {
+		return mMaxLate;
+	}
+	int getOverflows(void) {
+		return mOverflows;
+	}
+
+  private:
+
+	SeqWheelEntry *allocEntry(int clock);
+	void insert(SeqWheelEntry *e);
+	void append(SeqWheelEntry **heads, SeqWheelEntry **tails, int slot,
+				SeqWheelEntry *e);
+	void cascade(void);
+	void send(SeqWheelEntry *e);
+	void freeEntry(SeqWheelEntry *e);
+	void gather(SeqWheelEntry **list, SeqWheelEntry *chain);
+	int isNoteOn(SeqWheelEntry *e);
+	int getChannel(SeqWheelEntry *e);
+	void time(SeqWheelEntry *e);
+
+	SeqWheelEntry	*mEntries;		// preallocated block
+	SeqWheelEntry	*mPool;			// free entries
+
+	SeqWheelEntry	*mSlots[SEQ_WHEEL_SLOTS];
+	SeqWheelEntry	*mSlotTails[SEQ_WHEEL_SLOTS];
+	SeqWheelEntry	*mGroups[SEQ_WHEEL_SLOTS];
+	SeqWheelEntry	*mGroupTails[SEQ_WHEEL_SLOTS];
+	SeqWheelEntry	*mOverflow;
+
+	int				mClock;			// next clock to dispatch
+	int				mCount;			// entries scheduled
+
+	int				mDispatched;
+	int				mBatches;
+	int				mTotalLate;
+	int				mMaxLate;
+	int				mOverflows;
+
+	int				mTiming;		// non-zero to time each send
+	int				mTimingClock;	// clock that was due at mTimingStart
+	double			mTimingStart;	// milliseconds
+	double			mMsecPerClock;
+	int				mTimed;
+	double			mTotalLateMsec;
+	double			mTotalLateSquares;
+	double			mMinLateMsec;
+	double			mMaxLateMsec;
+};
+
 /****************************************************************************
  *                                                                          *
  *                                 SEQUENCER                                *
@@ -670,6 +822,11 @@ class Sequencer {
 		return metronome;
 	}
 
+	// output scheduler, mostly for the dispatch statistics
+	class SeqWheel *getWheel(void) {
+		return wheel;
+	}
+
 	// optional start/stop clocks
 	
 	int getStartClock(void) {
@@ -822,6 +979,8 @@ class Sequencer {
 	int 			next_beat_clock;	// time when next beat occurs
 	int 			next_sweep_clock;	// time when tracks need attention
 	int				debug_track_sweep;	// set when debugging interrupts
+	class SeqWheel	*wheel;				// output events waiting for their clock
+	int				lookahead;			// clocks to sweep ahead of the timer
 
 	//////////////////////////////////////////////////////////////////////
 	//
@@ -843,6 +1002,7 @@ class Sequencer {
 	void enterCriticalSection(void);
 	void leaveCriticalSection(void);
 	void addEvent(SeqEventType t, int clock, int duration, int value);
+	int getWakeClock(void);
 
 	//
 	// track.cxx
@@ -852,6 +1012,9 @@ class Sequencer {
 	int  sweepTracks(int clock);
 	void stopTracks(void);
 	int  getFirstSweepClock(void);
+	int  getTrackSweepClock(class SeqTrack *tr);
+	void stageEvent(int clock, class MidiOut *out, MidiEvent *e, int channel);
+	void stageNoteOff(int clock, class MidiOut *out, int channel, int key);
 
 	//
 	// seqint.cxx
@@ -1088,7 +1251,7 @@ class SeqTrack {
 	void doLoop(void);
 	void flushOn(void);
 	void centerControllers(void);
-	void forceOff(MidiEvent *e);
+	void forceOff(MidiEvent *e, int clock);
 	void sendEvents(int clock);
 	void endEvents(int clock);
 
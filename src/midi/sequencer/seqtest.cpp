@@ -307,6 +307,85 @@ void setupRecordTest(Sequencer *s)
 	s->setLoopEndEnable(1);
 }
 
+/****************************************************************************
+ *                                                                          *
+ *   							  BENCHMARK                                 *
+ *                                                                          *
+ ****************************************************************************/
+/*
+ * Dense playback to measure how the timer wheel keeps up.
+ * Every track has a one clock note on every clock, at 120 BPM that's
+ * a little over 3000 notes a second, plus their note offs.
+ * Lateness is the time each event was sent relative to the time its
+ * clock was due, measured with the high resolution clock.  Jitter is
+ * the standard deviation of that, a constant offset from when the
+ * timer started counting only shows up in the average.  The clock
+ * lateness is also shown, it only catches events that slipped a 
+ * whole clock or more.
+ */
+
+#define BENCH_TRACKS 16
+#define BENCH_SECONDS 10
+
+void runBenchmark(Sequencer *s)
+{
+	MidiSequence *ms;
+	MidiEvent *e;
+	SeqWheel *wheel;
+	int tr, clock, clocks, dispatched;
+	float msecPerClock;
+
+	s->stop();
+	s->clearTracks();
+
+	clocks = (int)((s->getTempo() * CPB * BENCH_SECONDS) / 60.0f);
+
+	for (tr = 0 ; tr < BENCH_TRACKS ; tr++) {
+		ms = s->newSequence();
+		for (clock = 0 ; clock < clocks ; clock++) {
+			e = s->newEvent(MS_NOTEON, tr, 36 + (clock % 48), 80);
+			e->setClock(clock);
+			e->setDuration(1);
+			ms->insert(e);
+		}
+		s->addSequence(ms);
+	}
+
+	printf("benchmark: %d tracks, %d clocks, %d seconds\n", 
+		   BENCH_TRACKS, clocks, BENCH_SECONDS);
+
+	wheel = s->getWheel();
+	wheel->resetStatistics();
+
+	msecPerClock = 60000.0f / (s->getTempo() * s->getResolution());
+
+	s->setClock(0);
+	wheel->startTiming(0, msecPerClock);
+	s->start();
+	Sleep(BENCH_SECONDS * 1000 + 500);
+	s->stop();
+	wheel->stopTiming();
+
+	dispatched = wheel->getDispatched();
+
+	printf("dispatched %d events in %d batches\n", dispatched, 
+		   wheel->getBatches());
+	if (wheel->getTimed() > 0) {
+		printf("lateness: average %.3f ms, min %.3f ms, max %.3f ms, jitter %.3f ms\n",
+			   wheel->getAverageLateMsec(), wheel->getMinLateMsec(),
+			   wheel->getMaxLateMsec(), wheel->getJitterMsec());
+	}
+	if (dispatched > 0) {
+		float avg = (float)wheel->getTotalLate() / (float)dispatched;
+		printf("clock lateness: average %.3f clocks, max %d clocks\n",
+			   avg, wheel->getMaxLate());
+	}
+	if (wheel->getOverflows() > 0)
+	  printf("wheel overflows: %d\n", wheel->getOverflows());
+
+	s->clearTracks();
+}
+
 /****************************************************************************
  *                                                                          *
  *   								 MAIN                                   *
@@ -328,6 +407,7 @@ void usage(void)
 	printf("    tp         setup play test\n");
 	printf("    tl         setup loop test\n");
 	printf("    tr         setup record test\n");
+	printf("    b          run playback benchmark\n");
 	printf("\n");
 }
 
@@ -452,6 +532,9 @@ int main(int argc, char *argv[])
 		else if (!strcmp(cmd, "tr"))
 		  setupRecordTest(seq);
 
+		else if (!strcmp(cmd, "b"))
+		  runBenchmark(seq);
+
 		else
 		  usage();
 	}
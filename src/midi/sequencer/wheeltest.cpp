@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2010 Jeffrey S. Larson  <jeff@circularlabs.com>
+ * All rights reserved.
+ * See the LICENSE file for the full copyright and license declaration.
+ *
+ * ---------------------------------------------------------------------
+ *
+ *  SeqWheel test
+ *
+ * Checks the dispatch order of the timer wheel and the note off
+ * pairing done by flush when the sequencer stops.  This doesn't need
+ * a device, SeqWheel only calls send and sendNoteOff so we link it by
+ * itself with a MidiOut that remembers what was sent.  Exits with
+ * a non-zero status if anything failed.
+ *
+ */
+
+#include <stdio.h>
+
+#include "port.h"
+#include "MidiEvent.h"
+#include "Sequencer.h"
+
+/****************************************************************************
+ *                                                                          *
+ *   							 RECORDING OUT                              *
+ *                                                                          *
+ ****************************************************************************/
+
+#define MAX_SENT 64
+
+typedef struct {
+	int on;
+	int channel;
+	int key;
+} SENT;
+
+SENT Sent[MAX_SENT];
+int SentCount = 0;
+
+class MidiOut {
+  public:
+	void send(MidiEvent *e, int channel);
+	void sendNoteOff(int channel, int key);
+};
+
+void MidiOut::send(MidiEvent *e, int channel)
+{
+	if (SentCount < MAX_SENT) {
+		Sent[SentCount].on = 1;
+		Sent[SentCount].channel = (channel < 0) ? e->getChannel() : channel;
+		Sent[SentCount].key = e->getKey();
+		SentCount++;
+	}
+}
+
+void MidiOut::sendNoteOff(int channel, int key)
+{
+	if (SentCount < MAX_SENT) {
+		Sent[SentCount].on = 0;
+		Sent[SentCount].channel = channel;
+		Sent[SentCount].key = key;
+		SentCount++;
+	}
+}
+
+/****************************************************************************
+ *                                                                          *
+ *   								CHECKS                                  *
+ *                                                                          *
+ ****************************************************************************/
+
+int Failures = 0;
+
+/**
+ * Compare what was sent since the last check with what we expected.
+ * The expected list is on/key pairs, all on channel 1.
+ */
+void check(const char *name, int *expected, int count)
+{
+	int i;
+	int ok = (SentCount == count);
+
+	for (i = 0 ; ok && i < count ; i++) {
+		if (Sent[i].on != expected[i * 2] ||
+			Sent[i].key != expected[(i * 2) + 1] ||
+			Sent[i].channel != 1)
+		  ok = 0;
+	}
+
+	if (ok)
+	  printf("%s: ok\n", name);
+	else {
+		printf("%s: FAILED, sent", name);
+		for (i = 0 ; i < SentCount ; i++)
+		  printf(" %s %d", (Sent[i].on ? "on" : "off"), Sent[i].key);
+		printf("\n");
+		Failures++;
+	}
+
+	SentCount = 0;
+}
+
+void initNote(MidiEvent *e, int key)
+{
+	e->setStatus(MS_NOTEON);
+	e->setChannel(1);
+	e->setKey(key);
+	e->setVelocity(80);
+	e->setDuration(10);
+}
+
+/**
+ * Events on the same clock go out in the order they were scheduled,
+ * including the ones cascaded down from the second level and the
+ * overflow list.
+ */
+void testOrder(void)
+{
+	SeqWheel wheel;
+	MidiOut out;
+	MidiEvent a, b, c;
+	int clock;
+
+	initNote(&a, 60);
+	initNote(&b, 62);
+	initNote(&c, 64);
+	wheel.reset(0);
+
+	wheel.schedule(3, &out, &b, -1);
+	wheel.schedule(3, &out, &a, -1);
+	wheel.scheduleOff(300, &out, 1, 62);
+	wheel.schedule(300, &out, &c, -1);
+	wheel.schedule(70000, &out, &a, -1);
+	wheel.scheduleOff(70000, &out, 1, 60);
+
+	wheel.dispatch(3);
+	int first[] = {1, 62, 1, 60};
+	check("same clock", first, 2);
+
+	wheel.dispatch(299);
+	check("nothing early", NULL, 0);
+
+	wheel.dispatch(300);
+	int second[] = {0, 62, 1, 64};
+	check("second level", second, 2);
+
+	// walk it so the overflow list is cascaded the way the timer would
+	for (clock = wheel.getNextClock() ; clock < 70000 ;
+		 clock = wheel.getNextClock())
+	  wheel.dispatch(clock);
+	check("overflow early", NULL, 0);
+
+	wheel.dispatch(70000);
+	int third[] = {1, 60, 0, 60};
+	check("overflow", third, 2);
+}
+
+/**
+ * When we stop, offs for notes that were sent go out, offs for
+ * notes that were never sent are dropped along with their note on.
+ */
+void testFlush(void)
+{
+	SeqWheel wheel;
+	MidiOut out;
+	MidiEvent a, b;
+
+	initNote(&a, 60);
+	initNote(&b, 62);
+	wheel.reset(0);
+
+	// sent, its off is waiting
+	wheel.schedule(1, &out, &a, -1);
+	wheel.scheduleOff(11, &out, 1, 60);
+
+	// never sent, neither is its off
+	wheel.schedule(5, &out, &b, -1);
+	wheel.scheduleOff(15, &out, 1, 62);
+
+	// a forced off for the first note ahead of a note on that reuses
+	// the key on the same clock, out in the second level
+	wheel.scheduleOff(300, &out, 1, 60);
+	wheel.schedule(300, &out, &a, -1);
+
+	// a pair on the overflow list
+	wheel.schedule(70000, &out, &b, -1);
+	wheel.scheduleOff(70010, &out, 1, 62);
+
+	wheel.dispatch(2);
+	int sent[] = {1, 60};
+	check("before flush", sent, 1);
+
+	wheel.flush();
+	int flushed[] = {0, 60, 0, 60};
+	check("flush", flushed, 2);
+
+	wheel.dispatch(80000);
+	check("empty after flush", NULL, 0);
+}
+
+/****************************************************************************
+ *                                                                          *
+ *   								 MAIN                                   *
+ *                                                                          *
+ ****************************************************************************/
+
+int main(int argc, char *argv[])
+{
+	testOrder();
+	testFlush();
+
+	if (Failures > 0)
+	  printf("%d checks failed\n", Failures);
+	else
+	  printf("all checks passed\n");
+
+	return (Failures > 0) ? 1 : 0;
+}
+
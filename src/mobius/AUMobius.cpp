@@ -290,17 +290,19 @@ AUMobius::AUMobius(AudioUnit component)
 	mInterruptOffset = 0;
 	mInterrupts = 0;
 	mTimeInfoAssimilations = 0;
+	mBlockFrames = HOST_DEFAULT_BLOCK_FRAMES;
 
 	// MAX_HOST_PLUGIN_PORTS is 16
+	mPortFrames = 0;
+	allocatePorts(MAX_HOST_BUFFER_FRAMES);
 	for (int i = 0 ; i < MAX_HOST_PLUGIN_PORTS ; i++) {
-		AudioStreamPort* port = &mPorts[i];
-		port->input = new float[MAX_HOST_BUFFER_FRAMES * MAX_HOST_BUFFER_CHANNELS];
-		port->inputPrepared = false;
-		port->output = new float[MAX_HOST_BUFFER_FRAMES * MAX_HOST_BUFFER_CHANNELS];
-		port->outputPrepared = false;
+		mPulled[i] = false;
+		mPulledBuffers[i] = NULL;
 	}
 
 	mTimeInfo.init();
+	mHostTime.init();
+	mHostTimeValid = false;
 	mTime.init();
 	mSyncState = new HostSyncState();
 
@@ -394,12 +396,6 @@ AUMobius::~AUMobius()
 	// ?? do we, this is a VST thing, not sure if it applies here...
 	mHandler = NULL;
 
-	for (int i = 0 ; i < MAX_HOST_PLUGIN_PORTS ; i++) {
-		AudioStreamPort* port = &mPorts[i];
-		delete port->input;
-		delete port->output;
-	}
-
 	// make sure we're not in an interrupt
 	SleepMillis(100);
 	delete mPlugin;
@@ -417,6 +413,20 @@ AUMobius::~AUMobius()
 	  trace("AUMobius::~AUMobius finished\n");
 }
 
+/**
+ * Make sure the port buffers can hold a render cycle of the
+ * given size.  Only called during initialization, never in the 
+ * render thread.
+ */
+PRIVATE void AUMobius::allocatePorts(int frames)
+{
+	if (frames > mPortFrames) {
+		for (int i = 0 ; i < MAX_HOST_PLUGIN_PORTS ; i++)
+		  mPorts[i].allocate(frames);
+		mPortFrames = frames;
+	}
+}
+
 /**
  * This is where we're supposed to do expensive initialization.
  * There is also Cleanup() which is supposed to take it back
@@ -451,6 +461,11 @@ ComponentResult AUMobius::Initialize()
 	if (result == noErr) {
         mPlugin->start();
 
+        // The port buffers hold the entire render cycle since we pull 
+        // every bus up front, the engine gets it in smaller blocks.
+        allocatePorts(GetMaxFramesPerSlice());
+        mBlockFrames = mPlugin->getBlockFrames();
+
         // VST calls resume and suspend when the plugin is bypassed
         // or processing stops, does AU have anything like that?
         //mPlugin->resume();
@@ -627,6 +642,7 @@ void AUMobius::captureHostTime(const AudioTimeStamp& inTimeStamp, UInt32 frames)
 	AUTimeInfo info;
 
 	mInterrupts++;
+	mHostTimeValid = false;
 
 	info.sampleTime = inTimeStamp.mSampleTime;
 
@@ -676,18 +692,35 @@ void AUMobius::captureHostTime(const AudioTimeStamp& inTimeStamp, UInt32 frames)
 										info.timeSig_Numerator,
 										info.timeSig_Denominator);
 
-				mSyncState->advance((int)frames, 
-									info.currentSampleInTimeLine,
-									info.currentBeat,
-									info.transportStateChanged,
-									info.isPlaying);
-
-				mSyncState->transfer(&mTime);
+				// advanceTime does the rest as blocks are processed
+				mHostTime = info;
+				mHostTimeValid = true;
 			}
 		}
 	}
 }
 
+/**
+ * Advance the sync state over one block of the render cycle.
+ * The host time captured at the start of the cycle is used for the
+ * first block, after that HostSyncState projects it forward.
+ */
+PRIVATE void AUMobius::advanceTime(int offset, int frames)
+{
+	if (mHostTimeValid) {
+		if (offset == 0)
+		  mSyncState->advance(frames, 
+							  mHostTime.currentSampleInTimeLine,
+							  mHostTime.currentBeat,
+							  mHostTime.transportStateChanged,
+							  mHostTime.isPlaying);
+		else
+		  mSyncState->advanceBlock(frames);
+
+		mSyncState->transfer(&mTime);
+	}
+}
+
 /**
  * Overloaded from AUBase.h  The default implementation just calls 
  * NeedsToRender then Render without passing down the bus number.
@@ -737,53 +770,31 @@ ComponentResult	AUMobius::RenderBus(AudioUnitRenderActionFlags& ioActionFlags,
 		// capture changes to AU parameters since the last render cycle
 		importParameters();
 
-		// reset our port buffers
+		// Reset our port buffers.  Inputs are pulled by getInterruptBuffers
+		// when the engine asks for them so busses no track uses cost
+		// nothing.
+		mInterruptActionFlags = ioActionFlags;
+		mInterruptTimeStamp = inTimeStamp;
+		mInterruptFrames = inNumberFrames;
 		for (int i = 0 ; i < MAX_HOST_PLUGIN_PORTS ; i++) {
-			AudioStreamPort* port = &mPorts[i];
-			port->inputPrepared = false;
-			port->outputPrepared = false;
-		}
-
-		// pull from each connected input, we'll convert the results later
-		// in calls to getInterruptBuffers
-		AUScope& inputs = Inputs();
-		int nInputs = inputs.GetNumberOfElements();
-		for (int i = 0 ; i < nInputs && result == noErr ; i++) {
-			AUInputElement* input = GetInput(i);
-			if (input == NULL) {
-				// not supposed to happen
-				whine("NULL input element during rendering\n");
-			}
-			else {
-				// need to pass element number in case this is handled
-				// by a callback
-				ComponentResult r = input->PullInput(ioActionFlags, inTimeStamp, i, inNumberFrames);
-				if (r == kAudioUnitErr_NoConnection) {
-					// this is okay, just ignore this input
-				}
-				else if (r != noErr) {
-					// AUEffectBase would skip processing if the input
-					// couldn't be rendered, I suppose we could try to 
-					// do the others?
-					whine("Unable to pull input from bus\n");
-					result = r;
-				}
-			}
+			mPorts[i].reset(inNumberFrames);
+			mPulled[i] = false;
+			mPulledBuffers[i] = NULL;
 		}
 
 		// render input ports to output ports
+		bool rendered = false;
 		if (result == noErr) {
 			if (ShouldBypassEffect()) {
-				// AUEffectBase uses this to pass inputs diretly to
-				// the corresponding output but that doesn't necessarily
-				// make sense for us, just leave the outputs silent and don't
-				// advance Mobius
+				// inputs pass through to the outputs below, 
+				// don't advance Mobius
 			}
 			else if (mHandler == NULL) {
 				// no where to go
 			}
-			else if (inNumberFrames > MAX_HOST_BUFFER_FRAMES) {
-				// this would cause an internal buffer overflow
+			else if ((int)inNumberFrames > mPortFrames) {
+				// host went beyond GetMaxFramesPerSlice, this
+				// would cause an internal buffer overflow
 				Trace(1, "Too many AU buffer frames!\n");
 			}
 			else if (inNumberFrames == 0) {
@@ -794,8 +805,7 @@ ComponentResult	AUMobius::RenderBus(AudioUnitRenderActionFlags& ioActionFlags,
 				// AUBase does the slicing and calls back to ProcessScheduledSlice
 				// mParamList defined on AUBase
 				
-				mInterruptActionFlags = ioActionFlags;
-				mInterruptFrames = inNumberFrames;
+				rendered = true;
 
 				if (mParamList.size() == 0) {
 					// AUEffectBase makes this optimization to avoid a little
@@ -812,6 +822,11 @@ ComponentResult	AUMobius::RenderBus(AudioUnitRenderActionFlags& ioActionFlags,
 			}
 		}
 
+		// the sync state has to keep up with the host even if 
+		// the engine didn't see this cycle
+		if (!rendered)
+		  advanceTime(0, inNumberFrames);
+
 		// send parameter changes made during this render cycle
 		// back to the view
 		exportParameters();
@@ -835,23 +850,24 @@ ComponentResult	AUMobius::RenderBus(AudioUnitRenderActionFlags& ioActionFlags,
 	AudioBufferList& outbuffers = output->GetBufferList();
 
 	if (result != noErr) {
-		// trouble pulling inputs, do we need to zero?  
+		// trouble rendering, do we need to zero?  
 		zero = true;
 	}
 	else if (ShouldBypassEffect()) {
-		// AUEffectBase uses this to pass inputs diretly to
-		// the corresponding output but that doesn't necessarily
-		// make sense for us, just leave the outputs silent and don't
-		// advance Mobius
-		zero = true;
-		/*
-		  if(!ProcessesInPlace() )
-		  theInput->CopyBufferContentsTo (theOutput->GetBufferList());
-		*/
+		// Pass the input straight through by pointing the output 
+		// at the input buffers the way AUEffectBase does for in place
+		// processing.  Mobius doesn't advance.
+		AudioBufferList* inbuffers = NULL;
+		if (inBusNumber < mInputPorts)
+		  inbuffers = pullInput(inBusNumber);
+		if (inbuffers != NULL)
+		  output->SetBufferList(*inbuffers);
+		else
+		  zero = true;
 	}
 	else if (inBusNumber >= 0 && inBusNumber < mOutputPorts) {
-		AudioStreamPort* port = &mPorts[inBusNumber];
-		if (!port->outputPrepared) {
+		HostPort* port = &mPorts[inBusNumber];
+		if (!port->isOutputPrepared()) {
 			// this is normal if no track targeted this port
 			zero = true;
 		}
@@ -864,7 +880,8 @@ ComponentResult	AUMobius::RenderBus(AudioUnitRenderActionFlags& ioActionFlags,
 			zero = true;
 		}
 		else {
-			deinterleaveBuffers(port->output, inNumberFrames, &outbuffers);
+			for (int c = 0 ; c < PORT_CHANNELS ; c++)
+			  port->exportOutput(c, (float*)outbuffers.mBuffers[c].mData, true);
 		}
 	}
 	else {
@@ -883,46 +900,6 @@ ComponentResult	AUMobius::RenderBus(AudioUnitRenderActionFlags& ioActionFlags,
 	return result;
 }
 
-/**
- * Convert one of our interleaved AudioStream buffers into
- * a non-interleaved AudioBufferList.
- * 
- * AudioBufferList
- *   UInt32 mNumberBuffers
- *   AudioBuffer mBuffers[]
- *
- * AudioBuffer
- *   UInt32 mNumberChannels
- *   UInt32 mDataByteSize
- *   void* mData
- *
- * Like interleaveBuffers we expect to be dealing with one
- * non-interleaved buffer per channel.  mNumberChannels will be 1
- * and mNumberBuffers should be 2.
- */
-PRIVATE void AUMobius::deinterleaveBuffers(float* input, int frames,
-										   AudioBufferList* outputs)
-{
-	int channels = outputs->mNumberBuffers;
-	int channelsPerPort = PORT_CHANNELS;
-	AudioBuffer* outBuffers = outputs->mBuffers;
-
-	for (int channel = 0 ; channel < channels ; channel++) {
-		float* dest = (float*)((outBuffers + channel)->mData);
-		float* src = input + channel;;
-
-		for (int i = 0 ; i < frames ; i++) {
-			if (src == NULL)
-			  *dest = 0.0;
-			else {
-				*dest = *src;
-				src += channelsPerPort;
-			}
-			dest++;
-		}
-	}
-}
-
 /**
  * Called by AUBase::ProcessForScheduledParams for each "slice" between
  * scheduled parameter events.
@@ -932,16 +909,32 @@ ComponentResult	AUMobius::ProcessScheduledSlice(void *inUserData,
 												UInt32 inSliceFramesToProcess,
 												UInt32 inTotalBufferFrames )
 {
-	// this is used by getInterruptBuffers to know where the slice begins
-	mInterruptOffset = inStartFrameInBuffer;
+	// Slices can be as large as the host buffer, break them up so the
+	// engine never sees more than mBlockFrames at a time.
+	int start = inStartFrameInBuffer;
+	int end = start + inSliceFramesToProcess;
+	int frames = 0;
+
+	for (int offset = start ; offset < end ; offset += frames) {
+
+		frames = end - offset;
+		if (frames > mBlockFrames)
+		  frames = mBlockFrames;
+
+		advanceTime(offset, frames);
 
-	// this is returned by getInteruptFrames for the mHandler to know 
-	// how many frames to process
-	mInterruptSliceFrames = inSliceFramesToProcess;
+		// this is used by getInterruptBuffers to know where the 
+		// block begins
+		mInterruptOffset = offset;
 
-	// This does the Mobius work calling back to getInterruptBuffers
-	// to do the interleaving of input buffers.
-	mHandler->processAudioBuffers(this);
+		// this is returned by getInteruptFrames for the mHandler to know 
+		// how many frames to process
+		mInterruptSliceFrames = frames;
+
+		// This does the Mobius work calling back to getInterruptBuffers
+		// to do the interleaving of input buffers.
+		mHandler->processAudioBuffers(this);
+	}
 
 	// don't have a way to return errors from getInterruptBuffers, 
 	// assume they worked
@@ -984,34 +977,14 @@ PUBLIC void AUMobius::getInterruptBuffers(int inport, float** inbuf,
 			inport = 0;	
 		}
 
-		AudioStreamPort* port = &mPorts[inport];
-		if (!port->inputPrepared) {
-			if (inport < mInputPorts) {
-				AudioBufferList* aubuffers = NULL;
-				AUInputElement* auinput = GetInput(inport);
-				if (auinput != NULL) {
-					// !! if pull returned k...NoConnection do we need
-					// to remember that or will the buffers be empty?
-					aubuffers = &(auinput->GetBufferList());
-				}
-				else {
-					// Shouldn't happen unless there is a mismatch
-					// between the number of busses advertised at the AU
-					// interface, and the number we think we're dealing
-					// with internally
-					whine("Unable to get input buffer list for port\n");
-				}
-				interleaveBuffers(aubuffers, mInterruptFrames, port->input);
-			}
-			else {
-				// not attached to anything, return an empty buffer
-				int floats = mInterruptFrames * channels;
-				memset(port->input, 0, (sizeof(float) * floats));
-			}
-			port->inputPrepared = true;
+		HostPort* port = &mPorts[inport];
+		if (!port->isInputPrepared() && inport < mInputPorts) {
+			// first use of this port in the render cycle
+			// ports not attached to anything stay empty
+			wrapInput(port, pullInput(inport));
 		}
 
-		*inbuf = port->input + (mInterruptOffset * channels);
+		*inbuf = port->getInput() + (mInterruptOffset * channels);
 	}
 
 	if (outbuf != NULL) {
@@ -1019,18 +992,54 @@ PUBLIC void AUMobius::getInterruptBuffers(int inport, float** inbuf,
 		if (outport < 0 || outport >= MAX_HOST_PLUGIN_PORTS)
 		  outport = 0;	
 
-		AudioStreamPort* port = &mPorts[outport];
-		if (!port->outputPrepared) {
-			int floats = mInterruptFrames * channels;
-			memset(port->output, 0, (sizeof(float) * floats));
-			port->outputPrepared = true;
+		HostPort* port = &mPorts[outport];
+		*outbuf = port->getOutput() + (mInterruptOffset * channels);
+	}
+}
+
+/**
+ * Pull one of the input busses for the current render cycle.
+ * Returns NULL if the bus isn't connected or couldn't be rendered.
+ * Only the first call in a cycle does the pull.
+ */
+PRIVATE AudioBufferList* AUMobius::pullInput(int bus)
+{
+	if (bus >= 0 && bus < MAX_HOST_PLUGIN_PORTS && !mPulled[bus]) {
+		mPulled[bus] = true;
+
+		AUInputElement* input = NULL;
+		if (bus < (int)Inputs().GetNumberOfElements())
+		  input = GetInput(bus);
+
+		if (input == NULL) {
+			// Shouldn't happen unless there is a mismatch
+			// between the number of busses advertised at the AU
+			// interface, and the number we think we're dealing
+			// with internally
+			whine("Unable to get input buffer list for port\n");
+		}
+		else {
+			// need to pass element number in case this is handled
+			// by a callback
+			ComponentResult r = input->PullInput(mInterruptActionFlags, 
+												 mInterruptTimeStamp, 
+												 bus, mInterruptFrames);
+			if (r == noErr)
+			  mPulledBuffers[bus] = &(input->GetBufferList());
+			else if (r != kAudioUnitErr_NoConnection) {
+				// AUEffectBase would skip processing if the input
+				// couldn't be rendered, we just treat it as silence
+				whine("Unable to pull input from bus\n");
+			}
 		}
-		*outbuf = port->output + (mInterruptOffset * channels);
 	}
+
+	return (bus >= 0 && bus < MAX_HOST_PLUGIN_PORTS) ? mPulledBuffers[bus] : NULL;
 }
 
 /**
- * Convert an AU input buffer into an interleaved AudioStreamPort buffer.
+ * Point a port at the channels of an AU input buffer, they're
+ * interleaved by the port.
  *
  * AudioBufferList
  *   UInt32 mNumberBuffers
@@ -1050,38 +1059,17 @@ PUBLIC void AUMobius::getInterruptBuffers(int inport, float** inbuf,
  * rather than 8x2 in which case we would have to offset into
  * mBuffers by the port base.  Let's hope we don't have to go there.
  */
-PRIVATE void AUMobius::interleaveBuffers(const AudioBufferList* sources,
-										 long frames, 
-										 float* output)
+PRIVATE void AUMobius::wrapInput(HostPort* port, const AudioBufferList* sources)
 {
-	const AudioBuffer* srcBuffer = NULL;
-	int channels = PORT_CHANNELS;
-
 	if (sources != NULL) {
-		if (sources->mNumberBuffers != channels ||
+		if (sources->mNumberBuffers != PORT_CHANNELS ||
 			sources->mBuffers[0].mNumberChannels != 1) {
 			// interleaved or mono, we should be neither
 			whine("interleaved audio buffers!\n");
 		}
 		else {
-			srcBuffer = sources->mBuffers;   // + portBase
-		}
-	}
-
-	for (int channel = 0 ; channel < channels ; channel++) {
-		float* src = NULL;
-		float* dest = output + channel;
-		if (srcBuffer != NULL)
-		  src = (float*)((srcBuffer + channel)->mData);
-
-		for (int j = 0 ; j < frames ; j++) {
-			if (src == NULL)
-			  *dest = 0.0;
-			else {
-				*dest = *src;
-				src++;
-			}
-			dest += channels;
+			for (int c = 0 ; c < PORT_CHANNELS ; c++)
+			  port->setInput(c, (float*)(sources->mBuffers[c].mData));
 		}
 	}
 }
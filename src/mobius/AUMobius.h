@@ -47,32 +47,6 @@
 #include "AudioInterface.h"
 #include "HostInterface.h"
 
-//////////////////////////////////////////////////////////////////////
-//
-// Ports
-//
-//////////////////////////////////////////////////////////////////////
-
-/**
- * Helper structure used to maintain processing state for
- * each "port" we expose through the stream.  These are created
- * on demand from the AU AudioBufferLists.  Each buffer will
- * contain interleaved frames for one port.  Normally a port
- * is a pair of stereo channels, eventually need to allow
- * more channels.
- *
- * NOTE: THis is identical to VstPort but there's not much to share.
- */
-typedef struct {
-
-	float* input;
-	bool inputPrepared;
-
-	float* output;
-	bool outputPrepared;
-
-} AudioStreamPort;
-
 //////////////////////////////////////////////////////////////////////
 //
 // AUTimeInfo
@@ -375,14 +349,16 @@ class AUMobius : public AUMIDIEffectBase, public HostInterface, public AudioInte
     void sendMidiEvents();
 
 	void captureHostTime(const AudioTimeStamp& inTimeStamp, UInt32 frames);
+	void advanceTime(int offset, int frames);
+	void allocatePorts(int frames);
 
 	OSStatus processBuffers(AudioUnitRenderActionFlags& ioActionFlags,
 							const AudioBufferList& inBuffer,
 							AudioBufferList& outBuffer,
 							UInt32 inFramesToProcess);
 
-	void interleaveBuffers(const AudioBufferList* sources, long frames, float* dest);
-	void deinterleaveBuffers(float* src, int frames, AudioBufferList* outputs);
+	AudioBufferList* pullInput(int bus);
+	void wrapInput(HostPort* port, const AudioBufferList* sources);
 
 	bool mTrace;
 	bool mTraceParameters;
@@ -393,12 +369,21 @@ class AUMobius : public AUMIDIEffectBase, public HostInterface, public AudioInte
 	AUTimeInfo mTimeInfo;
 	HostSyncState* mSyncState;
 
+	// time captured at the start of the render cycle, sync state 
+	// is advanced as each block is processed
+	AUTimeInfo mHostTime;
+	bool mHostTimeValid;
+
 	Context* mContext;
 	PluginInterface* mPlugin;
 	
 	AudioHandler* mHandler;
 	AudioTime mTime;
-	AudioStreamPort mPorts[MAX_HOST_PLUGIN_PORTS];
+	HostPort mPorts[MAX_HOST_PLUGIN_PORTS];
+	bool mPulled[MAX_HOST_PLUGIN_PORTS];
+	AudioBufferList* mPulledBuffers[MAX_HOST_PLUGIN_PORTS];
+	int mPortFrames;
+	int mBlockFrames;
 	int mInputPorts;
 	int mOutputPorts;
 	int mSampleRate;
@@ -406,6 +391,7 @@ class AUMobius : public AUMIDIEffectBase, public HostInterface, public AudioInte
 	int mOutputLatency;
 
 	AudioUnitRenderActionFlags mInterruptActionFlags;
+	AudioTimeStamp mInterruptTimeStamp;
 	int mInterruptFrames;
 	int mInterruptSliceFrames;
 	int mInterruptOffset;
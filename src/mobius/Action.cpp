@@ -355,7 +355,6 @@ PRIVATE void Action::init()
     // private
 
     mNext = NULL;
-    mPooled = false;
     mRegistered = false;
 
     mEvent = NULL;
@@ -410,8 +409,9 @@ PUBLIC Action::~Action()
  */
 PUBLIC void Action::free()
 {   
-    if (mPool != NULL)
-      mPool->freeAction(this);
+    ActionPool* pool = (ActionPool*)getPool();
+    if (pool != NULL)
+      pool->freeAction(this);
     else {
         // let this be okay
         //Trace(1, "Action::free with no pool!\n");
@@ -509,7 +509,7 @@ PRIVATE void Action::clone(Action* src)
     rescheduling = src->rescheduling;
     reschedulingReason = src->reschedulingReason;
 
-    // mNext and mPooled maintained by the pool functions
+    // mNext is maintained by the caller, the pool state by ObjectPool
 
     // mRegistered and mOverlay are not cloned, they are only used
     // by BindingResolver for actions we do clone
@@ -523,21 +523,6 @@ PUBLIC bool Action::isSustainable()
             triggerMode == TriggerModeToggle);
 }
 
-PUBLIC void Action::setPooled(bool b)
-{
-    mPooled = b;
-}
-
-PUBLIC bool Action::isPooled()
-{
-    return mPooled;
-}
-
-PUBLIC void Action::setPool(ActionPool* p)
-{
-    mPool = p;
-}
-
 PUBLIC Action* Action::getNext() 
 {
     return mNext;
@@ -970,20 +955,32 @@ PUBLIC void Action::detachEvent()
 
 ActionPool::ActionPool()
 {
-    mActions = NULL;
-    mAllocated = 0;
+    initObjectPool("Action");
+    prepare();
 }
 
 ActionPool::~ActionPool()
 {
-    delete mActions;
 }
 
 /**
- * Allocate a new action, using the pool if possible.
- * Note that this is not managed a csect, it should only be called
- * by Mobius which uses maintains a single app/interrupt coordination
- * csect.
+ * ObjectPool overload to create a new action.
+ * Normally called by the pool thread.
+ */
+PUBLIC PooledObject* ActionPool::newObject()
+{
+    return new Action();
+}
+
+PUBLIC void ActionPool::prepareObject(PooledObject* obj)
+{
+    ((Action*)obj)->reset();
+}
+
+/**
+ * Allocate a new action from the pool.
+ * ObjectPool is lock free so this may be called from any thread
+ * without a csect.
  */
 PUBLIC Action* ActionPool::newAction()
 {
@@ -995,19 +992,30 @@ PUBLIC Action* ActionPool::newAction(Action* src)
     return allocAction(src);
 }
 
-PRIVATE Action* ActionPool::allocAction(Action* src)
+/**
+ * Reinitialize an action we already allocated as a copy of another.
+ * This is used when replicating actions for groups and focus lock
+ * so we don't have to go back to the pool for every track.
+ * If the action found its way back to the pool, allocate another.
+ */
+PUBLIC Action* ActionPool::reuseAction(Action* action, Action* src)
 {
-    Action* action = mActions;
-
-    if (action == NULL) {
-        action = new Action(src);
-        action->setPool(this);
-        mAllocated++;
+    if (action->isPooled()) {
+        Trace(1, "Attempt to reuse pooled action\n");
+        action = allocAction(src);
     }
     else {
-        mActions = action->getNext();
-        action->setNext(NULL);
-        action->setPooled(false);
+        action->clone(src);
+    }
+
+    return action;
+}
+
+PRIVATE Action* ActionPool::allocAction(Action* src)
+{
+    Action* action = (Action*)alloc();
+
+    if (action != NULL) {
         if (src != NULL)
           action->clone(src);
         else
@@ -1017,37 +1025,37 @@ PRIVATE Action* ActionPool::allocAction(Action* src)
     return action;
 }
 
+/**
+ * Return an action to the pool.
+ * Actions built with new by the UI and given to Mobius::doAction
+ * were once absorbed into the pool, the ObjectPool can't take those
+ * so they are deleted.
+ */
 PUBLIC void ActionPool::freeAction(Action* action)
 {
     if (action != NULL) {
         if (action->isPooled())
           Trace(1, "Ignoring attempt to free pooled action\n");
+        else if (action->getPool() != this) {
+            // don't follow the chain
+            action->setNext(NULL);
+            delete action;
+        }
         else {
-            action->setNext(mActions);
-            mActions = action;
-            action->setPooled(true);
-
             // Release script args now or wait till it is brought
             // out of the pool?  Might as well do them now
             delete action->scriptArgs;
             action->scriptArgs = NULL;
             // this is transient
             action->setTargetTrack(NULL);
+            // the destructor follows this if the pool deletes it
+            action->setNext(NULL);
+
+            free(action);
         }
     }
 }
 
-PUBLIC void ActionPool::dump()
-{
-    int count = 0;
-
-    for (Action* a = mActions ; a != NULL ; a = a->getNext())
-      count++;
-
-    printf("ActionPool: %d allocated, %d in the pool, %d in use\n", 
-           mAllocated, count, mAllocated - count);
-}
-
 /****************************************************************************/
 /****************************************************************************/
 /****************************************************************************/
@@ -67,6 +67,7 @@
 
 #include "SystemConstant.h"
 #include "Binding.h"
+#include "ObjectPool.h"
 
 // sigh, need this until we can figure out what to do with ExValue
 #include "Expr.h"
@@ -213,7 +214,7 @@ class ResolvedTarget {
  * These are created in response to trigger events then passed to Mobius
  * for processing.
  */
-class Action {
+class Action : public PooledObject {
 
     friend class ActionPool;
 
@@ -545,12 +546,6 @@ class Action {
     //
     //////////////////////////////////////////////////////////////////////
 
-  protected:
-
-    void setPooled(bool b);
-    bool isPooled();
-    void setPool(class ActionPool* p);
-
     //////////////////////////////////////////////////////////////////////
     //
     // Private
@@ -565,14 +560,8 @@ class Action {
     char* advance(char* start, bool stopAtSpace);
 
     Action* mNext;
-    bool mPooled;
     bool mRegistered;
 
-    /**
-     * The pool we came from.
-     */
-    class ActionPool* mPool;
-
 	/**
 	 * Set as a side effect of function scheduling to the event
 	 * that represents the end of processing for this function.
@@ -638,27 +627,30 @@ class Action {
  *                                                                          *
  ****************************************************************************/
 
-class ActionPool {
+/**
+ * This is an ObjectPool so allocation in the interrupt is lock free
+ * and the pool thread keeps it filled.
+ */
+class ActionPool : public ObjectPool {
 
   public:
 
     ActionPool();
     ~ActionPool();
 
+    // ObjectPool implementations
+    PooledObject* newObject();
+    void prepareObject(PooledObject* o);
+
     Action* newAction();
     Action* newAction(Action* src);
+    Action* reuseAction(Action* a, Action* src);
     void freeAction(Action* a);
 
-    void dump();
-
   private:
 
     Action* allocAction(Action* src);
 
-    Action* mActions;
-    int mAllocated;
-
-
 };
 
 /****************************************************************************/
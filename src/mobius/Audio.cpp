@@ -130,6 +130,7 @@ void Audio::init()
 
 	mVersion = 0;
 	mBuffers = NULL;
+	mGains = NULL;
 	mBufferCount = 0;
 	mStartFrame = 0;
 	mFrames = 0;
@@ -143,6 +144,7 @@ PUBLIC Audio::~Audio()
 {
 	freeBuffers();
 	delete mBuffers;
+	delete mGains;
 	delete mPlay;
 	delete mRecord;
 }
@@ -219,10 +221,8 @@ PUBLIC void Audio::reset()
  */
 PUBLIC void Audio::zero() 
 {
-	for (int i = 0 ; i < mBufferCount ; i++) {
-		freeBuffer(mBuffers[i]);
-		mBuffers[i] = NULL;
-	}
+	for (int i = 0 ; i < mBufferCount ; i++)
+	  freeBuffer(i);
 	mVersion++;
 
 	// we could set mStartFrame back to zero now??
@@ -257,8 +257,11 @@ void Audio::initIndex()
 
 		mBufferCount = 60;			// configurable?
 		mBuffers = new float*[mBufferCount];
-		for (int i = 0 ; i < mBufferCount ; i++)
-		  mBuffers[i] = NULL;
+		mGains = new float[mBufferCount];
+		for (int i = 0 ; i < mBufferCount ; i++) {
+			mBuffers[i] = NULL;
+			mGains[i] = 1.0f;
+		}
 
 		// We'll normally record forward but if we reverse then
 		// we can start pushing new buffers on the front.  Though 
@@ -280,10 +283,8 @@ void Audio::initIndex()
 void Audio::freeBuffers() 
 {
 	if (mBuffers != NULL) {
-		for (int i = 0 ; i < mBufferCount ; i++) {
-			freeBuffer(mBuffers[i]);
-			mBuffers[i] = NULL;
-		}
+		for (int i = 0 ; i < mBufferCount ; i++)
+		  freeBuffer(i);
 	}
 	mStartFrame = 0;
     mFrames = 0;
@@ -299,29 +300,41 @@ void Audio::growIndex(int count, bool up)
 {
 	if (count > 0) {
 		float **buffers;
+		float *gains;
 		int i, newcount;
 
 		newcount = mBufferCount + count;
 		buffers  = new float*[newcount];
+		gains = new float[newcount];
 
 		if (up) {
-			for (i = 0 ; i < mBufferCount ; i++)
-			  buffers[i+count] = mBuffers[i];
+			for (i = 0 ; i < mBufferCount ; i++) {
+				buffers[i+count] = mBuffers[i];
+				gains[i+count] = mGains[i];
+			}
 	
-			for (i = 0 ; i < count ; i++)
-			  buffers[i] = NULL;
+			for (i = 0 ; i < count ; i++) {
+				buffers[i] = NULL;
+				gains[i] = 1.0f;
+			}
 		}
 		else {
-			for (i = 0 ; i < mBufferCount ; i++)
-			  buffers[i] = mBuffers[i];
+			for (i = 0 ; i < mBufferCount ; i++) {
+				buffers[i] = mBuffers[i];
+				gains[i] = mGains[i];
+			}
 	
-			for (i = mBufferCount ; i < newcount ; i++)
-			  buffers[i] = NULL;
+			for (i = mBufferCount ; i < newcount ; i++) {
+				buffers[i] = NULL;
+				gains[i] = 1.0f;
+			}
 		}
 
 		mBufferCount = newcount;
 		delete mBuffers;
+		delete mGains;
 		mBuffers = buffers;
+		mGains = gains;
 
 		// when growing up, the current content range must also be adjusted
 		if (up)
@@ -367,8 +380,19 @@ float* Audio::getBuffer(int i)
 	return ((i >= 0 && i < mBufferCount) ? mBuffers[i] : NULL);
 }
 
+/**
+ * Return the level that has yet to be applied to the buffer
+ * at a given index.
+ */
+float Audio::getGain(int i)
+{
+	return ((i >= 0 && i < mBufferCount) ? mGains[i] : 1.0f);
+}
+
 /**
  * Return the buffer at a given index, allocating one if necessary.
+ * This is only used when we're about to modify the buffer so
+ * apply any pending gain.
  */
 float *Audio::allocBuffer(int index) 
 {
@@ -381,10 +405,41 @@ float *Audio::allocBuffer(int index)
 		mBuffers[index] = buffer;
 		mVersion++;
 	}
+	else if (mGains[index] != 1.0f)
+	  applyGain(index);
 
 	return buffer;
 }
 
+/**
+ * Multiply the samples in one buffer by the pending gain.
+ * The version changes so cursors that cached the gain 
+ * will relocate.
+ */
+void Audio::applyGain(int index)
+{
+	float* buffer = mBuffers[index];
+	float gain = mGains[index];
+
+	if (buffer != NULL && gain != 1.0f) {
+		for (int i = 0 ; i < mBufferSize ; i++)
+		  buffer[i] *= gain;
+		mVersion++;
+	}
+	mGains[index] = 1.0f;
+}
+
+/**
+ * Apply the pending gain to every buffer.
+ */
+void Audio::applyGains()
+{
+	for (int i = 0 ; i < mBufferCount ; i++) {
+		if (mGains[i] != 1.0f)
+		  applyGain(i);
+	}
+}
+
 /**
  * Add a buffer at the specified index. 
  * Used only in the implementation of file reading.
@@ -396,7 +451,7 @@ void Audio::addBuffer(float* buffer, int index)
 	if (existing != NULL) {
 		// ordinarily not supposed to be replacing buffers, but allow it
 		Trace(1, "Audio::addBuffer replacing existing buffer!\n");
-        freeBuffer(existing);
+        freeBuffer(index);
 	}
 	mBuffers[index] = buffer;
 	mVersion++;
@@ -427,6 +482,16 @@ float* Audio::allocBuffer()
 	return buffer;
 }
 
+/**
+ * Release the buffer at an index.
+ */
+void Audio::freeBuffer(int index)
+{
+	freeBuffer(mBuffers[index]);
+	mBuffers[index] = NULL;
+	mGains[index] = 1.0f;
+}
+
 /**
  * Release one buffer.
  */
@@ -526,8 +591,7 @@ PUBLIC void Audio::setFrames(long frames)
 				  lastIndex = mBufferCount - 1;
 
 				for (int i = index + 1 ; i <= lastIndex ; i++) {
-					freeBuffer(mBuffers[i]);
-					mBuffers[i] = NULL;
+					freeBuffer(i);
 					mVersion++;
 				}
 			}
@@ -629,8 +693,7 @@ void Audio::setStartFrame(long frame)
 				  lastIndex = mBufferCount - 1;
 
 				for (int i = firstIndex ; i <= lastIndex ; i++) {
-					freeBuffer(mBuffers[i]);
-					mBuffers[i] = NULL;
+					freeBuffer(i);
 					mVersion++;
 				}
 			}
@@ -876,6 +939,12 @@ void Audio::copy(Audio* src)
 	copy(src, 127);
 }
 
+/**
+ * Feedback isn't applied to the samples here, it is combined with
+ * the source buffer's pending gain and left for AudioCursor.  Copying
+ * a long loop at reduced feedback is then no more expensive than
+ * copying at full feedback, and repeated copies just multiply the gain.
+ */
 void Audio::copy(Audio* src, int feedback)
 {
 	reset();
@@ -884,6 +953,13 @@ void Audio::copy(Audio* src, int feedback)
 		if (src->mBufferSize != mBufferSize)
 		  Trace(1, "Mismatched Audio buffer size!\n");
 		else {
+			// old way, linear
+			// float modifier = (float)feedback / 127.0f;
+			// new way, pseudo-log
+			float modifier = 1.0f;
+			if (feedback < 127 && feedback >= 0)
+			  modifier = AudioFade::getRampValue(feedback);
+
 			int srcmax = src->mBufferCount;
 			for (int i = 0 ; i < srcmax ; i++) {
 				float* srcb = src->getBuffer(i);
@@ -893,7 +969,7 @@ void Audio::copy(Audio* src, int feedback)
 					float* destb = allocBuffer(i);
 
 					memcpy(destb, srcb, mBufferSize * sizeof(float));
-					applyFeedback(destb, feedback);
+					mGains[i] = src->mGains[i] * modifier;
 				}
 			}
 		}
@@ -903,20 +979,6 @@ void Audio::copy(Audio* src, int feedback)
 	}
 }
 
-void Audio::applyFeedback(float* buffer, int feedback)
-{
-	if (feedback < 127 && feedback >= 0) {
-		// old way, linear
-		// float modifier = (float)feedback / 127.0f;
-		// new way, pseudo-log
-		float* ramp = AudioFade::getRamp128();
-		float modifier = ramp[feedback];
-
-		for (int i = 0 ; i < mBufferSize ; i++)
-		  buffer[i] = buffer[i] * modifier;
-	}
-}
-
 /****************************************************************************
  *                                                                          *
  *   							 DIAGNOSTICS                                *
@@ -1147,6 +1209,9 @@ void Audio::insert(Audio* audio, long insertFrame)
             append(audio);
         }
         else {
+            // we're moving samples between buffers
+            applyGains();
+
             // first shift everything down
             long lastFrame = mFrames - 1;
             long newFrames = audio->getFrames();
@@ -1208,6 +1273,23 @@ void Audio::insert(Audio* audio, long insertFrame)
  ****************************************************************************/
 /****************************************************************************/
 
+/**
+ * Protects creation of the shared pool and the instance count.
+ */
+PRIVATE CriticalSection SharedAudioCsect("SharedAudioPool");
+
+/**
+ * Number of AudioPools using the shared pool.
+ */
+PRIVATE int SharedAudioUsers = 0;
+
+/**
+ * Total buffers in use by all AudioPools using the shared pool,
+ * and the sum of their quotas.
+ */
+PRIVATE volatile long SharedAudioInUse = 0;
+PRIVATE volatile long SharedAudioQuota = 0;
+
 /**
  * Create an initially empty audio pool.
  * There is normally only one of these in a Mobius instance.
@@ -1219,6 +1301,8 @@ PUBLIC AudioPool::AudioPool()
     mPool = NULL;
     mAllocated = 0;
     mInUse = 0;
+    mShared = false;
+    mQuota = 0;
 
     // needs more testing
     // !! channels
@@ -1231,6 +1315,21 @@ PUBLIC AudioPool::AudioPool()
  */
 PUBLIC AudioPool::~AudioPool()
 {
+    // the shared pool stays in the ObjectPoolManager, it will
+    // trim itself to the high water mark
+    if (mShared) {
+        if (mInUse > 0)
+          Trace(1, "AudioPool: Deleting with %ld shared buffers in use\n",
+                (long)mInUse);
+        SharedAudioCsect.enter();
+        SharedAudioUsers--;
+        PoolAdd(&SharedAudioQuota, -mQuota);
+        PoolAdd(&SharedAudioInUse, -mInUse);
+        SharedAudioCsect.leave();
+        mNewPool = NULL;
+        mShared = false;
+    }
+
     delete mCsect;
     delete mNewPool;
 
@@ -1281,6 +1380,10 @@ PUBLIC float* AudioPool::newBuffer()
 
 	if (mNewPool) {
 		buffer = mNewPool->allocSamples();
+		memset(buffer, 0, BUFFER_SIZE * sizeof(float));
+        PoolAdd(&mInUse, 1);
+        if (mShared)
+          PoolAdd(&SharedAudioInUse, 1);
 	}
 	else {
 		mCsect->enter();
@@ -1321,6 +1424,9 @@ PUBLIC void AudioPool::freeBuffer(float* buffer)
 
 		if (mNewPool != NULL) {
 			mNewPool->freeSamples(buffer);
+            PoolAdd(&mInUse, -1);
+            if (mShared)
+              PoolAdd(&SharedAudioInUse, -1);
 		}
 		else {
 			OldPooledBuffer* pb = (OldPooledBuffer*)
@@ -1343,8 +1449,18 @@ PUBLIC void AudioPool::freeBuffer(float* buffer)
 PUBLIC void AudioPool::dump()
 {
 	if (mNewPool != NULL) {
-        // need a dump method for the new one
-		printf("NewBufferPool: %d in use ?? in pool\n", mInUse);
+        if (mShared) {
+            printf("AudioPool: %ld buffers in use, quota %ld, shared by %ld instances\n",
+                   (long)mInUse, (long)mQuota, (long)SharedAudioUsers);
+            printf("AudioPool: %ld shared buffers in use, combined quota %ld\n",
+                   (long)SharedAudioInUse, (long)SharedAudioQuota);
+        }
+        else {
+            // need a dump method for the new one
+            printf("NewBufferPool: %ld in use ?? in pool\n", (long)mInUse);
+        }
+        mNewPool->dump();
+		fflush(stdout);
 	}
 	else {
         int pooled = 0;
@@ -1360,8 +1476,8 @@ PUBLIC void AudioPool::dump()
 
         // this should match
         if (used != mInUse)
-          printf("AudioPool: Unmatched usage counters %d %d\n",
-                 used, mInUse);
+          printf("AudioPool: Unmatched usage counters %d %ld\n",
+                 used, (long)mInUse);
 
 		fflush(stdout);
 	}
@@ -1375,6 +1491,133 @@ PUBLIC void AudioPool::init(int buffers)
 {
 }
 
+/****************************************************************************
+ *                                                                          *
+ *                                SHARED POOL                               *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Locate the process wide pool, creating it the first time.
+ * It lives in the ObjectPoolManager singleton which doesn't
+ * run a thread, the instances using it call maintain from
+ * their own MobiusThreads.  Must be called in the csect.
+ */
+PRIVATE SampleBufferPool* AudioPool::getSharedPool()
+{
+    ObjectPoolManager* pm = ObjectPoolManager::instance();
+    SampleBufferPool* pool = (SampleBufferPool*)pm->get(AUDIO_SHARED_POOL);
+    if (pool == NULL) {
+        Trace(2, "AudioPool: Creating shared pool\n");
+        pool = new SampleBufferPool(AUDIO_SHARED_POOL, BUFFER_SIZE,
+                                    AUDIO_SHARED_POOL_CAPACITY,
+                                    AUDIO_SHARED_POOL_LOW_WATER,
+                                    AUDIO_SHARED_POOL_HIGH_WATER);
+        pm->add(pool);
+    }
+    return pool;
+}
+
+/**
+ * Switch between the private and shared pools.
+ * The buffer headers are different so this can only be done
+ * before anything has been allocated, Mobius does it right
+ * after reading the configuration.  Changes after that take
+ * effect on restart.
+ */
+PUBLIC void AudioPool::setShared(bool b)
+{
+    if (b != mShared) {
+        if (mInUse > 0) {
+            Trace(2, "AudioPool: Unable to change sharing with buffers in use\n");
+        }
+        else {
+            SharedAudioCsect.enter();
+            if (b) {
+                mNewPool = getSharedPool();
+                SharedAudioUsers++;
+                PoolAdd(&SharedAudioQuota, mQuota);
+            }
+            else {
+                mNewPool = NULL;
+                SharedAudioUsers--;
+                PoolAdd(&SharedAudioQuota, -mQuota);
+            }
+            mShared = b;
+            SharedAudioCsect.leave();
+        }
+    }
+}
+
+PUBLIC bool AudioPool::isShared()
+{
+    return mShared;
+}
+
+/**
+ * Set the soft quota for this instance.  Zero means no quota,
+ * this instance is never asked to give anything up.
+ */
+PUBLIC void AudioPool::setQuota(int megabytes)
+{
+    long buffers = 0;
+    if (megabytes > 0) {
+        long bufferBytes = BUFFER_SIZE * sizeof(float);
+        buffers = (long)(((double)megabytes * 1024 * 1024) / bufferBytes);
+        if (buffers < 1)
+          buffers = 1;
+    }
+
+    if (mShared)
+      PoolAdd(&SharedAudioQuota, buffers - mQuota);
+    mQuota = buffers;
+}
+
+/**
+ * True if this instance should give up some memory.
+ * The quota is soft, an instance may go over it as long as the
+ * shared pool as a whole is under the combined quota of everyone
+ * using it.  Once that is exceeded only the instances over their
+ * own quota are asked to trim, so one instance with a long undo
+ * history can't push the others out.
+ *
+ * Called by Layer in the interrupt, this only reads counters.
+ */
+PUBLIC bool AudioPool::isOverQuota()
+{
+    return (mShared && mQuota > 0 && mInUse > mQuota &&
+            SharedAudioInUse > SharedAudioQuota);
+}
+
+/**
+ * Called periodically by MobiusThread to keep the shared pool at
+ * its water marks.  ObjectPool only allows one maintainer at a time.
+ */
+PUBLIC void AudioPool::maintain()
+{
+    if (mShared && mNewPool != NULL) {
+        SharedAudioCsect.enter();
+        mNewPool->maintain();
+        SharedAudioCsect.leave();
+    }
+}
+
+/**
+ * Buffers in use by this instance.
+ */
+PUBLIC long AudioPool::getInUse()
+{
+    return mInUse;
+}
+
+/**
+ * Buffers in use by every instance sharing the pool.
+ */
+PUBLIC long AudioPool::getSharedInUse()
+{
+    return SharedAudioInUse;
+}
+
 /****************************************************************************/
 /****************************************************************************/
 /****************************************************************************/
@@ -261,6 +261,8 @@ class AudioCursor {
 	void put(AudioBuffer* b, AudioOp op, long frame);
 	void put(AudioBuffer* b, AudioOp op, Audio* a, long frame);
 
+	void mix(Audio* src, long srcFrame, long frames, float level);
+
 	void startFadeIn();
 	void setFadeIn(long frame);
 	void setFadeOut(long frame);
@@ -283,6 +285,7 @@ class AudioCursor {
 	void prepareFrame();
 	void locateFrame();
 	void incFrame();
+	void applyGain();
 	void get(AudioBuffer* buf, float* dest, float modifier);
 
 	char* mName;
@@ -302,6 +305,7 @@ class AudioCursor {
 	int mBufferIndex;		// index of buffer containing mFrame
 	int mBufferOffset;		// offset (in samples) in mBuffer to mFrame
 	float* mBuffer;			// buffer containing mFrame
+	float mGain;			// gain not yet applied to mBuffer
 
 	/**
 	 * When true, causes the automatic extension of the Audio buffers
@@ -430,11 +434,14 @@ class Audio {
 	float* allocBuffer(int index);
 	bool isEmpty(float* buffer);
 	void setStartFrame(long frame);
-	void applyFeedback(float* buffer, int feedback);
+	void freeBuffer(int index);
+	void applyGain(int index);
+	void applyGains();
 
 	// allow these to be directly accessible by AudioCursor
 
 	float* getBuffer(int i);
+	float getGain(int i);
 	long prepareFrame(long frame, int* retIndex, int* retOffset, 
 					  float** retBuffer);
 
@@ -472,6 +479,14 @@ class Audio {
 	 */
 	float **mBuffers;
 
+	/**
+	 * A level for each element in mBuffers that has not yet been
+	 * applied to the samples.  Copying with feedback just changes
+	 * this, AudioCursor factors it in when reading and applies it
+	 * before the buffer is modified.  Empty elements are always 1.0.
+	 */
+	float *mGains;
+
 	/**
 	 * Total number of elements in the mBuffers array.
 	 */
@@ -518,6 +533,25 @@ class Audio {
  *                                                                          *
  ****************************************************************************/
 
+/**
+ * Name of the process wide buffer pool in the ObjectPoolManager singleton.
+ */
+#define AUDIO_SHARED_POOL "SharedAudio"
+
+/**
+ * Maximum number of buffers the shared pool keeps track of.
+ * Buffers are 512K so this is 2G, beyond that they are still allocated
+ * but go back to the heap when freed.
+ */
+#define AUDIO_SHARED_POOL_CAPACITY 4096
+
+/**
+ * Levels the shared pool is maintained at.  Since every instance
+ * draws from it this is what keeps it warm.
+ */
+#define AUDIO_SHARED_POOL_LOW_WATER 8
+#define AUDIO_SHARED_POOL_HIGH_WATER 32
+
 /**
  * This structure is allocated at the top of every Audio buffer.
  */
@@ -532,6 +566,12 @@ struct OldPooledBuffer {
 /**
  * Maintains a pool of audio buffers.
  * There is normally only one of these in a Mobius instance.
+ *
+ * Optionally the buffers may come from a pool shared by every
+ * instance in the process.  Each AudioPool then just tracks the
+ * buffers its instance is using, and may be given a soft quota.
+ * When the shared pool is using more than all the quotas combined,
+ * the instances over their quota are asked to give up undo layers.
  */
 class AudioPool {
     
@@ -543,6 +583,15 @@ class AudioPool {
     void init(int buffers);
     void dump();
 
+    void setShared(bool b);
+    bool isShared();
+    void setQuota(int megabytes);
+    bool isOverQuota();
+    void maintain();
+
+    long getInUse();
+    static long getSharedInUse();
+
     Audio* newAudio();
     Audio* newAudio(const char* file);
     void freeAudio(Audio* a);
@@ -552,11 +601,19 @@ class AudioPool {
 
   private:
 
+    static class SampleBufferPool* getSharedPool();
+
     class CriticalSection* mCsect;
     OldPooledBuffer* mPool;
     class SampleBufferPool* mNewPool;
     int mAllocated;
-	int mInUse;
+	volatile long mInUse;
+
+    // true if mNewPool is the shared pool
+    bool mShared;
+
+    // soft quota in buffers, zero for none
+    long mQuota;
 
 };
 
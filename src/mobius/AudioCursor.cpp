@@ -482,6 +482,7 @@ void AudioCursor::init()
 	mBufferIndex = 0;
 	mBufferOffset = 0;
 	mBuffer = NULL;
+	mGain = 1.0f;
 	mAutoExtend = false;
     mOverflowTraced = false;
 	mFade.init();
@@ -509,6 +510,7 @@ bool AudioCursor::isReverse()
 PRIVATE void AudioCursor::decache()
 {
 	mBuffer = NULL;
+	mGain = 1.0f;
 	mBufferIndex = 0;
 	mBufferOffset = 0;
 	mVersion = 0;
@@ -603,10 +605,22 @@ PRIVATE void AudioCursor::locateFrame()
 		// Trace(2, "locateFrame\n");
 		mAudio->locate(mFrame, &mBufferIndex, &mBufferOffset);
 		mBuffer = mAudio->getBuffer(mBufferIndex);
+		mGain = mAudio->getGain(mBufferIndex);
 		mVersion = mAudio->mVersion;
 	}
 }
 
+/**
+ * Called before modifying the current buffer if it still has 
+ * a pending gain from an Audio copy.
+ */
+PRIVATE void AudioCursor::applyGain()
+{
+	mAudio->applyGain(mBufferIndex);
+	mGain = 1.0f;
+	mVersion = mAudio->mVersion;
+}
+
 /**
  * Called when we need to ensure that the frame identified by
  * the current mFrame counter is writable.  This is called whenever
@@ -620,6 +634,8 @@ PRIVATE void AudioCursor::prepareFrame()
         // potentially complex extension
         mFrame = mAudio->prepareFrame(mFrame, &mBufferIndex, &mBufferOffset, 
 									  &mBuffer);
+		// allocBuffer will have applied the gain
+		mGain = 1.0f;
 		mVersion = mAudio->mVersion;
     }
     else if (mFrame < 0) {
@@ -694,6 +710,7 @@ PRIVATE void AudioCursor::incFrame()
                     // wait and let prepareFrame allocate it, since
                     // we may not need it
                     mBuffer = mAudio->mBuffers[mBufferIndex];
+                    mGain = mAudio->mGains[mBufferIndex];
                 }
                 else {
                     // fell off the edge of the index
@@ -727,8 +744,10 @@ PRIVATE void AudioCursor::incFrame()
             if (mBufferOffset >= mAudio->mBufferSize) {
                 mBufferIndex++;
                 mBufferOffset = 0;
-                if (mBufferIndex < mAudio->mBufferCount)
+                if (mBufferIndex < mAudio->mBufferCount) {
                     mBuffer = mAudio->mBuffers[mBufferIndex];
+                    mGain = mAudio->mGains[mBufferIndex];
+                }
                 else {
                     // fell off the edge of the index
                     // let prepareFrame handle it
@@ -801,7 +820,10 @@ PRIVATE void AudioCursor::get(AudioBuffer* buf, float* dest, float level)
 	// don't really need this, but if we did it would be better to pass
 	// in a feedback value that could be 0
 	bool replace = false;
-	bool doLevel = (level != 1.0f);
+
+	// fold in any gain left over from an Audio copy
+	float scale = level * mGain;
+	bool doLevel = (scale != 1.0f);
 
 	for (int i = 0 ; i < buf->channels ; i++) {
 		float sample = 0.0f;
@@ -809,7 +831,7 @@ PRIVATE void AudioCursor::get(AudioBuffer* buf, float* dest, float level)
 		  sample = mBuffer[mBufferOffset + i];
             
 		if (doLevel)
-		  sample *= level;
+		  sample *= scale;
 
 		sample = mFade.fade(sample);
 
@@ -844,6 +866,8 @@ PUBLIC void AudioCursor::put(AudioBuffer* buf, AudioOp op)
 
 		// since we're recording, have to flesh out the buffers as we go
 		prepareFrame();
+		if (mGain != 1.0f)
+		  applyGain();
 
 		for (int j = 0 ; j < channels ; j++) {
 			float sample = (src != NULL) ? src[j] : 0.0f;
@@ -879,6 +903,85 @@ PUBLIC void AudioCursor::put(AudioBuffer* buf, AudioOp op, Audio* a,
 	put(buf, op);
 }
 
+/****************************************************************************
+ *                                                                          *
+ *   								 MIX                                    *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Add a range of frames from another Audio into ours starting at
+ * the current frame.  This is the same as a get() from the source
+ * into an interrupt buffer followed by a put() with OpAdd, without
+ * the intermediate buffer.  Used by Layer when flattening segments.
+ *
+ * Rather than incrementing a frame at a time we work with the
+ * spans of samples that are contiguous in both Audios, which for 
+ * an interrupt block is almost always one span.  There are separate
+ * loops for unity level since that's the usual case.
+ *
+ * This only goes forward and does not apply the cursor fade, the
+ * caller must check.  Frames past the end of the source are silent.
+ */
+PUBLIC void AudioCursor::mix(Audio* src, long srcFrame, long frames,
+							 float level)
+{
+	int channels = mAudio->mChannels;
+	int bufferSize = mAudio->mBufferSize;
+	long destFrame = mFrame;
+
+	long available = src->mFrames - srcFrame;
+	if (frames > available)
+	  frames = available;
+
+	while (frames > 0) {
+		int destIndex, destOffset, srcIndex, srcOffset;
+		float* dest;
+
+		// since we're recording, have to flesh out the buffers as we go,
+		// this also applies any pending gain
+		destFrame = mAudio->prepareFrame(destFrame, &destIndex, &destOffset,
+										 &dest);
+		src->locate(srcFrame, &srcIndex, &srcOffset);
+
+		long span = (bufferSize - destOffset) / channels;
+		long srcSpan = (bufferSize - srcOffset) / channels;
+		if (srcSpan < span)
+		  span = srcSpan;
+		if (frames < span)
+		  span = frames;
+
+		float* source = src->getBuffer(srcIndex);
+		if (source != NULL) {
+			float scale = level * src->getGain(srcIndex);
+			float* s = &source[srcOffset];
+			float* d = &dest[destOffset];
+			long samples = span * channels;
+
+			if (scale == 1.0f) {
+				for (long i = 0 ; i < samples ; i++)
+				  d[i] += s[i];
+			}
+			else {
+				for (long i = 0 ; i < samples ; i++)
+				  d[i] += s[i] * scale;
+			}
+		}
+
+		destFrame += span;
+		srcFrame += span;
+		frames -= span;
+
+		// prepareFrame only extended to the first frame
+		if (destFrame > mAudio->mFrames)
+		  mAudio->mFrames = destFrame;
+	}
+
+	// positions are no longer valid
+	mFrame = destFrame;
+	decache();
+}
+
 /****************************************************************************
  *                                                                          *
  *   								 FADE                                   *
@@ -943,6 +1046,10 @@ PUBLIC void AudioCursor::fade(int offset, int frames, bool up)
 
 PUBLIC void AudioCursor::fade(int offset, int frames, bool up, float baseLevel)
 {
+	// if the version number changed, we have to recalculate position
+	if (mVersion != mAudio->mVersion)
+	  decache();
+
 	locateFrame();
 	if (mBuffer != NULL) {
 		mFade.activate(offset, up);
@@ -954,6 +1061,8 @@ PUBLIC void AudioCursor::fade(int offset, int frames, bool up, float baseLevel)
 			for (int j = 0 ; j < channels ; j++) {
 				// if mBuffer goes null, we fell off the end
 				if (mBuffer != NULL) {
+					if (mGain != 1.0f)
+					  applyGain();
 					float* loc = &(mBuffer[mBufferOffset + j]);
 					*loc = mFade.fade(*loc);
 				}
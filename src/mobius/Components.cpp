@@ -3353,7 +3353,7 @@ PUBLIC void FocusButton::mousePressed(MouseEvent* e)
 	mPushed = !mPushed;
 
     // simulate the FocusLock function
-    Action* a = new Action();
+    Action* a = mMobius->newAction();
     a->setFunction(FocusLock);
 
     // Action takes a 1 based track number, which is what we have
@@ -3626,7 +3626,7 @@ PUBLIC void TrackGroupButton::mousePressed(MouseEvent* e)
 {
     // cycle through the possible groups
     // simulate the TrackGroup function
-    Action* a = new Action();
+    Action* a = mMobius->newAction();
     a->setFunction(TrackGroup);
 
     // Action takes a 1 based track number, which is what we have
@@ -128,8 +128,8 @@ PUBLIC void EventType::move(Loop* l, Event* e, long newFrame)
 
 EventPool::EventPool()
 {
-    mEvents = NULL;
-    mAllocated = 0;
+    initObjectPool("Event");
+    prepare();
 }
 
 EventPool::~EventPool()
@@ -137,25 +137,27 @@ EventPool::~EventPool()
 }
 
 /**
- * Allocate an event from the pool.
+ * ObjectPool overload to create a new event.
+ * Normally called by the pool thread.
  */
-Event* EventPool::newEvent()
+PooledObject* EventPool::newObject()
 {
-    Event* e = NULL;
+    return new Event();
+}
 
-    if (mEvents != NULL) {
-        e = mEvents->getEvents();
-        if (e != NULL) {
-            mEvents->remove(e);
-            e->init();
-            e->setPooled(false);
-        }
-    }
+void EventPool::prepareObject(PooledObject* obj)
+{
+    ((Event*)obj)->init();
+}
 
-    if (e == NULL) {
-        e = new Event(this);
-        mAllocated++;
-    }
+/**
+ * Allocate an event from the pool.
+ */
+Event* EventPool::newEvent()
+{
+    Event* e = (Event*)alloc();
+    if (e != NULL)
+      e->init();
 
 	return e;
 }
@@ -227,9 +229,7 @@ void EventPool::freeEvent(Event* e, bool freeAll)
                 e->setAction(NULL);
             }
 
-            if (mEvents == NULL)
-              mEvents = new EventList();
-			mEvents->add(e);
+			free(e);
 		}
 	}
 }
@@ -251,43 +251,16 @@ void EventPool::freeEventList(Event* event)
     }
 }
 
-/**
- * Presumably called during application shutdown to reclaim the event
- * pool.  It has never been implemented.  I guess this means it leaks
- * of you bring VST plugins up and down.
- */
-void EventPool::flush()
-{
-	// do we really need this?
-}
-
-void EventPool::dump()
-{
-    int pooled = 0;
-    if (mEvents != NULL) {
-        for (Event* head = mEvents->getEvents() ; head != NULL ; 
-             head = head->getNext())
-          pooled++;
-    }
-
-    printf("EventPool: %d allocated, %d in the pool, %d in use\n",
-           mAllocated, pooled, mAllocated - pooled);
-    fflush(stdout);
-}
-
 /****************************************************************************
  *                                                                          *
  *                                   EVENT                                  *
  *                                                                          *
  ****************************************************************************/
 
-Event::Event(EventPool* pool)
+Event::Event()
 {
 	init();
 
-    mPool = pool;
-    mPooled = false;
-
 	// this is permanent
 	mOwned = false;
 
@@ -356,8 +329,9 @@ Event::~Event()
  */
 void Event::free()
 {
-    if (mPool != NULL)
-      mPool->freeEvent(this, false);
+    EventPool* pool = (EventPool*)getPool();
+    if (pool != NULL)
+      pool->freeEvent(this, false);
     else
       Trace(1, "Event::free no pool!\n");
 }
@@ -367,22 +341,13 @@ void Event::free()
  */
 void Event::freeAll()
 {
-    if (mPool != NULL)
-      mPool->freeEvent(this, true);
+    EventPool* pool = (EventPool*)getPool();
+    if (pool != NULL)
+      pool->freeEvent(this, true);
     else
       Trace(1, "Event::freeAll no pool!\n");
 }
 
-PUBLIC void Event::setPooled(bool b)
-{
-    mPooled = b;
-}
-
-PUBLIC bool Event::isPooled()
-{
-    return mPooled;
-}
-
 PUBLIC void Event::setOwned(bool b)
 {
     mOwned = b;
@@ -235,7 +235,6 @@ extern const char* GetSyncPulseTypeName(SyncPulseType type);
 class Event : public PooledObject {
 
     friend class EventPool;
-    friend class EventObjectPool;
     friend class EventList;
     friend class EventManager;
 
@@ -568,12 +567,9 @@ class Event : public PooledObject {
 
   protected:
 
-	Event(class EventPool* p);
+	Event();
 	~Event();
 
-    void setPooled(bool b);
-    bool isPooled();
-
     void setList(class EventList* list);
 
     void setNext(Event* e);
@@ -583,16 +579,6 @@ class Event : public PooledObject {
     void setParent(Event* e);
     void setSibling(Event* e);
 
-    /**
-     * Pool this event came from.
-     */
-    class EventPool* mPool;
-
-    /**
-     * True if the event is currently in the pool.
-     */
-    bool mPooled;
-
 	/**
 	 * The list the event is in. When non-null, this will be EventPool
 	 * if the event is pooled, or a scheduled event list maintained by a Loop.
@@ -727,26 +713,24 @@ class EventList {
 
 /**
  * Event pool.
+ * This is an ObjectPool so allocation in the interrupt is lock free
+ * and the pool thread keeps it filled.
  */
-class EventPool {
+class EventPool : public ObjectPool {
     
   public:
 
     EventPool();
     ~EventPool();
 
+    // ObjectPool implementations
+    PooledObject* newObject();
+    void prepareObject(PooledObject* o);
+
     Event* newEvent();
     void freeEvent(Event* e, bool freeAll);
     void freeEventList(Event* event);
 
-    void flush();
-    void dump();
-
-  private:
-
-    EventList* mEvents;
-    int mAllocated;
-
 };
 
 #endif
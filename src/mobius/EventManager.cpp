@@ -130,9 +130,12 @@
 
 #include "Action.h"
 #include "Event.h"
+#include "Layer.h"
 #include "Loop.h"
 #include "Mobius.h"
+#include "MobiusThread.h"
 #include "Mode.h"
+#include "ObjectPool.h"
 #include "Script.h"
 #include "Stream.h"
 #include "Synchronizer.h"
@@ -151,6 +154,11 @@ PUBLIC EventManager::EventManager(Track* track)
     mTrack = track;
 	mEvents = new EventList();
     mSwitch = NULL;
+    mCopyState = SWITCH_COPY_NONE;
+    mCopyTarget = NULL;
+    mCopySource = NULL;
+    mCopyPlay = NULL;
+    mCopyRecord = NULL;
 
     // special event we can inject at sync boundaries
 	mSyncEvent = newEvent();
@@ -214,6 +222,7 @@ PUBLIC Event* EventManager::getSwitchEvent()
 PUBLIC void EventManager::setSwitchEvent(Event* e)
 {
     mSwitch = e;
+    requestSwitchCopy();
 }
 
 PUBLIC bool EventManager::isSwitching()
@@ -946,6 +955,7 @@ PRIVATE void EventManager::flushAllEvents()
     }
 
 	mSwitch = NULL;
+    cancelSwitchCopy();
 }
 
 /**
@@ -961,6 +971,8 @@ PUBLIC void EventManager::flushEventsExceptScripts()
 	mSwitch = NULL;
 
 	mTrack->leaveCriticalSection();
+
+    cancelSwitchCopy();
 }
 
 /****************************************************************************
@@ -1328,6 +1340,9 @@ PUBLIC void EventManager::scheduleSwitchStack(Event* event)
 		mTrack->leaveCriticalSection();
 
 		Trace(mTrack, 2, "EventManger: Added switch stack event %s\n", event->type->name);
+
+        // a stacked Multiply or Overdub may turn this into a copy
+        requestSwitchCopy();
 	}
 	else {
 		Trace(mTrack, 2, "EventManager: Switch already committed, ignoring stacking of %s!\n",
@@ -1393,6 +1408,8 @@ PUBLIC bool EventManager::undoSwitchStack()
 				  undo->getName(), undo->getFunctionName());
             undoAndFree(undo);
             undone = true;
+
+            requestSwitchCopy();
 		}
 	}	
     return undone;
@@ -1412,6 +1429,8 @@ PUBLIC void EventManager::cancelSwitchStack(Event* e)
 
             // should we call undoEvent here?
             freeEvent(e);
+
+            requestSwitchCopy();
 		}	
 	}
 }
@@ -1433,6 +1452,8 @@ PUBLIC void EventManager::cancelSwitch()
         mSwitch = NULL;
 		switchEventUndo(e);
 
+        cancelSwitchCopy();
+
 		Trace(mTrack, 2, "EventManager: switch canceled\n");
 	}
 }
@@ -1448,6 +1469,208 @@ PUBLIC void EventManager::switchEventUndo(Event* e)
 	undoEvent(e);
 }
 
+/****************************************************************************
+ *                                                                          *
+ *                          SPECULATIVE SWITCH COPY                         *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * When a switch goes into an empty loop with EmptyLoopAction=copy, or
+ * has Overdub, Multiply or Stutter stacked, Loop::copySound gives the
+ * next loop two new layers that are copies of the current play layer.
+ * The copy only adds a segment referencing the source, but getting
+ * the layers from the pool, resetting them, sizing their Audios and
+ * allocating the segment all happened right on the switch frame.
+ *
+ * The switch is usually scheduled a cycle or more before it happens, so
+ * as soon as it is scheduled we pin the current play layer with an extra
+ * reference and ask MobiusThread to build both copies.  copySound just
+ * picks them up if the play layer is still the one we copied.
+ *
+ * There are no locks, the state is changed with PoolCas and each side
+ * only touches the other fields in the states it owns, see
+ * SwitchCopyState.  If the switch is canceled, retargeted, or the
+ * play layer changes, MobiusThread frees the copies and we release
+ * the pin the next time we look.  A new request made while the
+ * thread is still cleaning up is dropped and copySound does the copy
+ * itself.
+ */
+
+/**
+ * Decide which loop, if any, the pending switch is going to copy into.
+ * This is an approximation of what Loop::switchEvent does, if we guess
+ * wrong we either return the layers to the pool or copySound
+ * allocates them the old way.
+ */
+PRIVATE Loop* EventManager::getSwitchCopyTarget()
+{
+    Loop* target = NULL;
+
+    if (mSwitch != NULL) {
+        Loop* current = mTrack->getLoop();
+        Loop* next = mSwitch->fields.loopSwitch.nextLoop;
+
+        if (next != NULL && next != current && 
+            next->getFrames() == 0 && current->getFrames() > 0) {
+
+            Preset* p = mTrack->getPreset();
+            bool copy = (p->getEmptyLoopAction() == Preset::EMPTY_LOOP_COPY);
+
+            for (Event* e = mSwitch->getChildren() ; e != NULL && !copy ; 
+                 e = e->getSibling()) {
+                if (e->type == OverdubEvent || e->type == MultiplyEvent ||
+                    e->type == StutterEvent)
+                  copy = true;
+            }
+
+            if (copy)
+              target = next;
+        }
+    }
+
+    return target;
+}
+
+/**
+ * Called in the interrupt whenever the switch event, its target loop
+ * or the events stacked under it change.
+ */
+PUBLIC void EventManager::requestSwitchCopy()
+{
+    Loop* target = getSwitchCopyTarget();
+
+    if (target != mCopyTarget)
+      cancelSwitchCopy();
+
+    reclaimSwitchCopy();
+
+    if (target != NULL && mCopyState == SWITCH_COPY_NONE) {
+        Layer* source = mTrack->getLoop()->getPlayLayer();
+        if (source != NULL) {
+            // keep it from going back to the pool while the thread copies
+            source->incReferences();
+            mCopyTarget = target;
+            mCopySource = source;
+            if (PoolCas(&mCopyState, SWITCH_COPY_NONE, SWITCH_COPY_REQUESTED))
+              signalSwitchCopy();
+        }
+    }
+}
+
+/**
+ * Wake up MobiusThread to prepare or release a copy.
+ */
+PRIVATE void EventManager::signalSwitchCopy()
+{
+    MobiusThread* thread = mTrack->getMobius()->getThread();
+    if (thread != NULL)
+      thread->prepareSwitchCopy();
+}
+
+/**
+ * Called by MobiusThread to build the layers for a requested copy,
+ * or free the ones for a canceled copy.  The source layer can't be
+ * returned to the pool until the interrupt releases the pin.
+ */
+PUBLIC void EventManager::prepareSwitchCopy()
+{
+    if (PoolCas(&mCopyState, SWITCH_COPY_REQUESTED, SWITCH_COPY_PREPARING)) {
+        LayerPool* pool = mTrack->getMobius()->getLayerPool();
+
+        mCopyPlay = pool->newLayer(mCopyTarget);
+        mCopyPlay->copy(mCopySource);
+        mCopyRecord = pool->newLayer(mCopyTarget);
+        mCopyRecord->copy(mCopySource);
+
+        if (!PoolCas(&mCopyState, SWITCH_COPY_PREPARING, SWITCH_COPY_READY))
+          Trace(mTrack, 2, "EventManager: Switch changed during copy preparation\n");
+    }
+
+    if (mCopyState == SWITCH_COPY_CANCELED) {
+        if (mCopyPlay != NULL) {
+            mCopyPlay->free();
+            mCopyPlay = NULL;
+        }
+        if (mCopyRecord != NULL) {
+            mCopyRecord->free();
+            mCopyRecord = NULL;
+        }
+        PoolCas(&mCopyState, SWITCH_COPY_CANCELED, SWITCH_COPY_RELEASED);
+    }
+}
+
+/**
+ * Called by Loop::copySound at the switch frame.  If the layers
+ * were copied from the current play layer for this loop hand them over.
+ * If the play layer changed since the request they're stale and
+ * go back to MobiusThread.
+ */
+PUBLIC bool EventManager::takeSwitchCopy(Loop* dest, Layer* source,
+                                         Layer** play, Layer** record)
+{
+    bool taken = false;
+
+    reclaimSwitchCopy();
+
+    if (mCopyTarget == dest && mCopySource == source &&
+        PoolCas(&mCopyState, SWITCH_COPY_READY, SWITCH_COPY_NONE)) {
+
+        *play = mCopyPlay;
+        *record = mCopyRecord;
+        mCopyPlay = NULL;
+        mCopyRecord = NULL;
+
+        // the copies have their own references now so this
+        // can't return it to the pool
+        mCopySource->free();
+        mCopySource = NULL;
+        mCopyTarget = NULL;
+        taken = true;
+    }
+    else {
+        cancelSwitchCopy();
+    }
+
+    return taken;
+}
+
+/**
+ * Called when the switch is canceled, undone, or the events are flushed.
+ * The layers are freed by MobiusThread.
+ */
+PUBLIC void EventManager::cancelSwitchCopy()
+{
+    bool canceled = false;
+
+    long state = mCopyState;
+    while (!canceled && 
+           (state == SWITCH_COPY_REQUESTED || 
+            state == SWITCH_COPY_PREPARING ||
+            state == SWITCH_COPY_READY)) {
+
+        canceled = PoolCas(&mCopyState, state, SWITCH_COPY_CANCELED);
+        state = mCopyState;
+    }
+
+    if (canceled)
+      signalSwitchCopy();
+}
+
+/**
+ * Once MobiusThread has freed the copies release our pin on the 
+ * source layer.  This is an ordinary layer free, the same thing
+ * would have happened when the loop was done with it if we hadn't
+ * pinned it.
+ */
+PRIVATE void EventManager::reclaimSwitchCopy()
+{
+    Layer* source = mCopySource;
+
+    if (PoolCas(&mCopyState, SWITCH_COPY_RELEASED, SWITCH_COPY_NONE))
+      source->free();
+}
+
 /****************************************************************************
  *                                                                          *
  *                            PLAY JUMP SCHEDULING                          *
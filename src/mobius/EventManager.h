@@ -14,6 +14,24 @@
 
 #include "Preset.h"
 
+/**
+ * State of the speculative layer copy for a loop switch
+ * that will copy into an empty loop.  The interrupt moves
+ * from NONE to REQUESTED, READY to NONE, anything active to CANCELED
+ * and RELEASED to NONE.  MobiusThread moves from REQUESTED to PREPARING
+ * to READY, and from CANCELED to RELEASED.
+ */
+typedef enum {
+
+    SWITCH_COPY_NONE,
+    SWITCH_COPY_REQUESTED,
+    SWITCH_COPY_PREPARING,
+    SWITCH_COPY_READY,
+    SWITCH_COPY_CANCELED,
+    SWITCH_COPY_RELEASED
+
+} SwitchCopyState;
+
 /**
  * A class encapsulating Event management code for a Track.
  */
@@ -84,6 +102,14 @@ class EventManager {
     void switchEventUndo(Event* e);
     void cancelSwitch();
 
+    // Speculative Switch Copy
+
+    void requestSwitchCopy();
+    void prepareSwitchCopy();
+    bool takeSwitchCopy(class Loop* dest, class Layer* source,
+                        class Layer** play, class Layer** record);
+    void cancelSwitchCopy();
+
     // Play Jump Scheduling
 
     void getEffectiveLatencies(Loop* loop, Event* parent, long frame, 
@@ -146,6 +172,10 @@ class EventManager {
     void rescheduleEvents(Loop* loop, Event* previous);
     Event* getRescheduleEvents(Loop* loop, Event* previous);
 
+    class Loop* getSwitchCopyTarget();
+    void reclaimSwitchCopy();
+    void signalSwitchCopy();
+
     // the track that owns us
     class Track* mTrack;
 
@@ -155,6 +185,14 @@ class EventManager {
     // a pending switch "stacking" event
     class Event* mSwitch;
 
+    // layers copied by MobiusThread for a switch that will copy,
+    // mCopyState is a SwitchCopyState changed only with PoolCas
+    volatile long mCopyState;
+    class Loop* mCopyTarget;
+    class Layer* mCopySource;
+    class Layer* mCopyPlay;
+    class Layer* mCopyRecord;
+
     // special sync event we can inject
 	Event* mSyncEvent;
 	long mLastSyncEventFrame;
@@ -1047,6 +1047,11 @@ bool ExNode::isSymbol()
 	return false;
 }
 
+bool ExNode::isConstant()
+{
+	return false;
+}
+
 int ExNode::getPrecedence()
 {
 	return 0;
@@ -1128,6 +1133,11 @@ ExLiteral::ExLiteral(const char* str)
 	mValue.setString(str);
 }
 
+bool ExLiteral::isConstant()
+{
+	return true;
+}
+
 void ExLiteral::eval(ExContext* context, ExValue* value)
 {
 	value->set(&mValue);
@@ -1168,6 +1178,15 @@ const char* ExSymbol::getName()
 	return mName;
 }
 
+/**
+ * A symbol is constant once we've looked for a resolver and didn't
+ * find one, it will evaluate to its name from then on.
+ */
+bool ExSymbol::isConstant()
+{
+	return (mResolved && mResolver == NULL);
+}
+
 /**
  * If we have not looked for an ExResolver, do so now, but
  * only do this once.  If there is no resolver, the value is the
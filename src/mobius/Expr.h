@@ -274,6 +274,9 @@ class ExNode {
 
 	bool hasPrecedence(ExNode* other);
 
+    // true if evaluation will always produce the same value
+    virtual bool isConstant();
+
 	// runtime evaluation
 
 	virtual void toString(class Vbuf* b);
@@ -312,6 +315,7 @@ class ExLiteral : public ExNode {
 	ExLiteral(float f);
 	ExLiteral(const char* str);
 
+	bool isConstant();
 	void toString(class Vbuf* b);
 	void eval(ExContext* context, ExValue *value);
 
@@ -335,6 +339,7 @@ class ExSymbol : public ExNode {
 
 	const char* getName();
 	bool isSymbol();
+	bool isConstant();
 	void toString(class Vbuf* b);
 	void eval(ExContext* context, ExValue *value);
 
@@ -207,6 +207,22 @@
  * and selectively extract content from them.  This doesn't seem any easier
  * though and complicates saving the layer in a project since the Audio
  * doesn't have everything.
+ *
+ * IN PLACE WINDOWS
+ *
+ * Copying every block into the window is only necessary once feedback
+ * content is being merged into the Audio.  Until then, which is always
+ * the case for the initial recording and when flattening is disabled,
+ * the Audio contains nothing but new content and the window content
+ * is already sitting there.  Layer will call setInPlace and we just
+ * keep track of where the window is.  Fades are applied directly to the
+ * Audio, and a tail fade that overlaps the head window doesn't need
+ * to be applied twice since both windows see the same frames.
+ *
+ * Before anything else is added to the Audio, Layer calls capture() and
+ * we copy the window out of the Audio and behave as before from then on.
+ * A background fade does the same thing since it has to remove the
+ * foreground from the Audio first.
  */
 
 #include <stdio.h>
@@ -243,6 +259,8 @@ PUBLIC bool CovFwinFadeLeftShiftTotal = false;
 PUBLIC bool CovFwinFadeLeftShiftPartial = false;
 PUBLIC bool CovFwinFadeLocalRight = false;
 PUBLIC bool CovFwinFadeLocalLeft = false;
+PUBLIC bool CovFwinFadeInPlace = false;
+PUBLIC bool CovFwinCapture = false;
 
 PUBLIC void FadeWindow::initCoverage()
 {
@@ -258,6 +276,8 @@ PUBLIC void FadeWindow::initCoverage()
     CovFwinFadeLeftShiftPartial = false;
     CovFwinFadeLocalRight = false;
     CovFwinFadeLocalLeft = false;
+    CovFwinFadeInPlace = false;
+    CovFwinCapture = false;
 }
 
 PUBLIC void FadeWindow::showCoverage()
@@ -288,6 +308,10 @@ PUBLIC void FadeWindow::showCoverage()
       printf("  CovFwinFadeLocalRight\n");
     if (!CovFwinFadeLocalLeft)
       printf("  CovFwinFadeLocalLeft\n");
+    if (!CovFwinFadeInPlace)
+      printf("  CovFwinFadeInPlace\n");
+    if (!CovFwinCapture)
+      printf("  CovFwinCapture\n");
 
     fflush(stdout);
 }
@@ -308,6 +332,8 @@ PUBLIC FadeWindow::FadeWindow()
 {
 	mBufferSize = AUDIO_MAX_FADE_FRAMES * AUDIO_MAX_CHANNELS;
 	mBuffer = new float[mBufferSize];
+    mAudioCursor = new AudioCursor("window", NULL);
+    mInPlace = false;
     reset();
 }
 
@@ -319,6 +345,7 @@ PUBLIC void FadeWindow::reset()
     mReverse = false;
     mFrames = 0;
 	mCursor = 0;
+	mCaptured = !mInPlace;
 	mLastExternalFrame = 0;
 	mFull = false;
 	mLeftFrames = 0;
@@ -336,6 +363,17 @@ PUBLIC void FadeWindow::reset()
 PUBLIC FadeWindow::~FadeWindow()
 {
 	delete mBuffer;
+    delete mAudioCursor;
+}
+
+/**
+ * Called by Layer to let the window stay in the record Audio until
+ * it is captured.  Survives reset.
+ */
+PUBLIC void FadeWindow::setInPlace(bool b)
+{
+    mInPlace = b;
+    mCaptured = !b;
 }
 
 PUBLIC bool FadeWindow::isForegroundFaded()
@@ -444,7 +482,10 @@ PUBLIC void FadeWindow::add(LayerContext* con, long startFrame)
             prepare(con, mHeadWindow);
         }
 	   
-		add(src, frames);
+		if (mCaptured)
+		  add(src, frames);
+		else
+		  advance(frames);
     }
 
 	// Now that we've moved the window, can clear these.
@@ -481,6 +522,83 @@ PUBLIC void FadeWindow::add(float* src, long frames)
 	}
 }
 
+/**
+ * Account for frames that were put into the Audio without copying them.
+ * The cursor and fade move the same way add() would move them so
+ * a later capture lands where add() would have put things.
+ */
+PRIVATE void FadeWindow::advance(long frames)
+{
+	long cursorFrame = (mCursor / mChannels) + frames;
+	mCursor = (int)((cursorFrame % mWindowFrames) * mChannels);
+	mFrames += frames;
+
+	for (int i = 0 ; i < frames && mFade.active ; i++)
+	  mFade.inc(0, false);
+}
+
+/**
+ * Copy the window out of the Audio, called by Layer before it adds
+ * anything other than new content to the Audio.  After this the window
+ * content is maintained in mBuffer.
+ */
+PUBLIC void FadeWindow::capture(AudioCursor* cursor)
+{
+	if (!mCaptured) {
+		if (mFrames > 0) {
+			CovFwinCapture = true;
+
+			AudioBuffer ab;
+			ab.channels = mChannels;
+
+			// same arrangement as applyWindow, get adds so clear it first
+			memset(mBuffer, 0, sizeof(float) * mWindowFrames * mChannels);
+			Audio* audio = cursor->getAudio();
+			mAudioCursor->setAudio(audio);
+			mAudioCursor->setReverse(mReverse);
+			long startFrame = mAudioCursor->reflectFrame(getStartFrame());
+
+			locateEdges(0);
+
+			if (mRightFrames > 0) {
+				ab.buffer = mRightBuffer;
+				ab.frames = mRightFrames;
+				mAudioCursor->get(&ab, audio, startFrame, 1.0f);
+			}
+			if (mLeftFrames > 0) {
+				ab.buffer = mLeftBuffer;
+				ab.frames = mLeftFrames;
+				long srcFrame;
+				if (mReverse)
+				  srcFrame = startFrame - mRightFrames;
+				else
+				  srcFrame = startFrame + mRightFrames;
+				mAudioCursor->get(&ab, audio, srcFrame, 1.0f);
+			}
+		}
+		mCaptured = true;
+	}
+}
+
+/**
+ * Return the Audio frame of the oldest frame in the window,
+ * before reflection.
+ */
+PRIVATE long FadeWindow::getStartFrame()
+{
+    long startFrame = 0;
+
+    if (!mHeadWindow) {
+        // note that mLastExternalFrame is actually 1+ the last frame
+        // in this window
+		if (mFrames < mWindowFrames)
+		  startFrame = mLastExternalFrame - mFrames;
+		else
+		  startFrame = mLastExternalFrame - mWindowFrames;
+    }
+    return startFrame;
+}
+
 /**
  * Common utility method to locate the range of valid content in the window.
  * Have to save the result in transient instance variables, but better
@@ -544,7 +662,6 @@ PRIVATE void FadeWindow::locateEdges(int fadeFrames)
 PUBLIC void FadeWindow::applyWindow(AudioCursor* cursor, AudioOp op)
 {
     AudioBuffer ab;
-    long startFrame;
 
 	ab.channels = mChannels;
 
@@ -552,18 +669,7 @@ PUBLIC void FadeWindow::applyWindow(AudioCursor* cursor, AudioOp op)
     // Audio in reverse, so must also add in reverse
     cursor->setReverse(mReverse);
 
-    if (mHeadWindow)
-      startFrame = 0;
-    else {
-        // note that mLastExternalFrame is actually 1+ the last frame
-        // in this window
-		if (mFrames < mWindowFrames)
-		  startFrame = mLastExternalFrame - mFrames;
-		else
-		  startFrame = mLastExternalFrame - mWindowFrames;
-		  
-    }
-    startFrame = cursor->reflectFrame(startFrame);
+    long startFrame = cursor->reflectFrame(getStartFrame());
 
     locateEdges(0);
 
@@ -587,9 +693,32 @@ PUBLIC void FadeWindow::applyWindow(AudioCursor* cursor, AudioOp op)
 
 PUBLIC void FadeWindow::removeForeground(AudioCursor* cursor)
 {
+    // have to remember what we're taking out
+    capture(cursor);
     applyWindow(cursor, OpRemove);
 }
 
+/**
+ * Fade the window while it is still in place in the Audio.  
+ * The shift is the number of frames at the front of the window to leave
+ * alone.
+ */
+PRIVATE void FadeWindow::fadeInPlace(AudioCursor* cursor, long shift,
+                                     long fadeOffset, bool up, 
+                                     float baseLevel)
+{
+	long windowFrames = (mFrames < mWindowFrames) ? mFrames : mWindowFrames;
+	long frames = windowFrames - shift;
+
+	if (frames > 0) {
+        CovFwinFadeInPlace = true;
+		mAudioCursor->setAudio(cursor->getAudio());
+		mAudioCursor->setReverse(mReverse);
+		mAudioCursor->setFrame(mAudioCursor->reflectFrame(getStartFrame() + shift));
+		mAudioCursor->fade(fadeOffset, frames, up, baseLevel);
+	}
+}
+
 PUBLIC void FadeWindow::addForeground(AudioCursor* cursor)
 {
     applyWindow(cursor, OpAdd);
@@ -624,6 +753,15 @@ PUBLIC void FadeWindow::fadeForeground(AudioCursor* cursor,
           fadeOffset = mWindowFrames - mFrames;
     }
 
+    if (!mCaptured) {
+        // nothing else in the Audio, fade it there
+        fadeInPlace(cursor, 0, fadeOffset, up, baseLevel);
+        cursor->setReverse(saveReverse);
+        if (baseLevel == 1.0)
+          mForegroundFaded = true;
+        return;
+    }
+
     // first remove the window from the Audio, this also calls locateEdges
     removeForeground(cursor);
 
@@ -712,6 +850,14 @@ PUBLIC void FadeWindow::fadeForegroundShifted(AudioCursor* cursor,
           fadeOffset = fadeFrames - windowFrames;
     }
 
+    if (!mCaptured) {
+        fadeInPlace(cursor, shift, fadeOffset, up, 1.0f);
+        cursor->setReverse(saveReverse);
+        if (fadeFrames >= windowFrames)
+          mForegroundFaded = true;
+        return;
+    }
+
     // remove the window from the Audio, this also calls locateEdges
     removeForeground(cursor);
 
@@ -776,7 +922,8 @@ PUBLIC void FadeWindow::fadeForegroundShifted(AudioCursor* cursor,
  */
 PUBLIC void FadeWindow::fadeWindow(long startFrame, long fadeOffset)
 {
-	if (mFrames > 0) {
+	// if we're still in place we already saw the fade
+	if (mFrames > 0 && mCaptured) {
 		long baseFrame = 0;
 		if (!mHeadWindow)
 		  baseFrame = mLastExternalFrame - mFrames;
@@ -9,6 +9,10 @@
  * recorded audio over which a deferred fade may need to be applied.
  * Also used by PitchPlugin.
  *
+ * When used by Layer the window can be left "in place", tracking
+ * frames in the Audio being recorded rather than copying them,
+ * until something other than new content is added to the Audio.
+ *
  */
 
 #ifndef FADE_WINDOW_H
@@ -30,7 +34,9 @@ class FadeWindow {
     ~FadeWindow();
 
     void reset();
+    void setInPlace(bool b);
     void prepare(class LayerContext* con, bool head);
+    void capture(class AudioCursor* cursor);
     void add(class LayerContext* con, long externalFrame);
 	void add(float* src, long frames);
 	long getLastExternalFrame();
@@ -57,8 +63,12 @@ class FadeWindow {
 
   private:
 
+	void advance(long frames);
+	long getStartFrame();
 	void locateEdges(int fadeFrames);
 	void applyWindow(class AudioCursor* cursor, AudioOp op);
+	void fadeInPlace(class AudioCursor* cursor, long shift, long fadeOffset,
+					 bool up, float baseLevel);
 
     /** 
      * A buffer large enough to hold the maximum fade range with
@@ -71,6 +81,27 @@ class FadeWindow {
      */
     int mBufferSize;
 
+    /**
+     * True if the window may be left in place in the Audio it is
+     * being recorded into.  This is set once by Layer, Plugins always
+     * keep their own copy.
+     */
+    bool mInPlace;
+
+    /**
+     * True once the frames in the window have been copied into mBuffer.
+     * Until then they only exist in the Audio and mBuffer is unused.
+     * This starts out true unless mInPlace is set.
+     */
+    bool mCaptured;
+
+    /**
+     * Private cursor used to capture the window and fade it in place.
+     * We don't use the cursor Layer passes in for this since it
+     * may have a record fade in progress.
+     */
+    class AudioCursor* mAudioCursor;
+
     /**
      * True if this is a "head" window vs. a "tail" window.
      */
@@ -25,6 +25,7 @@
 class Function : public SystemConstant {
 
     friend class Mobius;
+    friend class MobiusShared;
     // don't like this
     friend class ScriptFunctionStatement;
 
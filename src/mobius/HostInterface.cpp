@@ -10,6 +10,8 @@
  */
 
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
 
 #include "Trace.h"
 #include "Util.h"
@@ -256,6 +258,138 @@ void PluginParameter::setValueString(const char* value)
     }
 }
 
+//////////////////////////////////////////////////////////////////////
+//
+// HostPort
+//
+//////////////////////////////////////////////////////////////////////
+
+PUBLIC HostPort::HostPort()
+{
+    for (int i = 0 ; i < MAX_HOST_BUFFER_CHANNELS ; i++)
+      mChannels[i] = NULL;
+    mInput = NULL;
+    mOutput = NULL;
+    mMaxFrames = 0;
+    mFrames = 0;
+    mInputPrepared = false;
+    mOutputPrepared = false;
+}
+
+PUBLIC HostPort::~HostPort()
+{
+    delete[] mInput;
+    delete[] mOutput;
+}
+
+PUBLIC void HostPort::allocate(long frames)
+{
+    if (frames > mMaxFrames) {
+        delete[] mInput;
+        delete[] mOutput;
+        mInput = new float[frames * MAX_HOST_BUFFER_CHANNELS];
+        mOutput = new float[frames * MAX_HOST_BUFFER_CHANNELS];
+        mMaxFrames = frames;
+    }
+}
+
+PUBLIC void HostPort::reset(long frames)
+{
+    for (int i = 0 ; i < MAX_HOST_BUFFER_CHANNELS ; i++)
+      mChannels[i] = NULL;
+
+    // should have been caught by the wrapper
+    if (frames > mMaxFrames)
+      frames = mMaxFrames;
+
+    mFrames = frames;
+    mInputPrepared = false;
+    mOutputPrepared = false;
+}
+
+PUBLIC void HostPort::setInput(int channel, float* buffer)
+{
+    if (channel >= 0 && channel < MAX_HOST_BUFFER_CHANNELS)
+      mChannels[channel] = buffer;
+}
+
+PUBLIC bool HostPort::isInputPrepared()
+{
+    return mInputPrepared;
+}
+
+PUBLIC bool HostPort::isOutputPrepared()
+{
+    return mOutputPrepared;
+}
+
+/**
+ * Interleave the host channels the first time we're asked.
+ * One channel at a time so the inner loop is a simple strided copy.
+ */
+PUBLIC float* HostPort::getInput()
+{
+    if (!mInputPrepared) {
+        int channels = MAX_HOST_BUFFER_CHANNELS;
+        for (int c = 0 ; c < channels ; c++) {
+            float* src = mChannels[c];
+            float* dest = mInput + c;
+            if (src == NULL) {
+                for (long i = 0 ; i < mFrames ; i++) {
+                    *dest = 0.0f;
+                    dest += channels;
+                }
+            }
+            else {
+                for (long i = 0 ; i < mFrames ; i++) {
+                    *dest = src[i];
+                    dest += channels;
+                }
+            }
+        }
+        mInputPrepared = true;
+    }
+    return mInput;
+}
+
+/**
+ * The engine adds to the output buffer so it starts out clear.
+ */
+PUBLIC float* HostPort::getOutput()
+{
+    if (!mOutputPrepared) {
+        memset(mOutput, 0, sizeof(float) * mFrames * MAX_HOST_BUFFER_CHANNELS);
+        mOutputPrepared = true;
+    }
+    return mOutput;
+}
+
+PUBLIC void HostPort::exportOutput(int channel, float* buffer, bool replace)
+{
+    if (buffer != NULL && channel >= 0 && channel < MAX_HOST_BUFFER_CHANNELS) {
+        if (mOutputPrepared) {
+            int channels = MAX_HOST_BUFFER_CHANNELS;
+            float* src = mOutput + channel;
+            if (replace) {
+                for (long i = 0 ; i < mFrames ; i++) {
+                    buffer[i] = *src;
+                    src += channels;
+                }
+            }
+            else {
+                for (long i = 0 ; i < mFrames ; i++) {
+                    buffer[i] += *src;
+                    src += channels;
+                }
+            }
+        }
+        else if (replace) {
+            // nothing used the port
+            memset(buffer, 0, sizeof(float) * mFrames);
+        }
+    }
+}
+
 //////////////////////////////////////////////////////////////////////
 //
 // HostSyncState
@@ -294,6 +428,10 @@ PUBLIC HostSyncState::HostSyncState()
     mPlaying = false;
     mLastSamplePosition = -1.0;
     mLastBeatPosition = -1.0;
+    mLastFrames = 0;
+    mMeasuredBeatsPerFrame = 0.0;
+    mBlockBeatsPerFrame = 0.0;
+    mBlockBeatsPerFrameRamp = 0.0;
 
     mResumed = false;
     mStopped = false;
@@ -467,6 +605,9 @@ PUBLIC void HostSyncState::advance(int frames,
         }
     }
 
+    // decide how fast the beat position moves through this buffer
+    updateBeatRate(frames, newBeatPosition);
+
     // set if we detect a beat in this buffer
     // don't trash mBeatBoundary yet, we still need it 
     bool newBeatBoundary = false;
@@ -482,7 +623,7 @@ PUBLIC void HostSyncState::advance(int frames,
         long newBeat = baseBeat;
 
         // determine the last ppqPos within this buffer
-        newBeatRange = newBeatPosition + (mBeatsPerFrame * (frames - 1));
+        newBeatRange = getBeatPosition(newBeatPosition, frames - 1);
 
         // determine if there is a beat boundary at the beginning
         // or within the current buffer, and set beatBoundary
@@ -511,8 +652,8 @@ PUBLIC void HostSyncState::advance(int frames,
                 // fringe case, crossing zero
                 (newBeatPosition < 0 && newBeatRange > 0)) {
                 newBeatBoundary = true;
-                newBeatOffset = (long)
-                    (((double)lastBeatInBuffer - newBeatPosition) / mBeatsPerFrame);
+                newBeatOffset = getBeatFrame(newBeatPosition, 
+                                             (double)lastBeatInBuffer);
                 newBeat = lastBeatInBuffer;
             }
         }
@@ -562,6 +703,9 @@ PUBLIC void HostSyncState::advance(int frames,
 
         // when we resume or jump, have to recalculate the beat counter
         if (mResumed || jumped) {
+            // the measured rate spans the jump, don't use it
+            mMeasuredBeatsPerFrame = 0.0;
+
             // !! this will be wrong if mBeatsPerBar is not an integer,
             // when would that happen?
             mBeatCount = (int)(baseBeat % (long)mBeatsPerBar);
@@ -643,6 +787,9 @@ PUBLIC void HostSyncState::advance(int frames,
     }
 
     // save state for the next interrupt
+    if (!mPlaying)
+      mMeasuredBeatsPerFrame = 0.0;
+    mLastFrames = frames;
     mLastSamplePosition = newSamplePosition;
     mLastBeatPosition = newBeatPosition;
     mLastBeatRange = newBeatRange;
@@ -656,6 +803,120 @@ PUBLIC void HostSyncState::advance(int frames,
       mBeatDecay++;
 }
 
+/**
+ * Advance over the next block of a host buffer that is being split.
+ *
+ * The host only gives us positions for the start of its buffer so
+ * we project them from the end of the last block.  The rate measured
+ * over the projected blocks is the rate we projected with, so beat
+ * detection continues as if the host had given us small buffers, and
+ * any error is absorbed by the measurement when the next real 
+ * buffer arrives.
+ *
+ * Positions stand still while the transport is stopped, otherwise
+ * the hosts we watch for position changes would appear to start.
+ */
+PUBLIC void HostSyncState::advanceBlock(int frames)
+{
+    double samplePosition = mLastSamplePosition;
+    double beatPosition = mLastBeatPosition;
+
+    if (mPlaying) {
+        samplePosition += mLastFrames;
+        beatPosition = getBeatPosition(mLastBeatPosition, mLastFrames);
+    }
+
+    advance(frames, samplePosition, beatPosition, false, mPlaying);
+}
+
+/**
+ * Decide the beat rate for the current buffer.
+ *
+ * The host only gives us the beat position at the start of each buffer
+ * and we only ask for the tempo every few buffers, so with large buffers
+ * and tempo ramps the nominal mBeatsPerFrame puts beats in the wrong
+ * place.  Instead measure the rate from the distance the beat position
+ * moved over the last buffer.  That is the average rate over the last
+ * buffer, which for a linear ramp is the rate at its middle.  The
+ * difference between two measurements gives the ramp, and we 
+ * project both forward to the start of this buffer.
+ *
+ * A measurement that is wildly different than the nominal rate means
+ * the transport moved on its own, then we fall back to the nominal rate.
+ */
+PRIVATE void HostSyncState::updateBeatRate(int frames, double beatPosition)
+{
+    double measured = 0.0;
+
+    if (mPlaying && !mResumed && !mAwaitingRewind && mLastFrames > 0 &&
+        beatPosition > mLastBeatPosition) {
+
+        measured = (beatPosition - mLastBeatPosition) / (double)mLastFrames;
+
+        if (mBeatsPerFrame > 0.0 &&
+            (measured < (mBeatsPerFrame / 2.0) ||
+             measured > (mBeatsPerFrame * 2.0)))
+          measured = 0.0;
+    }
+
+    if (measured <= 0.0) {
+        mBlockBeatsPerFrame = mBeatsPerFrame;
+        mBlockBeatsPerFrameRamp = 0.0;
+    }
+    else {
+        double ramp = 0.0;
+        if (mMeasuredBeatsPerFrame > 0.0)
+          ramp = (measured - mMeasuredBeatsPerFrame) / (double)mLastFrames;
+
+        mBlockBeatsPerFrame = measured + (ramp * mLastFrames / 2.0);
+        mBlockBeatsPerFrameRamp = ramp;
+    }
+
+    mMeasuredBeatsPerFrame = measured;
+}
+
+/**
+ * Calculate the beat position at a frame within the current buffer
+ * given the beat position at the start.
+ */
+PRIVATE double HostSyncState::getBeatPosition(double beatPosition, int frame)
+{
+    return beatPosition + (mBlockBeatsPerFrame * frame) +
+        (mBlockBeatsPerFrameRamp * frame * frame / 2.0);
+}
+
+/**
+ * Calculate the frame within the current buffer where the
+ * beat position reaches a beat.  With a ramp this is the positive
+ * root of:
+ *
+ *    (ramp / 2) * f^2 + rate * f - distance = 0
+ */
+PRIVATE int HostSyncState::getBeatFrame(double beatPosition, double beat)
+{
+    double distance = beat - beatPosition;
+    double rate = mBlockBeatsPerFrame;
+    double ramp = mBlockBeatsPerFrameRamp;
+    double frame = 0.0;
+
+    if (rate > 0.0) {
+        frame = distance / rate;
+        if (ramp != 0.0) {
+            // written this way to avoid cancellation when the
+            // ramp is tiny, which is most of the time
+            double disc = (rate * rate) + (2.0 * ramp * distance);
+            if (disc >= 0.0)
+              frame = (2.0 * distance) / (rate + sqrt(disc));
+        }
+    }
+
+    // round to the nearest frame
+    int offset = (int)(frame + 0.5);
+    if (offset < 0)
+      offset = 0;
+    return offset;
+}
+
 /**
  * Update state related to host transport changes.
  */
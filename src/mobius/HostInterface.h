@@ -47,6 +47,15 @@
  */
 #define MAX_HOST_BUFFER_FRAMES 4096
 
+/**
+ * Default number of frames we pass to the engine at a time.
+ * Host buffers larger than this are processed in several blocks
+ * so the engine's working set stays small no matter what the
+ * host decides to give us.  Must not be larger than 
+ * MAX_HOST_BUFFER_FRAMES.
+ */
+#define HOST_DEFAULT_BLOCK_FRAMES 512
+
 /**
  * Maximum number of "ports" supported by the plugin.  
  * Each port is currently a pair of stereo channels.
@@ -56,6 +65,74 @@
  */
 #define MAX_HOST_PLUGIN_PORTS 16
 
+//////////////////////////////////////////////////////////////////////
+//
+// HostPort
+//
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Processing state for one "port" we expose to the engine through
+ * the AudioStream.  A port is currently a pair of stereo channels.
+ *
+ * Hosts give us one buffer per channel and the engine wants
+ * interleaved frames.  At the start of each block the wrapper
+ * just points the port at the host's channel buffers, the conversion
+ * happens the first time the engine asks for the port.  Ports that no
+ * track uses are never converted.
+ */
+class HostPort {
+
+  public:
+
+    HostPort();
+    ~HostPort();
+
+    /**
+     * Make sure the interleaved buffers can hold this many frames.
+     * Not to be called in the interrupt.
+     */
+    void allocate(long frames);
+
+    /**
+     * Start a new block, forgetting the host buffers.
+     */
+    void reset(long frames);
+
+    /**
+     * Wrap one of the host's input channel buffers.
+     * Channels left NULL are silent.
+     */
+    void setInput(int channel, float* buffer);
+
+    bool isInputPrepared();
+    bool isOutputPrepared();
+
+    /**
+     * Interleaved buffers for the engine, converted on demand.
+     */
+    float* getInput();
+    float* getOutput();
+
+    /**
+     * Copy one channel of the engine's output to a host buffer.
+     * If the engine never asked for the port and we're replacing,
+     * the host buffer is cleared.
+     */
+    void exportOutput(int channel, float* buffer, bool replace);
+
+  private:
+
+    float* mChannels[MAX_HOST_BUFFER_CHANNELS];
+    float* mInput;
+    float* mOutput;
+    long mMaxFrames;
+    long mFrames;
+    bool mInputPrepared;
+    bool mOutputPrepared;
+
+};
+
 //////////////////////////////////////////////////////////////////////
 //
 // HostSyncState
@@ -95,6 +172,12 @@ class HostSyncState {
     void advance(int frames, double samplePosition, double beatPosition,
                  bool transportChanged, bool transportPlaying);
 
+    /**
+     * Advance over the next piece of a host buffer that is being
+     * processed in several blocks.
+     */
+    void advanceBlock(int frames);
+
     /**
      * Transfer our internal state into an AudioTime for the plugin.
      */
@@ -105,6 +188,10 @@ class HostSyncState {
     void updateTransport(double samplePosition, double beatPosition,
                          bool transportChanged, bool transportPlaying);
 
+    void updateBeatRate(int frames, double beatPosition);
+    double getBeatPosition(double beatPosition, int frame);
+    int getBeatFrame(double beatPosition, double beat);
+
 
 	/**
 	 * True to enable general state change trace.
@@ -215,6 +302,32 @@ class HostSyncState {
      */
     double mLastBeatPosition;
 
+    /**
+     * The number of frames in the last buffer.
+     */
+    int mLastFrames;
+
+    //
+    // Beat rate measured from the transport
+    //
+
+    /**
+     * The beats per frame measured over the last buffer, the distance
+     * between the last two beat positions divided by the buffer size.
+     * Zero if we don't have two consecutive playing buffers.
+     * This follows tempo changes immediately, mBeatsPerFrame only
+     * changes when the host gets around to telling us the new tempo.
+     */
+    double mMeasuredBeatsPerFrame;
+
+    /**
+     * The beats per frame we expect at the start of the current buffer
+     * and the change per frame when the tempo is ramping.  These are
+     * used to interpolate the beat position within the buffer.
+     */
+    double mBlockBeatsPerFrame;
+    double mBlockBeatsPerFrameRamp;
+
     //
     // State derived from advance()
     //
@@ -564,6 +677,12 @@ class PluginInterface {
 	 */
 	virtual int getPluginPorts() = 0;
 
+    /**
+     * Return the maximum number of frames to pass to the plugin in
+     * one block.  Host buffers larger than this are split.
+     */
+    virtual int getBlockFrames() = 0;
+
 	/**
 	 * Perform the expensive initialization.
 	 */
@@ -0,0 +1,389 @@
+/*
+ * Copyright (c) 2010 Jeffrey S. Larson  <jeff@circularlabs.com>
+ * All rights reserved.
+ * See the LICENSE file for the full copyright and license declaration.
+ * 
+ * ---------------------------------------------------------------------
+ * 
+ * Round trip latency measurement using a maximum length sequence.
+ * See LatencyCalibrator.h for the overview.
+ *
+ * This replaces the single frame ping, which depended on an echo 
+ * threshold and could only find whole frames.  Correlation uses the
+ * entire signal so it works at much lower levels and the shape of the 
+ * peak gives us the fraction.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Util.h"
+#include "Thread.h"
+#include "ObjectPool.h"
+#include "LatencyCalibrator.h"
+
+/****************************************************************************
+ *                                                                          *
+ *   							  CONSTANTS                                 *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Feedback masks for a Galois LFSR that produces a maximum length
+ * sequence, indexed by order.  Zero for the ones we don't support.
+ */
+PRIVATE int SequenceTaps[] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0x240,		// 10
+	0x500,		// 11
+	0xE08,		// 12
+	0x1C80,		// 13
+	0x3802,		// 14
+	0x6000,		// 15
+	0xD008		// 16
+};
+
+#define MIN_SEQUENCE_ORDER 10
+#define MAX_SEQUENCE_ORDER 16
+
+#define CALIBRATION_PI 3.14159265358979323846
+
+/**
+ * States of the loopback buffer handoff.  The pending buffer belongs
+ * to the interrupt when OFFERED or SWAPPING.  Threads outside the 
+ * interrupt must move it to BUSY before touching the pending buffer,
+ * setLoopback and releaseLoopback may be called from different threads.
+ */
+#define LOOPBACK_IDLE 0
+#define LOOPBACK_OFFERED 1
+#define LOOPBACK_SWAPPING 2
+#define LOOPBACK_RETURNED 3
+#define LOOPBACK_BUSY 4
+
+/****************************************************************************
+ *                                                                          *
+ *   						   LATENCY CALIBRATOR                           *
+ *                                                                          *
+ ****************************************************************************/
+
+PUBLIC LatencyCalibrator::LatencyCalibrator(int order, float amplitude)
+{
+	if (order < MIN_SEQUENCE_ORDER)
+	  order = MIN_SEQUENCE_ORDER;
+	else if (order > MAX_SEQUENCE_ORDER)
+	  order = MAX_SEQUENCE_ORDER;
+
+	mLength = (1 << order) - 1;
+	mFftSize = 1 << (order + 1);
+	mSequence = new float[mLength];
+	mCapture = new float[mFftSize];
+	mReferenceReal = new double[mFftSize];
+	mReferenceImag = new double[mFftSize];
+	mReal = new double[mFftSize];
+	mImag = new double[mFftSize];
+	mLoopback = NULL;
+	mLoopbackFrames = -1;
+	mLoopbackPosition = 0;
+	mPendingLoopback = NULL;
+	mPendingLoopbackFrames = -1;
+	mLoopbackSwap = LOOPBACK_IDLE;
+	mLatency = 0.0;
+	mConfidence = 0.0f;
+
+	generate(order, amplitude);
+
+	// transform the sequence once, zero padded to the capture length
+	for (int i = 0 ; i < mFftSize ; i++) {
+		mReferenceReal[i] = (i < mLength) ? mSequence[i] : 0.0;
+		mReferenceImag[i] = 0.0;
+	}
+	fft(mReferenceReal, mReferenceImag, false);
+
+	reset();
+}
+
+PUBLIC LatencyCalibrator::~LatencyCalibrator()
+{
+	delete[] mSequence;
+	delete[] mCapture;
+	delete[] mReferenceReal;
+	delete[] mReferenceImag;
+	delete[] mReal;
+	delete[] mImag;
+	delete[] mLoopback;
+	delete[] mPendingLoopback;
+}
+
+/**
+ * Build the sequence from a Galois LFSR, the output bit
+ * becomes a positive or negative sample.
+ */
+PRIVATE void LatencyCalibrator::generate(int order, float amplitude)
+{
+	int taps = SequenceTaps[order];
+	int state = 1;
+
+	for (int i = 0 ; i < mLength ; i++) {
+		int bit = state & 1;
+		state >>= 1;
+		if (bit)
+		  state ^= taps;
+		mSequence[i] = (bit ? amplitude : -amplitude);
+	}
+}
+
+/**
+ * The interrupt may be using the current buffer so the new one is 
+ * offered to it and swapped in at the start of the next block.
+ * If the last one hasn't been taken yet we take it back.
+ * We wait while the interrupt is swapping or another thread
+ * owns the pending buffer, neither takes long.
+ */
+PUBLIC void LatencyCalibrator::setLoopback(int frames)
+{
+	while (!PoolCas(&mLoopbackSwap, LOOPBACK_IDLE, LOOPBACK_BUSY) &&
+		   !PoolCas(&mLoopbackSwap, LOOPBACK_OFFERED, LOOPBACK_BUSY) &&
+		   !PoolCas(&mLoopbackSwap, LOOPBACK_RETURNED, LOOPBACK_BUSY))
+	  SleepMillis(1);
+
+	// whatever is pending now is ours, an untaken offer or
+	// the one the interrupt replaced
+	delete[] mPendingLoopback;
+	mPendingLoopback = NULL;
+
+	mPendingLoopbackFrames = frames;
+	if (frames > 0) {
+		mPendingLoopback = new float[frames];
+		memset(mPendingLoopback, 0, sizeof(float) * frames);
+	}
+
+	PoolCas(&mLoopbackSwap, LOOPBACK_BUSY, LOOPBACK_OFFERED);
+}
+
+/**
+ * Free the loopback the interrupt replaced.  
+ * Called periodically outside the interrupt.
+ */
+PUBLIC void LatencyCalibrator::releaseLoopback()
+{
+	if (PoolCas(&mLoopbackSwap, LOOPBACK_RETURNED, LOOPBACK_BUSY)) {
+		delete[] mPendingLoopback;
+		mPendingLoopback = NULL;
+		PoolCas(&mLoopbackSwap, LOOPBACK_BUSY, LOOPBACK_IDLE);
+	}
+}
+
+/**
+ * Called at the start of each interrupt to pick up a new loopback.
+ * The old one goes back in the pending slot to be freed outside.
+ */
+PRIVATE void LatencyCalibrator::swapLoopback()
+{
+	if (PoolCas(&mLoopbackSwap, LOOPBACK_OFFERED, LOOPBACK_SWAPPING)) {
+		float* old = mLoopback;
+		mLoopback = mPendingLoopback;
+		mLoopbackFrames = mPendingLoopbackFrames;
+		mLoopbackPosition = 0;
+		mPendingLoopback = old;
+		PoolCas(&mLoopbackSwap, LOOPBACK_SWAPPING, LOOPBACK_RETURNED);
+	}
+}
+
+PUBLIC void LatencyCalibrator::reset()
+{
+	mPhase = 0;
+	mWarm = false;
+	mCaptured = 0;
+	mReady = false;
+}
+
+PUBLIC bool LatencyCalibrator::isReady()
+{
+	return mReady;
+}
+
+PUBLIC double LatencyCalibrator::getLatency()
+{
+	return mLatency;
+}
+
+PUBLIC float LatencyCalibrator::getConfidence()
+{
+	return mConfidence;
+}
+
+/**
+ * Called in the interrupt.  The sequence is added to every channel
+ * of the output.  Capture waits until one full period has been
+ * played, and then for a period boundary.
+ */
+PUBLIC void LatencyCalibrator::interrupt(float* input, float* output,
+										 long frames, int channels)
+{
+	swapLoopback();
+
+	for (long i = 0 ; i < frames ; i++) {
+		float sample = mSequence[mPhase];
+		long base = i * channels;
+
+		if (output != NULL) {
+			for (int c = 0 ; c < channels ; c++)
+			  output[base + c] += sample;
+		}
+
+		float returned = 0.0f;
+		if (mLoopbackFrames == 0)
+		  returned = sample;
+		else if (mLoopback != NULL) {
+			returned = mLoopback[mLoopbackPosition];
+			mLoopback[mLoopbackPosition] = sample;
+			mLoopbackPosition++;
+			if (mLoopbackPosition >= mLoopbackFrames)
+			  mLoopbackPosition = 0;
+		}
+		else if (input != NULL)
+		  returned = input[base];
+
+		if (!mReady && mWarm && (mCaptured > 0 || mPhase == 0)) {
+			mCapture[mCaptured++] = returned;
+			if (mCaptured >= mFftSize)
+			  mReady = true;
+		}
+
+		mPhase++;
+		if (mPhase >= mLength) {
+			mPhase = 0;
+			mWarm = true;
+		}
+	}
+}
+
+/**
+ * Correlate the capture with the sequence.  Called outside the
+ * interrupt.
+ *
+ * The capture is twice the sequence length, with the sequence zero
+ * padded to the same length the circular correlation from the FFTs 
+ * is the linear correlation for every lag in one period.  Since the 
+ * capture started on a period boundary, the lag of the peak is the
+ * latency.  A parabola through the peak and its neighbors gives
+ * the fraction.
+ */
+PUBLIC bool LatencyCalibrator::analyze()
+{
+	if (!mReady)
+	  return false;
+
+	for (int i = 0 ; i < mFftSize ; i++) {
+		mReal[i] = mCapture[i];
+		mImag[i] = 0.0;
+	}
+
+	// let the interrupt start another capture
+	mCaptured = 0;
+	mReady = false;
+
+	fft(mReal, mImag, false);
+
+	// multiply by the conjugate of the reference
+	for (int i = 0 ; i < mFftSize ; i++) {
+		double a = mReal[i];
+		double b = mImag[i];
+		double c = mReferenceReal[i];
+		double d = mReferenceImag[i];
+		mReal[i] = (a * c) + (b * d);
+		mImag[i] = (b * c) - (a * d);
+	}
+
+	fft(mReal, mImag, true);
+
+	// an inverting interface is still a peak
+	int peak = 0;
+	double peakValue = 0.0;
+	for (int i = 0 ; i < mLength ; i++) {
+		double value = fabs(mReal[i]);
+		if (value > peakValue) {
+			peakValue = value;
+			peak = i;
+		}
+	}
+
+	// largest sidelobe away from the peak
+	double sidelobe = 0.0;
+	for (int i = 0 ; i < mLength ; i++) {
+		int distance = abs(i - peak);
+		if (distance > 2 && distance < mLength - 2) {
+			double value = fabs(mReal[i]);
+			if (value > sidelobe)
+			  sidelobe = value;
+		}
+	}
+
+	double fraction = 0.0;
+	if (peak > 0 && peak < mLength - 1) {
+		double before = fabs(mReal[peak - 1]);
+		double after = fabs(mReal[peak + 1]);
+		double denom = before - (2.0 * peakValue) + after;
+		if (denom != 0.0)
+		  fraction = 0.5 * (before - after) / denom;
+	}
+
+	mLatency = peak + fraction;
+	mConfidence = (peakValue > 0.0) ? (float)(1.0 - (sidelobe / peakValue)) : 0.0f;
+
+	return true;
+}
+
+/**
+ * In place iterative radix 2 FFT.  The inverse is scaled.
+ */
+PRIVATE void LatencyCalibrator::fft(double* real, double* imag, bool inverse)
+{
+	int n = mFftSize;
+
+	// bit reversal
+	for (int i = 1, j = 0 ; i < n ; i++) {
+		int bit = n >> 1;
+		for ( ; j & bit ; bit >>= 1)
+		  j ^= bit;
+		j ^= bit;
+		if (i < j) {
+			double t = real[i]; real[i] = real[j]; real[j] = t;
+			t = imag[i]; imag[i] = imag[j]; imag[j] = t;
+		}
+	}
+
+	for (int len = 2 ; len <= n ; len <<= 1) {
+		double angle = 2.0 * CALIBRATION_PI / len * (inverse ? 1.0 : -1.0);
+		double wReal = cos(angle);
+		double wImag = sin(angle);
+		int half = len >> 1;
+		for (int start = 0 ; start < n ; start += len) {
+			double uReal = 1.0;
+			double uImag = 0.0;
+			for (int k = 0 ; k < half ; k++) {
+				int a = start + k;
+				int b = a + half;
+				double tReal = (real[b] * uReal) - (imag[b] * uImag);
+				double tImag = (real[b] * uImag) + (imag[b] * uReal);
+				real[b] = real[a] - tReal;
+				imag[b] = imag[a] - tImag;
+				real[a] += tReal;
+				imag[a] += tImag;
+				double next = (uReal * wReal) - (uImag * wImag);
+				uImag = (uReal * wImag) + (uImag * wReal);
+				uReal = next;
+			}
+		}
+	}
+
+	if (inverse) {
+		for (int i = 0 ; i < n ; i++) {
+			real[i] /= n;
+			imag[i] /= n;
+		}
+	}
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2010 Jeffrey S. Larson  <jeff@circularlabs.com>
+ * All rights reserved.
+ * See the LICENSE file for the full copyright and license declaration.
+ * 
+ * ---------------------------------------------------------------------
+ * 
+ * Round trip latency measurement using a maximum length sequence.
+ *
+ */
+
+#ifndef LATENCY_CALIBRATOR_H
+#define LATENCY_CALIBRATOR_H
+
+/****************************************************************************
+ *                                                                          *
+ *   							  CONSTANTS                                 *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Order of the sequence used for calibration.  The sequence is
+ * 2^order - 1 frames long and the latency has to be less than that,
+ * 15 gives us about 740 milliseconds at 44.1k.
+ */
+#define CALIBRATION_SEQUENCE_ORDER 15
+
+/**
+ * Amplitude of the calibration sequence.
+ */
+#define CALIBRATION_SEQUENCE_AMPLITUDE 0.5f
+
+/**
+ * Order of the sequence used by the background latency monitor,
+ * about 370 milliseconds at 44.1k.
+ */
+#define MONITOR_SEQUENCE_ORDER 14
+
+/**
+ * Amplitude of the monitor sequence.  This is played continuously
+ * so keep it low, the correlation pulls it out of the noise.
+ */
+#define MONITOR_SEQUENCE_AMPLITUDE 0.05f
+
+/**
+ * The confidence we require before believing a measurement.
+ * Confidence is 1 minus the ratio of the largest correlation 
+ * sidelobe to the peak.  A clean loopback is close to 1, 
+ * an unconnected port close to 0.
+ */
+#define CALIBRATION_MIN_CONFIDENCE 0.5f
+
+/****************************************************************************
+ *                                                                          *
+ *   						   LATENCY CALIBRATOR                           *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Plays a maximum length sequence and captures what comes back.
+ * The latency is the lag of the peak of the cross correlation
+ * between the two, interpolated to a fraction of a frame.
+ *
+ * The sequence repeats so once the first period has made it through
+ * the system the return is a circular shift of the sequence and a 
+ * capture starting on any period boundary can be used.  This lets the 
+ * same object run continuously on a spare port to watch for drift.
+ *
+ * interrupt() is called in the audio interrupt and does nothing but 
+ * copy.  analyze() does the FFTs and must be called outside the
+ * interrupt once isReady() returns true, after that another
+ * capture begins on the next period boundary.
+ *
+ * Everything is allocated up front.
+ */
+class LatencyCalibrator {
+
+  public:
+
+	LatencyCalibrator(int order, float amplitude);
+	~LatencyCalibrator();
+
+	/**
+	 * Ignore the input and feed the output back to ourselves
+	 * after this many frames.  Stands in for a loopback cable
+	 * when testing.  Negative to use the real input.
+	 * Called outside the interrupt, the interrupt picks up the
+	 * new buffer at the start of the next block.
+	 */
+	void setLoopback(int frames);
+
+	/**
+	 * Free the loopback buffer the interrupt replaced.
+	 * Called periodically outside the interrupt.
+	 */
+	void releaseLoopback();
+
+	/**
+	 * Start over with the sequence.
+	 */
+	void reset();
+
+	/**
+	 * Add the sequence to an interleaved output buffer and
+	 * capture the first channel of the input.
+	 */
+	void interrupt(float* input, float* output, long frames, int channels);
+
+	/**
+	 * True when a capture is waiting to be analyzed.
+	 */
+	bool isReady();
+
+	/**
+	 * Analyze the capture, returns false if there wasn't one.
+	 */
+	bool analyze();
+
+	double getLatency();
+	float getConfidence();
+
+  private:
+
+	void generate(int order, float amplitude);
+	void fft(double* real, double* imag, bool inverse);
+	void swapLoopback();
+
+	// the sequence
+	float* mSequence;
+	int mLength;
+	int mPhase;
+	bool mWarm;
+
+	// the capture, long enough for a linear correlation over
+	// a full period of lags
+	float* mCapture;
+	int mFftSize;
+	int mCaptured;
+	volatile bool mReady;
+
+	// transform of the sequence and the work area
+	double* mReferenceReal;
+	double* mReferenceImag;
+	double* mReal;
+	double* mImag;
+
+	// simulated loopback
+	float* mLoopback;
+	int mLoopbackFrames;
+	int mLoopbackPosition;
+
+	// loopback handed to the interrupt, and the one it replaced
+	// on the way back, mLoopbackSwap is a LOOPBACK_ state
+	float* mPendingLoopback;
+	int mPendingLoopbackFrames;
+	volatile long mLoopbackSwap;
+
+	// last result
+	double mLatency;
+	float mConfidence;
+
+};
+
+#endif
@@ -113,6 +113,17 @@
  * RED_HIGH_GREEN_LOW is a very usable orange.
  * RED_MED_GREEN_LOW is a good dark orange.
  *
+ * BUFFERING
+ *
+ * Refreshing a page can change a lot of LEDs at once, switching
+ * pages changes nearly all of them.  Sent one at a time you can see
+ * the page "wipe" across the grid.  Instead we use the LP's double
+ * buffering: refreshCell and refreshButton just remember what changed,
+ * then at the end of the refresh we write the changes to the hidden
+ * buffer and flip it to the front with one message.  When more than
+ * half the LEDs change we use the channel 3 rapid update which sends
+ * all 80 LEDs two at a time in 40 messages.
+ *
  */
 
 #include <stdio.h>
@@ -122,6 +133,7 @@
 #include <ctype.h>
 
 #include "Util.h"
+#include "Thread.h"
 #include "MidiByte.h"
 #include "MidiEvent.h"
 #include "MidiInterface.h"
@@ -254,6 +266,25 @@
 #define INNER_GRID_COLUMNS 8
 #define INNER_GRID_ROWS 8
 
+/**
+ * Rapid update always sends all 80 LEDs in 40 messages, if more
+ * changed than this it is cheaper than sending them individually.
+ */
+#define RAPID_UPDATE_THRESHOLD 40
+
+/**
+ * MIDI channel used for rapid update notes.
+ */
+#define RAPID_UPDATE_CHANNEL 2
+
+/**
+ * Buffer control value sent with CC 0.  Bits 0 and 2 are the
+ * displayed and updated buffers, bit 4 copies the new displayed
+ * buffer into the new update buffer.
+ */
+#define BUFFER_CONTROL 0x20
+#define BUFFER_COPY 0x10
+
 //////////////////////////////////////////////////////////////////////
 //
 // Constructor/Properties
@@ -268,6 +299,9 @@ Launchpad::Launchpad(Mobius* m)
     mMixerPage = PAGE_MIXER_VOLUME;
 
     mSessionLoops = 4;
+    mChanges = 0;
+    mUpdateBuffer = 0;
+    mCsect = new CriticalSection("Launchpad");
 
     initButtons(COLOR_OFF);
     initGrid(COLOR_OFF);
@@ -275,6 +309,7 @@ Launchpad::Launchpad(Mobius* m)
 
 Launchpad::~Launchpad()
 {
+    delete mCsect;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -285,14 +320,18 @@ Launchpad::~Launchpad()
 
 PRIVATE void Launchpad::initButtons(int color)
 {
-    for (int button = 0 ; button < TOP_BUTTONS ; button++)
-      mButtons[button] = color;
+    for (int button = 0 ; button < TOP_BUTTONS ; button++) {
+        mButtons[button] = color;
+        mButtonChanged[button] = false;
+    }
 }
 
 PRIVATE void Launchpad::initGrid(int color)
 {
-    for (int cell = 0 ; cell < GRID_CELLS ; cell++)
-      mGrid[cell] = color;
+    for (int cell = 0 ; cell < GRID_CELLS ; cell++) {
+        mGrid[cell] = color;
+        mGridChanged[cell] = false;
+    }
 }
 
 PRIVATE void Launchpad::resetLaunchpad()
@@ -314,6 +353,33 @@ PRIVATE void Launchpad::setGridMappingMode(bool drum)
     event->free();
 }
 
+/**
+ * Select the displayed and updated LED buffers.
+ */
+PRIVATE void Launchpad::setBuffers(int display, int update, bool copy)
+{
+    MobiusContext* con = mMobius->getContext();
+    MidiInterface* midi = con->getMidiInterface();
+    int value = BUFFER_CONTROL | (update << 2) | display;
+    if (copy)
+      value |= BUFFER_COPY;
+    MidiEvent* event = midi->newEvent(MS_CONTROL, 0, 0, value);
+    midi->send(event);
+    event->free();
+}
+
+/**
+ * Display the buffer we've been updating and start updating the
+ * other one.  The copy flag makes the new update buffer match what
+ * is displayed so incremental changes continue to work.
+ */
+PRIVATE void Launchpad::swapBuffers()
+{
+    int display = mUpdateBuffer;
+    mUpdateBuffer = (display == 0) ? 1 : 0;
+    setBuffers(display, mUpdateBuffer, true);
+}
+
 //////////////////////////////////////////////////////////////////////
 //
 // Export
@@ -321,22 +387,33 @@ PRIVATE void Launchpad::setGridMappingMode(bool drum)
 //////////////////////////////////////////////////////////////////////
 
 /**
- * Called periodically to send Mobius runtime state to the launchpad.
+ * Called periodically by MobiusThread to send Mobius runtime state 
+ * to the launchpad.  Button presses come in on the MIDI thread and
+ * also change the page and write to the LED buffers, so both hold
+ * the csect.
  */
 PUBLIC void Launchpad::refresh()
 {
+    mCsect->enter("Launchpad::refresh");
+
     if (!mInitialized) {
         // clear out everything so incremental updates aren't fooled
         // by false positives
         initButtons(COLOR_BUTTON_DEFAULT);
         initGrid(COLOR_OFF);
 
-        sendButtons();
-        sendGrid();
+        // display 0 and update 1, what is in 1 doesn't matter
+        // since rapid update sends everything
+        mUpdateBuffer = 1;
+        setBuffers(0, mUpdateBuffer, false);
+        sendRapid();
+        swapBuffers();
         mInitialized = true;
     }
     
     refreshPage();
+
+    mCsect->leave("Launchpad::refresh");
 }
 
 PRIVATE void Launchpad::refreshPage()
@@ -355,6 +432,69 @@ PRIVATE void Launchpad::refreshPage()
             refreshMixer();
             break;
     }   
+
+    flush();
+}
+
+/**
+ * Send the cells and buttons that changed during a refresh to the
+ * update buffer and display it.
+ */
+PRIVATE void Launchpad::flush()
+{
+    if (mChanges > RAPID_UPDATE_THRESHOLD) {
+        sendRapid();
+    }
+    else if (mChanges > 0) {
+        for (int button = 0 ; button < TOP_BUTTONS ; button++) {
+            if (mButtonChanged[button])
+              sendButton(button, mButtons[button]);
+        }
+        for (int cell = 0 ; cell < GRID_CELLS ; cell++) {
+            if (mGridChanged[cell])
+              sendCell(cell, mGrid[cell]);
+        }
+    }
+
+    if (mChanges > 0) {
+        for (int button = 0 ; button < TOP_BUTTONS ; button++)
+          mButtonChanged[button] = false;
+        for (int cell = 0 ; cell < GRID_CELLS ; cell++)
+          mGridChanged[cell] = false;
+        mChanges = 0;
+        swapBuffers();
+    }
+}
+
+/**
+ * Send every LED with rapid update notes, two colors per note.
+ * The order is the 8x8 grid by rows, the scene buttons on the right
+ * from top to bottom, then the top buttons from left to right.
+ * Any other message resets the rapid update position so there
+ * is nothing to terminate.
+ */
+PRIVATE void Launchpad::sendRapid()
+{
+    MobiusContext* con = mMobius->getContext();
+    MidiInterface* midi = con->getMidiInterface();
+    char colors[(INNER_GRID_ROWS * INNER_GRID_COLUMNS) + GRID_ROWS + TOP_BUTTONS];
+    int count = 0;
+
+    for (int row = 0 ; row < INNER_GRID_ROWS ; row++) {
+        for (int col = 0 ; col < INNER_GRID_COLUMNS ; col++)
+          colors[count++] = mGrid[(row * GRID_COLUMNS) + col];
+    }
+    for (int row = 0 ; row < GRID_ROWS ; row++)
+      colors[count++] = mGrid[(row * GRID_COLUMNS) + ARROW_CELL_COLUMN];
+    for (int button = 0 ; button < TOP_BUTTONS ; button++)
+      colors[count++] = mButtons[button];
+
+    for (int i = 0 ; i < count ; i += 2) {
+        MidiEvent* event = midi->newEvent(MS_NOTEON, RAPID_UPDATE_CHANNEL,
+                                          colors[i], colors[i+1]);
+        midi->send(event);
+        event->free();
+    }
 }
 
 PRIVATE void Launchpad::sendButton(int button, int color)
@@ -368,18 +508,14 @@ PRIVATE void Launchpad::sendButton(int button, int color)
     event->free();
 }
 
-PRIVATE void Launchpad::sendButtons()
-{
-    for (int button = 0 ; button < TOP_BUTTONS ; button++) {
-        sendButton(button, mButtons[button]);
-    }
-}
-
 PRIVATE void Launchpad::refreshButton(int button, int color)
 {
     if (mButtons[button] != color) {
-        sendButton(button, color);
         mButtons[button] = color;
+        if (!mButtonChanged[button]) {
+            mButtonChanged[button] = true;
+            mChanges++;
+        }
     }
 }
 
@@ -435,19 +571,14 @@ PRIVATE void Launchpad::sendCell(int cell, int color)
     event->free();
 }
 
-PRIVATE void Launchpad::sendGrid()
-{
-    for (int cell = 0 ; cell < GRID_CELLS ; cell++) {
-        sendCell(cell, mGrid[cell]);
-    }
-
-}
-
 PRIVATE void Launchpad::refreshCell(int cell, int color)
 {
     if (mGrid[cell] != color) {
-        sendCell(cell, color);
         mGrid[cell] = color;
+        if (!mGridChanged[cell]) {
+            mGridChanged[cell] = true;
+            mChanges++;
+        }
     }
 }
 
@@ -514,7 +645,9 @@ bool Launchpad::handleEvent(MidiEvent* event)
             int cell = keyToCell(event->getKey());
             if (status == MS_NOTEON && cell >= 0) {
                 bool down = (event->getVelocity() > 0);
+                mCsect->enter("Launchpad::handleEvent");
                 handleGridButton(cell, down);
+                mCsect->leave("Launchpad::handleEvent");
                 handled = true;
             }
             else {
@@ -527,7 +660,9 @@ bool Launchpad::handleEvent(MidiEvent* event)
             if (cc >= BUTTON_BASE && cc <= BUTTON_LAST) {
                 int button = cc - BUTTON_BASE;
                 bool down = (event->getVelocity() > 0);
+                mCsect->enter("Launchpad::handleEvent");
                 handleTopButton(button, down);
+                mCsect->leave("Launchpad::handleEvent");
                 handled = true;
             }
             else {
@@ -644,6 +779,8 @@ PRIVATE void Launchpad::handleGridButton(int cell, bool down)
         else {
             sendCell(cell, mGrid[cell]);
         }
+        // this went to the hidden buffer
+        swapBuffers();
     }
 }
 
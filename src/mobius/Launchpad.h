@@ -53,7 +53,6 @@ class Launchpad : public ControlSurface
     int panToRow(int value);
 
     void sendButton(int button, int color);
-    void sendButtons();
     void refreshButton(int button, int color);
     void refreshArrows(int color);
     void refreshArrows(int offset, int color);
@@ -64,7 +63,10 @@ class Launchpad : public ControlSurface
     void refreshColumn(int column, int row, int span, int color);
 
     void sendCell(int cell, int color);
-    void sendGrid();
+    void sendRapid();
+    void setBuffers(int display, int update, bool copy);
+    void swapBuffers();
+    void flush();
     void refreshCell(int button, int color);
     void refreshGrid(int color);
     void refreshInnerGrid(int color);
@@ -95,6 +97,18 @@ class Launchpad : public ControlSurface
     char mButtons[TOP_BUTTONS];
     char mGrid[GRID_CELLS];
 
+    // cells changed since the last flush
+    bool mButtonChanged[TOP_BUTTONS];
+    bool mGridChanged[GRID_CELLS];
+    int mChanges;
+
+    // the LED buffer we're writing to, the other one is displayed
+    int mUpdateBuffer;
+
+    // guards the page and LED state, refresh runs in MobiusThread
+    // and button presses arrive on the MIDI thread
+    class CriticalSection* mCsect;
+
 };
 
 /****************************************************************************/
@@ -488,7 +488,6 @@ Layer::Layer(LayerPool* lpool, AudioPool* apool)
 {
     mLayerPool = lpool;
     mAudioPool = apool;
-	mPooled = false;
 	mPrev = NULL;
 	mRedo = NULL;
     mNumber = 0;
@@ -531,7 +530,9 @@ Layer::Layer(LayerPool* lpool, AudioPool* apool)
 
 	mSmoother = new Smoother();
     mHeadWindow = new FadeWindow();
+    mHeadWindow->setInPlace(true);
     mTailWindow = new FadeWindow();
+    mTailWindow->setInPlace(true);
 
     mPlayCursor = new AudioCursor("play", mAudio);
     mCopyCursor = new AudioCursor("copy", mAudio);
@@ -581,7 +582,10 @@ void Layer::reset()
 {
 	mAudio->reset();
 	mOverdub->reset();
+    // splice may have taken these out of place
+    mHeadWindow->setInPlace(true);
     mHeadWindow->reset();
+    mTailWindow->setInPlace(true);
     mTailWindow->reset();
 
     resetSegments();
@@ -696,7 +700,9 @@ Layer* Layer::spawn()
 
 	mSegments = NULL;
     mHeadWindow = new FadeWindow();
+    mHeadWindow->setInPlace(true);
     mTailWindow = new FadeWindow();
+    mTailWindow->setInPlace(true);
 	mAudio = mAudioPool->newAudio();
     mRecordCursor->setAudio(mAudio);
     mFeedbackCursor->setAudio(mAudio);
@@ -743,23 +749,29 @@ void Layer::setAllocation(int i)
 
 int Layer::getReferences()
 {
-    return mReferences;
+    return (int)mReferences;
 }
 
+/**
+ * MobiusThread adds and removes references to the play layer
+ * when it prepares the layers for a loop switch copy, so the
+ * count has to be atomic.
+ */
 void Layer::incReferences()
 {
-    mReferences++;
+    PoolAdd(&mReferences, 1);
 }
 
 int Layer::decReferences()
 {
-	if (mReferences > 0)
-	  mReferences--;
-	else {
-		printf("Layer::decReferences: invalid reference count %d\n", 
-			   mReferences);
+    long refs = PoolAdd(&mReferences, -1);
+	if (refs < 0) {
+		printf("Layer::decReferences: invalid reference count %ld\n", 
+			   refs + 1);
+        PoolAdd(&mReferences, 1);
+        refs = 0;
 	}
-    return mReferences;
+    return (int)refs;
 }
 
 void Layer::setReferences(int i)
@@ -1462,6 +1474,17 @@ void Layer::setSegments(Segment* list)
 	mSegments = list;
 }
 
+/**
+ * Remove the segment list without freeing it.
+ * Used by WindowFunction to reuse the segments when the window moves.
+ */
+Segment* Layer::detachSegments()
+{
+    Segment* list = mSegments;
+    mSegments = NULL;
+    return list;
+}
+
 /****************************************************************************
  *                                                                          *
  *                                   FADES                                  *
@@ -1938,6 +1961,9 @@ PRIVATE void Layer::checkRecording(LayerContext* con, long startFrame)
 
 	// keep a moving window for intermediate fades
 	if (startFrame >= 0) {
+		// advanceInternal is about to flatten into the frames we add
+		if (!mNoFlattening && mSegments != NULL)
+		  captureWindows();
 		mHeadWindow->add(con, startFrame);
 		mTailWindow->add(con, startFrame);
 		mRecordable = true;
@@ -1968,6 +1994,17 @@ PRIVATE void Layer::startRecordFade(LayerContext* con)
 	  mOverdubCursor->startFadeIn();
 }
 
+/**
+ * Called before something other than new content is added to the
+ * local Audio.  Until then the fade windows only track where the new
+ * content is, after this they need their own copy.
+ */
+PRIVATE void Layer::captureWindows()
+{
+    mHeadWindow->capture(mRecordCursor);
+    mTailWindow->capture(mRecordCursor);
+}
+
 /**
  * Perform a retroactive fade out to the end of the last recorded region.
  * Called by checkRecording as we detect gaps in the recording.
@@ -3229,19 +3266,28 @@ void Layer::advanceInternal(LayerContext* con, long startFrame, int feedback)
 		if (feedback < AUTO_FEEDBACK_LEVEL)
 		  mFeedbackApplied = true;
 
+		// usually done by checkRecording, but not if we're just advancing
+		captureWindows();
+
 		// reflect the region in reverse
 		long regionStart = reflectRegion(con, startFrame, con->frames);
 		long regionFrames = con->frames;
 		long copyStart = regionStart;
 		long copyFrames = regionFrames;
 
+		// after feedback settles we can usually skip the copy buffer
+		bool direct = (!con->isReverse() && 
+					   isDirectCopy(regionStart, regionFrames));
+
 		// first copy into a temporary buffer applying feedback adjustments
 		LayerContext* cc = mLayerPool->getCopyContext();
 		float* copyBuffer = cc->buffer;
-		memset(copyBuffer, 0, sizeof(float) * (regionFrames * con->channels));
 		cc->setLevel(mSmoother->getValue());
 
 		mSmoother->setTarget(feedback);
+		if (!direct || mSmoother->isActive())
+		  memset(copyBuffer, 0, sizeof(float) * (regionFrames * con->channels));
+
 		if (mSmoother->isActive()) {
 
 			// Copy one frame at a time until the feedback adjusts.
@@ -3279,15 +3325,23 @@ void Layer::advanceInternal(LayerContext* con, long startFrame, int feedback)
 		mFeedback = feedback;
 
 		// copy the remainder after feedback ramping
+		long bufferFrames = regionFrames;
 		if (copyFrames > 0) {
-			cc->frames = copyFrames;
-			get(cc, copyStart, false);
+			if (direct) {
+				copyDirect(copyStart, copyFrames, cc->getLevel());
+				bufferFrames -= copyFrames;
+			}
+			else {
+				cc->frames = copyFrames;
+				get(cc, copyStart, false);
+			}
 		}
 
 		// restore the beginning of the buffer and add it to this layer
 		cc->buffer = copyBuffer;
-		cc->frames = regionFrames;
-		mFeedbackCursor->put(cc, OpAdd, mAudio, regionStart);
+		cc->frames = bufferFrames;
+		if (bufferFrames > 0)
+		  mFeedbackCursor->put(cc, OpAdd, mAudio, regionStart);
 
 		// Now adjust the segments so that the portion we just copied
 		// is no longer included, set the noFade flags since the
@@ -3296,6 +3350,74 @@ void Layer::advanceInternal(LayerContext* con, long startFrame, int feedback)
 	}
 }
 
+/**
+ * Check to see if a region can be flattened with copyDirect.
+ * This is the usual case once the previous layer has been flattened
+ * itself: every segment we pass over references a layer that has
+ * nothing but local audio, and we're not near a segment edge fade.
+ * The region must already be reflected, though we only do this
+ * when going forward.
+ */
+PRIVATE bool Layer::isDirectCopy(long startFrame, long frames)
+{
+	bool direct = !mFeedbackCursor->isFading();
+	long lastFrame = startFrame + frames - 1;
+
+	for (Segment* s = mSegments ; s != NULL && direct ; s = s->getNext()) {
+		long segFirst = s->getOffset();
+		long segLast = segFirst + s->getFrames() - 1;
+
+		if (segFirst <= lastFrame && segLast >= startFrame) {
+			long first = (segFirst > startFrame) ? segFirst : startFrame;
+			long last = (segLast < lastFrame) ? segLast : lastFrame;
+			Layer* src = s->getLayer();
+
+			direct = (src != NULL &&
+					  src->mSegments == NULL &&
+					  !src->mCopyCursor->isFading() &&
+					  !s->isFading(first - segFirst, last - first + 1));
+		}
+	}
+
+	return direct;
+}
+
+/**
+ * Fused form of the flattening copy in advanceInternal.
+ * Rather than getting the segments into the copy buffer and then
+ * putting the copy buffer into our Audio, each segment adds the 
+ * referenced audio directly with the feedback level.  Levels are 
+ * calculated the same way as Segment::get.
+ */
+PRIVATE void Layer::copyDirect(long startFrame, long frames, float level)
+{
+	long lastFrame = startFrame + frames - 1;
+
+	for (Segment* s = mSegments ; s != NULL ; s = s->getNext()) {
+		long segFirst = s->getOffset();
+		long segLast = segFirst + s->getFrames() - 1;
+
+		if (segFirst <= lastFrame && segLast >= startFrame) {
+			long first = (segFirst > startFrame) ? segFirst : startFrame;
+			long last = (segLast < lastFrame) ? segLast : lastFrame;
+
+			float segLevel = level;
+			int segFeedback = s->getFeedback();
+			if (segFeedback < 127)
+			  segLevel *= AudioFade::getRampValue(segFeedback);
+
+			// same audibility cutoff as Segment::get
+			if (segLevel > 0.000062) {
+				long srcFrame = s->getStartFrame() + (first - segFirst);
+				mFeedbackCursor->setAudio(mAudio);
+				mFeedbackCursor->setFrame(first);
+				mFeedbackCursor->mix(s->getLayer()->mAudio, srcFrame,
+									 last - first + 1, segLevel);
+			}
+		}
+	}
+}
+
 /**
  * Helper for Replace mode (feedback == 0) and incremental flattening.
  * Restructure the segment list to occlude a region of continguous
@@ -3708,6 +3830,14 @@ PUBLIC void Layer::splice(LayerContext* con, long startFrame, long frames,
 		pruneSegments();
     }
 
+	// The windows can't stay in place once the Audio has been spliced
+	// and faded, and it may already contain flattened background so 
+	// they can't go back in place when they're reset below.
+	// They're put back in place when the layer is reset.
+	captureWindows();
+	mHeadWindow->setInPlace(false);
+	mTailWindow->setInPlace(false);
+
 	// Splice out the region of local audio
 	mAudio->splice(startFrame, frames);
     // NOTE: the Isolated Overdub parameter was experimental and no longer exposed
@@ -4646,6 +4776,7 @@ PRIVATE void Layer::raiseBackgroundHead(LayerContext* con)
     }
 
 	long startFrame = reflectFrame(con, 0);
+	captureWindows();
 	mRecordCursor->setReverse(con->isReverse());
 	mRecordCursor->put(&fc, OpAdd, startFrame);
 
@@ -4720,6 +4851,7 @@ PRIVATE void Layer::checkMaxUndo()
         Layer* extras = oldest->getPrev();
         if (extras != NULL) {
             oldest->setPrev(NULL);
+            mLoop->getHistoryIndex()->trim(oldest);
             
             // should be only one, but there could be more if
             // the parameter changed after building a list
@@ -4731,6 +4863,358 @@ PRIVATE void Layer::checkMaxUndo()
             extras->freeAll();
         }
     }
+
+    checkAudioQuota();
+}
+
+/**
+ * After checking MaxUndo, if we're sharing audio buffers with other
+ * instances and they're under pressure, give up the oldest undo layer
+ * if we're over our quota.  Only one layer is freed each time so
+ * the history shrinks gradually, and we always keep the previous
+ * layer for the same reason checkMaxUndo does.
+ */
+PRIVATE void Layer::checkAudioQuota()
+{
+    if (mAudioPool->isOverQuota()) {
+        Layer* last = mPrev;
+        if (last != NULL && last->getPrev() != NULL) {
+            Layer* oldest = last->getPrev();
+            while (oldest->getPrev() != NULL) {
+                last = oldest;
+                oldest = oldest->getPrev();
+            }
+            last->setPrev(NULL);
+            mLoop->getHistoryIndex()->trim(last);
+            Trace(this, 2, "Freeing undo layer over audio quota\n");
+            oldest->freeAll();
+        }
+    }
+}
+
+/****************************************************************************
+ *                                                                          *
+ *                               HISTORY INDEX                              *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * States for the array handoff between MobiusThread and the interrupt.
+ * The thread owns the pending arrays in IDLE and RETURNED, the
+ * interrupt owns them in OFFERED.
+ */
+#define HISTORY_SWAP_IDLE 0
+#define HISTORY_SWAP_OFFERED 1
+#define HISTORY_SWAP_RETURNED 2
+
+HistoryIndex::HistoryIndex()
+{
+    mFirst = 0;
+    mCount = 0;
+    mMax = HISTORY_INDEX_INITIAL_LAYERS;
+    mTruncated = false;
+    mWanted = 0;
+    mPendingLayers = NULL;
+    mPendingNumbers = NULL;
+    mPendingOffsets = NULL;
+    mPendingMax = 0;
+    mSwap = HISTORY_SWAP_IDLE;
+
+    allocate(mMax, &mLayers, &mNumbers, &mOffsets);
+}
+
+HistoryIndex::~HistoryIndex()
+{
+    delete[] mLayers;
+    delete[] mNumbers;
+    delete[] mOffsets;
+    delete[] mPendingLayers;
+    delete[] mPendingNumbers;
+    delete[] mPendingOffsets;
+}
+
+PRIVATE void HistoryIndex::allocate(int max, Layer*** layers, int** numbers,
+                                    long** offsets)
+{
+    *layers = new Layer*[max];
+    *numbers = new int[max];
+    *offsets = new long[max];
+}
+
+/**
+ * Forget everything, called when the loop is reset.
+ */
+void HistoryIndex::reset()
+{
+    mFirst = 0;
+    mCount = 0;
+    mTruncated = false;
+}
+
+/**
+ * Called by MobiusThread to allocate larger arrays when we're 
+ * getting close to running out, and to delete the ones the
+ * interrupt gave back.  mCount and mFirst may be changing
+ * while we look at them but they're only used to decide whether
+ * to grow, the interrupt does the copy.
+ */
+void HistoryIndex::maintain()
+{
+    if (mSwap == HISTORY_SWAP_RETURNED) {
+        delete[] mPendingLayers;
+        delete[] mPendingNumbers;
+        delete[] mPendingOffsets;
+        mPendingLayers = NULL;
+        mPendingNumbers = NULL;
+        mPendingOffsets = NULL;
+        mPendingMax = 0;
+        PoolCas(&mSwap, HISTORY_SWAP_RETURNED, HISTORY_SWAP_IDLE);
+    }
+
+    if (mSwap == HISTORY_SWAP_IDLE) {
+        int max = mMax;
+        int needed = (mCount - mFirst) + HISTORY_INDEX_HEADROOM;
+        if (needed < mWanted + HISTORY_INDEX_HEADROOM)
+          needed = mWanted + HISTORY_INDEX_HEADROOM;
+
+        if (needed > max) {
+            while (max < needed)
+              max *= 2;
+            allocate(max, &mPendingLayers, &mPendingNumbers, &mPendingOffsets);
+            mPendingMax = max;
+            PoolCas(&mSwap, HISTORY_SWAP_IDLE, HISTORY_SWAP_OFFERED);
+        }
+    }
+}
+
+/**
+ * Move the layers down over the ones trimmed from the front.
+ */
+PRIVATE void HistoryIndex::compact()
+{
+    if (mFirst > 0) {
+        int remaining = mCount - mFirst;
+        for (int i = 0 ; i < remaining ; i++) {
+            mLayers[i] = mLayers[mFirst + i];
+            mNumbers[i] = mNumbers[mFirst + i];
+            mOffsets[i] = mOffsets[mFirst + i];
+        }
+        mFirst = 0;
+        mCount = remaining;
+    }
+}
+
+/**
+ * Called in the interrupt to pick up the larger arrays allocated
+ * by maintain() if there are any.  The old arrays are given back
+ * to the thread to delete.
+ */
+PRIVATE void HistoryIndex::swap()
+{
+    if (mSwap == HISTORY_SWAP_OFFERED) {
+        compact();
+
+        Layer** layers = mPendingLayers;
+        int* numbers = mPendingNumbers;
+        long* offsets = mPendingOffsets;
+        int max = mPendingMax;
+        for (int i = 0 ; i < mCount ; i++) {
+            layers[i] = mLayers[i];
+            numbers[i] = mNumbers[i];
+            offsets[i] = mOffsets[i];
+        }
+
+        mPendingLayers = mLayers;
+        mPendingNumbers = mNumbers;
+        mPendingOffsets = mOffsets;
+        mPendingMax = mMax;
+
+        mLayers = layers;
+        mNumbers = numbers;
+        mOffsets = offsets;
+        mMax = max;
+
+        PoolCas(&mSwap, HISTORY_SWAP_OFFERED, HISTORY_SWAP_RETURNED);
+    }
+}
+
+/**
+ * Bring the index up to date with the history ending in the given layer.
+ * We walk back from the last layer until we find one we already
+ * have, everything after that one is removed (undo) and the layers we
+ * passed on the way are added (shift).  If we don't find anything
+ * the history was replaced and we start over.  Normally this only 
+ * touches the layers that changed since the last refresh.
+ *
+ * This is called in the interrupt so we can't grow the arrays here.
+ * If there isn't room we keep only the newest layers, ask maintain()
+ * for more, and start over once we have it.
+ */
+void HistoryIndex::refresh(Layer* last)
+{
+    int found = -1;
+    int added = 0;
+
+    swap();
+
+    if (mTruncated && mWanted <= mMax) {
+        mFirst = 0;
+        mCount = 0;
+        mTruncated = false;
+    }
+
+    for (Layer* l = last ; l != NULL && found < 0 ; l = l->getPrev()) {
+        found = locate(l);
+        if (found < 0)
+          added++;
+    }
+
+    if (found >= 0)
+      mCount = found + 1;
+    else {
+        mFirst = 0;
+        mCount = 0;
+    }
+
+    if (added > 0) {
+        int needed = (mCount - mFirst) + added;
+        if (needed > mMax - mFirst)
+          compact();
+
+        if (needed > mMax) {
+            // remember how many we wanted, and drop the oldest
+            if (needed > mWanted)
+              mWanted = needed;
+            mTruncated = true;
+            if (added >= mMax) {
+                added = mMax;
+                mFirst = 0;
+                mCount = 0;
+            }
+            else {
+                int drop = needed - mMax;
+                for (int i = 0 ; i < mCount - drop ; i++) {
+                    mLayers[i] = mLayers[drop + i];
+                    mNumbers[i] = mNumbers[drop + i];
+                    mOffsets[i] = mOffsets[drop + i];
+                }
+                mCount -= drop;
+            }
+        }
+
+        mCount += added;
+        Layer* l = last;
+        for (int i = mCount - 1 ; i >= mCount - added ; i--) {
+            mLayers[i] = l;
+            mNumbers[i] = l->getNumber();
+            mOffsets[i] = l->getHistoryOffset();
+            l = l->getPrev();
+        }
+    }
+}
+
+/**
+ * Called by Layer when the layers before this one have been
+ * removed from the undo list.
+ */
+void HistoryIndex::trim(Layer* oldest)
+{
+    int found = locate(oldest);
+    if (found >= 0)
+      mFirst = found;
+    else {
+        // never refreshed with this layer, let the next refresh rebuild
+        mFirst = 0;
+        mCount = 0;
+    }
+}
+
+/**
+ * Return the position of the last layer whose history offset
+ * is less than or equal to the given offset, -1 if the offset is
+ * before the oldest layer.  Empty layers share the offset of the
+ * layer that follows them, since we take the last one
+ * they will never be returned.
+ */
+PRIVATE int HistoryIndex::locate(long offset)
+{
+    int found = -1;
+    int low = mFirst;
+    int high = mCount - 1;
+
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        if (mOffsets[mid] <= offset) {
+            found = mid;
+            low = mid + 1;
+        }
+        else
+          high = mid - 1;
+    }
+
+    return found;
+}
+
+/**
+ * Return the position of a layer in the index, -1 if we don't have it.
+ */
+PRIVATE int HistoryIndex::locate(Layer* layer)
+{
+    int found = -1;
+    int number = layer->getNumber();
+
+    // check the empty layers that share this offset too
+    for (int i = locate(layer->getHistoryOffset()) ; 
+         i >= mFirst && found < 0 ; i--) {
+        if (mLayers[i] == layer && mNumbers[i] == number)
+          found = i;
+        else if (mOffsets[i] != layer->getHistoryOffset())
+          break;
+    }
+
+    return found;
+}
+
+/**
+ * Return the total number of frames in the history.
+ */
+long HistoryIndex::getFrames()
+{
+    long frames = 0;
+    if (mCount > mFirst)
+      frames = mOffsets[mCount - 1] + mLayers[mCount - 1]->getFrames();
+    return frames;
+}
+
+/**
+ * Return the position of the layer containing a history frame,
+ * -1 if it isn't in the history.
+ */
+int HistoryIndex::find(long offset)
+{
+    int found = -1;
+    if (offset < getFrames())
+      found = locate(offset);
+    return found;
+}
+
+/**
+ * Return the position of the last layer, layers between the one 
+ * returned by find() and this one follow it on the timeline.
+ */
+int HistoryIndex::getLast()
+{
+    return mCount - 1;
+}
+
+Layer* HistoryIndex::getLayer(int index)
+{
+    return mLayers[index];
+}
+
+long HistoryIndex::getOffset(int index)
+{
+    return mOffsets[index];
 }
 
 /****************************************************************************
@@ -4744,20 +5228,29 @@ PRIVATE void Layer::checkMaxUndo()
  * objects.  Now that we pool Audio buffers this is less necessary but an
  * allocation interface like this is still necessary to manage the
  * reference count.
+ *
+ * This is an ObjectPool so MobiusThread can allocate and free layers
+ * while it prepares a loop switch copy without locking the interrupt
+ * out.  Layers are big so we only keep a few of them ready.
  */
 PUBLIC LayerPool::LayerPool(AudioPool* aupool)
 {
+    initObjectPool("Layer");
     mAudioPool = aupool;
-    mLayers = NULL;
     mCounter = 0;
     mAllocated = 0;
     mMuteLayer = NULL;
     mCopyContext = NULL;
+
+    mLowWater = 4;
+    mHighWater = 16;
+    prepare();
 }
 
 /**
  * This can only be called during shutdown when we know we won't
  * be in an interrupt trying to allocate layers.
+ * ObjectPool deletes the layers we're holding.
  */
 PUBLIC LayerPool::~LayerPool()
 {
@@ -4766,9 +5259,24 @@ PUBLIC LayerPool::~LayerPool()
     // return to the pool first for statistics
     if (mMuteLayer != NULL) 
       freeLayer(mMuteLayer);
+}
 
-    // this will delete the prev pointer chain
-    delete mLayers;
+/**
+ * ObjectPool overload to create a new layer.
+ */
+PUBLIC PooledObject* LayerPool::newObject()
+{
+    Layer* layer = new Layer(this, mAudioPool);
+    layer->setAllocation((int)PoolAdd(&mAllocated, 1) - 1);
+    return layer;
+}
+
+/**
+ * ObjectPool overload to initialize a layer coming out of the pool.
+ */
+PUBLIC void LayerPool::prepareObject(PooledObject* o)
+{
+    ((Layer*)o)->reset();
 }
 
 /**
@@ -4811,28 +5319,18 @@ PUBLIC Layer* LayerPool::getMuteLayer()
 /**
  * Allocate a new layer, use the pool if available.
  * Loop may be NULL here for special layer constants like MuteLayer.
+ *
+ * This is usually called in the interrupt but MobiusThread may also
+ * allocate layers ahead of a loop switch.
  */
 Layer* LayerPool::newLayer(Loop* loop)
 {
-	Layer* layer = mLayers;
-
-	if (layer == NULL) {
-        layer = new Layer(this, mAudioPool);
-        layer->setAllocation(mAllocated++);
-    }
-	else {
-        // pool is chained by the prev pointer...confusing!
-		mLayers = layer->getPrev();
-		if (!layer->mPooled)
-		  Trace(1, "Layer:  Layer in pool not marked as pooled\n");
-		layer->mPooled = false;
-		layer->reset();
-		layer->setPrev(NULL);
-	}
+	Layer* layer = (Layer*)alloc();
+    prepareObject(layer);
 
     // tag with a unique number for debugging, unlike
     // mAllocated this one can be reset
-    layer->setNumber(mCounter++);
+    layer->setNumber((int)PoolAdd(&mCounter, 1) - 1);
 
 	layer->setReferences(1);
 
@@ -4856,34 +5354,21 @@ Layer* LayerPool::newLayer(Loop* loop)
 }
 
 /**
- * Return a layer to the pool.
+ * Release a reference to a layer, and return it to the pool
+ * when there are no more.
  */
 void LayerPool::freeLayer(Layer* layer)
 {
 	if (layer != NULL) {
-		if (layer->mPooled)
+		if (layer->isPooled())
 		  Trace(1, "Layer: Attempt to free layer already in the pool!\n");
 		else {
 			int refs = layer->decReferences();
 			if (refs <= 0) {
 				layer->reset();
-				layer->setPrev(mLayers);
-				layer->mPooled = true;
-				
-				bool checkpool = true;
-				if (!checkpool)
-				  mLayers = layer;
-				else {
-					Layer* found = NULL;
-					for (found = mLayers ; found != NULL ; found = found->getPrev()) {
-						if (found == layer)
-						  break;
-					}
-					if (found != NULL) 
-					  Trace(1, "Layer: Attempt to free layer already in the pool!\n");
-					else
-					  mLayers = layer;
-				}
+                // the undo list has been taken apart by now
+                layer->setPrev(NULL);
+                free(layer);
 			}
 			else {
 				// do NOT null the prev pointer, it may still be on a list
@@ -4916,13 +5401,11 @@ void LayerPool::resetCounter()
 
 PUBLIC void LayerPool::dump()
 {
-    int count = 0;
-
-    for (Layer* l = mLayers ; l != NULL ; l = l->getPrev())
-      count++;
+    ObjectPoolStatistics stats;
+    getStatistics(&stats);
 
-    printf("LayerPool: %d allocated, %d in the pool, %d in use\n", 
-           mAllocated, count, mAllocated - count);
+    printf("LayerPool: %ld allocated, %ld in use\n", 
+           (long)mAllocated, (long)stats.inUse);
 }
 
 /****************************************************************************
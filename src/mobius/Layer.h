@@ -15,6 +15,7 @@
 #include "Trace.h"
 #include "Audio.h"
 #include "MobiusState.h"
+#include "ObjectPool.h"
 
 /****************************************************************************
  *                                                                          *
@@ -78,7 +79,7 @@ typedef enum {
 
 } CheckpointState;
 
-class Layer : public TraceContext
+class Layer : public PooledObject, public TraceContext
 {
     friend class LayerPool;
 	friend class Segment;
@@ -215,6 +216,7 @@ class Layer : public TraceContext
     void setOverdub(Audio* a);
 	void addSegment(class Segment* seg);
 	void setSegments(class Segment* list);
+    class Segment* detachSegments();
 	void setReverseRecord(bool b);
 	void setDeferredFadeLeft(bool b);
 	void setDeferredFadeRight(bool b);
@@ -263,6 +265,8 @@ class Layer : public TraceContext
 
 	void checkRecording(LayerContext* con, long startFrame);
 	void advanceInternal(LayerContext* con, long startFrame, int feedback);
+	bool isDirectCopy(long startFrame, long frames);
+	void copyDirect(long startFrame, long frames, float level);
 	void prepare(LayerContext* con);
     void get(LayerContext* con, long startFrame, bool play);
 	void insertCycle(LayerContext* con, long startFrame);
@@ -274,6 +278,7 @@ class Layer : public TraceContext
 	void coalesce();
 	void checkSegmentEdges();
 	void startRecordFade(LayerContext* con);
+	void captureWindows();
     void setDeferredFadeIn(LayerContext* con);
     void setDeferredFadeOut(LayerContext* con);
 	void setContainsDeferredFadeOut(LayerContext* con);
@@ -287,6 +292,7 @@ class Layer : public TraceContext
 	void lowerBackgroundHead(LayerContext* con);
 	void fadeBackground(LayerContext* con, long startFrame);
     void checkMaxUndo();
+    void checkAudioQuota();
 
     //void applyDeferredFades(bool undo);
     void fadeOut(LayerContext* con);
@@ -302,12 +308,11 @@ class Layer : public TraceContext
      */
     class AudioPool* mAudioPool;
 
-	bool		mPooled;
 	Layer*  	mPrev;
 	Layer*		mRedo;		// only for the redo list
 	int			mNumber;
     int         mAllocation;
-    int         mReferences;
+    volatile long mReferences;
 	Loop*		mLoop;
     Segment*    mSegments;
 	Audio*		mAudio;
@@ -438,6 +443,110 @@ class Layer : public TraceContext
 
 };
 
+/****************************************************************************
+ *                                                                          *
+ *                               HISTORY INDEX                              *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Initial number of layers in a HistoryIndex, grows as necessary.
+ */
+#define HISTORY_INDEX_INITIAL_LAYERS 32
+
+/**
+ * The index is grown by MobiusThread when there are fewer than this
+ * many free slots left, so the interrupt normally never runs out.
+ */
+#define HISTORY_INDEX_HEADROOM 16
+
+/**
+ * An index over the layer history of a loop, used by the window functions.
+ * The layers are kept oldest first along with their history offsets
+ * so we can find the layer containing a history frame with a binary 
+ * search rather than walking the prev chain.
+ *
+ * Rather than being told about every change to the layer list, 
+ * the index is refreshed with the last layer in the history before
+ * it is used.  Layers added by a shift are found by walking back from
+ * the last layer until we reach one we already have, layers removed by
+ * undo are dropped by truncating at the last layer.  Layers are pooled
+ * so we remember the layer number as well as the pointer to tell
+ * when one has been reused.  The only thing we can't detect this way
+ * is the removal of the oldest layers when the undo list is pruned,
+ * Layer tells us about that with trim().
+ *
+ * refresh() is called in the interrupt so it can't allocate.  
+ * MobiusThread calls maintain() periodically to allocate larger
+ * arrays before we need them, these are picked up by the next refresh
+ * and the old ones are returned to the thread to delete.  If we
+ * still manage to run out we index only the newest layers and 
+ * rebuild once the larger arrays arrive.
+ */
+class HistoryIndex {
+
+  public:
+
+    HistoryIndex();
+    ~HistoryIndex();
+
+    void reset();
+    void refresh(Layer* last);
+    void trim(Layer* oldest);
+    void maintain();
+
+    long getFrames();
+    int find(long offset);
+    int getLast();
+    Layer* getLayer(int index);
+    long getOffset(int index);
+
+  private:
+
+    int locate(long offset);
+    int locate(Layer* layer);
+    void compact();
+    void swap();
+    void allocate(int max, Layer*** layers, int** numbers, long** offsets);
+
+    Layer** mLayers;
+    int* mNumbers;
+    long* mOffsets;
+
+    /**
+     * The index of the oldest layer we still have.
+     * This advances as the undo list is pruned so we don't
+     * have to move everything down each time.
+     */
+    int mFirst;
+
+    int mCount;
+    int mMax;
+
+    /**
+     * Set when we didn't have room for all the layers and dropped
+     * the oldest ones.  The next refresh after the index grows
+     * starts over.
+     */
+    bool mTruncated;
+
+    /**
+     * The number of layers we wanted the last time we ran out.
+     */
+    int mWanted;
+
+    /**
+     * Arrays passed between MobiusThread and the interrupt,
+     * mSwap is a HISTORY_SWAP_ state.
+     */
+    Layer** mPendingLayers;
+    int* mPendingNumbers;
+    long* mPendingOffsets;
+    int mPendingMax;
+    volatile long mSwap;
+
+};
+
 /****************************************************************************
  *                                                                          *
  *                                    POOL                                  *
@@ -448,13 +557,16 @@ class Layer : public TraceContext
  * A pool of layers.  Normally only one of these managed
  * by a Mobius instance.
  */
-class LayerPool {
+class LayerPool : public ObjectPool {
 
   public:
 
     LayerPool(class AudioPool* aupool);
     ~LayerPool();
 
+    PooledObject* newObject();
+    void prepareObject(PooledObject* o);
+
     Layer* newLayer(class Loop* l);
     void freeLayer(Layer* l);
     void freeLayerList(Layer* l);
@@ -468,12 +580,9 @@ class LayerPool {
 
   private:
 
-	void flush();
-
     class AudioPool* mAudioPool;
-    Layer* mLayers;
-    int mCounter;
-    int mAllocated;
+    volatile long mCounter;
+    volatile long mAllocated;
     
     Layer* mMuteLayer;
     LayerContext* mCopyContext;
@@ -162,6 +162,7 @@ PRIVATE void Loop::init(Mobius* m, Track* track,
     mPlay = NULL;
     mPrePlay = NULL;
 	mRedo = NULL;
+    mHistory = new HistoryIndex();
 
 	mNumber = 0;
     mFrame = 0;
@@ -195,6 +196,8 @@ PUBLIC Loop::~Loop()
     if (mRecord != NULL)
       mRecord->freeAll();
 
+    delete mHistory;
+
     // TODO: delete event and transition pools
 }
 
@@ -830,6 +833,16 @@ PUBLIC void Loop::setRedoLayer(Layer* l)
     mRedo = l;
 }
 
+/**
+ * Index over the layer history for the window functions.
+ * WindowFunction refreshes it before use, Layer trims it when
+ * the undo list is pruned.
+ */
+PUBLIC HistoryIndex* Loop::getHistoryIndex()
+{
+    return mHistory;
+}
+
 /**
  * Return a copy of the loop that is currently audible.
  * Used in the implementation of "quick save" and "save loop".
@@ -2057,6 +2070,7 @@ PRIVATE void Loop::clear()
 	// this is always from the mRecord chain
 	mPlay = NULL;
 	mPrePlay = NULL;
+    mHistory->reset();
 
     // remember these are linked with the Redo pointer and
     // each element can be a list linked by Prev
@@ -5487,10 +5501,15 @@ PRIVATE Event* Loop::copySound(Loop* src, Function* initial,
         // and since we didn't copy it doesn't apply
     }
     else {
-		mPlay = play->copy();
-		mPlay->setLoop(this);
+        // MobiusThread may have copied the layers when the
+        // switch was scheduled
+        EventManager* em = mTrack->getEventManager();
+        if (!em->takeSwitchCopy(this, play, &mPlay, &mRecord)) {
+            mPlay = play->copy();
+            mRecord = play->copy();
+        }
 
-		mRecord = play->copy();
+		mPlay->setLoop(this);
 		mRecord->setLoop(this);
 
 		mRecord->setPrev(mPlay);
@@ -5520,7 +5539,6 @@ PRIVATE Event* Loop::copySound(Loop* src, Function* initial,
 
         if (initial != NULL) {
             // !! save preset?
-            EventManager* em = mTrack->getEventManager();
             event = em->newEvent(initial, modeFrame);
             em->addEvent(event);
         }
@@ -185,6 +185,7 @@ class Loop : public TraceContext {
 	class Layer* getRecordLayer();
 	class Layer* getPlayLayer();
 	class Layer* getRedoLayer();
+    class HistoryIndex* getHistoryIndex();
     class Audio* getPlaybackAudio();
     void setAltFeedback(int i);
     int getAltFeedback();
@@ -354,6 +355,7 @@ class Loop : public TraceContext {
     class Layer* mPlay;
     class Layer* mPrePlay;
 	class Layer* mRedo;
+    class HistoryIndex* mHistory;
 
 	int mNumber;
     long mFrame;
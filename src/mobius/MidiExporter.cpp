@@ -72,6 +72,7 @@ MidiExporter::MidiExporter(Mobius* m)
     mHistory = NULL;
     mMobius = m;
     mExports = NULL;
+    mResume = NULL;
 
 	MobiusConfig* config = m->getConfiguration();
 
@@ -175,7 +176,10 @@ MidiExporter::~MidiExporter()
  * Also for plugins it would be better to use the normal VST/AU MIDI
  * wiring rather than require that a device be opened just to get tracking
  * events.
- * 
+ *
+ * The number of events sent per call is capped at MIDI_EXPORT_MAX_EVENTS.
+ * Exports we don't get to keep their old last value so they will
+ * still look changed next time, and we resume where we left off.
  */
 void MidiExporter::sendEvents()
 {
@@ -188,7 +192,12 @@ void MidiExporter::sendEvents()
         // this is both an allocator of MidiEvents and an output
         MidiInterface* midi = con->getMidiInterface();
 
-        for (Export* exp = mExports ; exp != NULL ; exp = exp->getNext()) {
+        Export* start = (mResume != NULL) ? mResume : mExports;
+        Export* exp = start;
+        int sent = 0;
+
+        mResume = NULL;
+        while (exp != NULL) {
 
             int newValue = exp->getOrdinalValue();
 
@@ -220,8 +229,20 @@ void MidiExporter::sendEvents()
                     }
 
                     exp->setLast(newValue);
+                    sent++;
                 }
             }
+
+            exp = exp->getNext();
+            if (exp == NULL)
+              exp = mExports;
+
+            if (exp == start)
+              exp = NULL;
+            else if (sent >= MIDI_EXPORT_MAX_EVENTS) {
+                mResume = exp;
+                exp = NULL;
+            }
         }
     }
 
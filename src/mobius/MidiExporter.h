@@ -20,6 +20,14 @@
 #ifndef MIDI_EXPORTER_H
 #define MIDI_EXPORTER_H
 
+/**
+ * The maximum number of events we will send in one export tick.
+ * A preset or reset can change dozens of bound parameters at once
+ * and dumping them all in one burst can overflow slower hardware.
+ * Anything over the limit is sent on the next tick.
+ */
+#define MIDI_EXPORT_MAX_EVENTS 32
+
 //////////////////////////////////////////////////////////////////////
 //
 // MidiExporter
@@ -49,6 +57,13 @@ class MidiExporter {
     MidiExporter* mHistory;
     class Mobius* mMobius;
     class Export* mExports;
+
+    /**
+     * The export we stopped on when the last tick hit
+     * MIDI_EXPORT_MAX_EVENTS, we start here next time so the ones
+     * at the end of the list aren't starved.
+     */
+    class Export* mResume;
 };
 
 #endif
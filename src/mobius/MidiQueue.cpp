@@ -233,6 +233,7 @@ PUBLIC MidiQueue::MidiQueue()
 {
     // MidiState self initializes
 	mOverflows = 0;
+	mLateEvents = 0;
 	mHead = 0;
 	mTail = 0;
 	memset(&mEvents, 0, sizeof(mEvents));
@@ -261,6 +262,16 @@ void MidiQueue::setName(const char* name)
  * If we overflow, we'll start dropping events.
  */
 PRIVATE void MidiQueue::add(MidiEvent* e)
+{
+	add(e, 0.0);
+}
+
+/**
+ * Add an event from the MIDI thread with the audio stream time
+ * captured when it was received.  This lets getEvents place the event
+ * within the interrupt buffer rather than at the front.
+ */
+PUBLIC void MidiQueue::add(MidiEvent* e, double streamTime)
 {
 	int status = e->getStatus();
 	int next = mHead + 1;
@@ -269,6 +280,7 @@ PRIVATE void MidiQueue::add(MidiEvent* e)
 
 	mEvents[mHead].status = status;
 	mEvents[mHead].clock = e->getClock();
+	mEvents[mHead].time = streamTime;
 	if (status == MS_SONGPOSITION)
 	  mEvents[mHead].songpos = e->getSongPosition();
 	else
@@ -295,6 +307,7 @@ PUBLIC void MidiQueue::add(int status, long clock)
 
 	mEvents[mHead].status = status;
 	mEvents[mHead].clock = clock;
+	mEvents[mHead].time = 0.0;
 	mEvents[mHead].songpos = 0;
 	
 	if (next != mTail)
@@ -339,22 +352,62 @@ PUBLIC void MidiQueue::interruptStart(long millisecond)
  * a script might be expecting us to be started.  I really hope
  * this isn't important, if so we'll have to annotate the Events.
  *
- * !! We should try to offset these into the buffer based on when they
- * were received, but I think we need a finer resolution clock.  See
- * See Synchronizer::adjustEventFrame for an earlier attempt at this.
- * If we do adjust these we can only return ones that fit within
- * the given interruptFrames.  As it stands now, we process all of them
- * at the beginning of the buffer.
+ * Events are normally processed at the beginning of the buffer.
+ * Use the getEvents variant that takes a stream time to place them
+ * where they were received.
  */
 PUBLIC Event* MidiQueue::getEvents(EventPool* pool, long interruptFrames)
 {
-    Event* events = NULL;
-    Event* lastEvent = NULL;
+    return getEvents(pool, interruptFrames, 0.0, 0);
+}
 
-    // in theory we should try to offset these into the buffer
-    // based on when they were received...need a finer resolution clock
+/**
+ * Calculate the buffer offset for one queued event.
+ *
+ * Events in the queue were received during the previous interrupt
+ * period, blockTime is the stream time at the start of that period.
+ * The distance between the two is used as the offset into the
+ * current buffer.  This means MIDI events are always processed
+ * one buffer later than they happened, but the latency is constant
+ * rather than varying between zero and a full buffer which is what
+ * causes the pulse jitter that SyncTracker ends up correcting.
+ *
+ * The stream time is only available when we're running our own
+ * audio stream, plugin hosts return zero and we fall back to
+ * processing everything at the front.
+ *
+ * Offsets are clamped to the current buffer.  Underflow happens when
+ * the event was received just before the stream time for the last 
+ * interrupt was captured, overflow happens when the audio device delivers
+ * buffers faster than real time to catch up after a long interrupt.
+ */
+PRIVATE long MidiQueue::getOffset(MidiSyncEvent* e, long interruptFrames,
+                                  double blockTime, int sampleRate)
+{
     long offset = 0;
 
+    if (e->time > 0.0 && blockTime > 0.0 && sampleRate > 0 &&
+        interruptFrames > 0) {
+
+        offset = (long)((e->time - blockTime) * (double)sampleRate);
+        if (offset < 0) {
+            offset = 0;
+        }
+        else if (offset >= interruptFrames) {
+            offset = interruptFrames - 1;
+            mLateEvents++;
+        }
+    }
+
+    return offset;
+}
+
+PUBLIC Event* MidiQueue::getEvents(EventPool* pool, long interruptFrames,
+                                   double blockTime, int sampleRate)
+{
+    Event* events = NULL;
+    Event* lastEvent = NULL;
+
 	while (mTail != mHead) {
 
 		MidiSyncEvent* e = &(mEvents[mTail]);
@@ -408,8 +461,11 @@ PUBLIC Event* MidiQueue::getEvents(EventPool* pool, long interruptFrames)
 			// squirell this away for trace debugging
             newEvent->fields.sync.millisecond = e->clock;
 
-            // TODO: set event->frame to buffer offset!1
-            
+            // events are queued in the order received so the offsets
+            // will be ascending
+            newEvent->frame = getOffset(e, interruptFrames, blockTime, 
+                                        sampleRate);
+
             if (lastEvent == NULL)
               events = newEvent;
             else
@@ -427,6 +483,16 @@ PUBLIC bool MidiQueue::hasEvents()
     return (mHead != mTail);
 }
 
+/**
+ * Number of events whose stream time placed them beyond the end
+ * of the interrupt buffer.  A steadily increasing number means
+ * the audio device is not calling us close to real time.
+ */
+PUBLIC long MidiQueue::getLateEvents()
+{
+    return mLateEvents;
+}
+
 /****************************************************************************/
 /****************************************************************************/
 /****************************************************************************/
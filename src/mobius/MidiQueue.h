@@ -43,6 +43,7 @@ class MidiSyncEvent {
 	int status;		// one of the MS_ constants (START, STOP, CLOCK, etc.)
 	int songpos;	// valid if MS_SONG_POSITION
 	long clock;		// millisecond timer clock
+	double time;	// audio stream time in seconds, zero if unknown
 };
 
 /****************************************************************************
@@ -162,6 +163,7 @@ class MidiQueue {
      * MidiListener thread.
 	 */
 	void add(class MidiEvent* e);
+	void add(class MidiEvent* e, double streamTime);
     void add(int status, long clock);
 
 	/**
@@ -175,6 +177,13 @@ class MidiQueue {
      */
     class Event* getEvents(class EventPool* pool, long interruptFrames);
 
+    /**
+     * Variant that places events within the buffer using the
+     * stream time captured when they were received.
+     */
+    class Event* getEvents(class EventPool* pool, long interruptFrames,
+                           double blockTime, int sampleRate);
+
 	/**
 	 * Get the entire running status for exposure in Variables.
 	 */
@@ -182,15 +191,22 @@ class MidiQueue {
 
     // diagnostics
     bool hasEvents();
+    long getLateEvents();
 
   private:
 
+	long getOffset(MidiSyncEvent* e, long interruptFrames, 
+				   double blockTime, int sampleRate);
+
 	// state that needs to carry over into the next interrupt
 	MidiState mState;
 
 	// number of events we couldn't process
 	long mOverflows;
 
+	// number of events whose stream time fell outside the buffer
+	long mLateEvents;
+
 	// counters incremented by the MIDI thread
 	int mHead;
 	int mTail;
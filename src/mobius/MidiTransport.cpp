@@ -46,10 +46,24 @@
  * The SyncTracker for the MIDI clock generator will watch clock pulses.
  * The distinction between CLOCK and BEAT is only important when 
  * quantizing the start of a recording and when rounding it off.
+ *
+ * Clock Scheduling
+ *
+ * Left alone the timer sends clocks by counting milliseconds, which
+ * quantizes them to the millisecond and drifts against the sample clock
+ * so external devices slowly wander away from the loop.  When
+ * mScheduleClocks is on (the default, MobiusConfig noClockScheduling
+ * turns it off) we instead step through the audio stream
+ * a clock width at a time and tell the timer exactly when each clock
+ * in the next block should go out, delayed by the output latency
+ * so the clock lines up with what is heard.  The timer can only
+ * send on millisecond boundaries but devices that support
+ * timestamps are given the fraction.
  * 
  */
 
 #include <stdlib.h>
+#include <math.h>
 #include <memory.h>
 
 #include "Trace.h"
@@ -92,6 +106,11 @@ PUBLIC MidiTransport::MidiTransport(MidiInterface* midi, int sampleRate)
     // events to the queue.  This was !UseInternalTransport in older
     // releases, it has been on for a long time.
     mImmediateTransportQueue = false;
+
+    mScheduleClocks = true;
+    mClockFrame = 0.0;
+    mBlockMsec = 0.0;
+    mStartMsec = -1;
 }
 
 PUBLIC MidiTransport::~MidiTransport()
@@ -227,6 +246,7 @@ PUBLIC void MidiTransport::startClocks(TraceContext* c)
 
 		mMidi->startClocks(mTempo);
 		mSending = true;
+        mStartMsec = mMidi->getMilliseconds();
 	}
 }
 
@@ -250,6 +270,7 @@ PUBLIC void MidiTransport::start(TraceContext* c)
 
 	mSending = true;
 	mStarts++;
+    mStartMsec = mMidi->getMilliseconds();
 
 	if (mImmediateTransportQueue) {
         // don't wait for timer callbacks, queue them now so we can
@@ -348,6 +369,7 @@ PUBLIC void MidiTransport::midiContinue(TraceContext* c)
 	mSending = true;
 	// hmm, treat this like a start for now
 	mStarts++;
+    mStartMsec = mMidi->getMilliseconds();
     
     if (mImmediateTransportQueue) {
         // add events immediately to the queue
@@ -502,6 +524,71 @@ PUBLIC void MidiTransport::interruptStart(long millisecond)
     mQueue.interruptStart(millisecond);
 }
 
+/**
+ * Turn clock scheduling on or off, set from MobiusConfig.
+ * When it is off we stop scheduling and the timer goes back to 
+ * deriving clocks from the tempo.
+ */
+PUBLIC void MidiTransport::setScheduleClocks(bool b)
+{
+    mScheduleClocks = b;
+}
+
+/**
+ * Called at the beginning of each audio interrupt to schedule the
+ * clocks that fall within it.  The millisecond is the timer clock
+ * sampled at the start of the interrupt, latencyFrames is the
+ * output latency.  
+ *
+ * Clock positions are carried over from one interrupt to the next in
+ * frames so they can't drift relative to the audio.  Tempo changes 
+ * take effect on the next clock which is what the timer would do.
+ */
+PUBLIC void MidiTransport::scheduleClocks(long millisecond, 
+                                          long interruptFrames,
+                                          long latencyFrames)
+{
+    if (!mScheduleClocks || !mSending || mTempo <= 0.0f || mSampleRate <= 0) {
+        // start over when we resume
+        mBlockMsec = 0.0;
+    }
+    else {
+        double msecPerFrame = 1000.0 / (double)mSampleRate;
+        double framesPerClock = ((double)mSampleRate * 60.0) / 
+            ((double)mTempo * 24.0);
+
+        // The interrupt doesn't wake up at regular times but the
+        // blocks are a regular size, follow the timer loosely
+        double error = (double)millisecond - mBlockMsec;
+        if (mBlockMsec <= 0.0 || fabs(error) > CLOCK_SCHEDULE_MAX_ERROR)
+          mBlockMsec = (double)millisecond;
+        else
+          mBlockMsec += error * CLOCK_SCHEDULE_GAIN;
+
+        double latencyMsec = (double)latencyFrames * msecPerFrame;
+
+        if (mStartMsec >= 0) {
+            // the timer sent a clock along with START or CONTINUE,
+            // the next one is a full width after that
+            double next = (double)mStartMsec + (framesPerClock * msecPerFrame);
+            mClockFrame = (next - (mBlockMsec + latencyMsec)) / msecPerFrame;
+            if (mClockFrame < 0.0)
+              mClockFrame = 0.0;
+            mStartMsec = -1;
+        }
+
+        while (mClockFrame < (double)interruptFrames) {
+            double msec = mBlockMsec + latencyMsec + (mClockFrame * msecPerFrame);
+            mMidi->scheduleClock(msec);
+            mClockFrame += framesPerClock;
+        }
+        mClockFrame -= (double)interruptFrames;
+
+        // where we expect the next interrupt to start
+        mBlockMsec += (double)interruptFrames * msecPerFrame;
+    }
+}
+
 /**
  * Convert events from the internal MIDI queue.
  * The queue is updated as we send MIDI events to the output port.
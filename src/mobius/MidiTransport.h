@@ -22,6 +22,19 @@
 #include "MidiListener.h"
 #include "MidiQueue.h"
 
+/**
+ * Gain used to track the millisecond timer against the audio
+ * interrupt.  Small so the jitter in when the interrupt wakes up
+ * doesn't make it into the clock schedule.
+ */
+#define CLOCK_SCHEDULE_GAIN 0.01
+
+/**
+ * If the predicted interrupt time is off by more than this many
+ * milliseconds we assume the stream was restarted and snap to it.
+ */
+#define CLOCK_SCHEDULE_MAX_ERROR 20.0
+
 /****************************************************************************
  *                                                                          *
  *                               MIDI TRANSPORT                             *
@@ -74,6 +87,9 @@ class MidiTransport : public MidiClockListener {
     //
 
     void interruptStart(long millisecond);
+    void setScheduleClocks(bool b);
+    void scheduleClocks(long millisecond, long interruptFrames, 
+                        long latencyFrames);
     Event* getEvents(class EventPool* pool, long interruptFrames);
 
     // Diagnostics
@@ -139,6 +155,31 @@ class MidiTransport : public MidiClockListener {
      */
     bool mImmediateTransportQueue;
 
+    /**
+     * When true we place each clock within the audio stream and
+     * schedule it with the timer rather than letting the timer 
+     * derive clocks from the tempo.
+     */
+    bool mScheduleClocks;
+
+    /**
+     * Frames from the start of the next interrupt to the next clock.
+     */
+    double mClockFrame;
+
+    /**
+     * Our estimate of the timer millisecond at the start of the 
+     * next interrupt.
+     */
+    double mBlockMsec;
+
+    /**
+     * Millisecond of the last start, continue or clock start, 
+     * the next clock is scheduled relative to this.  Negative if
+     * there hasn't been one since the last schedule.
+     */
+    long mStartMsec;
+
 };
 
 /****************************************************************************/
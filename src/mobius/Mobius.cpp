@@ -17,6 +17,7 @@
 
 #include "Util.h"
 #include "Thread.h"
+#include "RealTime.h"
 #include "List.h"
 #include "MessageCatalog.h"
 
@@ -30,6 +31,7 @@
 #include "BindingResolver.h"
 #include "ControlSurface.h"
 #include "Event.h"
+#include "EventManager.h"
 #include "Export.h"
 #include "Function.h"
 #include "HostConfig.h"
@@ -37,6 +39,7 @@
 #include "Layer.h"
 #include "Loop.h"
 #include "MidiExporter.h"
+#include "MobiusShared.h"
 #include "MobiusThread.h"
 #include "Mode.h"
 #include "OscConfig.h"
@@ -284,6 +287,7 @@ PUBLIC Mobius::Mobius(MobiusContext* context)
 	mVariables = new UserVariables();
     mFunctions = NULL;
 	mScriptEnv = NULL;
+    mScriptEnvs = NULL;
 	mScripts = NULL;
     mActions = NULL;
     mLastAction = NULL;
@@ -302,6 +306,10 @@ PUBLIC Mobius::Mobius(MobiusContext* context)
 	mCatalog = NULL;
     mWatchers = new Watchers();
     mNewWatchers = new List();
+    mWatchEvents = new WatchEvent[MAX_WATCH_EVENTS];
+    mWatchHead = 0;
+    mWatchTail = 0;
+    mWatchOverflows = 0;
 
 	// need this to manage the action list
 	mCsect = new CriticalSection("Mobius");
@@ -309,10 +317,9 @@ PUBLIC Mobius::Mobius(MobiusContext* context)
     // let's turn debug stream output on for now, what uses this??
     TraceToDebug = true;
     
-    // initialize the static object tables
-    MobiusMode::initModes();
-    Function::initStaticFunctions();
-    Parameter::initParameters();
+    // initialize the static object tables, these are shared
+    // with other instances in the process
+    MobiusShared::acquire();
 
 	parseCommandLine();
 
@@ -325,6 +332,10 @@ PUBLIC Mobius::Mobius(MobiusContext* context)
 	TracePrintLevel = mConfig->getTracePrintLevel();
 	TraceDebugLevel = mConfig->getTraceDebugLevel();
 
+    // this has to be decided before anything allocates buffers
+    mAudioPool->setShared(mConfig->isSharedAudioPool());
+    mAudioPool->setQuota(mConfig->getAudioPoolQuota());
+
     // Too much code assumes this is non-null unfortuantely.
     // If we're not connected to an audio input code still
     // gets called for the UI update timer so we need to 
@@ -572,6 +583,8 @@ PUBLIC CalibrationResult* Mobius::calibrateLatency()
         result->timeout = rcr->timeout;
         result->noiseFloor = rcr->noiseFloor;
         result->latency = rcr->latency;
+        result->exactLatency = rcr->exactLatency;
+        result->confidence = rcr->confidence;
         delete rcr;
 
 		// turn it back on
@@ -814,6 +827,7 @@ PUBLIC Mobius::~Mobius()
     // and does not need to be freed.
 
     delete mWatchers;
+    delete [] mWatchEvents;
     delete mTriggerState;
 	delete mRecorder;	// will delete the Tracks too
 	delete mThread;
@@ -826,30 +840,42 @@ PUBLIC Mobius::~Mobius()
 	delete mOsc;
     delete mControlSurfaces;
     delete mFunctions;
-	delete mScriptEnv;
 	delete mTracks;
 	delete mSynchronizer;
-	delete mCatalog;
     delete mVariables;
 
+    // scripts and the catalog are shared, release our references
+    if (mScriptEnvs != NULL) {
+        for (int i = 0 ; i < mScriptEnvs->size() ; i++)
+          MobiusShared::releaseScripts((ScriptEnv*)mScriptEnvs->get(i));
+        delete mScriptEnvs;
+    }
+
     // avoid a warning message
     for (ResolvedTarget* t = mResolvedTargets ; t != NULL ; t = t->getNext())
       t->setInterned(false);
     delete mResolvedTargets;
 
-	flushObjectPools();
-    
     mActionPool->dump();
-    delete mActionPool;
-
     mEventPool->dump();
-    delete mEventPool;
-
     mLayerPool->dump();
-    delete mLayerPool;
+
+    // the manager owns the action, event and layer pools once they're added
+    if (mPools != NULL)
+      flushObjectPools();
+    else {
+        delete mActionPool;
+        delete mEventPool;
+        delete mLayerPool;
+    }
 
     mAudioPool->dump();
     delete mAudioPool;
+
+    MobiusShared::release();
+
+    // only has something to say in builds with RT_SANITIZE
+    RealTimeDump(stdout);
 }
 
 PUBLIC MessageCatalog* Mobius::getMessageCatalog()
@@ -1534,6 +1560,15 @@ PRIVATE void Mobius::installConfiguration(MobiusConfig* config, bool doBindings)
         config->setTracks(1);
     }
 
+    // the quota may change at any time, sharing only on restart
+    mAudioPool->setQuota(config->getAudioPoolQuota());
+
+    // latency measurement, both off unless configured
+    if (mRecorder != NULL) {
+        mRecorder->setCalibrationLoopback(config->getCalibrationLoopback());
+        mRecorder->setLatencyMonitor(config->getLatencyMonitorPort() - 1);
+    }
+
 	// Build the track list if this is the first time
 	buildTracks(config->getTracks());
 
@@ -1887,13 +1922,15 @@ PRIVATE bool Mobius::installScripts(ScriptConfig* config, bool force)
         else
           Trace(2, "Mobius: Reloading scripts and function tables\n");
 
-        ScriptCompiler* sc = new ScriptCompiler();
-        ScriptEnv* env = sc->compile(this, config);
-        delete sc;
+        // another instance may already have compiled the same files
+        ScriptEnv* env = MobiusShared::getScripts(this, config);
 
         // add it to the history, should use a csect but script configs
-        // can't come in that fast
-        env->setNext(mScriptEnv);
+        // can't come in that fast.  These are shared with other
+        // instances so they can't be chained.
+        if (mScriptEnvs == NULL)
+          mScriptEnvs = new List();
+        mScriptEnvs->add(env);
         mScriptEnv = env;
 
         // rebuild the global Function table
@@ -2403,6 +2440,19 @@ PUBLIC MobiusState* Mobius::getState(int track)
 
 	mState.globalRecording = mCapturing;
 
+    if (mPools != NULL) {
+        ObjectPoolStatistics stats;
+        mPools->getStatistics(&stats);
+        mState.poolAllocs = stats.allocs;
+        mState.poolMisses = stats.misses;
+        mState.poolFallbacks = stats.fallbacks;
+        mState.poolHighWater = stats.highWater;
+    }
+
+    mState.audioBuffers = mAudioPool->getInUse();
+    if (mAudioPool->isShared())
+      mState.sharedAudioBuffers = AudioPool::getSharedInUse();
+
     if (track >= 0 && track < mTrackCount)
 	  mState.track = mTracks[track]->getState();
 	else {
@@ -2568,6 +2618,14 @@ PUBLIC Action* Mobius::resolveAction(Binding* b)
             CopyString(b->getArgs(), a->bindingArgs, sizeof(a->bindingArgs));
             a->parseBindingArgs();
 
+            // convert enumeration names to ordinals now rather
+            // than every time the binding is triggered
+            if (t->getTarget() == TargetParameter) {
+                Parameter* p = (Parameter*)t->getObject();
+                if (p != NULL)
+                  p->resolveValue(&(a->arg));
+            }
+
             resolveTrigger(b, a);
         }
     }
@@ -3273,6 +3331,11 @@ PUBLIC void Mobius::exportStatus(bool inThread)
     // maybe it would be better if MobiusThread managed it's own copy
     // and we just posted a new version 
     MidiExporter *exporter = mMidiExporter;
+
+    // watch point changes from the interrupt, do these before
+    // OSC since OscRuntimeWatcher sends on the OSC tick
+    deliverWatchEvents();
+
     if (exporter != NULL) {
 
         if (inThread) {
@@ -3329,7 +3392,9 @@ PUBLIC WatchPoint* Mobius::addWatcher(WatchPointListener* l)
 }
 
 /**
- * Called inside the interrupt to transition in new watch point listeners.
+ * Called by MobiusThread to transition in new watch point listeners.
+ * The listener lists are only touched by MobiusThread so we don't need
+ * the csect to read them, only to get things off mNewWatchers.
  */
 PRIVATE void Mobius::installWatchers()
 {
@@ -3359,27 +3424,133 @@ PRIVATE void Mobius::installWatchers()
 /**
  * Called internally to notify the watch point listeners.
  * This is IN THE INTERRUPT.
+ *
+ * We don't call the listeners here, the change is added to a ring
+ * that MobiusThread drains in deliverWatchEvents.  Only this
+ * thread advances the head, only MobiusThread advances the tail.
  */
 PUBLIC void Mobius::notifyWatchers(WatchPoint* wp, int value)
 {
-    List* listeners = wp->getListeners(mWatchers);
-    if (listeners != NULL) {
-        int max = listeners->size();
-        for (int i = 0 ; i < max ; i++) {
-            WatchPointListener* l = (WatchPointListener*)listeners->get(i);
-            // gc listeners marked removable
-            if (!l->isRemoving())
-              l->watchPointEvent(value);
-            else {
-                Trace(2, "Removing watch point listener for %s\n",
-                      l->getWatchPointName());
-                listeners->remove(i);
-                max--;
+    int next = mWatchHead + 1;
+    if (next >= MAX_WATCH_EVENTS)
+      next = 0;
+
+    if (next == mWatchTail) {
+        // MobiusThread isn't keeping up, drop it
+        mWatchOverflows++;
+    }
+    else {
+        WatchEvent* e = &mWatchEvents[mWatchHead];
+        e->point = wp;
+        e->value = value;
+        mWatchHead = next;
+    }
+}
+
+/**
+ * Called by MobiusThread to pass the watch point changes captured
+ * in the interrupt on to the listeners.
+ *
+ * Changes to the same point since the last tick are coalesced, the 
+ * listener only sees the last value.  Listeners with a rate limit 
+ * hold the last value until their interval has passed.
+ */
+PRIVATE void Mobius::deliverWatchEvents()
+{
+    WatchEvent changes[MAX_WATCH_EVENTS];
+    int count = 0;
+
+    installWatchers();
+
+    while (mWatchTail != mWatchHead) {
+        WatchEvent* e = &mWatchEvents[mWatchTail];
+        int i;
+        for (i = 0 ; i < count ; i++) {
+            if (changes[i].point == e->point)
+              break;
+        }
+        if (i == count) {
+            changes[i].point = e->point;
+            count++;
+        }
+        changes[i].value = e->value;
+
+        int next = mWatchTail + 1;
+        if (next >= MAX_WATCH_EVENTS)
+          next = 0;
+        mWatchTail = next;
+    }
+
+    if (mWatchOverflows > 0) {
+        Trace(1, "Mobius: %ld watch point events dropped\n", mWatchOverflows);
+        mWatchOverflows = 0;
+    }
+
+    WatchPoint** points = WatchPoint::getWatchPoints();
+    for (int p = 0 ; points[p] != NULL ; p++) {
+        WatchPoint* wp = points[p];
+        List* listeners = wp->getListeners(mWatchers);
+        if (listeners != NULL && listeners->size() > 0) {
+
+            WatchEvent* change = NULL;
+            for (int i = 0 ; i < count ; i++) {
+                if (changes[i].point == wp) {
+                    change = &changes[i];
+                    break;
+                }
+            }
+
+            int max = listeners->size();
+            for (int i = 0 ; i < max ; i++) {
+                WatchPointListener* l = (WatchPointListener*)listeners->get(i);
+                // gc listeners marked removable
+                if (l->isRemoving()) {
+                    Trace(2, "Removing watch point listener for %s\n",
+                          l->getWatchPointName());
+                    listeners->remove(i);
+                    i--;
+                    max--;
+                }
+                else {
+                    if (change != NULL) {
+                        l->mPending = true;
+                        l->mPendingValue = change->value;
+                    }
+                    if (l->mTicks < l->mRateLimit)
+                      l->mTicks++;
+                    if (l->mPending && l->mTicks >= l->mRateLimit) {
+                        l->mPending = false;
+                        l->mTicks = 0;
+                        l->watchPointEvent(l->mPendingValue);
+                    }
+                }
             }
         }
     }
 }
 
+/**
+ * Called by MobiusThread after a track scheduled a loop switch that
+ * is expected to copy into an empty loop, or canceled one.  Let each
+ * track build the layers for the copy so the interrupt doesn't have
+ * to do it at the switch frame, and free the ones it no longer wants.
+ */
+PUBLIC void Mobius::prepareSwitchCopies()
+{
+    for (int i = 0 ; i < mTrackCount ; i++)
+      mTracks[i]->getEventManager()->prepareSwitchCopy();
+}
+
+/**
+ * Called periodically by MobiusThread to grow the history
+ * indexes used by the window functions, the interrupt can't.
+ */
+PUBLIC void Mobius::maintainHistory()
+{
+    for (int i = 0 ; i < mTrackCount ; i++)
+      mTracks[i]->maintainHistory();
+}
+
 /****************************************************************************
  *                                                                          *
  *                                  ACTIONS                                 *
@@ -3391,15 +3562,12 @@ PUBLIC void Mobius::notifyWatchers(WatchPoint* wp, int value)
  * The caller is expected to fill this out and execute it with doAction.
  * If the caller doesn't want it they must call freeAction.
  * These are maintained in a pool that both the application threads
- * and the interrupt threads can access so have to use a Csect.
+ * and the interrupt threads can access.  ActionPool is a lock free
+ * ObjectPool so we no longer need a Csect.
  */
 PUBLIC Action* Mobius::newAction()
 {
-    Action* action = NULL;
-
-    mCsect->enter("newAction");
-    action = mActionPool->newAction();
-    mCsect->leave("newAction");
+    Action* action = mActionPool->newAction();
 
     // always need this
     action->mobius = this;
@@ -3413,18 +3581,12 @@ PUBLIC void Mobius::freeAction(Action* a)
     if (a->isRegistered())
       Trace(1, "Freeing a registered action!\n");
 
-    mCsect->enter("newAction");
     mActionPool->freeAction(a);
-    mCsect->leave("newAction");
 }
 
 PUBLIC Action* Mobius::cloneAction(Action* src)
 {
-    Action* action = NULL;
-
-    mCsect->enter("cloneAction");
-    action = mActionPool->newAction(src);
-    mCsect->leave("cloneAction");
+    Action* action = mActionPool->newAction(src);
 
     // not always set if allocated outside
     action->mobius = this;
@@ -3927,7 +4089,7 @@ PRIVATE void Mobius::doFunction(Action* a)
         }
         else {
             // Apply to tracks in a group or focused
-            Action* ta = a;
+            Action* replicant = NULL;
             int nactions = 0;
             int targetGroup = a->getTargetGroup();
 
@@ -3938,25 +4100,53 @@ PRIVATE void Mobius::doFunction(Action* a)
                     (targetGroup <= 0 &&
                      (t == mTrack || (f->isFocusable() && isFocused(t))))) {
 
-                    // if we have more than one, have to clone the
+                    // if we have more than one, have to replicate the
                     // action so it can have independent life
-                    if (nactions > 0)
-                      ta = cloneAction(a);
-
-                    doFunction(ta, f, t);
-
-                    // since we only "return" the first one free the 
-                    // replicants
-                    if (nactions > 0)
-                      completeAction(ta);
-
+                    if (nactions == 0)
+                      doFunction(a, f, t);
+                    else {
+                        replicant = replicateAction(a, replicant);
+                        doFunction(replicant, f, t);
+                    }
                     nactions++;
                 }
             }
+
+            // since we only "return" the first one free the 
+            // last replicant unless an event took it
+            if (replicant != NULL)
+              completeAction(replicant);
         }
     }
 }
 
+/**
+ * Prepare a copy of an Action for the next track when replicating
+ * for groups or focus lock.
+ *
+ * Most functions and parameters don't keep the Action, so rather
+ * than cloning a new one for every track and freeing it after, the
+ * replicant from the previous track is refreshed and used again.
+ * Only when a track claims it by scheduling an Event do we need to
+ * get another one from the pool.  For a large group this saves
+ * a pool allocation and free for every track.
+ *
+ * The caller must call completeAction on the last replicant.
+ */
+PRIVATE Action* Mobius::replicateAction(Action* src, Action* replicant)
+{
+    if (replicant == NULL || replicant->isRegistered() || 
+        replicant->getEvent() != NULL) {
+        // the previous one is owned by something else now
+        replicant = cloneAction(src);
+    }
+    else {
+        replicant = mActionPool->reuseAction(replicant, src);
+    }
+
+    return replicant;
+}
+
 /**
  * Determine the destination Track for an Action.
  * Return NULL if the action does not specify a destination track.
@@ -4117,21 +4307,24 @@ PRIVATE void Mobius::doParameter(Action* a)
         // OutputLevel where it would remember relative positions
         // among the group.
         Action* ta = a;
+        Action* replicant = NULL;
         int nactions = 0;
         int group = a->getTargetGroup();
         for (int i = 0 ; i < mTrackCount ; i++) {
             Track* t = getTrack(i);
             if (t->getGroup() == group) {
-                if (p->scheduled && nactions > 0)
-                  ta = cloneAction(a);
+                if (p->scheduled && nactions > 0) {
+                    replicant = replicateAction(a, replicant);
+                    ta = replicant;
+                }
                   
                 doParameter(ta, p, t);
-
-                if (p->scheduled && nactions > 0)
-                  completeAction(ta);
                 nactions++;
             }
         }
+
+        if (replicant != NULL)
+          completeAction(replicant);
     }
     else {
         // current track and focused
@@ -4143,20 +4336,23 @@ PRIVATE void Mobius::doParameter(Action* a)
         }
         else {
             Action* ta = a;
+            Action* replicant = NULL;
             int nactions = 0;
             for (int i = 0 ; i < mTrackCount ; i++) {
                 Track* t = getTrack(i);
                 if (isFocused(t)) {
-                    if (p->scheduled && nactions > 0)
-                      ta = cloneAction(a);
+                    if (p->scheduled && nactions > 0) {
+                        replicant = replicateAction(a, replicant);
+                        ta = replicant;
+                    }
 
                     doParameter(ta, p, t);
-
-                    if (p->scheduled && nactions > 0)
-                      completeAction(ta);
                     nactions++;
                 }
             }
+
+            if (replicant != NULL)
+              completeAction(replicant);
         }
     }
 }
@@ -5518,9 +5714,6 @@ void Mobius::recorderMonitorEnter(AudioStream* stream)
         return;
     }
 
-    // install new watchers
-    installWatchers();
-
     // change setups
     if (mPendingSetup >= 0) {
         setSetupInternal(mPendingSetup);
@@ -5600,6 +5793,12 @@ PRIVATE void Mobius::propagateInterruptConfig()
     // thankfully it is hidden now and can't be changed
 	AudioFade::setRange(mInterruptConfig->getFadeFrames());
 
+    // long press frames depend on the sample rate, calculate them
+    // here rather than on every advance
+    if (mTriggerState != NULL)
+      mTriggerState->setLongPressTime(mInterruptConfig->getLongPress(),
+                                      getSampleRate());
+
     // tracks are sensitive to lots of things including prests and setups
 	for (int i = 0 ; i < mTrackCount ; i++) {
 		Track* t = mTracks[i];
@@ -5803,6 +6002,10 @@ PUBLIC void Mobius::doMidiEvent(MidiEvent* e)
  * be called from different "monitor threads" without any synchronization.
  * We either need to put Csects around sensitive areas or better yet, make
  * MidiInterface manage a single monitor thread for all input devices.
+ *
+ * The event is owned by the MidiInput ring and will be reused as soon
+ * as we return, copy it if it needs to be kept.  Bursts of controller
+ * changes will already have been coalesced by the MidiInput.
  */
 PUBLIC void Mobius::midiEvent(MidiEvent* e)
 {
@@ -5895,14 +6098,12 @@ PRIVATE void Mobius::localize()
 		// if we're misconfigured have to have something
 		if (mCatalog == NULL) {
             Trace(1, "ERROR: Unable to read message catalog!!\n");
-            mCatalog = new MessageCatalog();
+            mCatalog = MobiusShared::getCatalog(NULL);
         }
 
-        // propagate the catalog to the internal objects
-		MobiusMode::localizeAll(mCatalog);
-		Parameter::localizeAll(mCatalog);
-		Function::localizeAll(mCatalog);
-        WatchPoint::localizeAll(mCatalog);
+        // propagate the catalog to the internal objects, they're shared
+        // so this only does something for the first instance
+        MobiusShared::localize(mCatalog);
 
         localizeUIControls();
 	}
@@ -5912,26 +6113,19 @@ PRIVATE void Mobius::localize()
  * Read the message catalog for a given language.
  * These are normally only in the installation directory, but
  * support alternate langs in the config directory too.
+ *
+ * Catalogs are shared by all instances and owned by MobiusShared,
+ * don't delete them.
  */
 PRIVATE MessageCatalog* Mobius::readCatalog(const char* language)
 {
-	MessageCatalog* cat = NULL;
 	char catalog[256];
 	char path[1024];
 	
 	sprintf(catalog, "Catalog_%s.txt", language);
 	findConfigurationFile(catalog, path, sizeof(path));
 
-	cat = new MessageCatalog();
-	if (!cat->read(path)) {
-		// problems reading catalog
-		printf("ERROR: Mobius: Unable to read message catalog: %s\n", path);
-		fflush(stdout);
-		delete cat;
-		cat = NULL;
-	}
-
-	return cat;
+	return MobiusShared::getCatalog(path);
 }
 
 PRIVATE void Mobius::localizeUIControls()
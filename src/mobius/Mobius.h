@@ -155,6 +155,7 @@ class Mobius :
     class AudioPool* getAudioPool();
     class LayerPool* getLayerPool();
     class EventPool* getEventPool();
+    void releaseObjectPoolThread();
 
     //////////////////////////////////////////////////////////////////////
     //
@@ -280,6 +281,8 @@ class Mobius :
 	void emergencyExit();
     void exportStatus(bool inThread);
 	void notifyGlobalReset();
+    void prepareSwitchCopies();
+    void maintainHistory();
 
     // Need these for the Setup and Preset script statements
     void setSetupInternal(class Setup* setup);
@@ -292,6 +295,7 @@ class Mobius :
 	void stop();
     bool installScripts(class ScriptConfig* config, bool force);
     void installWatchers();
+    void deliverWatchEvents();
 	void localize();
 	class MessageCatalog* readCatalog(const char* language);
     void localizeUIControls();
@@ -344,6 +348,7 @@ class Mobius :
     void doScriptNotification(Action* a);
     void doParameter(Action* a);
     void doParameter(Action* a, Parameter*p, class Track* t);
+    Action* replicateAction(Action* src, Action* replicant);
     void doControl(Action* a);
     void doUIControl(Action* a);
     void invoke(Action* a, class Track* t);
@@ -359,6 +364,12 @@ class Mobius :
 	MobiusListener* mListener;
     Watchers* mWatchers;
     class List* mNewWatchers;
+
+    // watch point changes from the interrupt waiting for MobiusThread
+    class WatchEvent* mWatchEvents;
+    int mWatchHead;
+    int mWatchTail;
+    long mWatchOverflows;
     UIControl** mUIControls;
     UIParameter** mUIParameters;
 	char* mConfigFile;
@@ -385,6 +396,7 @@ class Mobius :
 	class SampleTrack* mSampleTrack;
 	class UserVariables* mVariables;
 	class ScriptEnv* mScriptEnv;
+    class List* mScriptEnvs;
     class Function** mFunctions;
 	class ScriptInterpreter* mScripts;
     class Action* mRegisteredActions;
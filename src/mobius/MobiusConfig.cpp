@@ -50,9 +50,11 @@
 #define ATT_SUGGESTED_LATENCY "suggestedLatencyMsec"
 #define ATT_UI_CONFIG  "uiConfig"
 #define ATT_PLUGIN_PINS "pluginPins"
+#define ATT_PLUGIN_BLOCK_FRAMES "pluginBlockFrames"
 #define ATT_PLUGIN_HOST_REWINDS "pluginHostRewinds"
 
 #define ATT_NO_SYNC_BEAT_ROUNDING "noSyncBeatRounding"
+#define ATT_NO_CLOCK_SCHEDULING "noClockScheduling"
 
 #define ATT_OVERLAY_BINDINGS "overlayBindings"
 
@@ -75,6 +77,10 @@
 
 #define ATT_LOG_STATUS "logStatus"
 #define ATT_EDPISMS "edpisms"
+#define ATT_SHARED_AUDIO_POOL "sharedAudioPool"
+#define ATT_AUDIO_POOL_QUOTA "audioPoolQuota"
+#define ATT_LATENCY_MONITOR_PORT "latencyMonitorPort"
+#define ATT_CALIBRATION_LOOPBACK "calibrationLoopback"
 
 /****************************************************************************
  *                                                                          *
@@ -187,6 +193,7 @@ PUBLIC void MobiusConfig::init()
 	mMonitorAudio = false;
     mHostRewinds = false;
 	mPluginPins = DEFAULT_PLUGIN_PINS;
+    mPluginBlockFrames = 0;
     mAutoFeedbackReduction = false;
     mIsolateOverdubs = false;
     mIntegerWaveFile = false;
@@ -217,9 +224,14 @@ PUBLIC void MobiusConfig::init()
     mOscOutputHost = NULL;
 
     mNoSyncBeatRounding = false;
+    mNoClockScheduling = false;
     mLogStatus = false;
 
     mEdpisms = false;
+    mSharedAudioPool = false;
+    mAudioPoolQuota = 0;
+    mLatencyMonitorPort = 0;
+    mCalibrationLoopback = -1;
 }
 
 PUBLIC MobiusConfig::~MobiusConfig()
@@ -368,6 +380,16 @@ void MobiusConfig::setPluginPorts(int i)
 	mPluginPins = i * 2;
 }
 
+void MobiusConfig::setPluginBlockFrames(int i)
+{
+	mPluginBlockFrames = i;
+}
+
+int MobiusConfig::getPluginBlockFrames()
+{
+	return mPluginBlockFrames;
+}
+
 void MobiusConfig::setHostRewinds(bool b)
 {
 	mHostRewinds = b;
@@ -941,6 +963,14 @@ PUBLIC bool MobiusConfig::isNoSyncBeatRounding() {
 	return mNoSyncBeatRounding;
 }
 
+PUBLIC void MobiusConfig::setNoClockScheduling(bool b) {
+	mNoClockScheduling = b;
+}
+
+PUBLIC bool MobiusConfig::isNoClockScheduling() {
+	return mNoClockScheduling;
+}
+
 PUBLIC void MobiusConfig::setLogStatus(bool b) {
 	mLogStatus = b;
 }
@@ -957,6 +987,38 @@ PUBLIC bool MobiusConfig::isEdpisms() {
 	return mEdpisms;
 }
 
+PUBLIC void MobiusConfig::setSharedAudioPool(bool b) {
+	mSharedAudioPool = b;
+}
+
+PUBLIC bool MobiusConfig::isSharedAudioPool() {
+	return mSharedAudioPool;
+}
+
+PUBLIC void MobiusConfig::setAudioPoolQuota(int i) {
+	mAudioPoolQuota = i;
+}
+
+PUBLIC int MobiusConfig::getAudioPoolQuota() {
+	return mAudioPoolQuota;
+}
+
+PUBLIC void MobiusConfig::setLatencyMonitorPort(int i) {
+	mLatencyMonitorPort = i;
+}
+
+PUBLIC int MobiusConfig::getLatencyMonitorPort() {
+	return mLatencyMonitorPort;
+}
+
+PUBLIC void MobiusConfig::setCalibrationLoopback(int i) {
+	mCalibrationLoopback = i;
+}
+
+PUBLIC int MobiusConfig::getCalibrationLoopback() {
+	return mCalibrationLoopback;
+}
+
 /****************************************************************************
  *                                                                          *
  *                                    OSC                                   *
@@ -1571,6 +1633,7 @@ PUBLIC void MobiusConfig::parseXml(XmlElement* e)
 	setMonitorAudio(e->getBoolAttribute(MonitorAudioParameter->getName()));
 	setHostRewinds(e->getBoolAttribute(ATT_PLUGIN_HOST_REWINDS));
 	setPluginPins(e->getIntAttribute(ATT_PLUGIN_PINS));
+	setPluginBlockFrames(e->getIntAttribute(ATT_PLUGIN_BLOCK_FRAMES));
 	setAutoFeedbackReduction(e->getBoolAttribute(AutoFeedbackReductionParameter->getName()));
     // don't allow this to be persisted any more, can only be set in scripts
 	//setIsolateOverdubs(e->getBoolAttribute(IsolateOverdubsParameter->getName()));
@@ -1593,11 +1656,20 @@ PUBLIC void MobiusConfig::parseXml(XmlElement* e)
 
     // this isn't a parameter yet
     setNoSyncBeatRounding(e->getBoolAttribute(ATT_NO_SYNC_BEAT_ROUNDING));
+    setNoClockScheduling(e->getBoolAttribute(ATT_NO_CLOCK_SCHEDULING));
     setLogStatus(e->getBoolAttribute(ATT_LOG_STATUS));
 
     // not an official parameter yet
     setEdpisms(e->getBoolAttribute(ATT_EDPISMS));
 
+    // not parameters, these are only for multi-instance hosts
+    setSharedAudioPool(e->getBoolAttribute(ATT_SHARED_AUDIO_POOL));
+    setAudioPoolQuota(e->getIntAttribute(ATT_AUDIO_POOL_QUOTA));
+
+    // not parameters, latency measurement options
+    setLatencyMonitorPort(e->getIntAttribute(ATT_LATENCY_MONITOR_PORT));
+    setCalibrationLoopback(e->getIntAttribute(ATT_CALIBRATION_LOOPBACK, -1));
+
 	setSampleRate((AudioSampleRate)XmlGetEnum(e, SampleRateParameter->getName(), SampleRateParameter->values));
 
     // fade frames can no longer be set high so we don't bother exposing it
@@ -1736,6 +1808,8 @@ PUBLIC void MobiusConfig::toXml(XmlBuffer* b)
 	b->addAttribute(MonitorAudioParameter->getName(), mMonitorAudio);
 	b->addAttribute(ATT_PLUGIN_HOST_REWINDS, mHostRewinds);
 	b->addAttribute(ATT_PLUGIN_PINS, mPluginPins);
+    if (mPluginBlockFrames > 0)
+      b->addAttribute(ATT_PLUGIN_BLOCK_FRAMES, mPluginBlockFrames);
 	b->addAttribute(AutoFeedbackReductionParameter->getName(), mAutoFeedbackReduction);
     // don't allow this to be persisted any more, can only be set in scripts
 	//b->addAttribute(IsolateOverdubsParameter->getName(), mIsolateOverdubs);
@@ -1752,6 +1826,7 @@ PUBLIC void MobiusConfig::toXml(XmlBuffer* b)
 	b->addAttribute(GroupFocusLockParameter->getName(), mGroupFocusLock);
 
     b->addAttribute(ATT_NO_SYNC_BEAT_ROUNDING, mNoSyncBeatRounding);
+    b->addAttribute(ATT_NO_CLOCK_SCHEDULING, mNoClockScheduling);
     b->addAttribute(ATT_LOG_STATUS, mLogStatus);
 
 	b->addAttribute(OscInputPortParameter->getName(), mOscInputPort);
@@ -1775,6 +1850,16 @@ PUBLIC void MobiusConfig::toXml(XmlBuffer* b)
     if (mEdpisms)
       b->addAttribute(ATT_EDPISMS, "true");
 
+    if (mSharedAudioPool)
+      b->addAttribute(ATT_SHARED_AUDIO_POOL, "true");
+    if (mAudioPoolQuota > 0)
+      b->addAttribute(ATT_AUDIO_POOL_QUOTA, mAudioPoolQuota);
+
+    if (mLatencyMonitorPort > 0)
+      b->addAttribute(ATT_LATENCY_MONITOR_PORT, mLatencyMonitorPort);
+    if (mCalibrationLoopback >= 0)
+      b->addAttribute(ATT_CALIBRATION_LOOPBACK, mCalibrationLoopback);
+
 	b->add(">\n");
 	b->incIndent();
 
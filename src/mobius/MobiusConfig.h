@@ -191,7 +191,11 @@ typedef enum {
     MIDI_TEMPO_SMOOTH,
 
     // end exactly on a MIDI clock pulse
-    MIDI_RECORD_PULSED
+    MIDI_RECORD_PULSED,
+
+    // pulse width estimated by the MIDI SyncTracker, falls back
+    // to MIDI_TEMPO_AVERAGE if the estimate is not reliable
+    MIDI_TEMPO_ESTIMATE
 
 } MidiRecordMode;
 
@@ -339,6 +343,8 @@ class MobiusConfig {
 	int getPluginPins();
 	void setPluginPorts(int i);
 	int getPluginPorts();
+    void setPluginBlockFrames(int i);
+    int getPluginBlockFrames();
 	void setHostRewinds(bool b);
 	bool isHostRewinds();
 	void setAutoFeedbackReduction(bool b);
@@ -520,12 +526,27 @@ class MobiusConfig {
     void setNoSyncBeatRounding(bool b);
     bool isNoSyncBeatRounding();
 
+    void setNoClockScheduling(bool b);
+    bool isNoClockScheduling();
+
     void setLogStatus(bool b);
     bool isLogStatus();
 
     void setEdpisms(bool b);
     bool isEdpisms();
 
+    void setSharedAudioPool(bool b);
+    bool isSharedAudioPool();
+
+    void setAudioPoolQuota(int megabytes);
+    int getAudioPoolQuota();
+
+    void setLatencyMonitorPort(int port);
+    int getLatencyMonitorPort();
+
+    void setCalibrationLoopback(int frames);
+    int getCalibrationLoopback();
+
     //
     // Transient fields for testing
     //
@@ -653,6 +674,13 @@ class MobiusConfig {
 	 */
 	int mPluginPins;
 
+    /**
+     * The maximum number of frames we process at a time when running
+     * as a plugin.  Larger host buffers are split into blocks of
+     * this size.  Zero means to use the default.
+     */
+    int mPluginBlockFrames;
+
 	/**
 	 * When true, indicates that we should perform an automatic
 	 * 5% reduction in feedback during an overdub.  The EDP does this,
@@ -824,6 +852,14 @@ class MobiusConfig {
      */
     bool mNoSyncBeatRounding;
 
+    /**
+     * Disable the scheduling of outgoing MIDI clocks within the
+     * audio stream.  The timer then derives clocks from the tempo
+     * the way it used to.  This is a fallback in case the scheduled
+     * clocks cause trouble for some devices and is not exposed.
+     */
+    bool mNoClockScheduling;
+
     /**
      * Diagnostic option to periodically log engine status,
      * primarily memory usage.
@@ -839,6 +875,35 @@ class MobiusConfig {
      */
     bool mEdpisms;
 
+    /**
+     * When true audio buffers come from a pool shared by every
+     * plugin instance in the process rather than a private pool.
+     * Only read when the engine is created.
+     */
+    bool mSharedAudioPool;
+
+    /**
+     * Soft limit in megabytes on the shared buffers this instance
+     * may hold when the shared pool is under pressure.  Instances over
+     * their quota give up their oldest undo layers.  Zero means
+     * no limit.
+     */
+    int mAudioPoolQuota;
+
+    /**
+     * Port number, starting from 1, with its output wired back to
+     * its input that is used to measure latency continuously in the
+     * background.  Zero when disabled.
+     */
+    int mLatencyMonitorPort;
+
+    /**
+     * When zero or more latency calibration ignores the audio input 
+     * and simulates a loopback cable with this many frames of latency.
+     * For testing without hardware.  Negative to use the real input.
+     */
+    int mCalibrationLoopback;
+
 };
 
 /****************************************************************************/
@@ -308,6 +308,8 @@ class CalibrationResult {
 		timeout = false;
 		noiseFloor = 0.0;
 		latency = 0;
+		exactLatency = 0.0;
+		confidence = 0.0f;
 	}
 
 	~CalibrationResult() {
@@ -316,6 +318,10 @@ class CalibrationResult {
 	bool timeout;
 	float noiseFloor;
 	int latency;
+
+	// latency with the fraction, and how much we believe it
+	double exactLatency;
+	float confidence;
 };
 
 /****************************************************************************
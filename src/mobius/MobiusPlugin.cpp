@@ -347,6 +347,7 @@ class MobiusPlugin : public PluginInterface, public HostMidiInterface,
 
     HostConfigs* getHostConfigs();
 	int getPluginPorts();
+    int getBlockFrames();
 	void start();
     void resume();
     void suspend();
@@ -387,6 +388,7 @@ class MobiusPlugin : public PluginInterface, public HostMidiInterface,
     bool isDualWindowMode();
     void getWindowBounds(Bounds* b);
 	PluginParameter* addParameter(PluginParameter* last, Parameter* p);
+	void buildParameterTable();
 
 	bool mTrace;
 	HostInterface* mHost;
@@ -516,7 +518,7 @@ PUBLIC MobiusPlugin::~MobiusPlugin()
 	delete mParameters;
 	mParameters = NULL;
 
-	delete mParameterTable;
+	delete [] mParameterTable;
 	mParameterTable = NULL;
 
 	// note that deleting this will also delete the ResolvedTargets
@@ -613,6 +615,27 @@ PUBLIC int MobiusPlugin::getPluginPorts()
 	return ports;
 }
 
+/**
+ * Return the largest block of frames the host wrapper should give
+ * us at a time.  Normally the default, "pluginBlockFrames" is there
+ * to experiment with hosts that use very large buffers.
+ */
+PUBLIC int MobiusPlugin::getBlockFrames()
+{
+	int frames = HOST_DEFAULT_BLOCK_FRAMES;
+
+	MobiusConfig* config = mMobius->getConfiguration();
+	int configured = config->getPluginBlockFrames();
+
+	if (configured > 0) {
+		frames = configured;
+		if (frames > MAX_HOST_BUFFER_FRAMES)
+		  frames = MAX_HOST_BUFFER_FRAMES;
+	}
+
+	return frames;
+}
+
 /**
  * Called at an appropriate time after the initial quick opening.
  * Mobius creates a Recorder and registers it as the AudioHandler
@@ -711,40 +734,53 @@ PUBLIC PluginParameter* MobiusPlugin::getParameters()
                 }
             }
         }
+
+        // build the id table now rather than on the first
+        // host parameter change
+        buildParameterTable();
     }
 
 	return mParameters;
 }
 
 /**
- * !! not sure we need this any more now that we do parameter
- * sync in bulk.
+ * Build a table indexed by parameter id so the AU can find
+ * parameters without walking the list on every change.
  */
-PUBLIC PluginParameter* MobiusPlugin::getParameter(int id)
+PRIVATE void MobiusPlugin::buildParameterTable()
 {
-	PluginParameter* found = NULL;
-	if (mParameterTable == NULL) {
-		PluginParameter* params = getParameters();
-		if (params != NULL) {
-			int max = 0;
-			PluginParameter* p;
-			for (p = params ; p != NULL ; p = p->getNext()) {
-				if (p->getId() > max)
-				  max = p->getId();
-			}
+	if (mParameterTable == NULL && mParameters != NULL) {
+		int max = 0;
+		PluginParameter* p;
+		for (p = mParameters ; p != NULL ; p = p->getNext()) {
+			if (p->getId() > max)
+			  max = p->getId();
+		}
 			
-			mParameterTable = new PluginParameter*[max+1];
-			mParameterTableMax = max;
+		mParameterTable = new PluginParameter*[max+1];
+		mParameterTableMax = max;
 
-			for (int i = 0 ; i < max ; i++)
-			  mParameterTable[i] = NULL;
+		for (int i = 0 ; i <= max ; i++)
+		  mParameterTable[i] = NULL;
 
-			for (p = params ; p != NULL ; p = p->getNext())
-				mParameterTable[p->getId()] = p;
+		for (p = mParameters ; p != NULL ; p = p->getNext()) {
+			if (p->getId() >= 0)
+			  mParameterTable[p->getId()] = p;
 		}
 	}
+}
+
+/**
+ * Used by the AU to locate parameters by id.
+ */
+PUBLIC PluginParameter* MobiusPlugin::getParameter(int id)
+{
+	PluginParameter* found = NULL;
+
+	if (mParameterTable == NULL)
+	  getParameters();
 	
-	if (id >= 0 && id <= mParameterTableMax)
+	if (mParameterTable != NULL && id >= 0 && id <= mParameterTableMax)
 	  found = mParameterTable[id];
 
 	return found;
@@ -5,8 +5,10 @@
  * 
  * ---------------------------------------------------------------------
  * 
- * ObjectPool extensions for Mobius objects.
- * This has never been used.
+ * ObjectPool management for Mobius objects.
+ * EventPool, ActionPool and LayerPool are ObjectPools, they are created with
+ * Mobius and handed to the ObjectPoolManager when the engine starts
+ * so the pool thread can keep them filled.
  *
  */
 
@@ -16,43 +18,11 @@
 #include "Util.h"
 #include "ObjectPool.h"
 
+#include "Action.h"
 #include "Event.h"
+#include "Layer.h"
 #include "Mobius.h"
 
-/****************************************************************************
- *                                                                          *
- *                                   EVENTS                                 *
- *                                                                          *
- ****************************************************************************/
-
-class EventObjectPool : public ObjectPool {
-
-  public:
-
-    EventObjectPool();
-
-    PooledObject* newObject();
-    void prepareObject(PooledObject* obj);
-
-};
-
-PUBLIC EventObjectPool::EventObjectPool()
-{
-    initObjectPool("Event");
-    // defaults are fine, we don't use the free ring
-	prepare();
-}
-
-PUBLIC PooledObject* EventObjectPool::newObject()
-{
-    return NULL;
-}
-
-PUBLIC void EventObjectPool::prepareObject(PooledObject* obj)
-{
-    //((Event*)obj)->init();
-}
-
 /****************************************************************************
  *                                                                          *
  *   							INITIALIZATION                              *
@@ -68,21 +38,40 @@ PUBLIC void Mobius::initObjectPools()
 	if (mPools == NULL ) {
 		Trace(this, 2, "Creating object pools\n");
 		mPools = new ObjectPoolManager();
-		mPools->add(new EventObjectPool());
+		mPools->startThread();
+		// the manager owns these now
+		mPools->add(mEventPool);
+		mPools->add(mActionPool);
+		mPools->add(mLayerPool);
 	}
 }
 
+/**
+ * Stops the pool thread and deletes the pools.  The Action, Event
+ * and Layer pools go with it.
+ */
 PUBLIC void Mobius::flushObjectPools()
 {
 	if (mPools != NULL) {
 		Trace(this, 2, "Flushing object pools\n");
-        // we've never used this and tracing looks confusing
-		//mPools->dump();
 		delete mPools;
 		mPools = NULL;
+        mEventPool = NULL;
+        mActionPool = NULL;
+        mLayerPool = NULL;
 	}
 }
 
+/**
+ * Called by MobiusThread before it exits so the objects cached
+ * for it in the pools aren't stranded.
+ */
+PUBLIC void Mobius::releaseObjectPoolThread()
+{
+	if (mPools != NULL)
+	  mPools->releaseThread();
+}
+
 PUBLIC void Mobius::dumpObjectPools()
 {
 	if (mPools != NULL) {
@@ -0,0 +1,431 @@
+/*
+ * Copyright (c) 2010 Jeffrey S. Larson  <jeff@circularlabs.com>
+ * All rights reserved.
+ * See the LICENSE file for the full copyright and license declaration.
+ * 
+ * ---------------------------------------------------------------------
+ * 
+ * Things that can be shared by every Mobius instance in the process.
+ * See MobiusShared.h for the overview.
+ *
+ * The static Modes, Functions and Parameters were already shared but
+ * were localized again by every instance, and the Parameters kept
+ * pointers into the catalog of whichever instance localized them
+ * last.  When that instance was deleted the labels dangled.  Now the
+ * catalogs are owned here and the statics are only localized when
+ * the catalog actually changes.
+ *
+ * Compiled scripts are keyed by a hash of the files they were compiled
+ * from, so instances loading the same ScriptConfig get the same
+ * ScriptEnv.  If the files are edited the hash changes and the next
+ * reload compiles a new one.  A ScriptEnv is deleted when the last
+ * instance that used it releases it.
+ *
+ * Scripts with the !autoload option are never shared.  They are
+ * recompiled by ScriptInterpreter::setScript when they are not in use,
+ * but it can only see the interpreters of its own instance and
+ * would free blocks another instance's interrupt may be running.
+ *
+ * The csect protects the lists, hosts can create plugins from different
+ * threads.  None of this is touched by the audio interrupt.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Util.h"
+#include "List.h"
+#include "Vbuf.h"
+#include "Thread.h"
+#include "Trace.h"
+#include "MessageCatalog.h"
+
+#include "Function.h"
+#include "Mode.h"
+#include "Mobius.h"
+#include "MobiusConfig.h"
+#include "Parameter.h"
+#include "Script.h"
+#include "WatchPoint.h"
+
+#include "MobiusShared.h"
+
+/****************************************************************************
+ *                                                                          *
+ *                                   STATE                                  *
+ *                                                                          *
+ ****************************************************************************/
+
+PRIVATE CriticalSection SharedCsect("MobiusShared");
+
+/**
+ * Number of Mobius instances that have called acquire.
+ */
+PRIVATE int SharedReferences = 0;
+
+PRIVATE SharedCatalog* SharedCatalogs = NULL;
+
+/**
+ * The catalog the static objects were last localized with.
+ */
+PRIVATE MessageCatalog* SharedLocalized = NULL;
+
+PRIVATE SharedScripts* SharedScriptList = NULL;
+
+/****************************************************************************
+ *                                                                          *
+ *                                  ENTRIES                                 *
+ *                                                                          *
+ ****************************************************************************/
+
+PUBLIC SharedCatalog::SharedCatalog(const char* p, MessageCatalog* c)
+{
+    next = NULL;
+    path = CopyString(p);
+    catalog = c;
+}
+
+PUBLIC SharedCatalog::~SharedCatalog()
+{
+	SharedCatalog *el, *nextel;
+
+    delete path;
+    delete catalog;
+
+	for (el = next ; el != NULL ; el = nextel) {
+		nextel = el->next;
+		el->next = NULL;
+		delete el;
+	}
+}
+
+PUBLIC SharedScripts::SharedScripts(unsigned long h, const char* k,
+                                    ScriptEnv* e)
+{
+    next = NULL;
+    hash = h;
+    key = CopyString(k);
+    env = e;
+    exclusive = false;
+    references = 0;
+}
+
+PUBLIC SharedScripts::~SharedScripts()
+{
+	SharedScripts *el, *nextel;
+
+    delete key;
+    delete env;
+
+	for (el = next ; el != NULL ; el = nextel) {
+		nextel = el->next;
+		el->next = NULL;
+		delete el;
+	}
+}
+
+/****************************************************************************
+ *                                                                          *
+ *                                 INSTANCES                                *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Called by the Mobius constructor.
+ * The first one in initializes the static object tables.  These
+ * ignore redundant calls anyway, but this way it's done under
+ * the csect.
+ */
+PUBLIC void MobiusShared::acquire()
+{
+    SharedCsect.enter();
+
+    if (SharedReferences == 0) {
+        MobiusMode::initModes();
+        Function::initStaticFunctions();
+        Parameter::initParameters();
+    }
+    SharedReferences++;
+
+    SharedCsect.leave();
+}
+
+/**
+ * Called by the Mobius destructor.
+ * The last one out deletes the catalogs and anything left over
+ * in the script list.  The static objects may still point into
+ * the catalogs but they'll be localized again if another instance
+ * is created.
+ */
+PUBLIC void MobiusShared::release()
+{
+    SharedCsect.enter();
+
+    if (SharedReferences > 0) {
+        SharedReferences--;
+        if (SharedReferences == 0) {
+            if (SharedScriptList != NULL)
+              Trace(1, "MobiusShared: Unreleased scripts!\n");
+            delete SharedScriptList;
+            SharedScriptList = NULL;
+
+            delete SharedCatalogs;
+            SharedCatalogs = NULL;
+            SharedLocalized = NULL;
+        }
+    }
+
+    SharedCsect.leave();
+}
+
+/****************************************************************************
+ *                                                                          *
+ *                                  CATALOGS                                *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Return the message catalog read from a file, reading it the
+ * first time.  Returns NULL if the file can't be read.  A NULL path
+ * returns an empty catalog for when we're misconfigured.
+ *
+ * The catalog is owned by us, the caller must not delete it.
+ */
+PUBLIC MessageCatalog* MobiusShared::getCatalog(const char* path)
+{
+    MessageCatalog* cat = NULL;
+
+    SharedCsect.enter();
+
+    for (SharedCatalog* c = SharedCatalogs ; c != NULL ; c = c->next) {
+        if (StringEqual(c->path, path)) {
+            cat = c->catalog;
+            break;
+        }
+    }
+
+    if (cat == NULL) {
+        cat = new MessageCatalog();
+        if (path != NULL && !cat->read(path)) {
+            // problems reading catalog
+            printf("ERROR: Mobius: Unable to read message catalog: %s\n", path);
+            fflush(stdout);
+            delete cat;
+            cat = NULL;
+        }
+        else {
+            SharedCatalog* c = new SharedCatalog(path, cat);
+            c->next = SharedCatalogs;
+            SharedCatalogs = c;
+        }
+    }
+
+    SharedCsect.leave();
+
+    return cat;
+}
+
+/**
+ * Propagate a catalog to the static objects.
+ * Since they're shared, this only has to be done when the catalog
+ * changes which is normally only for the first instance.
+ */
+PUBLIC void MobiusShared::localize(MessageCatalog* cat)
+{
+    SharedCsect.enter();
+
+    if (cat != NULL && cat != SharedLocalized) {
+		MobiusMode::localizeAll(cat);
+		Parameter::localizeAll(cat);
+		Function::localizeAll(cat);
+        WatchPoint::localizeAll(cat);
+        SharedLocalized = cat;
+    }
+
+    SharedCsect.leave();
+}
+
+/****************************************************************************
+ *                                                                          *
+ *                                  SCRIPTS                                 *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Return a compiled ScriptEnv for a ScriptConfig, compiling it if
+ * no other instance has compiled the same files.
+ * Must be released with releaseScripts.
+ *
+ * Compilation is done inside the csect so two instances
+ * starting at the same time don't both compile.
+ */
+PUBLIC ScriptEnv* MobiusShared::getScripts(Mobius* m, ScriptConfig* config)
+{
+    ScriptEnv* env = NULL;
+    SharedScripts* found = NULL;
+
+    // this reads the files, do it outside the csect
+    Vbuf* key = new Vbuf();
+    unsigned long h = hash(m, config, key);
+    const char* keystring = key->getString();
+    if (keystring == NULL) keystring = "";
+
+    SharedCsect.enter();
+
+    for (SharedScripts* s = SharedScriptList ; s != NULL ; s = s->next) {
+        if (!s->exclusive && s->hash == h && 
+            StringEqual(s->key, keystring)) {
+            found = s;
+            break;
+        }
+    }
+
+    if (found == NULL) {
+        ScriptCompiler* sc = new ScriptCompiler();
+        found = new SharedScripts(h, keystring, sc->compile(m, config));
+        delete sc;
+
+        found->exclusive = isAutoLoad(found->env);
+        if (found->exclusive)
+          Trace(2, "MobiusShared: Not sharing scripts with !autoload\n");
+
+        found->next = SharedScriptList;
+        SharedScriptList = found;
+    }
+    else {
+        Trace(2, "MobiusShared: Sharing compiled scripts\n");
+    }
+
+    found->references++;
+    env = found->env;
+
+    SharedCsect.leave();
+
+    delete key;
+
+    return env;
+}
+
+/**
+ * True if any of the scripts in the environment will be
+ * recompiled when they are run.
+ */
+PRIVATE bool MobiusShared::isAutoLoad(ScriptEnv* env)
+{
+    bool autoload = false;
+
+    if (env != NULL) {
+        for (Script* s = env->getScripts() ; s != NULL && !autoload ; 
+             s = s->getNext())
+          autoload = s->isAutoLoad();
+    }
+
+    return autoload;
+}
+
+/**
+ * Release a ScriptEnv returned by getScripts.
+ * It is deleted when the last reference is released.
+ */
+PUBLIC void MobiusShared::releaseScripts(ScriptEnv* env)
+{
+    SharedScripts* prev = NULL;
+    SharedScripts* found = NULL;
+
+    SharedCsect.enter();
+
+    for (SharedScripts* s = SharedScriptList ; s != NULL ; s = s->next) {
+        if (s->env == env) {
+            found = s;
+            break;
+        }
+        prev = s;
+    }
+
+    if (found == NULL)
+      Trace(1, "MobiusShared: Releasing unknown scripts!\n");
+    else {
+        found->references--;
+        if (found->references <= 0) {
+            if (prev == NULL)
+              SharedScriptList = found->next;
+            else
+              prev->next = found->next;
+            found->next = NULL;
+            delete found;
+        }
+    }
+
+    SharedCsect.leave();
+}
+
+/**
+ * Calculate the hash that identifies a compiled ScriptConfig.
+ * This includes the resolved path of each reference and the contents
+ * of every file, directories are expanded the same way the
+ * ScriptCompiler does it.  The resolved paths are also left in the
+ * key buffer so matches can be verified.
+ */
+PRIVATE unsigned long MobiusShared::hash(Mobius* m, ScriptConfig* config,
+                                         Vbuf* key)
+{
+    // FNV-1a offset basis
+    unsigned long h = 2166136261UL;
+
+    if (config != NULL) {
+		for (ScriptRef* ref = config->getScripts() ; ref != NULL ; 
+			 ref = ref->getNext()) {
+
+            char path[1024];
+            ScriptCompiler::getPath(m, ref->getFile(), path);
+            h = hash(h, path);
+            key->add(path);
+            key->add("\n");
+
+            if (IsFile(path)) {
+                h = hashFile(h, path);
+            }
+            else if (IsDirectory(path)) {
+				StringList* files = GetDirectoryFiles(path, ".mos");
+				if (files != NULL) {
+					for (int i = 0 ; i < files->size() ; i++) {
+                        const char* file = files->getString(i);
+                        h = hash(h, file);
+                        h = hashFile(h, file);
+                        key->add(file);
+                        key->add("\n");
+                    }
+                    delete files;
+				}
+            }
+        }
+    }
+
+    return h;
+}
+
+PRIVATE unsigned long MobiusShared::hash(unsigned long h, const char* s)
+{
+    if (s != NULL) {
+        for (const char* ptr = s ; *ptr ; ptr++)
+          h = (h ^ (unsigned char)*ptr) * 16777619UL;
+    }
+
+    // separator so adjacent strings can't run together
+    h = (h ^ 0xFF) * 16777619UL;
+
+    return h;
+}
+
+PRIVATE unsigned long MobiusShared::hashFile(unsigned long h, const char* path)
+{
+    char* content = ReadFile(path);
+    h = hash(h, content);
+    delete content;
+    return h;
+}
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
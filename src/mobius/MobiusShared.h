@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2010 Jeffrey S. Larson  <jeff@circularlabs.com>
+ * All rights reserved.
+ * See the LICENSE file for the full copyright and license declaration.
+ * 
+ * ---------------------------------------------------------------------
+ * 
+ * Things that can be shared by every Mobius instance in the process.
+ *
+ * A host may create several plugin instances and each of them used
+ * to read its own message catalog and compile its own scripts.
+ * These never change once built so we keep one copy, reference
+ * counted, and hand out pointers.  Only the mutable runtime state
+ * lives in the Mobius instance.
+ *
+ */
+
+#ifndef MOBIUS_SHARED_H
+#define MOBIUS_SHARED_H
+
+/****************************************************************************
+ *                                                                          *
+ *                                   SHARED                                 *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * One message catalog read from a file.
+ */
+class SharedCatalog {
+
+  public:
+
+    SharedCatalog(const char* path, class MessageCatalog* catalog);
+    ~SharedCatalog();
+
+    SharedCatalog* next;
+    char* path;
+    class MessageCatalog* catalog;
+
+};
+
+/**
+ * One compiled script environment.
+ * The hash is calculated from the resolved paths and the contents
+ * of every file the ScriptConfig references.  The key is the full
+ * list of resolved paths so a hash collision can't hand out scripts
+ * compiled from different files.
+ *
+ * An environment containing !autoload scripts is exclusive to the
+ * instance that compiled it since those are recompiled in place
+ * when they are run.
+ */
+class SharedScripts {
+
+  public:
+
+    SharedScripts(unsigned long hash, const char* key, class ScriptEnv* env);
+    ~SharedScripts();
+
+    SharedScripts* next;
+    unsigned long hash;
+    char* key;
+    class ScriptEnv* env;
+    bool exclusive;
+    int references;
+
+};
+
+/**
+ * The process wide holder.  Everything is static, Mobius instances
+ * call acquire when they are constructed and release when they are
+ * deleted.  Catalogs and scripts stay around until the last
+ * instance is released since the static Functions and Parameters
+ * keep pointers into the catalogs.
+ */
+class MobiusShared {
+
+  public:
+
+    static void acquire();
+    static void release();
+
+    static class MessageCatalog* getCatalog(const char* path);
+    static void localize(class MessageCatalog* catalog);
+
+    static class ScriptEnv* getScripts(class Mobius* m, class ScriptConfig* config);
+    static void releaseScripts(class ScriptEnv* env);
+
+  private:
+
+    static unsigned long hash(class Mobius* m, class ScriptConfig* config,
+                              class Vbuf* key);
+    static bool isAutoLoad(class ScriptEnv* env);
+    static unsigned long hash(unsigned long hash, const char* s);
+    static unsigned long hashFile(unsigned long hash, const char* path);
+
+};
+
+#endif
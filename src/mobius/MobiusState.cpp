@@ -39,6 +39,12 @@ void MobiusState::init()
 
 	bindings = NULL;
 	globalRecording = false;
+    poolAllocs = 0;
+    poolMisses = 0;
+    poolFallbacks = 0;
+    poolHighWater = 0;
+    audioBuffers = 0;
+    sharedAudioBuffers = 0;
 	strcpy(customMode, "");
 	track = NULL;
 };
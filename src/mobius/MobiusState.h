@@ -270,6 +270,24 @@ class MobiusState {
 	 */
 	bool globalRecording;
 
+    /**
+     * Object pool counters summed over all pools.  A non-zero
+     * poolFallbacks means something had to go to the heap
+     * because a pool ran dry.
+     */
+    long poolAllocs;
+    long poolMisses;
+    long poolFallbacks;
+    long poolHighWater;
+
+    /**
+     * Audio buffers held by this instance, and by every instance
+     * using the shared audio pool.  The shared count is zero when
+     * the pool isn't shared.
+     */
+    long audioBuffers;
+    long sharedAudioBuffers;
+
 	// TODO: Capture global variables here, or have the UI pull
 	// them one at a time?
 
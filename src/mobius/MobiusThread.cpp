@@ -253,6 +253,7 @@ MobiusThread::MobiusThread(Mobius* m)
     mMobius = m;
 	mEvents = NULL;
 	mOneShot = TE_NONE;
+    mPrepareCopy = false;
 	mInterrupts = 0;
     mCycles = 0;
     mStatusCycles = 0;
@@ -316,6 +317,9 @@ void MobiusThread::threadEnding()
 {
 	if (NewTraceListener == this)
 	  NewTraceListener = NULL;
+
+    // give back anything the pools cached for us
+    mMobius->releaseObjectPoolThread();
 }
 
 void MobiusThread::flushEvents()
@@ -368,6 +372,19 @@ PUBLIC void MobiusThread::addEvent(ThreadEventType tet)
 	signal();
 }
 
+/**
+ * Called from the interrupt when a loop switch has been scheduled
+ * that will copy into an empty loop, or when the copy is no longer
+ * wanted and the layers must be freed.  This has its own flag rather
+ * than using the one-shot so it can't be lost to a TE_TIME_BOUNDARY,
+ * and so we don't have to allocate a ThreadEvent in the interrupt.
+ */
+PUBLIC void MobiusThread::prepareSwitchCopy()
+{
+    mPrepareCopy = true;
+    signal();
+}
+
 /**
  * We implement the util/TraceListener interface and will be registered
  * as the listener.  This method is called whenever a new trace
@@ -431,6 +448,18 @@ void MobiusThread::eventTimeout()
         mStatusCycles = 0;
     }
 
+    // keep the shared audio pool warm, this does nothing
+    // if the pool isn't shared
+    mMobius->getAudioPool()->maintain();
+
+    // grow the layer history indexes before the interrupt needs them
+    mMobius->maintainHistory();
+
+    // analyze the background latency capture if there is one
+    Recorder* recorder = mMobius->getRecorder();
+    if (recorder != NULL)
+      recorder->checkLatencyMonitor();
+
     // this is typically the UI
 	MobiusListener* ml = mMobius->getListener();
 	if (ml != NULL)
@@ -640,6 +669,12 @@ void MobiusThread::processEvent()
 		mOneShot = TE_NONE;
 	}
 
+    // build or free the layers for loop switch copies
+    if (mPrepareCopy) {
+        mPrepareCopy = false;
+        mMobius->prepareSwitchCopies();
+    }
+
 	// and flush trace messages again
 	if (NewTraceListener == this) FlushTrace();
 }
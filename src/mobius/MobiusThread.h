@@ -121,6 +121,7 @@ class MobiusThread : public Thread, public TraceListener
 
 	void addEvent(ThreadEvent* e);
 	void addEvent(ThreadEventType type);
+    void prepareSwitchCopy();
 	void traceEvent();
 	void threadEnding();
 
@@ -142,6 +143,7 @@ class MobiusThread : public Thread, public TraceListener
     class Mobius* mMobius;
 	ThreadEvent* mEvents;
 	ThreadEventType mOneShot;
+    bool mPrepareCopy;
 	long mInterrupts;
     long mCycles;
     int mStatusCycles;
@@ -23,6 +23,7 @@
 class MobiusMode : public SystemConstant {
 
     friend class Mobius;
+    friend class MobiusShared;
 
   public:
 
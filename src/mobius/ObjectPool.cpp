@@ -10,87 +10,65 @@
  * 
  * NOTE: This is general, consider moving to util.
  *
- * The object pool will be accessed from two contexts:
+ * The object pool will be accessed from several contexts:
  *
  *    Maintenance Thread - an application thread that runs periodically to 
  *      perform pool maintenance
  *
  *    Interrupt - an device interrupt that runs continually 
  *
- * The interrupt is expected to be able to retrieve and return 
- * objects from the pool instantly, without a critical section
- * crossing where possible.  The pool thread is expected to keep
- * the pool full of objects so the interrupt handler will never starve.
+ *    Other threads - the UI and MIDI threads may also allocate
+ *      and free objects
  *
- * An object pool maintains two linked lists and two ring buffers.
- * 
- *   Allocation Ring
- *     A ring buffer of pooled objects available to the interrupt.
- *     The interrupt handler will remove objects from the tail of the ring,
- *     the pool thread will add objects to the head of the ring.
+ * Everyone is expected to be able to retrieve and return objects from 
+ * the pool instantly, without a critical section.  The pool thread is
+ * expected to keep the pool full of objects so the interrupt handler 
+ * will never starve.
  *
- *   Allocation List
- *     A list of pooled objects that the pool thread may add to the
- *     allocation ring.  The allocation ring is of fixed size and may not
- *     be large enough to hold all of the pooled objects that have ever
- *     been allocated.  When an object is freed and the ring buffer is full,
- *     it "overflows" to the allocation list.  When the pool thread
- *     needs to add something to the allocation ring, it first uses
- *     objects from the allocation list, then allocates new objects.
+ * Every object a pool creates is kept in an object table and is
+ * identified by its index in the table.  The pool maintains two
+ * lock free stacks of indexes:
  *
- *   Free Ring
- *     A ring buffer of pooled objects available to be reclaimed.
- *     The interrupt handler will add objects to the head of the ring.
- *     The pool thread will remove objects from the tail of the ring.
- *     Objects removed from the tail will be placed back on the
- *     head of the allocation ring if it is not full, otherwise on
- *     the allocation list.
+ *   Available Stack
+ *     Indexes of objects that may be allocated.  Any thread may push
+ *     and pop.
  *
- *   Free List
- *     A list of objects ready to be put on the free ring by the interrupt
- *     handler.  Like the allocation ring, the free ring is not necessarily
- *     large enough to hold all objects that have ever been allocated.  If the
- *     free ring is full when the interrupt handler frees an object, 
- *     it will be added to the free list.  The interrupt handler will
- *     periodically check to see if space is available on the free ring
- *     and move the free list objects to the ring.
+ *   Empty Stack
+ *     Indexes of table slots that have no object.  The pool thread
+ *     pops these when it creates new objects and pushes them when
+ *     it returns objects to the heap.
  *
- * Only the pool thread is allowed to touch the allocation list, the head
- * of the allocation ring, and the tail of the free ring.
+ * The stacks are linked through an array of indexes rather than through
+ * the objects, which lets the top of the stack be a single 64-bit word 
+ * holding the index and a tag that changes on every push.  This avoids 
+ * the usual ABA problem with compare and swap lists without needing
+ * a double wide swap.
  *
- * Only the interrupt handler is allowed to touch the free list, the head
- * of the free ring, and the tail of the allocation ring.
- * 
- * A pool may decide not to return objects in the free list to the
- * free ring, and instead allocate directly from the free list.  This
- * requires slighthly less overhead than a ring allocation, and a freed
- * object will available immediately without waiting for the maintenance
- * thread to move it from the free ring to the allocation ring.
- * This is useful for most small objects that are allocated and freed
- * frequently.  
+ * In front of the shared stack each thread has a small private cache of
+ * indexes called a magazine.  Alloc and free work on the magazine
+ * without any atomic operations, when the magazine runs empty half of it
+ * is refilled from the shared stack, and when it fills half of it is
+ * returned.  There are a fixed number of magazines, threads beyond
+ * that go directly to the shared stack.  A thread that is about to
+ * exit should call ObjectPoolManager::releaseThread so the objects
+ * in its magazines go back to the shared stack and the slot can
+ * be used by another thread.
  *
- * The free ring is useful for very large objects such as audio buffers.
- * Since the free list is "owned" by the interrupt handler and the 
- * interrupt handler is not allowed to return objects to the heap, 
- * everything on the free list will remain allocated for the lifetime
- * of the application.  If large buffers are allowed to accumulate, 
- * the memory size of the process will steadily increase.  This is not
- * necessarily a bad thing, but may lead to increased paging.  Instead,
- * the interrupt may periodically return buffers to the free ring
- * (such as after a GlobalReset), and the maintenance thread may
- * then choose to return them to the heap rather than accumulating
- * them on the allocation list.
+ * The pool thread is signaled when the number of objects on the available
+ * stack falls below the low water mark, it then creates objects until it
+ * reaches the high water mark.  When frees push the count above the high
+ * water mark, the excess is returned to the heap.
+ *
+ * If the available stack is empty when something calls alloc, a new
+ * object is allocated from the heap by the caller.  This is counted
+ * as a "fallback" and when the caller is the interrupt it means we've
+ * done something we shouldn't have.  The statistics are available
+ * through ObjectPoolManager::getStatistics and included in MobiusState.
  *
  * Some pooled objects, notably Audio objects, contain a hierarchy
  * of other objects which may also be pooled.  The interrupt handler
  * will usually pool the root Audio object, not each of the audio buffers
- * maintained within the Audio object.  The audio buffers will be returned
- * to the pool when the pool thread reclaims the Audio object.
- *
- * This means that there are two contexts in which an object may be returned
- * to the allocation list: indirectly by the interrupt handler via
- * the free ring, or directly by the pool thread if the object is inside
- * another pooled object.
+ * maintained within the Audio object.
  * 
  * The Object Pool Manager is a singleton that maintains multiple
  * object pools.  The interrupt handler may retain pointers to the
@@ -116,7 +94,7 @@
 PUBLIC PooledObject::PooledObject()
 {
     mPool = NULL;
-    mPoolChain = NULL;
+    mPoolIndex = -1;
     mPooled = false;
 }
 
@@ -137,14 +115,14 @@ PUBLIC class ObjectPool* PooledObject::getPool()
     return mPool;
 }
 
-PUBLIC void PooledObject::setPoolChain(PooledObject* p)
+PUBLIC void PooledObject::setPoolIndex(int i)
 {
-    mPoolChain = p;
+    mPoolIndex = i;
 }
 
-PUBLIC PooledObject* PooledObject::getPoolChain()
+PUBLIC int PooledObject::getPoolIndex()
 {
-    return mPoolChain;
+    return mPoolIndex;
 }
 
 PUBLIC void PooledObject::setPooled(bool b)
@@ -222,6 +200,131 @@ PUBLIC PooledBuffer* PooledBuffer::getPooledBuffer(unsigned char* buffer)
     return pb;
 }
 
+/****************************************************************************
+ *                                                                          *
+ *                                  ATOMICS                                 *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Layout of a stack top word, see mAvailable in ObjectPool.h.
+ */
+#define POOL_INDEX_MASK 0xFFFFFFFFULL
+#define POOL_TAG_MASK 0xFFFFFFFF00000000ULL
+#define POOL_TAG_ONE 0x100000000ULL
+
+#ifdef _WIN32
+#define POOL_THREAD_LOCAL __declspec(thread)
+
+PRIVATE unsigned long long PoolRead(volatile unsigned long long* p)
+{
+    // a 64-bit read isn't atomic on 32-bit Windows
+    return (unsigned long long)
+        InterlockedCompareExchange64((volatile LONGLONG*)p, 0, 0);
+}
+
+PRIVATE bool PoolCas(volatile unsigned long long* p, 
+                     unsigned long long oldval, unsigned long long newval)
+{
+    return ((unsigned long long)
+            InterlockedCompareExchange64((volatile LONGLONG*)p, 
+                                         (LONGLONG)newval, (LONGLONG)oldval)
+            == oldval);
+}
+
+PUBLIC bool PoolCas(volatile long* p, long oldval, long newval)
+{
+    return (InterlockedCompareExchange(p, newval, oldval) == oldval);
+}
+
+PUBLIC long PoolAdd(volatile long* p, long delta)
+{
+    return InterlockedExchangeAdd(p, delta) + delta;
+}
+
+#else
+#define POOL_THREAD_LOCAL __thread
+
+PRIVATE unsigned long long PoolRead(volatile unsigned long long* p)
+{
+    return __sync_val_compare_and_swap(p, 0ULL, 0ULL);
+}
+
+PRIVATE bool PoolCas(volatile unsigned long long* p, 
+                     unsigned long long oldval, unsigned long long newval)
+{
+    return __sync_bool_compare_and_swap(p, oldval, newval);
+}
+
+PUBLIC bool PoolCas(volatile long* p, long oldval, long newval)
+{
+    return __sync_bool_compare_and_swap(p, oldval, newval);
+}
+
+PUBLIC long PoolAdd(volatile long* p, long delta)
+{
+    return __sync_add_and_fetch(p, delta);
+}
+
+#endif
+
+/**
+ * Magazine slot for the current thread.  Zero until the thread
+ * first touches a pool, then 1 based slot number or -1 if we
+ * ran out of slots.  Slots are shared by all pools and are
+ * given back by releaseThreadSlot.
+ */
+POOL_THREAD_LOCAL int PoolThreadSlot = 0;
+
+/**
+ * Non-zero for each slot a thread has claimed.
+ */
+volatile long PoolThreadSlots[OBJECT_POOL_MAX_MAGAZINES];
+
+/****************************************************************************
+ *                                                                          *
+ *                           OBJECT POOL STATISTICS                         *
+ *                                                                          *
+ ****************************************************************************/
+
+PUBLIC ObjectPoolStatistics::ObjectPoolStatistics()
+{
+    init();
+}
+
+PUBLIC void ObjectPoolStatistics::init()
+{
+    allocs = 0;
+    frees = 0;
+    misses = 0;
+    fallbacks = 0;
+    contention = 0;
+    created = 0;
+    deleted = 0;
+    inUse = 0;
+    highWater = 0;
+    overflows = 0;
+}
+
+/**
+ * Accumulate the counters from another pool.
+ * The high water marks weren't reached at the same time, so the
+ * sum is an upper bound.
+ */
+PUBLIC void ObjectPoolStatistics::add(ObjectPoolStatistics* other)
+{
+    allocs += other->allocs;
+    frees += other->frees;
+    misses += other->misses;
+    fallbacks += other->fallbacks;
+    contention += other->contention;
+    created += other->created;
+    deleted += other->deleted;
+    inUse += other->inUse;
+    highWater += other->highWater;
+    overflows += other->overflows;
+}
+
 /****************************************************************************
  *                                                                          *
  *                                OBJECT POOL                               *
@@ -234,101 +337,93 @@ PUBLIC ObjectPool::ObjectPool()
 
 /**
  * Called by the subclass constructor.
+ * The subclass may change mCapacity, mLowWater, and mHighWater 
+ * before calling prepare.
  */
 PRIVATE void ObjectPool::initObjectPool(const char* name)
 {
 	mNext = NULL;
 	mName = CopyString(name);
     mThread = NULL;
-	mAllocList = NULL;
-	mAllocRing = NULL;
-	mAllocHead = 0;
-	mAllocTail = 0;
-	mAllocSize = 0;
-    mAllocWarning = 0;
-	mFreeList = NULL;
-	mFreeRing = NULL;
-	mFreeHead = 0;
-	mFreeTail = 0;
-	mFreeSize = 0;
-    mUseFreeRing = false;
+
+    mCapacity = OBJECT_POOL_DEFAULT_CAPACITY;
+    mLowWater = OBJECT_POOL_DEFAULT_LOW_WATER;
+    mHighWater = OBJECT_POOL_DEFAULT_HIGH_WATER;
+
+    mObjects = NULL;
+    mLinks = NULL;
+    mAvailable = 0;
+    mEmpty = 0;
+    mAvailableCount = 0;
+    memset(mMagazines, 0, sizeof(mMagazines));
+
+    mAllocs = 0;
+    mFrees = 0;
+    mMisses = 0;
+    mFallbacks = 0;
+    mContention = 0;
+    mCreated = 0;
+    mDeleted = 0;
+    mInUse = 0;
+    mHighWaterMark = 0;
+    mOverflows = 0;
 }
 
 /**
  * Called by the subclass constructor after it has specified options.
+ * Builds the object table and fills the pool to the high water mark
+ * so the interrupt doesn't miss before the maintenance thread has run.
  */
 PRIVATE void ObjectPool::prepare()
 {
     if (mName == NULL)
       mName = CopyString("unspecified");
 
-    // rings must be at least 2 elements
+	if (mCapacity < 1)
+	  mCapacity = OBJECT_POOL_DEFAULT_CAPACITY;
 
-	if (mAllocSize < 2)
-	  mAllocSize = OBJECT_POOL_DEFAULT_RING_SIZE;
+    if (mHighWater > mCapacity)
+      mHighWater = mCapacity;
 
-	if (mFreeSize < 2)
-	  mFreeSize = OBJECT_POOL_DEFAULT_RING_SIZE;
+    if (mLowWater > mHighWater)
+      mLowWater = mHighWater / 2;
 
-    // when the number of objects falls below this threshold
-    // signal the maintenance thread
-    if (mAllocWarning <= 0)
-      mAllocWarning = mAllocSize / 2;
+	mObjects = new PooledObject*[mCapacity];
+	memset(mObjects, 0, sizeof(PooledObject*) * mCapacity);
 
-	// the way rings work, the head must always be pointing
-	// to "empty" space so the rings have to be one larger
-	// than the desired number of objects
-	mAllocSize++;
-	mFreeSize++;
+    mLinks = new int[mCapacity];
 
-	mAllocRing = new PooledObject*[mAllocSize];
-	memset(mAllocRing, 0, sizeof(PooledObject*) * mAllocSize);
+    // every slot starts out empty, push in reverse so the 
+    // low slots are used first
+    for (int i = mCapacity - 1 ; i >= 0 ; i--)
+      push(&mEmpty, i);
 
-	mFreeRing = new PooledObject*[mFreeSize];
-	memset(mFreeRing, 0, sizeof(PooledObject*) * mFreeSize);
+    maintain();
 }
 
 PUBLIC ObjectPool::~ObjectPool()
 {
-    // free the allocation list
-    while (mAllocList != NULL) {
-        PooledObject* obj = mAllocList;
-        mAllocList = obj->getPoolChain();
-        deleteObject(obj);
-    }
-
-    // free the allocation ring
-    while (mAllocTail != mAllocHead) {
-        PooledObject* obj = mAllocRing[mAllocTail];
-        if (obj == NULL)
-          Trace(1, "Corrupted allocation ring %s\n", mName);
-        else
-          deleteObject(obj);
-        mAllocTail++;
-        if (mAllocTail >= mAllocSize)
-          mAllocTail = 0;
+    int inUse = 0;
+
+    // anything still in use is leaked, we can't tell who has it
+    if (mObjects != NULL) {
+        for (int i = 0 ; i < mCapacity ; i++) {
+            PooledObject* obj = mObjects[i];
+            if (obj != NULL) {
+                if (obj->isPooled())
+                  deleteObject(obj);
+                else
+                  inUse++;
+            }
+        }
     }
-    delete mAllocRing;
 
-    // free the free ring
-    while (mFreeTail != mFreeHead) {
-        PooledObject* obj = mFreeRing[mFreeTail];
-        if (obj == NULL)
-          Trace(1, "Corrupted free ring %s\n", mName);
-        else
-          deleteObject(obj);
-        mFreeTail++;
-        if (mFreeTail >= mFreeSize)
-          mFreeTail = 0;
-    }
-    delete mFreeRing;
+    if (inUse > 0)
+      Trace(1, "ObjectPool %s: deleted with %ld objects in use\n", 
+            mName, (long)inUse);
 
-    // free the free list
-    while (mFreeList != NULL) {
-        PooledObject* obj = mFreeList;
-        mFreeList = obj->getPoolChain();
-        deleteObject(obj);
-    }
+    delete[] mObjects;
+    delete[] mLinks;
 }
 
 PRIVATE void ObjectPool::deleteObject(PooledObject* obj)
@@ -359,17 +454,6 @@ PUBLIC void ObjectPool::setThread(Thread* t)
     mThread = t;
 }
 
-/**
- * Called internally to allocate a new object from the heap.
- * The newObject method must be overloaded in the subclass.
- */
-PRIVATE PooledObject* ObjectPool::allocNew()
-{
-    PooledObject* obj = newObject();
-    obj->setPool(this);
-    return obj;
-}
-
 /**
  * Called indirectly by the interrupt handler when it wants the
  * maintenance thread to run soon.
@@ -381,59 +465,194 @@ PRIVATE void ObjectPool::requestMaintenance()
 }
 
 /**
- * Called by the interrupt handler to allocate an object.
+ * Locate the private cache for the calling thread.
+ * Returns NULL if all the slots have been taken.
+ */
+PRIVATE ObjectPoolMagazine* ObjectPool::getMagazine()
+{
+    ObjectPoolMagazine* mag = NULL;
+
+    if (PoolThreadSlot == 0) {
+        PoolThreadSlot = -1;
+        for (int i = 0 ; i < OBJECT_POOL_MAX_MAGAZINES ; i++) {
+            if (PoolCas(&PoolThreadSlots[i], 0, 1)) {
+                PoolThreadSlot = i + 1;
+                break;
+            }
+        }
+    }
+
+    if (PoolThreadSlot > 0)
+      mag = &mMagazines[PoolThreadSlot - 1];
+
+    return mag;
+}
+
+/****************************************************************************
+ *                                                                          *
+ *                                INDEX STACKS                              *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Pop an index from one of the shared stacks, -1 if it is empty.
+ * mLinks may be changed by another thread after we read it, but if 
+ * that happens the top will have changed too and the swap fails.
+ */
+PRIVATE int ObjectPool::pop(volatile unsigned long long* stack)
+{
+    int index = -1;
+    long retries = 0;
+
+    unsigned long long top = PoolRead(stack);
+    while ((top & POOL_INDEX_MASK) != 0) {
+        int i = (int)(top & POOL_INDEX_MASK) - 1;
+        unsigned long long next = 
+            (top & POOL_TAG_MASK) | (unsigned long long)(mLinks[i] + 1);
+        if (PoolCas(stack, top, next)) {
+            index = i;
+            break;
+        }
+        retries++;
+        top = PoolRead(stack);
+    }
+
+    if (retries > 0)
+      PoolAdd(&mContention, retries);
+
+    return index;
+}
+
+/**
+ * Push an index on one of the shared stacks.  The tag is bumped
+ * so a pop that read the old top before we got here can't succeed.
+ */
+PRIVATE void ObjectPool::push(volatile unsigned long long* stack, int index)
+{
+    long retries = 0;
+
+    unsigned long long top = PoolRead(stack);
+    for (;;) {
+        mLinks[index] = (int)(top & POOL_INDEX_MASK) - 1;
+        unsigned long long next = 
+            ((top & POOL_TAG_MASK) + POOL_TAG_ONE) | 
+            (unsigned long long)(index + 1);
+        if (PoolCas(stack, top, next))
+          break;
+        retries++;
+        top = PoolRead(stack);
+    }
+
+    if (retries > 0)
+      PoolAdd(&mContention, retries);
+}
+
+PRIVATE int ObjectPool::popAvailable()
+{
+    int index = pop(&mAvailable);
+    if (index >= 0)
+      PoolAdd(&mAvailableCount, -1);
+    return index;
+}
+
+PRIVATE void ObjectPool::pushAvailable(int index)
+{
+    push(&mAvailable, index);
+    PoolAdd(&mAvailableCount, 1);
+}
+
+/****************************************************************************
+ *                                                                          *
+ *                              ALLOC AND FREE                              *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Called when the pool is empty to allocate a new object from the heap.
+ * The newObject method must be overloaded in the subclass.
+ * If the object table is full, the object is given an index of -1
+ * and will be deleted when it is freed.
+ */
+PRIVATE PooledObject* ObjectPool::allocNew()
+{
+    PooledObject* obj = newObject();
+    if (obj != NULL) {
+        int index = pop(&mEmpty);
+        if (index >= 0)
+          mObjects[index] = obj;
+        else
+          PoolAdd(&mOverflows, 1);
+        obj->setPool(this);
+        obj->setPoolIndex(index);
+    }
+    return obj;
+}
+
+/**
+ * Called by the interrupt handler, or any other thread, to 
+ * allocate an object.
  */
 PUBLIC PooledObject* ObjectPool::alloc()
 {
 	PooledObject* obj = NULL;
+    int index = -1;
+    ObjectPoolMagazine* mag = getMagazine();
 
-    if (mFreeList != NULL) {
-        // first use the free list if we have one
-        obj = mFreeList;
-        mFreeList = obj->getPoolChain();
-    }
-    else if (mAllocTail == mAllocHead) {
-        // the ring has been consumed, the maintenance thread 
-        // must not be running
-        Trace(1, "Empty allocation ring in pool %s\n", mName);
+    if (mag == NULL) {
+        PoolAdd(&mAllocs, 1);
+        index = popAvailable();
     }
     else {
-        obj = mAllocRing[mAllocTail];
-        if (obj == NULL)
-          Trace(1, "Corrupted allocation ring in pool %s\n", mName);
-        mAllocTail++;
-        if (mAllocTail >= mAllocSize)
-          mAllocTail = 0;
+        mag->allocs++;
+        if (mag->count == 0) {
+            // take half a magazine so the next free has room
+            while (mag->count < OBJECT_POOL_MAGAZINE_SIZE / 2) {
+                int i = popAvailable();
+                if (i < 0)
+                  break;
+                mag->indexes[mag->count++] = i;
+            }
+        }
+        if (mag->count > 0)
+          index = mag->indexes[--mag->count];
     }
 
-    if (obj == NULL) {
-        // This should never happen but on windows we can call the factory
-        // and have a very good chance of success.  On Mac this will crash.
+    if (index >= 0)
+      obj = mObjects[index];
+    else {
+        // the maintenance thread isn't keeping up
+        Trace(1, "Empty object pool %s\n", mName);
         obj = allocNew();
+        if (mag == NULL) {
+            PoolAdd(&mMisses, 1);
+            if (obj != NULL)
+              PoolAdd(&mFallbacks, 1);
+        }
+        else {
+            mag->misses++;
+            if (obj != NULL)
+              mag->fallbacks++;
+        }
     }
 
-    obj->setPooled(false);
-    obj->setPoolChain(NULL);
-
-    if (mUseFreeRing || mFreeList == NULL) {
-        // capture current for threshold detection, it doesn't matter if the
-        // maintenance thread advances the head after this
-        int available = 0;
-        int head = mAllocHead;
-        if (head > mAllocTail)
-          available = head - mAllocTail;
-        else if (head < mAllocTail)
-          available = mAllocSize - (mAllocTail - head);
-
-        if (available < mAllocWarning)
-          requestMaintenance();
+    if (obj != NULL) {
+        obj->setPooled(false);
+
+        long inUse = PoolAdd(&mInUse, 1);
+        long high = mHighWaterMark;
+        while (inUse > high && !PoolCas(&mHighWaterMark, high, inUse))
+          high = mHighWaterMark;
     }
 
+    if (mAvailableCount < mLowWater)
+      requestMaintenance();
+
     return obj;
 }
 
 /**
- * Called by the interrupt handler to free an object.
+ * Called by the interrupt handler, or any other thread, to 
+ * free an object.
  */
 PUBLIC void ObjectPool::free(PooledObject* obj)
 {
@@ -442,134 +661,173 @@ PUBLIC void ObjectPool::free(PooledObject* obj)
         // let it leak
     }
     else if (obj->getPool() != this) {
+        ObjectPool* other = obj->getPool();
         Trace(1, "Attempt to pool object %s in pool %s\n", 
-              obj->getPool()->getName(), mName);
+              ((other != NULL) ? other->getName() : "none"), mName);
         // let it leak
     }
-    else if (!mUseFreeRing) {
-        
-        // TODO: If the number of objects on the free list exceeds
-        // a threshold, return them to the ring so they may be returned
-        // to the heap.
-
-        obj->setPoolChain(mFreeList);
-        mFreeList = obj;
-        obj->setPooled(true);
-    }
     else {
-        int nextHead = mFreeHead + 1;
-        if (nextHead >= mFreeSize)
-          nextHead = 0;
-
-        else if (nextHead == mFreeTail) {
-            // management thread isn't keeping up, this usually indicates
-            // a problem since we don't normally free large numbers of things
-            Trace(2, "Free ring overflow, spilling to free list\n");
-            obj->setPoolChain(mFreeList);
-            mFreeList = obj;
-            obj->setPooled(true);
+        ObjectPoolMagazine* mag = getMagazine();
+        int index = obj->getPoolIndex();
+
+        if (mag == NULL)
+          PoolAdd(&mFrees, 1);
+        else
+          mag->frees++;
+
+        PoolAdd(&mInUse, -1);
+
+        if (index < 0) {
+            // allocated after the table filled, nowhere to put it,
+            // raise the capacity if you see this
+            Trace(1, "Deleting overflow object in pool %s\n", mName);
+            deleteObject(obj);
         }
         else {
-            mFreeRing[mFreeHead] = obj;
-            mFreeHead = nextHead;
             obj->setPooled(true);
+            if (mag == NULL)
+              pushAvailable(index);
+            else {
+                if (mag->count >= OBJECT_POOL_MAGAZINE_SIZE) {
+                    // give half back so other threads can have them
+                    while (mag->count > OBJECT_POOL_MAGAZINE_SIZE / 2)
+                      pushAvailable(mag->indexes[--mag->count]);
+                }
+                mag->indexes[mag->count++] = index;
+            }
         }
     }
 }
 
+/****************************************************************************
+ *                                                                          *
+ *                                MAINTENANCE                               *
+ *                                                                          *
+ ****************************************************************************/
+
 /**
- * Called by the application thread to perform pending operations.
+ * Called by the maintenance thread.  When the number of available
+ * objects falls below the low water mark fill it to the high water mark,
+ * when it rises above the high water mark return the excess to the heap.
+ * Only one thread may call this at a time.
  */
 PUBLIC void ObjectPool::maintain()
 {
-    // consume the free ring
-	int freed = 0;
-    while (mFreeTail != mFreeHead) {
-        PooledObject* obj = mFreeRing[mFreeTail];
-        if (obj == NULL)
-          Trace(1, "Corrupted free ring %s\n", mName);
-        else {
-            obj->setPoolChain(mAllocList);
-            mAllocList = obj;
+	int added = 0;
+    int removed = 0;
+
+    if (mAvailableCount < mLowWater) {
+        while (mAvailableCount < mHighWater) {
+            int index = pop(&mEmpty);
+            if (index < 0) {
+                Trace(2, "ObjectPool %s: capacity reached\n", mName);
+                break;
+            }
+            PooledObject* obj = newObject();
+            if (obj == NULL) {
+                push(&mEmpty, index);
+                break;
+            }
+            obj->setPool(this);
+            obj->setPoolIndex(index);
+            obj->setPooled(true);
+            mObjects[index] = obj;
+            pushAvailable(index);
+            added++;
+        }
+    }
+    else {
+        while (mAvailableCount > mHighWater) {
+            int index = popAvailable();
+            if (index < 0)
+              break;
+            PooledObject* obj = mObjects[index];
+            mObjects[index] = NULL;
+            push(&mEmpty, index);
+            deleteObject(obj);
+            removed++;
         }
-        mFreeTail++;
-		freed++;
-        if (mFreeTail >= mFreeSize)
-          mFreeTail = 0;
     }
 
-	if (freed > 0)
-	  Trace(2, "ObjectPool: consumed %ld objects from the free ring\n", (long)freed);
+	if (added > 0) {
+        PoolAdd(&mCreated, added);
+        Trace(2, "ObjectPool %s: added %ld objects\n", mName, (long)added);
+    }
 
-    // TODO: If the number of objects on the free list exceeds a threshold
-    // return them to the heap
+	if (removed > 0) {
+        PoolAdd(&mDeleted, removed);
+        Trace(2, "ObjectPool %s: deleted %ld objects\n", mName, (long)removed);
+    }
+}
 
-    // fill the allocation ring
+/**
+ * Called by a thread that is about to exit to return the objects
+ * in its magazine to the shared stack, otherwise they would be
+ * stranded until another thread is given the same slot.
+ */
+PUBLIC void ObjectPool::releaseMagazine()
+{
+    if (PoolThreadSlot > 0) {
+        ObjectPoolMagazine* mag = &mMagazines[PoolThreadSlot - 1];
+        while (mag->count > 0)
+          pushAvailable(mag->indexes[--mag->count]);
+    }
+}
 
-    int nextHead = mAllocHead + 1;
-    if (nextHead >= mAllocSize) nextHead = 0;
-	int added = 0;
+/**
+ * Called by a thread that is about to exit after it has released
+ * its magazines so the slot may be claimed by another thread.
+ */
+PUBLIC void ObjectPool::releaseThreadSlot()
+{
+    if (PoolThreadSlot > 0)
+      PoolThreadSlots[PoolThreadSlot - 1] = 0;
+    PoolThreadSlot = 0;
+}
 
-    while (nextHead != mAllocTail) {
-        PooledObject* obj;
-        if (mAllocList == NULL)
-          obj = allocNew();
-        else {
-            obj = mAllocList;
-            mAllocList = obj->getPoolChain();
-            obj->setPoolChain(NULL);
-        }
-        mAllocRing[mAllocHead] = obj;
-        mAllocHead = nextHead;
-        nextHead = mAllocHead + 1;
-		added++;
-        if (nextHead >= mAllocSize) nextHead = 0;
+/**
+ * Capture the counters.  Magazine counters are read without 
+ * synchronization so this may be slightly behind.
+ */
+PUBLIC void ObjectPool::getStatistics(ObjectPoolStatistics* stats)
+{
+    stats->init();
+    stats->allocs = mAllocs;
+    stats->frees = mFrees;
+    stats->misses = mMisses;
+    stats->fallbacks = mFallbacks;
+    stats->contention = mContention;
+    stats->created = mCreated;
+    stats->deleted = mDeleted;
+    stats->inUse = mInUse;
+    stats->highWater = mHighWaterMark;
+    stats->overflows = mOverflows;
+
+    for (int i = 0 ; i < OBJECT_POOL_MAX_MAGAZINES ; i++) {
+        ObjectPoolMagazine* mag = &mMagazines[i];
+        stats->allocs += mag->allocs;
+        stats->frees += mag->frees;
+        stats->misses += mag->misses;
+        stats->fallbacks += mag->fallbacks;
     }
-
-	if (added > 0)
-	  Trace(2, "ObjectPool: added %ld objects to the allocation ring\n", 
-			(long)added);
 }
 
 PUBLIC void ObjectPool::dump()
 {
-	PooledObject* o;
+    ObjectPoolStatistics stats;
+    int cached = 0;
 
-	printf("%s\n", mName);
-	
-	int allocListCount = 0;
-	int allocRingCount = 0;
-	int freeListCount = 0;
-	int freeRingCount = 0;
-
-	for (o = mAllocList ; o != NULL ; o = o->getPoolChain())
-	  allocListCount++;
-
-	for (o = mFreeList ; o != NULL ; o = o->getPoolChain())
-	  freeListCount++;
-
-	if (mAllocHead > mAllocTail)
-	  allocRingCount = mAllocHead - mAllocTail;
-	else if (mAllocHead < mAllocTail)
-	  allocRingCount = mAllocSize - (mAllocTail - mAllocHead);
-
-	if (mFreeHead > mFreeTail)
-	  freeRingCount = mFreeHead - mFreeTail;
-	else if (mFreeHead < mFreeTail)
-	  allocRingCount = mFreeSize - (mFreeTail - mFreeHead);
-
-	// remember that the internal sizes are 1+ the requested 
-	// size because the head must always point to "free" space
-	char msg[1024];
-
-	// formerly used Trace(1 here, why?
-	sprintf(msg, "  %d objects on the allocation list, allocation ring has %d of %d\n", 
-			allocListCount, allocRingCount, mAllocSize - 1);
-	printf("%s", msg);
+    getStatistics(&stats);
+    for (int i = 0 ; i < OBJECT_POOL_MAX_MAGAZINES ; i++)
+      cached += mMagazines[i].count;
 
-	sprintf(msg, "  %d objects on the free list, free ring has %d of %d\n", 
-			freeListCount, freeRingCount, mFreeSize - 1);
-	printf("%s", msg);
+	printf("%s\n", mName);
+	printf("  %ld available, %ld cached, %ld in use, high water %ld\n",
+           (long)mAvailableCount, (long)cached, stats.inUse, stats.highWater);
+	printf("  %ld allocs, %ld frees, %ld misses, %ld fallbacks\n",
+           stats.allocs, stats.frees, stats.misses, stats.fallbacks);
+	printf("  %ld created, %ld deleted, %ld overflows, %ld contention\n",
+           stats.created, stats.deleted, stats.overflows, stats.contention);
 }
 
 /****************************************************************************
@@ -654,6 +912,10 @@ void ObjectPoolManager::setThread(Thread* t)
 	}
 	mThread = t;
 	mExternalThread = (mThread != NULL);
+
+    // pools may have been added before the thread
+    for (ObjectPool* p = mPools ; p != NULL ; p = p->getNext())
+      p->setThread(mThread);
 }
 
 /**
@@ -665,27 +927,35 @@ void ObjectPoolManager::startThread()
 		mExternalThread = false;
 		mThread = new PoolThread(this);
 		mThread->start();
+
+        for (ObjectPool* p = mPools ; p != NULL ; p = p->getNext())
+          p->setThread(mThread);
 	}
 }
 
 ObjectPoolManager::~ObjectPoolManager()
 {
+    bool stopped = true;
+
 	if (mThread != NULL && !mExternalThread) {
-		if (mThread->stopAndWait()) {
-			ObjectPool* next = NULL;
-			for (ObjectPool* p = mPools ; p != NULL ; p = next) {
-				next = p->getNext();
-				delete p;
-			}
-
-			delete mThread;
-		}
+		if (mThread->stopAndWait())
+          delete mThread;
 		else {
 			// thread not responding, or really busy
 			// may crash if we delete the pools now, better to leak
 			Trace(1, "Unable to halt pool thread!\n");
+            stopped = false;
 		}
 	}
+
+    if (stopped) {
+        ObjectPool* next = NULL;
+        for (ObjectPool* p = mPools ; p != NULL ; p = next) {
+            next = p->getNext();
+            delete p;
+        }
+    }
+
 	mThread = NULL;
 	mExternalThread = false;
 }
@@ -712,9 +982,31 @@ PUBLIC void ObjectPoolManager::exit(bool dumpit)
 
 PUBLIC void ObjectPoolManager::dump()
 {
+    ObjectPoolStatistics totals;
+
 	printf("*** Object Pools ***\n");
     for (ObjectPool* p = mPools ; p != NULL ; p = p->getNext())
 	  p->dump();
+
+    getStatistics(&totals);
+	printf("Totals\n");
+	printf("  %ld allocs, %ld misses, %ld fallbacks, %ld in use, high water %ld\n",
+           totals.allocs, totals.misses, totals.fallbacks, totals.inUse,
+           totals.highWater);
+}
+
+/**
+ * Sum the statistics for all pools.
+ */
+PUBLIC void ObjectPoolManager::getStatistics(ObjectPoolStatistics* totals)
+{
+    ObjectPoolStatistics stats;
+
+    totals->init();
+    for (ObjectPool* p = mPools ; p != NULL ; p = p->getNext()) {
+        p->getStatistics(&stats);
+        totals->add(&stats);
+    }
 }
 
 PUBLIC void ObjectPoolManager::sdump()
@@ -742,6 +1034,18 @@ PUBLIC ObjectPool* ObjectPoolManager::get(const char* name)
     return found;
 }
 
+/**
+ * Called by a thread that is about to exit.  Objects cached for the
+ * thread go back to the shared stacks and the magazine slot is freed.
+ */
+PUBLIC void ObjectPoolManager::releaseThread()
+{
+    for (ObjectPool* p = mPools ; p != NULL ; p = p->getNext())
+      p->releaseMagazine();
+
+    ObjectPool::releaseThreadSlot();
+}
+
 PUBLIC void ObjectPoolManager::maintain()
 {
     // TODO: if we have a lot of these, could add a flag that marks
@@ -788,6 +1092,24 @@ PUBLIC float* SampleBuffer::getSamples()
 PUBLIC SampleBufferPool::SampleBufferPool(long samples)
 {
     mSamples = samples;
+    initObjectPool("SampleBuffer");
+    prepare();
+}
+
+/**
+ * Used for pools that need their own name and sizing, such as
+ * the process wide audio pool.
+ */
+PUBLIC SampleBufferPool::SampleBufferPool(const char* name, long samples,
+                                          int capacity, int lowWater,
+                                          int highWater)
+{
+    mSamples = samples;
+    initObjectPool(name);
+    mCapacity = capacity;
+    mLowWater = lowWater;
+    mHighWater = highWater;
+    prepare();
 }
 
 PUBLIC SampleBufferPool::~SampleBufferPool()
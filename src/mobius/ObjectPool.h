@@ -32,8 +32,8 @@ class PooledObject {
     void setPool(class ObjectPool* p);
     class ObjectPool* getPool();
 
-    void setPoolChain(PooledObject* p);
-    PooledObject* getPoolChain();
+    void setPoolIndex(int i);
+    int getPoolIndex();
 
     void setPooled(bool b);
     bool isPooled();
@@ -48,13 +48,13 @@ class PooledObject {
     class ObjectPool* mPool;
 
     /**
-     * Chain pointer for the free list.
+     * Slot in the pool's object table, -1 if the table was full
+     * when this was allocated.
      */
-    PooledObject* mPoolChain;
+    int mPoolIndex;
 
     /**
-     * True if the object is in the pool.  Can't use mPoolChain because
-     * it will be null for the last object in the list.
+     * True if the object is in the pool.
      */
     bool mPooled;
 
@@ -98,7 +98,124 @@ class PooledBuffer : public PooledObject {
  *                                                                          *
  ****************************************************************************/
 
-#define OBJECT_POOL_DEFAULT_RING_SIZE 64
+/**
+ * Default maximum number of objects a pool will keep track of.
+ * Objects allocated beyond this are deleted rather than pooled
+ * when they are freed.
+ */
+#define OBJECT_POOL_DEFAULT_CAPACITY 1024
+
+/**
+ * When the number of available objects falls below this the
+ * maintenance thread is signaled.
+ */
+#define OBJECT_POOL_DEFAULT_LOW_WATER 32
+
+/**
+ * The maintenance thread fills the pool to this level, and returns
+ * objects to the heap when there are more than this available.
+ */
+#define OBJECT_POOL_DEFAULT_HIGH_WATER 128
+
+/**
+ * Number of objects each thread may cache privately.
+ */
+#define OBJECT_POOL_MAGAZINE_SIZE 16
+
+/**
+ * Maximum number of threads that get a private cache.  Threads
+ * beyond this go directly to the shared lists which is still lock
+ * free, just a little slower.
+ */
+#define OBJECT_POOL_MAX_MAGAZINES 8
+
+/****************************************************************************
+ *                                                                          *
+ *                           OBJECT POOL STATISTICS                         *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Counters maintained by each pool, these are cumulative from the
+ * time the pool was created.
+ */
+class ObjectPoolStatistics {
+
+  public:
+
+    ObjectPoolStatistics();
+    void init();
+    void add(ObjectPoolStatistics* other);
+
+    /**
+     * Number of calls to alloc and free.
+     */
+    long allocs;
+    long frees;
+
+    /**
+     * Number of allocs that found both the thread cache and the
+     * shared list empty.
+     */
+    long misses;
+
+    /**
+     * Number of objects that had to be allocated from the heap
+     * by the thread calling alloc.  For the Mobius pools this is the
+     * interrupt, and should always be zero.
+     */
+    long fallbacks;
+
+    /**
+     * Number of times a compare and swap on the shared lists
+     * had to be retried because another thread got there first.
+     */
+    long contention;
+
+    /**
+     * Objects created and deleted by the maintenance thread.
+     */
+    long created;
+    long deleted;
+
+    /**
+     * Number of objects allocated and not yet freed, and the most
+     * there have ever been.
+     */
+    long inUse;
+    long highWater;
+
+    /**
+     * Number of objects allocated after the object table was full.
+     */
+    long overflows;
+
+};
+
+/****************************************************************************
+ *                                                                          *
+ *                                OBJECT POOL                               *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Private object cache for one thread.  Only the owning thread
+ * touches this so there is no synchronization.
+ */
+class ObjectPoolMagazine {
+
+  public:
+
+    int count;
+    int indexes[OBJECT_POOL_MAGAZINE_SIZE];
+
+    // counters only the owner updates, summed by getStatistics
+    long allocs;
+    long frees;
+    long misses;
+    long fallbacks;
+
+};
 
 /**
  * A pool for one type of object.  This must be subclassed to add
@@ -123,11 +240,17 @@ class ObjectPool {
     void setNext(ObjectPool* p);
     void setThread(class Thread* t);
 	void dump();
+    void getStatistics(ObjectPoolStatistics* stats);
 
     // called by the maintenance thread
     
     void maintain();
 
+    // called by a thread that is about to exit
+
+    void releaseMagazine();
+    static void releaseThreadSlot();
+
     // called by the interrupt handler
     
     PooledObject* alloc();
@@ -142,23 +265,60 @@ class ObjectPool {
 	void deleteObject(PooledObject* obj);
     void requestMaintenance();
 
+    ObjectPoolMagazine* getMagazine();
+    int pop(volatile unsigned long long* stack);
+    void push(volatile unsigned long long* stack, int index);
+    int popAvailable();
+    void pushAvailable(int index);
+
     ObjectPool* mNext;          // ObjectPoolManager chain
     Thread* mThread;
     char* mName;
 
-    PooledObject* mAllocList;
-    PooledObject** mAllocRing;
-    int mAllocHead;
-    int mAllocTail;
-    int mAllocSize;
-    int mAllocWarning;
+    // options that may be set by the subclass before prepare
+    int mCapacity;
+    int mLowWater;
+    int mHighWater;
 
-    PooledObject* mFreeList;
-    PooledObject** mFreeRing;
-    int mFreeHead;
-    int mFreeTail;
-    int mFreeSize;
-    bool mUseFreeRing;
+    /**
+     * Every object we have created, indexed by PooledObject::mPoolIndex.
+     */
+    PooledObject** mObjects;
+
+    /**
+     * Links for the two index stacks, mLinks[i] is the index
+     * below i on whichever stack it is on.
+     */
+    int* mLinks;
+
+    /**
+     * Tops of the stacks of available objects and unused table slots.
+     * The low word is the index plus one, the high word is a tag
+     * that changes on every push so a stale compare and swap can't
+     * succeed.
+     */
+    volatile unsigned long long mAvailable;
+    volatile unsigned long long mEmpty;
+
+    /**
+     * Number of objects on the mAvailable stack, not counting
+     * those cached in the magazines.
+     */
+    volatile long mAvailableCount;
+
+    ObjectPoolMagazine mMagazines[OBJECT_POOL_MAX_MAGAZINES];
+
+    // counters that may be updated by more than one thread
+    volatile long mAllocs;
+    volatile long mFrees;
+    volatile long mMisses;
+    volatile long mFallbacks;
+    volatile long mContention;
+    volatile long mCreated;
+    volatile long mDeleted;
+    volatile long mInUse;
+    volatile long mHighWaterMark;
+    volatile long mOverflows;
 
 };
 
@@ -186,7 +346,9 @@ class ObjectPoolManager {
     ObjectPool* get(const char* name);
 
     void maintain();
+    void releaseThread();
     void dump();
+    void getStatistics(ObjectPoolStatistics* stats);
 
   private:
 
@@ -198,6 +360,25 @@ class ObjectPoolManager {
 
 };
 
+/****************************************************************************
+ *                                                                          *
+ *                                  ATOMICS                                 *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Atomic add returning the new value.  Used by the pools and by things
+ * that keep their own counters alongside a pool.
+ */
+long PoolAdd(volatile long* p, long delta);
+
+/**
+ * Atomic compare and swap, true if the value was changed.
+ * This is also a full barrier so it may be used to publish
+ * things to another thread.
+ */
+bool PoolCas(volatile long* p, long oldval, long newval);
+
 /****************************************************************************
  *                                                                          *
  *                             SAMPLE BUFFER POOL                           *
@@ -232,6 +413,8 @@ class SampleBufferPool : public ObjectPool {
   public:
 
 	SampleBufferPool(long samples);
+	SampleBufferPool(const char* name, long samples, int capacity,
+                     int lowWater, int highWater);
     ~SampleBufferPool();
     
     // ObjectPool implementations
@@ -52,6 +52,7 @@
 #include <math.h>
 
 #include "Util.h"
+#include "List.h"
 #include "Map.h"
 #include "XmlModel.h"
 #include "XmlBuffer.h"
@@ -910,6 +911,13 @@ void OscRuntimeWatcher::send(float value)
 //
 //////////////////////////////////////////////////////////////////////
 
+/**
+ * The maximum number of unresolved addresses we'll remember.
+ * This is just to keep a misconfigured device that sends a different
+ * garbage address every time from growing the list forever.
+ */
+#define OSC_MAX_UNRESOLVED 256
+
 OscResolver::OscResolver(MobiusInterface* mobius, OscInterface* osc, 
                          OscConfig* config)
 {
@@ -919,6 +927,8 @@ OscResolver::OscResolver(MobiusInterface* mobius, OscInterface* osc,
     mBindings = NULL;
     mBindingMap = NULL;
 	mExports = NULL;
+    mUnresolved = NULL;
+    mUnresolvedMap = NULL;
 
     // formerly in OscConfig, this is now global
     MobiusConfig* mconfig = mobius->getConfiguration();
@@ -959,6 +969,10 @@ OscResolver::~OscResolver()
     // need a way to tell it to release keys
     delete mBindingMap;
 
+    // keys here are owned by the list
+    delete mUnresolvedMap;
+    delete mUnresolved;
+
 	OscResolver *el, *next;
 	for (el = mNext ; el != NULL ; el = next) {
 		next = el->getNext();
@@ -1064,6 +1078,34 @@ PRIVATE OscBinding* OscResolver::getBinding(const char* trigger)
     return b;
 }
 
+/**
+ * Return true if this is an address we've already failed to resolve.
+ */
+PRIVATE bool OscResolver::isUnresolved(const char* address)
+{
+    return (mUnresolvedMap != NULL && mUnresolvedMap->get(address) != NULL);
+}
+
+/**
+ * Remember an address we couldn't resolve so we don't go through 
+ * resolveAction and the path parser for every message.  TouchOSC will
+ * stream these as fast as you can move a fader.
+ */
+PRIVATE void OscResolver::addUnresolved(const char* address)
+{
+    if (mUnresolved == NULL) {
+        mUnresolved = new StringList();
+        mUnresolvedMap = new Map();
+    }
+
+    if (mUnresolved->size() < OSC_MAX_UNRESOLVED) {
+        // the list makes a copy which becomes the key
+        mUnresolved->add(address);
+        const char* key = mUnresolved->getString(mUnresolved->size() - 1);
+        mUnresolvedMap->put(key, (void*)key);
+    }
+}
+
 /**
  * After creating an OscBinding either from the OscConfig or dynamically,
  * see if it can be added to the exports list.
@@ -1157,9 +1199,11 @@ PUBLIC void OscResolver::oscMessage(OscMessage* msg)
     // will do.  Ignore anything that doesn't have our prefix.
     if (StartsWith(address, "/mobius")) {
 
+        // bindings from the config were hashed when we were built,
+        // so usually this is all we do
         OscBinding* ob = getBinding(address);
 
-        if (ob == NULL) {
+        if (ob == NULL && !isUnresolved(address)) {
             // Not currently mapped, try to resolve within our address space
             // and guess at the triggerMode
             Binding* b = new Binding();
@@ -1168,11 +1212,9 @@ PUBLIC void OscResolver::oscMessage(OscMessage* msg)
 
             Action* a = mMobius->resolveAction(b);
             if (a == NULL) {
-                // To keep this from happening every time could go ahead and
-                // make a binding that goes nowhere?  Since we're
-                // limiting this to /mobius addresses it really 
-                // should be fixed.  resolveAction will have traced enough.
-                //Trace(2, "Unresolved OSC address: %s\n", address);
+                // Remember it so this doesn't happen every time.
+                // resolveAction will have traced enough.
+                addUnresolved(address);
             }
             else {
                 // copy this for the map key
@@ -1203,6 +1245,10 @@ PUBLIC void OscResolver::oscMessage(OscMessage* msg)
  * Send messages for each exportable binding.
  * Called once during initialization to send initial state,
  * and periodically by MobiusThread.
+ *
+ * Only values that changed since the last export are sent, and
+ * they are collected into one bundle per device rather than sending
+ * a packet for each.
  */
 PUBLIC void OscResolver::exportStatus(bool force)
 {
@@ -1231,10 +1277,11 @@ PUBLIC void OscResolver::exportStatus(bool force)
                         Trace(2, "OSC send: %s %s\n", address, buf);
                     }
 
-                    mOsc->send(dev, &msg);
+                    mOsc->bundle(dev, &msg);
                 }
             }
         }
+        mOsc->flush();
     }
 }
 
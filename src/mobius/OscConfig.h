@@ -388,6 +388,8 @@ class OscResolver {
     void addExport(OscBindingSet* set, OscBinding* ob);
     OscBinding* getBinding(const char* trigger);
     void addBinding(OscBinding* b);
+    bool isUnresolved(const char* address);
+    void addUnresolved(const char* address);
     
     class MobiusInterface* mMobius;
     class OscInterface* mOsc;
@@ -397,6 +399,10 @@ class OscResolver {
     class Map* mBindingMap;
     List* mExports;
 
+    // /mobius addresses we couldn't resolve, so we don't keep trying
+    class StringList* mUnresolved;
+    class Map* mUnresolvedMap;
+
     bool mTrace;
 };
 
@@ -434,6 +434,33 @@ PUBLIC void Parameter::fixEnum(ExValue* value, const char* oldName,
     }
 }
 
+/**
+ * Convert an enumeration name in a binding argument or script constant
+ * to its ordinal.  This is done once when the Action or ScriptStatement
+ * is resolved so the setter called in the interrupt only sees an int
+ * and getEnum(ExValue*) doesn't have to compare strings.
+ *
+ * Dynamic enumerations are left alone since the names can
+ * change after resolution.  Names that don't match are also left
+ * alone so getEnum can complain about them later.
+ */
+PUBLIC bool Parameter::resolveValue(ExValue* value)
+{
+    bool resolved = false;
+
+    if (type == TYPE_ENUM && !dynamic && values != NULL &&
+        value->getType() == EX_STRING) {
+
+        int ivalue = getEnumValue(value->getString());
+        if (ivalue >= 0) {
+            value->setInt(ivalue);
+            resolved = true;
+        }
+    }
+
+    return resolved;
+}
+
 /**
  * Convert a Continuous Controller number in the range of 0-127
  * to an enumerated value.
@@ -54,6 +54,7 @@ typedef enum {
 class Parameter : public SystemConstant {
 
     friend class Mobius;
+    friend class MobiusShared;
 
   public:
 
@@ -163,6 +164,13 @@ class Parameter : public SystemConstant {
      */
     void fixEnum(ExValue* value, const char* oldValue, const char* newValue);
 
+    /**
+     * Replace an enumeration name with its ordinal so it does not
+     * have to be searched for every time the value is set.
+     * Returns true if the value was converted.
+     */
+    bool resolveValue(ExValue* value);
+
 	/**
 	 * Convert a CC number in the range of 0-127 to an enumeration ordinal.
 	 * !! This isn't used any more. Scaling needs to be done at the
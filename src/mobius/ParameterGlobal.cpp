@@ -1717,7 +1717,7 @@ class MidiRecordModeParameterType : public GlobalParameter
 };
 
 const char* MIDI_RECORD_MODE_NAMES[] = {
-	"average", "smooth", "pulse", NULL
+	"average", "smooth", "pulse", "estimate", NULL
 };
 
 MidiRecordModeParameterType::MidiRecordModeParameterType() :
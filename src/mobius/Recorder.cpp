@@ -18,14 +18,18 @@
 
 #include <stdio.h>
 #include <memory.h>
+#include <math.h>
 
 #include "Util.h"
 #include "Trace.h"
 #include "Thread.h"
+#include "RealTime.h"
 
 #include "Audio.h"
 #include "AudioInterface.h"
 #include "MidiInterface.h"
+#include "ObjectPool.h"
+#include "LatencyCalibrator.h"
 
 #include "Recorder.h"
 
@@ -60,6 +64,11 @@ void Recorder::processAudioBuffers(AudioStream* stream)
 	mLastInterruptTime = start;
 
 	long frames = stream->getInterruptFrames();
+
+	// everything from here to recorderMonitorExit must be real-time safe,
+	// builds with RT_SANITIZE will record anything that isn't
+	RealTimeEnter();
+
 	if (mMonitor != NULL)
 	  mMonitor->recorderMonitorEnter(stream);
 
@@ -74,9 +83,21 @@ void Recorder::processAudioBuffers(AudioStream* stream)
 			stream->getInterruptBuffers(0, &input, 0, &output);
 			calibrateInterrupt(input, output, frames);
 		}
-        else
-		  processTracks(stream);
-
+        else {
+			processTracks(stream);
+
+			int port = (int)mLatencyMonitorPort;
+			if (port >= 0 && mLatencyMonitor != NULL) {
+				float* input = NULL;
+				float* output = NULL;
+				stream->getInterruptBuffers(port, &input, port, &output);
+				if (mLatencyMonitorReset) {
+					mLatencyMonitor->reset();
+					mLatencyMonitorReset = false;
+				}
+				mLatencyMonitor->interrupt(input, output, frames, 2);
+			}
+		}
     }
 
     if (TraceInterruptTime) {
@@ -93,6 +114,8 @@ void Recorder::processAudioBuffers(AudioStream* stream)
 	if (mMonitor != NULL)
 	  mMonitor->recorderMonitorExit(stream);
 
+	RealTimeExit();
+
 	mFrame += frames;
 	mInInterrupt = false;
 }
@@ -194,7 +217,6 @@ void Recorder::calibrateInterrupt(float *input, float *output, long frames)
 {
     // !! assuming 2 channel ports
 	int channels = 2;
-	int rate = mStream->getSampleRate();
 	long samples = frames * channels;
 
 	// capture inputs for offline analysis
@@ -223,75 +245,12 @@ void Recorder::calibrateInterrupt(float *input, float *output, long frames)
 		}
 		//printf("Noise sample\n");
 	}
-	else {
-		if (mPingFrame > 0) {
-			// we're waiting for a response
-			long echoFrame = 0;
-			if (input != NULL) {
-				// formerly tried to base this on a multiple
-				// of the measured noise floor, but that was too low
-				//float signalAmplitude = mNoiseAmplitude * 2;
-				float signalAmplitude = CALIBRATION_ECHO_AMPLITUDE;
-
-				for (int i = 0 ; i < samples ; i += channels) {
-					float sample = input[i];
-					if (sample < 0)
-					  sample = -sample;
-					if (sample > signalAmplitude) {
-						// found it
-						echoFrame = mFrame + (i / channels);
-						//printf("Echo amplitude %f\n", sample);
-						break;
-					}
-				}
-			}
-
-			if (echoFrame > 0) {
-				int latency = echoFrame - mPingFrame;
-				mLatencyFrames[mLatencyTest++] = latency;
-				if (mLatencyTest == CALIBRATION_TEST_COUNT)
-				  mCalibrating = false;
-
-				//printf("Latency measurement %d, %ld - %ld = %ld\n",
-				//mLatencyTest, mPingFrame, echoFrame, latency);
-
-				// set to zero to setup another ping
-				mPingFrame = 0;
-
-				// save the first buffer so we can get some idea
-				// of what the return wave looks like	
-				// wait, now we just save the entire input
-#if 0
-				if (mLatencyTest == 1) {
-					Audio *a = mAudioPool->newAudio();
-					a->add(input, frames, 0);
-					a->write("temp.wav");
-					mAudioPool->freeAudio(a);
-				}
-#endif				
-			}
-			else {
-				// still haven't found it, wait at most one second
-				long delta = mFrame - mPingFrame;
-				long samples = delta / channels;
-				int seconds = samples / rate;
-				if (seconds > 0) {
-					mCalibrating = false;
-					printf("Calibration timeout!\n");
-				}
-			}
-		}
-
-		// if we're still calibrating, setup a ping 
-		if (mCalibrating && mPingFrame == 0) {
-			if (output != NULL) {
-				int pinglen = channels * CALIBRATION_PING_FRAMES;
-				for (int i = 0 ; i < pinglen ; i++)
-				  output[i] = CALIBRATION_PING_AMPLITUDE;
-			}
-			mPingFrame = mFrame;
-			//printf("Ping %ld\n", mPingFrame);
-		}
+	else if (mCalibrator != NULL) {
+		// play the sequence and capture the return, calibrate
+		// does the analysis when the capture is full
+		mCalibrator->interrupt(input, output, frames, channels);
+		if (mCalibrator->isReady())
+		  mCalibrating = false;
 	}
 }
 
@@ -543,10 +502,15 @@ Recorder::Recorder(AudioInterface* ai, MidiInterface* midi, AudioPool* pool)
 	mInInterrupt = false;
 	mEcho = false;
 	mCalibrationInput = NULL;
+	mCalibrator = NULL;
 	mCalibrating = false;
 	mNoiseAmplitude = 0.0;
-	mPingFrame = 0;
-	mLatencyTest = 0;
+	mCalibrationLoopback = -1;
+	mLatencyMonitor = NULL;
+	mLatencyMonitorPort = -1;
+	mMonitorLoopback = -1;
+	mLatencyMonitorReset = false;
+	mMonitoredLatency = 0.0;
 	mLastInterruptTime = 0;
 
 	mTrackCount = 0;
@@ -558,6 +522,9 @@ Recorder::~Recorder()
 {
 	shutdown();
 
+	// shutdown stopped the interrupt
+	delete mLatencyMonitor;
+
 	for (int i = 0 ; i < MAX_RECORDER_TRACKS ; i++) {
 		if (mTracks[i] != NULL) {
 			delete mTracks[i];
@@ -862,9 +829,11 @@ RecorderCalibrationResult* Recorder::calibrate()
 	stop();
 
 	mNoiseAmplitude = 0.0f;
-	mLatencyTest = 0;
 	mFrame = 0;
 	mCalibrationInput = mAudioPool->newAudio();
+	mCalibrator = new LatencyCalibrator(CALIBRATION_SEQUENCE_ORDER,
+										CALIBRATION_SEQUENCE_AMPLITUDE);
+	mCalibrator->setLoopback(mCalibrationLoopback);
 	mCalibrating = true;
 
 	start();
@@ -872,26 +841,116 @@ RecorderCalibrationResult* Recorder::calibrate()
 	for (int i = 0 ; i < 5 && mCalibrating ; i++)
 	  SleepMillis(1000);
 
+	// make sure the interrupt is done with it
+	mCalibrating = false;
+	SleepMillis(100);
+
 	result->noiseFloor = mNoiseAmplitude;
 
-	if (mLatencyTest == 0 || mCalibrating)
+	if (!mCalibrator->analyze())
 	  result->timeout = true;
 	else {
-		int latency = 0;
-		for (int i = 0 ; i < mLatencyTest ; i++)
-		  latency += mLatencyFrames[i];
-		latency /= mLatencyTest;
-		result->latency = latency;
+		result->exactLatency = mCalibrator->getLatency();
+		result->confidence = mCalibrator->getConfidence();
+		result->latency = (int)(result->exactLatency + 0.5);
+
+		Trace(2, "Recorder: calibrated latency %ld (x100) confidence %ld (x100)\n",
+			  (long)(result->exactLatency * 100),
+			  (long)(result->confidence * 100));
+
+		// not connected or too noisy, same as not hearing the ping
+		if (result->confidence < CALIBRATION_MIN_CONFIDENCE)
+		  result->timeout = true;
 	}
 
 	mCalibrationInput->write("calibration.wav");
     mAudioPool->freeAudio(mCalibrationInput);
     mCalibrationInput = NULL;
-    mCalibrating = false;
+	delete mCalibrator;
+	mCalibrator = NULL;
 
 	return result;
 }
 
+/**
+ * Simulate a loopback cable with this many frames of latency
+ * for calibration and the latency monitor.  Negative to use
+ * the real inputs.
+ */
+void Recorder::setCalibrationLoopback(int frames)
+{
+	mCalibrationLoopback = frames;
+}
+
+/**
+ * Start or stop the background latency monitor.  The port must
+ * have its output wired back to its input and not be used by any track.
+ * Negative to disable.  The monitor is allocated the first time
+ * and kept since the interrupt may be using it.  Also picks up
+ * changes to the calibration loopback, so call setCalibrationLoopback
+ * first.
+ */
+void Recorder::setLatencyMonitor(int port)
+{
+	if (port >= 0 && mLatencyMonitor == NULL) {
+		mLatencyMonitor = new LatencyCalibrator(MONITOR_SEQUENCE_ORDER,
+												MONITOR_SEQUENCE_AMPLITUDE);
+	}
+
+	if (mLatencyMonitor != NULL && mCalibrationLoopback != mMonitorLoopback) {
+		// the interrupt swaps this in at the start of a block
+		mLatencyMonitor->setLoopback(mCalibrationLoopback);
+		mMonitorLoopback = mCalibrationLoopback;
+		mLatencyMonitorReset = true;
+		mMonitoredLatency = 0.0;
+	}
+
+	long current = mLatencyMonitorPort;
+	if (port != current) {
+		if (port >= 0)
+		  mLatencyMonitorReset = true;
+		mMonitoredLatency = 0.0;
+		// the barrier makes sure the interrupt and MobiusThread
+		// see the monitor before they see the port
+		PoolCas(&mLatencyMonitorPort, current, port);
+	}
+}
+
+/**
+ * Called periodically outside the interrupt to analyze the latest
+ * capture from the latency monitor.
+ */
+void Recorder::checkLatencyMonitor()
+{
+	// free the loopback buffer the interrupt replaced
+	if (mLatencyMonitor != NULL)
+	  mLatencyMonitor->releaseLoopback();
+
+	if (mLatencyMonitorPort >= 0 && mLatencyMonitor != NULL &&
+		mLatencyMonitor->analyze()) {
+
+		if (mLatencyMonitor->getConfidence() >= CALIBRATION_MIN_CONFIDENCE) {
+			double latency = mLatencyMonitor->getLatency();
+			if (mMonitoredLatency == 0.0)
+			  Trace(2, "Recorder: monitored latency %ld (x100)\n",
+					(long)(latency * 100));
+			else if (fabs(latency - mMonitoredLatency) >= 1.0)
+			  Trace(2, "Recorder: latency drift from %ld to %ld (x100)\n",
+					(long)(mMonitoredLatency * 100), (long)(latency * 100));
+			mMonitoredLatency = latency;
+		}
+	}
+}
+
+/**
+ * Latest latency from the background monitor in frames, 
+ * zero if it isn't running or hasn't got a good measurement.
+ */
+double Recorder::getMonitoredLatency()
+{
+	return mMonitoredLatency;
+}
+
 /****************************************************************************/
 /****************************************************************************/
 /****************************************************************************/
@@ -40,47 +40,12 @@
  */
 #define MAX_RECORDER_TRACKS 64
 
-/**
- * The number of latency tests to run during calibration.
- */
-#define CALIBRATION_TEST_COUNT 10
-
 /**
  * Approxomate number of frames to measure the noise floor
  * during calibration.  
  */
 #define CALIBRATION_NOISE_FRAMES 10000
 
-/**
- * The length in frames of the calibration signal.
- */
-#define CALIBRATION_PING_FRAMES 1
-
-/**
- * The amplitude of the calibration signal.
- */
-#define CALIBRATION_PING_AMPLITUDE 0.7f
-
-/**
- * The minimum level we require in the ping echo.
- * Some other code I found measured the noise floor
- * and then just looked for something that was 2x the
- * floor, but this proved to be unreliable. With
- * a floor of 0.000061 I would see very regular
- * blips of 0.000153 to 0.000183 would would be
- * falsely treated as echos.  This appears
- * to be caused by crosstalk/channel bleed
- * in the Mackie, when the Lynx output is
- * routed to the Alt bus and monitored, a small
- * amount of the signal still makes it to the main outs.
- *
- * The echo signal seems to be getting a little bit of 
- * gain and has A/D artifacts resulting in some ramp up/down
- * samples.  Not sure if we should measure the echo frame
- * from the start of the ramp up or till it reaches its maximum?
- */
-#define CALIBRATION_ECHO_AMPLITUDE 0.01f
-
 /**
  * The default latency for LynxOne Analog In/Out in milliseconds.
  * Measured using the WMME drivers.
@@ -285,6 +250,8 @@ class RecorderCalibrationResult {
 		timeout = false;
 		noiseFloor = 0.0;
 		latency = 0;
+		exactLatency = 0.0;
+		confidence = 0.0f;
 	}
 
 	~RecorderCalibrationResult() {
@@ -293,6 +260,10 @@ class RecorderCalibrationResult {
 	bool timeout;
 	float noiseFloor;
 	int latency;
+
+	// latency with the fraction, and how much we believe it
+	double exactLatency;
+	float confidence;
 };
 
 /****************************************************************************
@@ -357,6 +328,10 @@ class Recorder : public AudioHandler {
     // Special operations
 
 	RecorderCalibrationResult* calibrate();
+	void setCalibrationLoopback(int frames);
+	void setLatencyMonitor(int port);
+	void checkLatencyMonitor();
+	double getMonitoredLatency();
 	void inputBufferModified(RecorderTrack* track, float* buffer);
 
 	// AudioHandler interface
@@ -391,11 +366,18 @@ class Recorder : public AudioHandler {
 	bool mEcho;             // true to echo input to output
 
 	Audio* mCalibrationInput;
+	class LatencyCalibrator* mCalibrator;
 	bool mCalibrating;
 	float mNoiseAmplitude;
-	long mPingFrame;
-	int mLatencyTest;
-	int mLatencyFrames[CALIBRATION_TEST_COUNT];
+	int mCalibrationLoopback;
+
+	// background latency measurement on a spare port
+	// the port is published with PoolCas after the monitor is built
+	class LatencyCalibrator* mLatencyMonitor;
+	volatile long mLatencyMonitorPort;
+	int mMonitorLoopback;
+	bool mLatencyMonitorReset;
+	double mMonitoredLatency;
 
 	long mLastInterruptTime;
 
@@ -1261,6 +1261,7 @@ PUBLIC ScriptSetStatement::ScriptSetStatement(ScriptCompiler* comp,
 											  char* args)
 {
 	mExpression = NULL;
+    mOrdinal = -1;
 
 	// isolate the first argument representing the reference
 	// to the thing to set, the remainder is an expression
@@ -1296,11 +1297,29 @@ PUBLIC void ScriptSetStatement::resolve(Mobius* m)
     mName.resolve(m, mParentBlock, mArgs[0]);
 }
 
+/**
+ * Symbols in the expression aren't resolved until the first evaluation
+ * so we can't tell until then whether "Set quantize loop" refers to a
+ * variable named "loop" or the enumeration value.  If the expression
+ * turns out to be constant and names an enumeration value of the
+ * parameter, remember the ordinal and skip the expression and the 
+ * name search from then on.
+ */
 PUBLIC ScriptStatement* ScriptSetStatement::eval(ScriptInterpreter* si)
 {
-	if (mExpression != NULL) {
+    if (mOrdinal >= 0) {
+        ExValue v;
+        v.setInt(mOrdinal);
+        mName.set(si, &v);
+    }
+	else if (mExpression != NULL) {
 		ExValue v;
 		mExpression->eval(si, &v);
+
+        Parameter* p = mName.getParameter();
+        if (p != NULL && mExpression->isConstant() && p->resolveValue(&v))
+          mOrdinal = v.getInt();
+
 		mName.set(si, &v);
 	}
 	return NULL;
@@ -4264,32 +4283,9 @@ PUBLIC ScriptEnv* ScriptCompiler::compile(Mobius* m, ScriptConfig* config)
 		for (ScriptRef* ref = config->getScripts() ; ref != NULL ; 
 			 ref = ref->getNext()) {
 
-            // allow relative paths so we can distribute examples
             char path[1024];
 			const char* file = ref->getFile();
-            if (IsAbsolute(file))
-              strcpy(path, file);
-            else {
-                MobiusContext* con = m->getContext();
-
-                strcpy(path, "");
-                // check configuration directory first
-                const char* srcdir = con->getConfigurationDirectory();
-                bool found = false;
-                if (srcdir != NULL) {
-                    sprintf(path, "%s/%s", srcdir, file);
-                    found = IsFile(path) || IsDirectory(path);
-                }
-
-                // fall back to installation directory
-                if (!found) {
-                    srcdir = con->getInstallationDirectory();
-                    if (srcdir != NULL)
-                      sprintf(path, "%s/%s", srcdir, file);
-                    else
-                      strcpy(path, file);
-                }
-            }
+            getPath(m, file, path);
 
 			if (IsFile(path)) {
 				parse(path);
@@ -4318,6 +4314,40 @@ PUBLIC ScriptEnv* ScriptCompiler::compile(Mobius* m, ScriptConfig* config)
     return mEnv;
 }
 
+/**
+ * Resolve the path to a script file or directory.
+ * Relative paths are allowed so we can distribute examples, these are
+ * checked in the configuration directory first, then the installation
+ * directory.  This is also used by MobiusShared to find the files
+ * it hashes, so keep them in sync.
+ */
+PUBLIC void ScriptCompiler::getPath(Mobius* m, const char* file, char* path)
+{
+    if (IsAbsolute(file))
+      strcpy(path, file);
+    else {
+        MobiusContext* con = m->getContext();
+
+        strcpy(path, "");
+        // check configuration directory first
+        const char* srcdir = con->getConfigurationDirectory();
+        bool found = false;
+        if (srcdir != NULL) {
+            sprintf(path, "%s/%s", srcdir, file);
+            found = IsFile(path) || IsDirectory(path);
+        }
+
+        // fall back to installation directory
+        if (!found) {
+            srcdir = con->getInstallationDirectory();
+            if (srcdir != NULL)
+              sprintf(path, "%s/%s", srcdir, file);
+            else
+              strcpy(path, file);
+        }
+    }
+}
+
 /**
  * Recompile one script declared with !autoload
  * Keep the same script object so we don't have to mess
@@ -5800,6 +5830,8 @@ PUBLIC void ScriptInterpreter::setScript(Script* s, bool inuse)
 	mScript = s;
 
 	// kludge, do not refesh if the script is currently in use
+    // MobiusShared never shares environments with autoload scripts
+    // so only our own interpreters can be using it
 	if (!inuse && s->isAutoLoad()) {
         ScriptCompiler* comp = new ScriptCompiler();
         comp->recompile(mMobius, s);
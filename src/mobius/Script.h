@@ -487,6 +487,11 @@ class ScriptCompiler {
      */
     void recompile(class Mobius* m, Script* script);
 
+    /**
+     * Resolve a possibly relative ScriptRef file to a full path.
+     */
+    static void getPath(class Mobius* m, const char* file, char* path);
+
     // Utilities for the ScriptStatement constructors and linkers
 
     Mobius *getMobius();
@@ -1044,6 +1049,9 @@ class ScriptSetStatement : public ScriptStatement {
 
 	ScriptArgument mName;
 	class ExNode* mExpression;
+
+    // enumeration ordinal when mExpression is a constant name
+    int mOrdinal;
 };
 
 class ScriptUseStatement : public ScriptSetStatement {
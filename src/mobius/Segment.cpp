@@ -85,6 +85,30 @@ Segment::~Segment()
 	  mLayer->free();
 }
 
+/**
+ * Reinitialize a segment to reference the beginning of another layer.
+ * Used by WindowFunction to recycle the segments of the window layer
+ * as it moves.  The new layer is referenced before the old one is 
+ * released since they are often the same.
+ */
+void Segment::reinit(Layer* src)
+{
+    Layer* old = mLayer;
+
+    delete mAudio;
+    delete mCursor;
+    init();
+
+    if (src != NULL) {
+        mLayer = src;
+        mLayer->incReferences();
+        mFrames = src->getFrames();
+    }
+
+    if (old != NULL)
+      old->free();
+}
+
 void Segment::init()
 {
     mNext = NULL;
@@ -364,6 +388,31 @@ PUBLIC bool Segment::isAtStart(Layer* parent)
 	return (mOffset == 0 && mStartFrame == 0);
 }
 
+/**
+ * True if get() would apply one of the edge fades to a range of frames.
+ * This must match the calculations in get().  Used by Layer to decide
+ * whether it can mix the referenced audio directly.
+ */
+PUBLIC bool Segment::isFading(long startFrame, long frames)
+{
+	bool fading = false;
+	long fadeRange = AudioFade::getRange();
+
+	if (mFadeLeft) {
+		long leftFadeRange = fadeRange - mLocalCopyLeft;
+		fading = (leftFadeRange > 0 && startFrame < leftFadeRange);
+	}
+
+	if (mFadeRight && !fading) {
+		long rightFadeRange = fadeRange - mLocalCopyRight;
+		long lastFrame = startFrame + frames - 1;
+		fading = (rightFadeRange > 0 && 
+				  lastFrame >= mFrames - rightFadeRange);
+	}
+
+	return fading;
+}
+
 /****************************************************************************
  *                                                                          *
  *   								FETCH                                   *
@@ -30,6 +30,8 @@ class Segment {
     Segment(Segment* src);
     ~Segment();
 
+    void reinit(class Layer* src);
+
     void setNext(Segment* ref);
     Segment* getNext();
 
@@ -81,6 +83,7 @@ class Segment {
 
 	bool isAtStart(class Layer* parent);
 	bool isAtEnd(class Layer* parent);
+	bool isFading(long startFrame, long frames);
 
 	void dump(class TraceBuffer* b);
 
@@ -290,16 +290,21 @@ PUBLIC SyncTracker::SyncTracker(SyncSource src)
 
     mPulseMonitor = new PulseMonitor();
     mDriftMonitor = new PulseMonitor();
+    mEstimator = new PulseEstimator();
 
     // KLUDGE: For event generation we need to know how many pulses are
     // in one beat.  This will be 24 for MIDI, 1 for host.
     // Could make Synchronizer pass this in but we can know.    
     // Ugh, the logic has to go somewhere, consider making subclasses
     // of SyncTracker for each source so we can encapsulate this better...
-    if (mSource == SYNC_OUT || mSource == SYNC_MIDI)
-      mPulsesPerBeat = 24;
-    else
-      mPulsesPerBeat = 1;
+    if (mSource == SYNC_OUT || mSource == SYNC_MIDI) {
+        mPulsesPerBeat = 24;
+        mEstimator->setGain(PULSE_ESTIMATOR_CLOCK_GAIN);
+    }
+    else {
+        mPulsesPerBeat = 1;
+        mEstimator->setGain(PULSE_ESTIMATOR_BEAT_GAIN);
+    }
 
     // leave this on all the time to get beat/bar pulses
     // clock pulses will be ore selective
@@ -310,6 +315,9 @@ PUBLIC SyncTracker::SyncTracker(SyncSource src)
 
 PUBLIC SyncTracker::~SyncTracker()
 {
+    delete mPulseMonitor;
+    delete mDriftMonitor;
+    delete mEstimator;
 }
 
 PUBLIC SyncSource SyncTracker::getSyncSource()
@@ -383,10 +391,24 @@ PUBLIC float SyncTracker::getAverageDrift()
  * Added this for debugging, but if tempo is changing this can
  * take a LONG time to catch up, so it is highly inaccurate if the
  * user is fidding with tempos before recording.
+ *
+ * We now prefer the PulseEstimator which follows tempo changes
+ * and falls back to the average until it has settled.
  */
 PUBLIC float SyncTracker::getAveragePulseFrames()
 {
-    return mPulseMonitor->getPulseWidth();
+    float frames = mEstimator->getPulseFrames();
+    if (frames == 0.0f)
+      frames = mPulseMonitor->getPulseWidth();
+    return frames;
+}
+
+/**
+ * Confidence in the pulse estimate from 0.0 to 1.0.
+ */
+PUBLIC float SyncTracker::getConfidence()
+{
+    return mEstimator->getConfidence();
 }
 
 PUBLIC int SyncTracker::getBeatsPerBar()
@@ -439,6 +461,7 @@ PUBLIC void SyncTracker::reset()
     mDriftChecks = 0;
     mDriftCorrections = 0;
     mLastPulseAudioFrame = -1;
+    mStreamFrame = 0.0;
 
     // Start this out true so we don't do an initial 
     // pulse increment.  
@@ -446,6 +469,7 @@ PUBLIC void SyncTracker::reset()
   
     mPulseMonitor->reset();
     mDriftMonitor->reset();
+    mEstimator->reset();
 }
 
 /**
@@ -469,9 +493,8 @@ PUBLIC void SyncTracker::setMasterTrack(Track* t)
 
 /**
  * Advance the tracker state by some number of audio frames.
- * This will usually be the length of an audio interrupt block.
- * For SYNC_HOST we'll also call this to do a partial advance after
- * locking the tracker in the middle of a buffer.
+ * This is called once for every audio interrupt block and is the
+ * only thing that advances the stream time we give the PulseEstimator.
  * This must be called AFTER processing pulses that might change
  * the length of the loop (pending resize).
  *
@@ -482,6 +505,30 @@ PUBLIC void SyncTracker::setMasterTrack(Track* t)
  * calculations here.
  */
 PUBLIC void SyncTracker::advance(long frames, EventPool* pool, EventList* events)
+{
+    if (frames > 0)
+      mStreamFrame += frames;
+
+    advanceAudio(frames, pool, events);
+}
+
+/**
+ * Advance the audio frame for the remainder of a block after locking
+ * the tracker in the middle of it.  The stream time for the whole
+ * block was already counted by advance() at the start of the interrupt
+ * so it must not move here or the estimator would see a phase jump.
+ */
+PUBLIC void SyncTracker::advanceRemaining(long frames)
+{
+    advanceAudio(frames, NULL, NULL);
+}
+
+/**
+ * Shared by advance() and advanceRemaining() to advance the loop
+ * frame and generate pulse events.
+ */
+PRIVATE void SyncTracker::advanceAudio(long frames, EventPool* pool, 
+                                       EventList* events)
 {
     // originally did this only if the tracker was locked but that
     // makes it harder to measure the average pulse width before locking
@@ -831,6 +878,7 @@ PRIVATE void SyncTracker::jumpPulse(Event* e)
             mLastPulseAudioFrame = -1;
             mPulseMonitor->reset();
             mDriftMonitor->reset();
+            mEstimator->reset();
         }
         else {
             // retain drift, but don't measure this pulse
@@ -857,6 +905,12 @@ PRIVATE void SyncTracker::jumpPulse(Event* e)
  */
 PRIVATE void SyncTracker::pulse(Event* e)
 {
+    // The estimator follows the pulse stream in real time so it
+    // sees every pulse, including the pending ones we ignore below.
+    // Pulses are processed before advance() so mStreamFrame is still
+    // at the start of this interrupt.
+    mEstimator->pulse(mStreamFrame + (double)e->frame);
+
     // If we have pending pulses, ignore them since they were logically
     // included when the tracker was locked.  There should normally be
     // only one of these.
@@ -920,7 +974,15 @@ PRIVATE void SyncTracker::pulse(Event* e)
         // logical pulse frame
         float pulseFrame = getPulseFrame();
 
-        mDrift = calcDrift((long)pulseFrame, effectiveAudioFrame, mLoopFrames);
+        // The raw pulse is late or early by some amount of jitter,
+        // calculate drift relative to where the estimator thinks the
+        // pulse really was so a single jittery pulse can't trigger
+        // a drift correction.  If the estimator hasn't settled the
+        // residual is zero.
+        long residual = (long)mEstimator->getResidual();
+        long smoothedAudioFrame = wrap(effectiveAudioFrame - residual);
+
+        mDrift = calcDrift((long)pulseFrame, smoothedAudioFrame, mLoopFrames);
 
         // remember this for Realign when OutRealign=Restart
         // UPDATE: Now that Realign follows the SyncTrakcer pulses we
@@ -1179,6 +1241,7 @@ PUBLIC void SyncTracker::lock(TraceContext* tc, int originPulse, int pulses,
         // reset the pulse monitor too?  it's kind of late now since we've
         // locked to it already
         mDriftMonitor->reset();
+        mEstimator->reset();
 
         // this ususally start from zero but can be adjusted below
         mPendingPulses = 0;
@@ -1287,6 +1350,7 @@ PRIVATE void SyncTracker::doResize()
         // don't make the new average lag
         mPulseMonitor->reset();
         mDriftMonitor->reset();
+        mEstimator->reset();
     }
 }
 
@@ -1550,6 +1614,140 @@ PUBLIC void PulseMonitor::pulse(int width)
     mPulse = (float)mTotal / (float)mDivisor;
 }
 
+/****************************************************************************
+ *                                                                          *
+ *                              PULSE ESTIMATOR                             *
+ *                                                                          *
+ ****************************************************************************/
+
+PUBLIC PulseEstimator::PulseEstimator()
+{
+    mGain = PULSE_ESTIMATOR_CLOCK_GAIN;
+	reset();
+}
+
+PUBLIC PulseEstimator::~PulseEstimator()
+{
+}
+
+/**
+ * Set the phase gain of the loop, between 0.0 and 1.0.
+ * Smaller values smooth more jitter but take longer to follow
+ * a tempo change.
+ */
+PUBLIC void PulseEstimator::setGain(float gain)
+{
+    if (gain > 0.0f && gain <= 1.0f)
+      mGain = gain;
+}
+
+PUBLIC void PulseEstimator::reset()
+{
+    mPulses = 0;
+    mTime = 0.0;
+    mPeriod = 0.0;
+    mVariance = 0.0;
+    mResidual = 0.0f;
+}
+
+/**
+ * Add a pulse received at the given time.
+ *
+ * The first two pulses seed the phase and period.  After that 
+ * we compare the pulse with the predicted time and feed the error back.
+ * The period gain is derived from the phase gain so the loop is 
+ * critically damped.  While we're settling we use a larger gain so 
+ * the first estimates converge quickly.
+ *
+ * A pulse further than half a period from the prediction is either
+ * a lost pulse or a sudden tempo change.  We don't let those pull the
+ * loop, instead we resynchronize the phase and settle again.
+ */
+PUBLIC void PulseEstimator::pulse(double time)
+{
+    mResidual = 0.0f;
+
+    if (mPulses == 0) {
+        mTime = time;
+        mPulses++;
+    }
+    else if (mPulses == 1) {
+        if (time > mTime) {
+            mPeriod = time - mTime;
+            mTime = time;
+            mPulses++;
+        }
+    }
+    else {
+        double predicted = mTime + mPeriod;
+        double error = time - predicted;
+        double abserror = (error > 0.0) ? error : -error;
+
+        if (abserror > (mPeriod / 2.0)) {
+            if (time > mTime)
+              mPeriod = time - mTime;
+            mTime = time;
+            mVariance = 0.0;
+            mPulses = 2;
+        }
+        else {
+            double gain = mGain;
+            double settle = 2.0 / (double)(mPulses + 1);
+            if (settle > gain)
+              gain = settle;
+
+            double periodGain = (gain * gain) / (2.0 - gain);
+
+            mTime = predicted + (gain * error);
+            mPeriod += (periodGain * error);
+            mVariance += gain * ((error * error) - mVariance);
+            mPulses++;
+
+            // the part of the error we consider to be jitter
+            if (mPulses > PULSE_ESTIMATOR_SETTLE_PULSES)
+              mResidual = (float)(time - mTime);
+        }
+    }
+}
+
+/**
+ * The estimated number of frames between pulses, zero if we
+ * haven't settled.
+ */
+PUBLIC float PulseEstimator::getPulseFrames()
+{
+    float frames = 0.0f;
+    if (mPulses > PULSE_ESTIMATOR_SETTLE_PULSES)
+      frames = (float)mPeriod;
+    return frames;
+}
+
+/**
+ * The difference between the last pulse received and the
+ * estimated pulse time.  Positive if the pulse was late.
+ */
+PUBLIC float PulseEstimator::getResidual()
+{
+    return mResidual;
+}
+
+/**
+ * Derive a confidence from the phase error variance relative to 
+ * the pulse width.  Jitter of half a pulse or more is considered
+ * useless.
+ */
+PUBLIC float PulseEstimator::getConfidence()
+{
+    float confidence = 0.0f;
+    if (mPulses > PULSE_ESTIMATOR_SETTLE_PULSES && mPeriod > 0.0) {
+        double jitter = sqrt(mVariance);
+        confidence = (float)(1.0 - (jitter / (mPeriod / 2.0)));
+        if (confidence < 0.0f)
+          confidence = 0.0f;
+    }
+    return confidence;
+}
+
 /****************************************************************************/
 /****************************************************************************/
 /****************************************************************************/
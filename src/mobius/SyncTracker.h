@@ -42,6 +42,7 @@ class SyncTracker {
     void reset();
     void interruptStart();
     void advance(long frames, class EventPool* pool, class EventList* events);
+    void advanceRemaining(long frames);
     void event(Event* e);
     long prepare(TraceContext* tc, int pulses, long frames, bool warn);
     void lock(TraceContext* tc, int originPulses, int pulses, 
@@ -65,6 +66,7 @@ class SyncTracker {
     long getDrift();
     float getAverageDrift();
     float getAveragePulseFrames();
+    float getConfidence();
 
     int getBeatsPerBar();
     long getDealign(Track* t);
@@ -82,6 +84,7 @@ class SyncTracker {
   private:
 
     float getPulseFrame();
+    void advanceAudio(long frames, class EventPool* pool, class EventList* events);
     void jumpPulse(Event* e);
     void pulse(Event* e);
     long advanceInternal(long frames);
@@ -264,6 +267,19 @@ class SyncTracker {
      */
     class PulseMonitor *mDriftMonitor;
 
+    /**
+     * Smoothed estimate of pulse width and phase, used to remove
+     * pulse jitter from the drift calculation.
+     */
+    class PulseEstimator *mEstimator;
+
+    /**
+     * The total number of frames we have advanced, this is not wrapped
+     * or adjusted by drift correction.  It provides the timeline for 
+     * mEstimator.
+     */
+    double mStreamFrame;
+
     /**
      * Flag to enable pulse trace.
      * Relatively harmless for host sync, MIDI/Out sync gets noisy.
@@ -305,6 +321,54 @@ class PulseMonitor {
 	float mPulse;
 };
 
+/**
+ * Default loop gain for PulseEstimator.  
+ * MIDI clocks are frequent and jittery so we can smooth over several
+ * of them, host beats are infrequent and are already sample accurate
+ * so they need to be followed more closely.
+ */
+#define PULSE_ESTIMATOR_CLOCK_GAIN 0.05f
+#define PULSE_ESTIMATOR_BEAT_GAIN 0.5f
+
+/**
+ * The number of pulses we need before the estimate is considered usable.
+ */
+#define PULSE_ESTIMATOR_SETTLE_PULSES 4
+
+/**
+ * Used internally by SyncTracker to maintain a smoothed estimate of
+ * pulse width and pulse phase.  This is a second order phase locked loop,
+ * the phase error of each pulse relative to the predicted pulse time
+ * adjusts both the phase and the period so it will follow gradual tempo
+ * changes without lagging the way PulseMonitor does.
+ *
+ * Times are in audio frames on a timeline that is never wrapped.
+ */
+class PulseEstimator {
+
+  public:
+
+	PulseEstimator();
+	~PulseEstimator();
+
+	void setGain(float gain);
+	void reset();
+	void pulse(double time);
+
+	float getPulseFrames();
+	float getResidual();
+	float getConfidence();
+
+  private:
+
+	float mGain;
+	int mPulses;
+	double mTime;
+	double mPeriod;
+	double mVariance;
+	float mResidual;
+};
+
 
 
 /****************************************************************************/
@@ -140,6 +140,12 @@
  *                                                                          *
  ****************************************************************************/
 
+/**
+ * The minimum SyncTracker confidence required before we will use
+ * the estimated pulse width for MidiRecordMode=estimate.
+ */
+#define MIN_ESTIMATE_CONFIDENCE 0.5f
+
 /****************************************************************************
  *                                                                          *
  *   							 SYNCHRONIZER                               *
@@ -162,6 +168,7 @@ PUBLIC Synchronizer::Synchronizer(Mobius* mob, MidiInterface* midi)
 	mDriftCheckPoint = DRIFT_CHECK_LOOP;
 	mMidiRecordMode = MIDI_TEMPO_AVERAGE;
     mNoSyncBeatRounding = false;
+    mLateMidiEvents = 0;
 
     EventPool* epool = mMobius->getEventPool();
 
@@ -176,6 +183,8 @@ PUBLIC Synchronizer::Synchronizer(Mobius* mob, MidiInterface* midi)
 	mLastInterruptMsec = 0;
 	mInterruptMsec = 0;
 	mInterruptFrames = 0;
+    mLastInterruptStreamTime = 0.0;
+    mInterruptStreamTime = 0.0;
 
     mForceDriftCorrect = false;
 	// kludge for special conditional breakpoints
@@ -221,6 +230,7 @@ PUBLIC void Synchronizer::updateConfiguration(MobiusConfig* config)
 	mDriftCheckPoint = config->getDriftCheckPoint();
 	mMidiRecordMode = config->getMidiRecordMode();
     mNoSyncBeatRounding = config->isNoSyncBeatRounding();
+    mTransport->setScheduleClocks(!config->isNoClockScheduling());
 }
 
 /**
@@ -261,6 +271,12 @@ PUBLIC void Synchronizer::globalReset()
  *
  * Most realtime events are added to a MidiQueue for processing
  * on the next audio interrupt.
+ *
+ * The millisecond clock in the MidiEvent is too coarse to place
+ * the event within an audio buffer so we also capture the stream time.
+ * AudioStream allows getStreamTime to be called outside the interrupt.
+ * It will be zero if we're a plugin, MidiQueue then falls back to 
+ * processing events at the front of the buffer.
  */
 PUBLIC bool Synchronizer::event(MidiEvent* e)
 {
@@ -274,7 +290,7 @@ PUBLIC bool Synchronizer::event(MidiEvent* e)
 		break;
 		case MS_SONGPOSITION: {
 			// this is only considered actionable if a MS_CONTINUE is received
-			mMidiQueue.add(e);
+			mMidiQueue.add(e, getStreamTime());
 		}
 		break;
 		case MS_SONGSELECT: {
@@ -283,19 +299,19 @@ PUBLIC bool Synchronizer::event(MidiEvent* e)
 		}
 		break;
 		case MS_CLOCK: {
-			mMidiQueue.add(e);
+			mMidiQueue.add(e, getStreamTime());
 		}
 		break;
 		case MS_START: {
-			mMidiQueue.add(e);
+			mMidiQueue.add(e, getStreamTime());
 		}
 		break;
 		case MS_STOP: {
-			mMidiQueue.add(e);
+			mMidiQueue.add(e, getStreamTime());
 		}
 		break;
 		case MS_CONTINUE: {
-			mMidiQueue.add(e);
+			mMidiQueue.add(e, getStreamTime());
 		}
 		break;
 		case MS_SENSE: {
@@ -311,6 +327,18 @@ PUBLIC bool Synchronizer::event(MidiEvent* e)
 	return realtime;
 }
 
+/**
+ * Capture the current audio stream time for an incomming MIDI event.
+ */
+PRIVATE double Synchronizer::getStreamTime()
+{
+    double time = 0.0;
+    AudioStream* stream = mMobius->getAudioStream();
+    if (stream != NULL)
+      time = stream->getStreamTime();
+    return time;
+}
+
 /****************************************************************************
  *                                                                          *
  *                               BEATS PER BAR                              *
@@ -1906,7 +1934,20 @@ PRIVATE void Synchronizer::getRecordUnit(Loop* l, SyncUnitInfo* unit)
             Trace(l, 2, "Sync: getRecordUnit average frames %ld smooth frames %ld\n",
                   (long)frames, (long)sframes);
         
-            if (mMidiRecordMode == MIDI_TEMPO_AVERAGE)
+            if (mMidiRecordMode == MIDI_TEMPO_ESTIMATE) {
+                // the tracker measures pulses in audio frames rather
+                // than milliseconds so it doesn't need to be converted
+                float confidence = mMidiTracker->getConfidence();
+                float eframes = mMidiTracker->getAveragePulseFrames() * 24.0f;
+                Trace(l, 2, "Sync: getRecordUnit estimated frames %ld confidence (x100) %ld\n",
+                      (long)eframes, (long)(confidence * 100));
+
+                if (confidence >= MIN_ESTIMATE_CONFIDENCE && eframes > 0.0f)
+                  unit->frames = eframes;
+                else
+                  unit->frames = frames;
+            }
+            else if (mMidiRecordMode == MIDI_TEMPO_AVERAGE)
               unit->frames = frames;
             else
               unit->frames = sframes;
@@ -2050,8 +2091,10 @@ PRIVATE void Synchronizer::adjustBarUnit(Loop* l, SyncState* state,
  * Convert raw events recieved since the last interrupt into a list
  * of Event object we can feed into each track's event list.
  *
- * Host events may have an offset within the current buffer.  MIDI and Timer
- * events are always processed at the beinning of the buffer since they
+ * Host events may have an offset within the current buffer.  External
+ * MIDI events are offset by the stream time they were received relative
+ * to the start of the previous interrupt, see MidiQueue::getOffset.
+ * Timer events are always processed at the beinning of the buffer since they
  * have already happened and we need to catch up ASAP.  
  *
  * TODO: Eventually try to be smarter about buffer quantization.
@@ -2076,6 +2119,12 @@ PUBLIC void Synchronizer::interruptStart(AudioStream* stream)
 	mLastInterruptMsec = mInterruptMsec;
 	mInterruptMsec = mMidi->getMilliseconds();
 	mInterruptFrames = stream->getInterruptFrames();
+    mLastInterruptStreamTime = mInterruptStreamTime;
+    mInterruptStreamTime = stream->getLastInterruptStreamTime();
+
+    // place the outgoing clocks for this block
+    mTransport->scheduleClocks(mInterruptMsec, mInterruptFrames,
+                               mMobius->getEffectiveOutputLatency());
 
     // should be empty but make sure
     flushEvents();
@@ -2094,7 +2143,19 @@ PUBLIC void Synchronizer::interruptStart(AudioStream* stream)
     // I really dont' think that's worth it
     EventPool* pool = mMobius->getEventPool();
     int bpb = getInBeatsPerBar();
-    events = mMidiQueue.getEvents(pool, mInterruptFrames);
+    events = mMidiQueue.getEvents(pool, mInterruptFrames, 
+                                  mLastInterruptStreamTime,
+                                  stream->getSampleRate());
+
+    // these were placed at the end of the buffer, complain once per 
+    // interrupt, a steady stream means the device isn't keeping up
+    long late = mMidiQueue.getLateEvents();
+    if (late != mLateMidiEvents) {
+        Trace(2, "Sync: %ld late MIDI events, %ld total\n",
+              (long)(late - mLateMidiEvents), (long)late);
+        mLateMidiEvents = late;
+    }
+
     next = NULL;
     for (event = events ; event != NULL ; event = next) {
         next = event->getNext();
@@ -4329,7 +4390,7 @@ PUBLIC void Synchronizer::loopRecordStop(Loop* l, Event* stop)
 
             // advance the remaining frames in this buffer
             // this should not be returning any events
-            tracker->advance(track->getRemainingFrames(), NULL, NULL);
+            tracker->advanceRemaining(track->getRemainingFrames());
             informFollowers(tracker, l);
         }
     }
@@ -5148,7 +5209,7 @@ PRIVATE void Synchronizer::lockOutSyncTracker(Loop* l, bool recordStop)
         if (recordStop) {
             long advance = t->getRemainingFrames();
             Trace(l, 2, "Sync: initial tracker audio frame advance %ld\n", advance);
-            mOutTracker->advance(advance, NULL, NULL);
+            mOutTracker->advanceRemaining(advance);
         }
 
         mTransport->setTempo(l, tempo);
@@ -218,6 +218,7 @@ class Synchronizer {
 	/////////////////////////////////////////////////////////////////////
 
     void flushEvents();
+    double getStreamTime();
     float getSpeed(Loop* l);
     void traceTempo(Loop* l, const char* type, float tempo);
 
@@ -314,6 +315,9 @@ class Synchronizer {
 
 	// state captured during each interrupt
     class EventList* mInterruptEvents;
+
+    // late MIDI events we've already traced
+    long mLateMidiEvents;
     Event* mReturnEvent;
     Event* mNextAvailableEvent;
 
@@ -326,6 +330,11 @@ class Synchronizer {
 	long mInterruptMsec;
 	long mInterruptFrames;
 
+    // audio stream time at the start of the last two interrupts,
+    // used to place MIDI events within the buffer
+    double mLastInterruptStreamTime;
+    double mInterruptStreamTime;
+
     // flag that may be set by the DriftCorrect function
     // to force a drift correction on the next interrupt
     bool mForceDriftCorrect;
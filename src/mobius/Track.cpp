@@ -603,6 +603,15 @@ PUBLIC EventManager* Track::getEventManager()
     return mEventManager;
 }
 
+/**
+ * Called by MobiusThread to grow the loop history indexes.
+ */
+PUBLIC void Track::maintainHistory()
+{
+    for (int i = 0 ; i < mLoopCount ; i++)
+      mLoops[i]->getHistoryIndex()->maintain();
+}
+
 PRIVATE InputStream* Track::getInputStream()
 {
     return mInput;
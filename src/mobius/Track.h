@@ -133,6 +133,7 @@ class Track : public RecorderTrack, public TraceContext
     class SyncState* getSyncState();
 	class Synchronizer* getSynchronizer();
     class EventManager* getEventManager();
+    void maintainHistory();
 
 	int getLoopCount();
 	class Loop* getLoop(int index);
@@ -34,7 +34,8 @@ PRIVATE void TriggerWatcher::init()
     trigger = NULL;
     triggerId = NULL;
     function = NULL;
-    frames = 0;
+    deadline = 0;
+    heapIndex = -1;
     longPress = false;
 }
 
@@ -62,7 +63,8 @@ PUBLIC void TriggerWatcher::init(Action* a)
     function = a->getFunction();
     track = a->getTargetTrack();
     group = a->getTargetGroup();
-    frames = 0;
+    deadline = 0;
+    heapIndex = -1;
     longPress = false;
 }
 
@@ -72,11 +74,6 @@ PUBLIC void TriggerWatcher::init(Action* a)
  *                                                                          *
  ****************************************************************************/
 
-/**
- * Let the max be two per track, way more than needed in practice.
- */
-#define MAX_TRIGGER_WATCHERS 16
-
 PUBLIC TriggerState::TriggerState()
 {
     mPool = NULL;
@@ -85,6 +82,10 @@ PUBLIC TriggerState::TriggerState()
 
     // default to 1/2 second at 44100
     mLongPressFrames = 22050;
+    mLongPressMsecs = 0;
+    mSampleRate = 0;
+    mFrame = 0;
+    mHeapSize = 0;
 
     // go ahead and flesh out the pool now, we can use this
     // to enforce the maximum
@@ -111,10 +112,18 @@ PUBLIC void TriggerState::setLongPressFrames(int frames)
 
 /**
  * Must be set by the owner when it knows the long press frame length.
+ * This is called whenever the configuration is propagated so only
+ * do the math when something changed.
  */
 PUBLIC void TriggerState::setLongPressTime(int msecs, int sampleRate)
 {
-    // TODO: Calculate frame from time and sample rate
+    if (msecs > 0 && sampleRate > 0 &&
+        (msecs != mLongPressMsecs || sampleRate != mSampleRate)) {
+
+        mLongPressMsecs = msecs;
+        mSampleRate = sampleRate;
+        mLongPressFrames = (int)(((long long)msecs * sampleRate) / 1000);
+    }
 }
 
 /**
@@ -133,6 +142,7 @@ PUBLIC void TriggerState::assimilate(Action* action)
         // an up transition
         TriggerWatcher* tw = remove(action);
         if (tw != NULL) {
+            unschedule(tw);
             const char* msg;
             if (tw->longPress)
               msg = "TriggerState: ending long press for %s\n";
@@ -177,6 +187,7 @@ PUBLIC void TriggerState::assimilate(Action* action)
             if (tw != NULL) {
                 Trace(2, "TriggerState: Cleaning dangling trigger for %s\n",
                       tw->function->getDisplayName());
+                unschedule(tw);
                 tw->next = mPool;
                 mPool = tw;
             }
@@ -199,6 +210,8 @@ PUBLIC void TriggerState::assimilate(Action* action)
                 mPool = tw->next;
                 tw->next = NULL;
                 tw->init(action);
+                tw->deadline = mFrame + mLongPressFrames;
+                schedule(tw);
 
                 if (mLastWatcher != NULL)
                   mLastWatcher->next = tw;
@@ -252,58 +265,145 @@ PRIVATE TriggerWatcher* TriggerState::remove(Action* action)
  * Advance the time of all pending triggers.  If any of them
  * reach the long-press threshold notify the functions.
  *
- * For each trigger we determined to be sustained long, create
- * an Action containing the relevant parts of the original down
- * Action and pass it to the special Function::invokeLong method.
- * !! Think about whether this can't just be a normal Action sent
- * to Mobius::doAction, with action->down = true and 
- * action->longPress = true it means to do the long press behvaior.
+ * We're called at the start of the interrupt for the frames about
+ * to be processed.  Actions can't be placed within the block so a
+ * deadline fires at the block boundary closest to it: in this block
+ * if it falls in the first half, otherwise in the next one.
  */
 PUBLIC void TriggerState::advance(Mobius* mobius, int frames)
 {
-    for (TriggerWatcher* t = mWatchers ; t != NULL ; t = t->next) {
+    long fireFrame = mFrame + (frames / 2);
 
-        //Trace(2, "TriggerState: advancing %s %ld\n", 
-        //t->function->getDisplayName(), (long)t->frames);
+    while (mHeapSize > 0 && mHeap[0]->deadline <= fireFrame) {
+        TriggerWatcher* t = mHeap[0];
+        unschedule(t);
+        longPress(mobius, t);
+    }
 
-        t->frames += frames;
+    if (mHeapSize > 0)
+      mFrame += frames;
+    else
+      mFrame = 0;
+}
 
-        // ignore if we've already long-pressed 
-        if (!t->longPress) {
-            if (t->frames > mLongPressFrames) {
-                // exceeded the threshold
-                t->longPress = true;
+/**
+ * Called when a trigger has been sustained long.  Create an Action
+ * containing the relevant parts of the original down Action and pass
+ * it to the special Function::invokeLong method.
+ * !! Think about whether this can't just be a normal Action sent
+ * to Mobius::doAction, with action->down = true and 
+ * action->longPress = true it means to do the long press behvaior.
+ */
+PRIVATE void TriggerState::longPress(Mobius* mobius, TriggerWatcher* t)
+{
+    // ignore if we've already long-pressed 
+    if (!t->longPress) {
+        t->longPress = true;
+
+        Trace(2, "TriggerState: Long-press %s\n", 
+              t->function->getDisplayName());
+
+        Action* a = mobius->newAction();
+        a->inInterrupt = true;
+
+        // trigger
+        // what about triggerValue and triggerOffset?
+        a->trigger = t->trigger;
+        a->id = t->triggerId;
+
+        // target
+        // sigh, we need everything in ResolvedTarget 
+        // for this 
+        a->setFunction(t->function);
+        a->setTargetTrack(t->track);
+        a->setTargetGroup(t->group);
+
+        // arguments
+        // not carrying any of these yet, if we start needing this
+        // then just clone the damn Action 
+                
+        // this tells Mobius to call Function::invokeLong
+        a->down = true;
+        a->longPress = true;
 
-                Trace(2, "TriggerState: Long-press %s\n", 
-                      t->function->getDisplayName());
+        mobius->doAction(a);
+    }
+}
 
-                Action* a = mobius->newAction();
-                a->inInterrupt = true;
+//////////////////////////////////////////////////////////////////////
+//
+// Deadline Heap
+//
+//////////////////////////////////////////////////////////////////////
 
-                // trigger
-                // what about triggerValue and triggerOffset?
-                a->trigger = t->trigger;
-                a->id = t->triggerId;
+/**
+ * Add a watcher to the heap.  The heap can't overflow since it is
+ * the same size as the watcher pool.
+ */
+PRIVATE void TriggerState::schedule(TriggerWatcher* t)
+{
+    if (t->heapIndex < 0 && mHeapSize < MAX_TRIGGER_WATCHERS) {
+        heapSet(mHeapSize, t);
+        mHeapSize++;
+        heapUp(t->heapIndex);
+    }
+}
+
+/**
+ * Remove a watcher from the heap if it is there.  Move the last
+ * one into the hole and let it find its place.
+ */
+PRIVATE void TriggerState::unschedule(TriggerWatcher* t)
+{
+    int index = t->heapIndex;
+    if (index >= 0) {
+        t->heapIndex = -1;
+        mHeapSize--;
+        if (index < mHeapSize) {
+            TriggerWatcher* last = mHeap[mHeapSize];
+            heapSet(index, last);
+            heapUp(index);
+            heapDown(last->heapIndex);
+        }
+        mHeap[mHeapSize] = NULL;
+    }
+}
 
-                // target
-                // sigh, we need everything in ResolvedTarget 
-                // for this 
-                a->setFunction(t->function);
-                a->setTargetTrack(t->track);
-                a->setTargetGroup(t->group);
+PRIVATE void TriggerState::heapSet(int index, TriggerWatcher* t)
+{
+    mHeap[index] = t;
+    t->heapIndex = index;
+}
 
-                // arguments
-                // not carrying any of these yet, if we start needing this
-                // then just clone the damn Action 
-                
-                // this tells Mobius to call Function::invokeLong
-                a->down = true;
-                a->longPress = true;
+PRIVATE void TriggerState::heapUp(int index)
+{
+    TriggerWatcher* t = mHeap[index];
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (mHeap[parent]->deadline <= t->deadline)
+          break;
+        heapSet(index, mHeap[parent]);
+        index = parent;
+    }
+    heapSet(index, t);
+}
 
-                mobius->doAction(a);
-            }
-        }
+PRIVATE void TriggerState::heapDown(int index)
+{
+    TriggerWatcher* t = mHeap[index];
+    while (true) {
+        int child = (index * 2) + 1;
+        if (child >= mHeapSize)
+          break;
+        if (child + 1 < mHeapSize && 
+            mHeap[child + 1]->deadline < mHeap[child]->deadline)
+          child++;
+        if (t->deadline <= mHeap[child]->deadline)
+          break;
+        heapSet(index, mHeap[child]);
+        index = child;
     }
+    heapSet(index, t);
 }
 
 /****************************************************************************/
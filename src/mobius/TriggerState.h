@@ -13,6 +13,11 @@
 #ifndef TRIGGER_STATE_H
 #define TRIGGER_STATE_H
 
+/**
+ * Let the max be two per track, way more than needed in practice.
+ */
+#define MAX_TRIGGER_WATCHERS 16
+
 /**
  * Utility class used to detect when a trigger is held down long enough
  * to cause "long press" behavior.
@@ -66,9 +71,15 @@ class TriggerWatcher {
     int group;
 
     /**
-     * The time in frames this function has been held down.
+     * The TriggerState frame at which this becomes a long press.
      */
-    int frames;
+    long deadline;
+
+    /**
+     * Position in the TriggerState deadline heap, -1 if not
+     * waiting for a long press.
+     */
+    int heapIndex;
 
     /**
      * Set true if we decide this was a long press.
@@ -99,7 +110,11 @@ class TriggerWatcher {
  * there may be more than one sustaining trigger per track, but usually
  * they cancel each other.  Some that could be supported are SUSOverdub
  * combined with SUSReverse.
- * 
+ *
+ * Watchers waiting for a long press are also kept in a binary heap
+ * ordered by the frame at which they become long, so advance() only
+ * has to look at the top of the heap rather than visiting every
+ * watcher on every interrupt.
  */
 class TriggerState {
 
@@ -117,12 +132,31 @@ class TriggerState {
   private:
     
     TriggerWatcher* remove(Action* action);
+    void longPress(Mobius* mobius, TriggerWatcher* t);
+
+    void schedule(TriggerWatcher* t);
+    void unschedule(TriggerWatcher* t);
+    void heapSet(int index, TriggerWatcher* t);
+    void heapUp(int index);
+    void heapDown(int index);
 
     TriggerWatcher* mPool;
     TriggerWatcher* mWatchers;
     TriggerWatcher* mLastWatcher;
 
     int mLongPressFrames;
+    int mLongPressMsecs;
+    int mSampleRate;
+
+    /**
+     * Frames advanced since the heap was last empty.  Deadlines
+     * are relative to this, it goes back to zero when nothing is
+     * pending so it can't overflow.
+     */
+    long mFrame;
+
+    TriggerWatcher* mHeap[MAX_TRIGGER_WATCHERS];
+    int mHeapSize;
 
 };
 
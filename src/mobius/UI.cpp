@@ -829,7 +829,7 @@ void UI::actionPerformed(void *c)
 	else if (c == mTrackGrid) {
         int index = mTrackGrid->getSelectedIndex();
         if (index >= 0) {
-            Action* a = new Action();
+            Action* a = mMobius->newAction();
             a->setFunction(TrackN);
             a->trigger = TriggerUI;
             a->down = true;
@@ -863,7 +863,7 @@ void UI::actionPerformed(void *c)
 		if (id >= SETUP_MENU_BASE) {
             // one of the setup menu items
             int index = id - SETUP_MENU_BASE;
-            Action* a = new Action();
+            Action* a = mMobius->newAction();
             a->setTarget(TargetSetup);
             a->arg.setInt(index);
             // special operator to save the selected setup in the config file
@@ -873,7 +873,7 @@ void UI::actionPerformed(void *c)
 		else if (id >= PRESET_MENU_BASE) {
             // one of the preset menu items
             int index = id - PRESET_MENU_BASE;
-            Action* a = new Action();
+            Action* a = mMobius->newAction();
             a->setTarget(TargetPreset);
             a->arg.setInt(index);
             mMobius->doAction(a);
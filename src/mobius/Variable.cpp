@@ -2372,6 +2372,39 @@ void SyncAverageDriftVariableType::getTrackValue(Track* t, ExValue* value)
 PUBLIC SyncAverageDriftVariableType* SyncAverageDriftVariable = 
 new SyncAverageDriftVariableType();
 
+//////////////////////////////////////////////////////////////////////
+//
+// syncConfidence
+//
+// The confidence of the tracker's pulse estimate, from 0 to 100.
+// This falls as the sync source becomes more jittery.
+//
+//////////////////////////////////////////////////////////////////////
+
+class SyncConfidenceVariableType : public ScriptInternalVariable {
+  public:
+    SyncConfidenceVariableType();
+    void getTrackValue(Track* t, ExValue* value);
+};
+
+SyncConfidenceVariableType::SyncConfidenceVariableType()
+{
+    setName("syncConfidence");
+}
+
+void SyncConfidenceVariableType::getTrackValue(Track* t, ExValue* value)
+{
+    Synchronizer* s = t->getSynchronizer();
+    SyncTracker* tracker = s->getSyncTracker(t);
+    if (tracker != NULL)
+      value->setLong((long)(tracker->getConfidence() * 100));
+    else
+      value->setNull();
+}
+
+PUBLIC SyncConfidenceVariableType* SyncConfidenceVariable = 
+new SyncConfidenceVariableType();
+
 //////////////////////////////////////////////////////////////////////
 //
 // syncDriftChecks
@@ -3244,6 +3277,7 @@ PRIVATE ScriptInternalVariable* InternalVariables[] = {
 	SyncAudioFrameVariable,
     SyncBarVariable,
     SyncBeatVariable,
+	SyncConfidenceVariable,
 	SyncCorrectionsVariable,
 	SyncCyclePulsesVariable,
 	SyncDealignVariable,
@@ -74,8 +74,9 @@
  ****************************************************************************/
 
 /**
- * Maximum number of frames we'll allow in the VST callback.
- * Determines the sizes of the interleaved frame buffers.  
+ * Maximum number of frames we'll pass to the engine at a time.
+ * Determines the sizes of the interleaved frame buffers.  Host
+ * buffers larger than this are processed in several blocks.
  */
 #define MAX_VST_FRAMES 1024 * 2
 
@@ -131,7 +132,9 @@ VstMobius::VstMobius (Context* context, audioMasterCallback audioMaster)
 
     mInterruptInputs = NULL;
     mInterruptOutputs = NULL;
+    mInterruptOffset = 0;
     mInterruptFrames = 0;
+    mBlockFrames = HOST_DEFAULT_BLOCK_FRAMES;
 	mProcessing = true;
 	mBypass = false;
 	mDummy = false;
@@ -153,18 +156,14 @@ VstMobius::VstMobius (Context* context, audioMasterCallback audioMaster)
 	mCheckSamplePosTransport = false;
 	mCheckPpqPosTransport = false;
 	mTraceBeats = false;
+	mTraceParameters = false;
 
     // new implementation, setting this non-null disables
     // the old one
     mSyncState = new HostSyncState();
 
-	for (int i = 0 ; i < MAX_VST_PORTS ; i++) {
-		VstPort* port = &mPorts[i];
-		port->input = new float[MAX_VST_FRAMES * MAX_VST_CHANNELS];
-		port->inputPrepared = false;
-		port->output = new float[MAX_VST_FRAMES * MAX_VST_CHANNELS];
-		port->outputPrepared = false;
-	}
+	for (int i = 0 ; i < MAX_VST_PORTS ; i++)
+	  mPorts[i].allocate(MAX_VST_FRAMES);
 
 	initSync();
 
@@ -286,12 +285,6 @@ VstMobius::~VstMobius ()
 	// ?? do we, this is a VST thing, not sure if it applies here...
 	mHandler = NULL;
 
-	for (int i = 0 ; i < MAX_VST_PORTS ; i++) {
-		VstPort* port = &mPorts[i];
-		delete port->input;
-		delete port->output;
-	}
-
 	// make sure we're not in an interrupt
 	SleepMillis(100);
 
@@ -396,6 +389,9 @@ void VstMobius::resume()
     // expensive initialization
 	mPlugin->start();
 
+	// hosts that never call startProcess still need this
+	updateBlockFrames();
+
 	// isInputConnected and isOutputConnected went away...
 #ifdef VST_2_1
 	if (mTrace) {
@@ -465,6 +461,10 @@ VstInt32 VstMobius::startProcess()
 	  trace("VstMobius::startProcess\n");
 
 	mPlugin->resume();
+
+	// block size may have changed in the config
+	updateBlockFrames();
+
 	mProcessing = true;
 
 	return 1;
@@ -700,6 +700,20 @@ void VstMobius::setBlockSizeInternal(int size)
 	// to assume the latency is the same
     setInputLatencyFrames(size);
 	setOutputLatencyFrames(size);
+
+	updateBlockFrames();
+}
+
+/**
+ * Refresh the maximum number of frames we give the engine at a time.
+ * This is called from every place the host may be preparing to 
+ * process since not all of them call startProcess.
+ */
+void VstMobius::updateBlockFrames()
+{
+	mBlockFrames = mPlugin->getBlockFrames();
+	if (mBlockFrames <= 0 || mBlockFrames > MAX_VST_FRAMES)
+	  mBlockFrames = MAX_VST_FRAMES;
 }
 
 void VstMobius::setSampleRateInternal(float rate)
@@ -933,7 +947,7 @@ float VstMobius::scaleParameterOut(PluginParameter* p, int value)
  */
 void VstMobius::setParameter(VstInt32 index, float value)
 {
-	if (mTrace)
+	if (mTraceParameters)
 	  trace("VstMobius::setParameter %ld %f\n", index, value);
 
     // Ignore if we're exporting since setParameterAutomated
@@ -944,7 +958,8 @@ void VstMobius::setParameter(VstInt32 index, float value)
             if (p != NULL) {
                 float scaled = (float)scaleParameterIn(p, value);
 
-                trace("setParameter %d %f scaled %f\n", (int)index, value, scaled);
+                if (mTraceParameters)
+                  trace("setParameter %d %f scaled %f\n", (int)index, value, scaled);
 
                 p->setValueIfChanged(scaled);
             }
@@ -956,7 +971,7 @@ float VstMobius::getParameter(VstInt32 index)
 {
     float value = 0.0f;
 
-	if (mTrace)
+	if (mTraceParameters)
 	  trace("VstMobius::getParameter %ld of %ld\n", index, mParameters);
 
     if (index < mParameters) {
@@ -968,7 +983,8 @@ float VstMobius::getParameter(VstInt32 index)
             int current = (int)p->getLast();
             value = (float)scaleParameterOut(p, current);
 
-            trace("getParameter %d %d scaled %f\n", (int)index, current, value);
+            if (mTraceParameters)
+              trace("getParameter %d %d scaled %f\n", (int)index, current, value);
         }
 	}
 
@@ -2004,10 +2020,12 @@ void VstMobius::processReplacing(float** inputs, float** outputs,
 PRIVATE void VstMobius::processInternal(float** inputs, float** outputs, 
 										VstInt32 sampleFrames, bool replace)
 {
-    if (mSyncState != NULL)
-      checkTime(sampleFrames);
-    else
-      checkTimeOld(sampleFrames);
+	// the engine only sees the buffer if everything is in order, but
+	// the sync state has to keep up with the host regardless
+	bool ready = (inputs != NULL && outputs != NULL && mProcessing &&
+				  mHandler != NULL && sampleFrames > 0);
+	if (!ready)
+	  advanceTime(sampleFrames, true);
 
 	if (inputs == NULL) 
 	  Trace(1, "VstMobius::processInternal null input array\n");
@@ -2019,102 +2037,144 @@ PRIVATE void VstMobius::processInternal(float** inputs, float** outputs,
 	}
 	else if (mHandler != NULL) {
 
-		if (sampleFrames > MAX_VST_FRAMES)
-		  Trace(1, "VstMobius::processInternal Too many VST frames!\n");
-		else if (sampleFrames == 0) {
+		if (sampleFrames == 0) {
 		  Trace(1, "VstMobius::processInternal No frames to process!\n");
 		}
 		else {
-			// todo: may want different channels per port
-			int channels = getPortChannels();
-
 			mInterruptInputs = inputs;
 			mInterruptOutputs = outputs;
-			mInterruptFrames = sampleFrames;
 
-			for (int i = 0 ; i < MAX_VST_PORTS ; i++) {
-				VstPort* port = &mPorts[i];
-				port->inputPrepared = false;
-				port->outputPrepared = false;
-			}
+			// Hosts may give us anything up to several thousand frames,
+			// pass them to the engine in blocks no larger than 
+			// mBlockFrames.  Host time is only available for the
+			// start of the buffer, advanceTime projects it for 
+			// the blocks after that.
+			long frames = 0;
+			for (long offset = 0 ; offset < sampleFrames ; offset += frames) {
+
+				frames = sampleFrames - offset;
+				if (frames > mBlockFrames)
+				  frames = mBlockFrames;
 
-			// have to call this even if in bypass to keep the
-			// machinery running, if necessary could figure
-			// out a lighter weight way to do this?
-			// even though we ignore outputs, should we also
-			// ignore inputs?
+				advanceTime(frames, (offset == 0));
 
-            // mHandler is normally the same as mPlugin
-            // but it registers itself through the AudioStream interface
-            // it calls back to getInterruptBuffers
-			mHandler->processAudioBuffers(mStream);
+				mInterruptOffset = offset;
+				mInterruptFrames = frames;
+				wrapInputs(inputs, offset, frames);
+
+				// have to call this even if in bypass to keep the
+				// machinery running, if necessary could figure
+				// out a lighter weight way to do this?
+				// even though we ignore outputs, should we also
+				// ignore inputs?
+
+				// mHandler is normally the same as mPlugin
+				// but it registers itself through the AudioStream 
+				// interface it calls back to getInterruptBuffers
+				mHandler->processAudioBuffers(mStream);
+
+				copyOutputs(inputs, outputs, offset, frames, replace);
+			}
 
             // tell the host about parameters changed during this
             // processing cycle
             exportParameters();
+		}
 
-			if (mBypass) {
-				// copy inputs to outputs
-				// !! need to support in/out ports of different size
-				int inports = mInputPins / channels;
-				for (int p = 0 ; p < inports ; p++) {
-					int portbase = p * channels;
-					for (int c = 0 ; c < channels ; c++) {
-						float* output = outputs[portbase + c];
-						if (output != NULL) {
-							float* input = inputs[portbase + c];
-							if (input != NULL) {
-								for (int i = 0 ; i < sampleFrames ; i++) {
-									if (replace)
-									  output[i] = input[i];
-									else
-									  output[i] += input[i];
-								}
-							}
-							else if (replace) {
-								// if replace on, should we erase
-								// current contents?
-								for (int i = 0 ; i < sampleFrames ; i++)
-								  output[i] = 0;
-							}
-						}
-					}
-				}
+        // send MIDI events that accumulated during this cycle
+        sendMidiEvents();
+	}
+}
+
+/**
+ * Advance the sync state over one block of the host buffer.
+ * The host is only asked for time at the start of the buffer.
+ */
+PRIVATE void VstMobius::advanceTime(VstInt32 frames, bool first)
+{
+	if (first) {
+		if (mSyncState != NULL)
+		  checkTime(frames);
+		else
+		  checkTimeOld(frames);
+	}
+	else if (mSyncState != NULL) {
+		mSyncState->advanceBlock(frames);
+		mSyncState->transfer(&mTime);
+	}
+	else {
+		// the old way only sees beats at the start of the buffer
+		mTime.beatBoundary = false;
+		mTime.barBoundary = false;
+	}
+}
+
+/**
+ * Point the ports at this block of the host's input buffers.
+ * They're converted only if the engine asks for them.
+ */
+PRIVATE void VstMobius::wrapInputs(float** inputs, long offset, long frames)
+{
+	int channels = getPortChannels();
+	int inports = mInputPins / channels;
+
+	for (int p = 0 ; p < MAX_VST_PORTS ; p++) {
+		HostPort* port = &mPorts[p];
+		port->reset(frames);
+		if (p < inports) {
+			int portbase = p * channels;
+			for (int c = 0 ; c < channels ; c++) {
+				float* input = inputs[portbase + c];
+				if (input != NULL)
+				  port->setInput(c, input + offset);
 			}
-			else {
-				// !! need to support variable numbers if in/out pins
-				int inports = mInputPins / channels;
-				for (int p = 0 ; p < inports ; p++) {
-					VstPort* port = &mPorts[p];
-					int portbase = p * channels;
-					for (int c = 0 ; c < channels ; c++) {
-						float* output = outputs[portbase + c];
-						if (output != NULL) {
-							if (port->outputPrepared) {
-								float* src = port->output;
-								int sample = c;
-								for (int i = 0 ; i < sampleFrames ; i++) {
-									if (replace)
-									  output[i] = src[sample];
-									else
-									  output[i] += src[sample];
-									sample += channels;
-								}
-							}
-							else if (replace) {
-								// if replace on, should we erase
-								// current contents?
-								for (int i = 0 ; i < sampleFrames ; i++)
-								  output[i] = 0;
-							}
+		}
+	}
+}
+
+/**
+ * Copy one block of engine output back to the host buffers.
+ */
+PRIVATE void VstMobius::copyOutputs(float** inputs, float** outputs,
+									long offset, long frames, bool replace)
+{
+	// todo: may want different channels per port
+	int channels = getPortChannels();
+
+	// !! need to support in/out ports of different size
+	int inports = mInputPins / channels;
+	for (int p = 0 ; p < inports ; p++) {
+		HostPort* port = &mPorts[p];
+		int portbase = p * channels;
+		for (int c = 0 ; c < channels ; c++) {
+			float* output = outputs[portbase + c];
+			if (output != NULL) {
+				output += offset;
+				if (mBypass) {
+					// copy inputs to outputs, nothing to do if
+					// the host is processing in place
+					float* input = inputs[portbase + c];
+					if (input != NULL) {
+						input += offset;
+						if (!replace) {
+							for (int i = 0 ; i < frames ; i++)
+							  output[i] += input[i];
 						}
+						else if (input != output)
+						  memcpy(output, input, sizeof(float) * frames);
+					}
+					else if (replace) {
+						// if replace on, should we erase
+						// current contents?
+						memset(output, 0, sizeof(float) * frames);
 					}
 				}
+				else {
+					// clears the output if no track used the port
+					port->exportOutput(c, output, replace);
+				}
 			}
 		}
-
-        // send MIDI events that accumulated during this cycle
-        sendMidiEvents();
 	}
 }
 
@@ -2128,15 +2188,8 @@ PUBLIC void VstMobius::getInterruptBuffers(int inport, float** inbuf,
 
 	if (inbuf != NULL) {
 		int inports = mInputPins / channels;
-		if (inport >= 0 && inport < inports) {
-			VstPort* port = &mPorts[inport];
-			if (!port->inputPrepared) {
-				mergeBuffers(port->input, mInterruptInputs, 
-							 inport, mInterruptFrames);
-				port->inputPrepared = true;
-			}
-			*inbuf = port->input;
-		}
+		if (inport >= 0 && inport < inports)
+		  *inbuf = mPorts[inport].getInput();
 		else {
 			// !! invalid port, return an empty buffer?
 		}
@@ -2144,42 +2197,14 @@ PUBLIC void VstMobius::getInterruptBuffers(int inport, float** inbuf,
 
 	if (outbuf != NULL) {
 		int outports = mOutputPins / channels;
-		if (outport >= 0 && outport < outports) {
-			VstPort* port = &mPorts[outport];
-			if (!port->outputPrepared) {
-				int channels = getPortChannels();
-				int floats = mInterruptFrames * channels;
-				memset(port->output, 0, (sizeof(float) * floats));
-				port->outputPrepared = true;
-			}
-			*outbuf = port->output;
-		}
+		if (outport >= 0 && outport < outports)
+		  *outbuf = mPorts[outport].getOutput();
 		else {
 			// !! invalid port, return dummy buffer?
 		}
 	}
 }
 
-PRIVATE void VstMobius::mergeBuffers(float* dest, float** sources, 
-									 int port, long frames)
-{
-	int channels = getPortChannels();
-	int portbase = port * channels;
-	int sample = 0;
-
-	// !! fix this, not pipelining well
-
-	for (int i = 0 ; i < frames ; i++) {
-		for (int j = 0 ; j < channels ; j++) {
-			float* src = sources[portbase + j];
-			if (src != NULL) 
-			  dest[sample++] = src[i];
-			else 
-			  dest[sample++] = 0.0;
-		}
-	}
-}
-
 //////////////////////////////////////////////////////////////////////
 //
 // HostInterface
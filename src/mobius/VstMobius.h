@@ -24,29 +24,6 @@
 #include "AudioInterface.h"
 #include "HostInterface.h"
 
-//////////////////////////////////////////////////////////////////////
-//
-// Ports
-//
-//////////////////////////////////////////////////////////////////////
-
-/**
- * Helper structure used to maintain processing state for
- * each "port" we expose to the Recorder.
- *
- * This is the same as AUMobius/AudioStreamPort, consider breaking out a 
- * utility class for port management and interleave/deinterleave.
- */
-typedef struct {
-
-	float* input;
-	bool inputPrepared;
-
-	float* output;
-	bool outputPrepared;
-
-} VstPort;
-
 //////////////////////////////////////////////////////////////////////
 //
 // AudioStreamProxy
@@ -242,10 +219,14 @@ class VstMobius : public VstPlugin,
 
 	void setBlockSizeInternal(int size);
     void setSampleRateInternal(float rate);
+	void updateBlockFrames();
 
 	void processInternal(float** inputs, float** outputs, 
 						 VstInt32 sampleFrames, bool replace);
-	void mergeBuffers(float* dest, float** src, int port, long frames);
+	void wrapInputs(float** inputs, long offset, long frames);
+	void copyOutputs(float** inputs, float** outputs, long offset, long frames,
+					 bool replace);
+	void advanceTime(VstInt32 frames, bool first);
 	void initSync();
 	void checkTime(VstInt32 frames);
 	void checkTimeOld(VstInt32 frames);
@@ -271,10 +252,12 @@ class VstMobius : public VstPlugin,
 	bool mHostRewinds;
 	char mError[256];
 	
-	VstPort mPorts[MAX_VST_PORTS];
+	HostPort mPorts[MAX_VST_PORTS];
 	float** mInterruptInputs;
 	float** mInterruptOutputs;
+	long mInterruptOffset;
 	long mInterruptFrames;
+	long mBlockFrames;
 	bool mProcessing;
 	bool mBypass;
 	bool mDummy;
@@ -300,6 +283,10 @@ class VstMobius : public VstPlugin,
 	bool mCheckSamplePosTransport;
 	bool mCheckPpqPosTransport;
 	bool mTraceBeats;
+
+	// hosts automate parameters at high rates, this is separate
+	// from mTrace so it doesn't flood the log
+	bool mTraceParameters;
 };
 
 /****************************************************************************
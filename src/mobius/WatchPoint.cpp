@@ -58,6 +58,10 @@ PUBLIC Watchers::~Watchers()
 PUBLIC WatchPointListener::WatchPointListener()
 {
     mRemoving = false;
+    mRateLimit = 0;
+    mTicks = 0;
+    mPending = false;
+    mPendingValue = 0;
 }
 
 PUBLIC WatchPointListener::~WatchPointListener()
@@ -75,6 +79,16 @@ PUBLIC bool WatchPointListener::isRemoving()
     return mRemoving;
 }
 
+PUBLIC void WatchPointListener::setRateLimit(int ticks)
+{
+    mRateLimit = ticks;
+}
+
+PUBLIC int WatchPointListener::getRateLimit()
+{
+    return mRateLimit;
+}
+
 //////////////////////////////////////////////////////////////////////
 //
 // WatchPoint
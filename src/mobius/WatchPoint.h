@@ -19,6 +19,11 @@
  * with Exports.  WatchPoints have listeners and the client is notified
  * as soon after the watched value changes as possible.
  *
+ * Watch points change inside the audio interrupt but listeners are
+ * not called there since they usually want to send something over
+ * the network.  The interrupt pushes a WatchEvent onto a ring and
+ * MobiusThread delivers them on its next tick.
+ *
  */
 
 #ifndef WATCHPOINT_H
@@ -26,6 +31,14 @@
 
 #include "SystemConstant.h"
 
+/**
+ * The maximum number of watch point changes we can buffer between
+ * MobiusThread ticks.  Subcycle points at fast tempos are the busiest,
+ * these are coalesced as they are delivered so it doesn't need
+ * to be large.  If it fills, events are dropped.
+ */
+#define MAX_WATCH_EVENTS 256
+
 //////////////////////////////////////////////////////////////////////
 //
 // WatchBehavior
@@ -75,6 +88,7 @@ typedef enum {
 class WatchPoint : public SystemConstant {
 
     friend class Mobius;
+    friend class MobiusShared;
     friend class Export;
     friend class Loop;
 
@@ -144,8 +158,8 @@ extern WatchPoint* LoopSubcyclePoint;
  * must call the remove() method on the current listener
  * objects they no longer need. Once this is done the client
  * MUST NOT USE the listener object in any way.  Mobius will
- * garbage collect deactivated listener methods inside the
- * interrupt.
+ * garbage collect deactivated listener methods in MobiusThread
+ * the next time it delivers watch point events.
  */
 class WatchPointListener {
 
@@ -179,6 +193,16 @@ class WatchPointListener {
      */
     virtual void watchPointEvent(int value) = 0;
 
+    /**
+     * Set the minimum number of MobiusThread ticks (1/10 second)
+     * between calls to watchPointEvent.  Changes that happen in 
+     * between are coalesced and the last value is delivered
+     * when the interval expires.  The default of zero delivers
+     * on every tick with a change.
+     */
+    void setRateLimit(int ticks);
+    int getRateLimit();
+
     /**
      * Mark the listener as inactive.
      * Once this is called, the listener object will
@@ -195,6 +219,29 @@ class WatchPointListener {
     
     bool mRemoving;
 
+    // delivery state maintained by Mobius
+    int mRateLimit;
+    int mTicks;
+    bool mPending;
+    int mPendingValue;
+
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// WatchEvent
+//
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * A watch point change captured in the interrupt, waiting to
+ * be delivered to the listeners.
+ */
+class WatchEvent {
+  public:
+
+    class WatchPoint* point;
+    int value;
 };
 
 //////////////////////////////////////////////////////////////////////
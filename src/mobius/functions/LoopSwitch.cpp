@@ -747,6 +747,9 @@ PRIVATE Event* LoopTriggerFunction::scheduleSwitch(Action* action,
         // modifying an existing switch
 		switche->fields.loopSwitch.nextLoop = next;
 
+        // a copy prepared for the old target is no longer wanted
+        em->requestSwitchCopy();
+
         // If this is a replicated function the name of the function
         // has the loop number, otherwise we have to set the "number"
         // field of the event to convey the number.  This is displayed
@@ -158,7 +158,6 @@ class WindowFunction : public Function {
     void buildWindow();
     void constrainWindow();
     Segment* buildSegments();
-    Layer* getNextLayer(Layer* src);
     void installSegments(Segment* segs);
     void calculateNewFrame();
 
@@ -597,7 +596,9 @@ PRIVATE void WindowFunction::constrainWindow()
     }
 
     if (!mIgnore) {
-        historyFrames = mLastLayer->getHistoryOffset() + mLastLayer->getFrames();
+        HistoryIndex* history = mLoop->getHistoryIndex();
+        history->refresh(mLastLayer);
+        historyFrames = history->getFrames();
 
         Trace(mLoop, 2, "Window: Constraining window offset %ld frames %ld history %ld\n",
               (long)mOffset, (long)mFrames, (long)historyFrames);
@@ -677,51 +678,69 @@ PRIVATE void WindowFunction::constrainWindow()
 
 /**
  * Build the segment list.
+ * The layers covering the window are found in the loop's HistoryIndex.
+ * If we're already windowing the segments of the current window layer
+ * are reused, scrubbing the window around generates a lot of these.
  */
 PRIVATE Segment* WindowFunction::buildSegments()
 {
-    // find the layer containing the offset
-    Layer* startLayer = mLastLayer;
-    while (startLayer != NULL) {
-        if (startLayer->getHistoryOffset() > mOffset)
-          startLayer = startLayer->getPrev();
-        else
-          break;
-    }
+    HistoryIndex* history = mLoop->getHistoryIndex();
+    Segment* segments = NULL;
 
-    if (startLayer == NULL) {
-        // ran off the end on the left, some calculation above was wrong
-        Trace(mLoop, 1, "Window: Unable to find layer with offset %ld\n",
-              (long)mOffset);
+    // find the layers containing the edges
+    int startIndex = history->find(mOffset);
+    int endIndex = history->find(mOffset + mFrames - 1);
+    if (startIndex < 0 || endIndex < 0) {
+        // ran off one of the ends, some calculation above was wrong
+        Trace(mLoop, 1, "Window: Unable to find layers for offset %ld frames %ld\n",
+              (long)mOffset, (long)mFrames);
         mIgnore = true;
     }
 
+    // make sure the layers can fill the window before we start
+    // taking segments away from the window layer
+    if (!mIgnore) {
+        long need = mFrames + (mOffset - history->getOffset(startIndex));
+        for (int i = startIndex ; i <= endIndex ; i++)
+          need -= history->getLayer(i)->getFrames();
+
+        if (need > 0) {
+            // layer sizes don't match the offsets, calculation error somewhere
+            Trace(mLoop, 1, "Window: Unable to fill segments!\n");
+            mIgnore = true;
+        }
+    }
+
     // build segments
-    Segment* segments = NULL;
     if (!mIgnore) {
+        Segment* unused = NULL;
+        if (mLayer->getWindowOffset() >= 0)
+          unused = mLayer->detachSegments();
+
         Segment* lastSegment = NULL;
-        Layer* curLayer = startLayer;
-        long refOffset = mOffset - startLayer->getHistoryOffset();
+        long refOffset = mOffset - history->getOffset(startIndex);
         long need = mFrames;
         long layerFrame = 0;
 
-        while (need > 0 && curLayer != NULL) {
+        for (int i = startIndex ; i <= endIndex ; i++) {
 
-            long avail = curLayer->getFrames() - refOffset;
+            Layer* layer = history->getLayer(i);
+            long avail = layer->getFrames() - refOffset;
             long take = (avail > need) ? need : avail;
 
-            if (take <= 0) {
-                // either the layer is empty or the offset is too high
-                // must be a calculation error somewhere
-                Trace(mLoop, 1, "Window: Invalid layer take %ld\n",
-                      (long)take);
-                curLayer = NULL;
-            }
-            else {
+            // empty layers are skipped
+            if (take > 0) {
                 Trace(mLoop, 2, "Window: Segment for layer %ld ref offset %ld start frame %ld frames %ld\n",
-                      curLayer->getNumber(), refOffset, layerFrame, take);
+                      (long)layer->getNumber(), refOffset, layerFrame, take);
+
+                Segment* seg = unused;
+                if (seg == NULL)
+                  seg = new Segment(layer);
+                else {
+                    unused = seg->getNext();
+                    seg->reinit(layer);
+                }
 
-                Segment* seg = new Segment(curLayer);
                 // keep them ordered first to last
                 if (lastSegment == NULL)
                   segments = seg;
@@ -736,58 +755,20 @@ PRIVATE Segment* WindowFunction::buildSegments()
                 seg->setFrames(take);
                 layerFrame += take;
                 need -= take;
-                if (need > 0) {
-                    // sigh, this isn't doubly linked so we have
-                    // to go back to the head of the list and work backward
-                    curLayer = getNextLayer(curLayer);
-                }
             }
 
             // offset only applies to the layer we started in
             refOffset = 0;
         }
-        
-        if (need > 0) {
-            // ran off the end, calculation error somewhere
-            Trace(mLoop, 1, "Window: Unable to fill segments!\n");
-            while (segments != NULL) {
-                Segment* next = segments->getNext();
-                delete segments;
-                segments = next;
-            }
-            segments = NULL;
-            mIgnore = true;
-        }
-    }
 
-    return segments;
-}
-
-/**
- * Get the layer later on the timeline than the given layer.
- * The layer model only has a "prev" pointer to the one before it,
- * to get the next one we have to search the Loop's layer list.
- * Would be nice if this could be doubly linked, is there anything
- * else that needs this?
- *
- */
-PRIVATE Layer* WindowFunction::getNextLayer(Layer* src) 
-{
-    Layer* found = NULL;
-
-    Layer* layer = mLoop->getPlayLayer();
-
-    while (layer != NULL) {
-        Layer* prev = layer->getPrev();
-        if (prev != src)
-          layer = prev;
-        else {
-            found = layer;
-            break;
+        while (unused != NULL) {
+            Segment* next = unused->getNext();
+            delete unused;
+            unused = next;
         }
     }
 
-    return found;
+    return segments;
 }
 
 /**
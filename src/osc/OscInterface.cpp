@@ -269,6 +269,9 @@ class OscpackDevice : public OscDevice
     void setNext(OscpackDevice* d);
 
     UdpTransmitSocket* getSocket();
+    osc::OutboundPacketStream* getBundle();
+    int getBundleMessages();
+    void setBundleMessages(int i);
 
     // these are required by the OscDevice interface
     const char* getHost();
@@ -281,6 +284,13 @@ class OscpackDevice : public OscDevice
     int mPort;
     UdpTransmitSocket* mSocket;
 
+    /**
+     * Bundle being accumulated for periodic export.
+     */
+    char mBundleBuffer[OSC_MAX_OUTPUT];
+    osc::OutboundPacketStream* mBundle;
+    int mBundleMessages;
+
 };
 
 PUBLIC OscpackDevice::OscpackDevice(const char* host, int port,
@@ -290,6 +300,8 @@ PUBLIC OscpackDevice::OscpackDevice(const char* host, int port,
     mHost = CopyString(host);
     mPort = port;
     mSocket = socket;
+    mBundle = new osc::OutboundPacketStream(mBundleBuffer, OSC_MAX_OUTPUT);
+    mBundleMessages = 0;
 }
 
 PUBLIC OscpackDevice::~OscpackDevice()
@@ -298,6 +310,7 @@ PUBLIC OscpackDevice::~OscpackDevice()
 
     delete mHost;
     delete mSocket;
+    delete mBundle;
 
 	for (el = mNext ; el != NULL ; el = next) {
 		next = el->getNext();
@@ -331,6 +344,21 @@ PUBLIC UdpTransmitSocket* OscpackDevice::getSocket()
     return mSocket;
 }
 
+PUBLIC osc::OutboundPacketStream* OscpackDevice::getBundle()
+{
+    return mBundle;
+}
+
+PUBLIC int OscpackDevice::getBundleMessages()
+{
+    return mBundleMessages;
+}
+
+PUBLIC void OscpackDevice::setBundleMessages(int i)
+{
+    mBundleMessages = i;
+}
+
 //////////////////////////////////////////////////////////////////////
 //
 // OscpackInterface
@@ -355,11 +383,14 @@ class OscpackInterface : public OscInterface
     OscDevice* registerDevice(const char* host, int port);
     void send(OscDevice* dev, OscMessage* m);
 	void send(const char* host, int port, OscMessage* m);
+    void bundle(OscDevice* dev, OscMessage* m);
+    void flush();
 
   private:
    
     UdpTransmitSocket* openSocket(const char* host, int port);
     void send(UdpTransmitSocket* socket, OscMessage* msg);
+    void flush(OscpackDevice* dev);
 
 	OscThread* mThread;
 	OscListener* mListener;
@@ -567,6 +598,81 @@ PRIVATE void OscpackInterface::send(UdpTransmitSocket* socket, OscMessage* msg)
 	}
 }
 
+/**
+ * Add a message to the device's bundle.
+ * oscpack throws if the buffer overflows so estimate the size
+ * of the message and send what we have if it won't fit.  The
+ * estimate includes the element size slot, the padded address
+ * and type tags, and the float args.
+ */
+PUBLIC void OscpackInterface::bundle(OscDevice* dev, OscMessage* msg)
+{
+	if (dev != NULL && msg != NULL) {
+
+        OscpackDevice* packdev = (OscpackDevice*)dev;
+        osc::OutboundPacketStream* p = packdev->getBundle();
+        int args = msg->getNumArgs();
+        unsigned long required = 4 + 
+            (((strlen(msg->getAddress()) + 4) / 4) * 4) +
+            (((args + 5) / 4) * 4) + (args * 4);
+
+        if (packdev->getBundleMessages() > 0 &&
+            p->Size() + required + 4 > p->Capacity())
+          flush(packdev);
+
+        try {
+            if (packdev->getBundleMessages() == 0) {
+                p->Clear();
+                *p << osc::BeginBundleImmediate;
+            }
+
+            *p << osc::BeginMessage(msg->getAddress());
+            for (int i = 0 ; i < args ; i++) {
+                *p << msg->getArg(i);
+            }
+            *p << osc::EndMessage;
+
+            packdev->setBundleMessages(packdev->getBundleMessages() + 1);
+        }
+        catch (osc::Exception& e) {
+            Trace(1, "ERROR: OscInterface:bundle overflow\n");
+            p->Clear();
+            packdev->setBundleMessages(0);
+            e = e;
+        }
+	}
+}
+
+/**
+ * Send the accumulated bundles for all devices.
+ */
+PUBLIC void OscpackInterface::flush()
+{
+    for (OscpackDevice* d = mDevices ; d != NULL ; d = d->getNext())
+      flush(d);
+}
+
+PRIVATE void OscpackInterface::flush(OscpackDevice* dev)
+{
+    if (dev->getBundleMessages() > 0) {
+        osc::OutboundPacketStream* p = dev->getBundle();
+        *p << osc::EndBundle;
+
+        if (mTrace) {
+            printf("OSC sending bundle: %s %d messages\n", 
+                   dev->getHost(), dev->getBundleMessages());
+            fflush(stdout);
+        }
+
+        UdpTransmitSocket* socket = dev->getSocket();
+        if (socket != NULL)
+          socket->Send(p->Data(), p->Size());
+
+        p->Clear();
+        dev->setBundleMessages(0);
+    }
+}
+
 //////////////////////////////////////////////////////////////////////
 //
 // Factory
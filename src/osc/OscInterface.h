@@ -148,6 +148,19 @@ class OscInterface {
 	 */
 	virtual void send(const char* host, int port, OscMessage* m) = 0;
 
+    /**
+     * Add a message to a bundle being accumulated for a registered
+     * device.  Nothing is sent until flush() is called, or the bundle
+     * fills up.  This is intended for periodic status export where
+     * sending one UDP packet per changed value adds up.
+     */
+    virtual void bundle(OscDevice* dev, OscMessage* m) = 0;
+
+    /**
+     * Send any bundles accumulated by bundle().
+     */
+    virtual void flush() = 0;
+
   protected:
 
 };
@@ -9,21 +9,12 @@
  * 
  */
 
-#include <map>
+#include <stdio.h>
+#include <string.h>
 
 #include "Port.h"
 #include "Map.h"
 
-struct strCmp {
-    bool operator()( const char* s1, const char* s2 ) const {
-        return strcmp( s1, s2 ) < 0;
-    }
-};
-
-// actually it's a tree map
-//typedef std::map<const char*, void*> HashMap;
-typedef std::map<const char*, void*, strCmp> HashMap;
-
 Map::Map()
 {
     init(0);
@@ -36,35 +27,127 @@ Map::Map(int initialSize)
 
 Map::~Map()
 {
-    HashMap* map = (HashMap*)mMap;
-    delete map;
+    for (int i = 0 ; i < mBucketCount ; i++) {
+        MapEntry* next = NULL;
+        for (MapEntry* e = mBuckets[i] ; e != NULL ; e = next) {
+            next = e->next;
+            delete e;
+        }
+    }
+    delete [] mBuckets;
 }
 
+/**
+ * Round the size up to a power of two so we can mask rather than 
+ * divide when selecting a bucket.
+ */
 PRIVATE void Map::init(int size)
 {
-    // not sure how to specify this
-    mMap = (void*)(new HashMap());
+    int buckets = MAP_DEFAULT_SIZE;
+    while (buckets < size)
+      buckets *= 2;
+
+    mBucketCount = buckets;
+    mCount = 0;
+    mBuckets = new MapEntry*[mBucketCount];
+    for (int i = 0 ; i < mBucketCount ; i++)
+      mBuckets[i] = NULL;
+}
+
+/**
+ * FNV-1a, good enough for the short path-like keys we have.
+ */
+PRIVATE unsigned long Map::hash(const char* key)
+{
+    unsigned long h = 2166136261UL;
+    for (const unsigned char* ptr = (const unsigned char*)key ; *ptr ; ptr++) {
+        h ^= *ptr;
+        h *= 16777619UL;
+        h &= 0xFFFFFFFFUL;
+    }
+    return h;
+}
+
+/**
+ * Double the number of buckets and rehash, the entries are reused.
+ */
+PRIVATE void Map::grow()
+{
+    int newCount = mBucketCount * 2;
+    MapEntry** newBuckets = new MapEntry*[newCount];
+    for (int i = 0 ; i < newCount ; i++)
+      newBuckets[i] = NULL;
+
+    for (int i = 0 ; i < mBucketCount ; i++) {
+        MapEntry* next = NULL;
+        for (MapEntry* e = mBuckets[i] ; e != NULL ; e = next) {
+            next = e->next;
+            int index = (int)(e->hash & (newCount - 1));
+            e->next = newBuckets[index];
+            newBuckets[index] = e;
+        }
+    }
+
+    delete [] mBuckets;
+    mBuckets = newBuckets;
+    mBucketCount = newCount;
 }
 
 void Map::put(const char* key, void* value)
 {
-    HashMap* map = (HashMap*)mMap;
-    (*map)[key] = value;
+    if (key != NULL) {
+        unsigned long h = hash(key);
+        int index = (int)(h & (mBucketCount - 1));
+
+        MapEntry* found = NULL;
+        for (MapEntry* e = mBuckets[index] ; e != NULL ; e = e->next) {
+            if (e->hash == h && !strcmp(e->key, key)) {
+                found = e;
+                break;
+            }
+        }
+
+        if (found != NULL)
+          found->value = value;
+        else {
+            if (mCount >= mBucketCount) {
+                grow();
+                index = (int)(h & (mBucketCount - 1));
+            }
+            MapEntry* e = new MapEntry();
+            e->key = key;
+            e->value = value;
+            e->hash = h;
+            e->next = mBuckets[index];
+            mBuckets[index] = e;
+            mCount++;
+        }
+    }
 }
 
 void* Map::get(const char* key)
 {
     void *value = NULL;
-    HashMap* map = (HashMap*)mMap;
-    
-    // stl map is just fucking unbelievable
-    HashMap::const_iterator it = map->find(key);
-    if (it != map->end())
-      value = it->second;
+
+    if (key != NULL) {
+        unsigned long h = hash(key);
+        int index = (int)(h & (mBucketCount - 1));
+        for (MapEntry* e = mBuckets[index] ; e != NULL ; e = e->next) {
+            if (e->hash == h && !strcmp(e->key, key)) {
+                value = e->value;
+                break;
+            }
+        }
+    }
 
     return value;
 }
 
+int Map::size()
+{
+    return mCount;
+}
+
 /****************************************************************************/
 /****************************************************************************/
 /****************************************************************************/
@@ -12,9 +12,31 @@
 #ifndef MAP_UTIL_H
 #define MAP_UTIL_H
 
+/**
+ * The default number of hash buckets.  Always a power of two.
+ */
+#define MAP_DEFAULT_SIZE 64
+
+/**
+ * One entry in a Map bucket chain.
+ */
+class MapEntry {
+  public:
+
+    MapEntry* next;
+    const char* key;
+    void* value;
+    unsigned long hash;
+};
+
 /**
  * The default map has string keys and object values.
  * The values are not owned and won't be freed.
+ * The keys are not copied and must remain valid while the map is in use.
+ *
+ * This is a chained hash table, lookups are constant time unless
+ * things go very badly with the hash.  The table doubles when the number
+ * of entries reaches the number of buckets.
  */
 class Map {
   public:
@@ -25,12 +47,17 @@ class Map {
 
     void put(const char* key, void* value);
     void* get(const char* key);
+    int size();
 
   private:
 
     void init(int size);
+    void grow();
+    unsigned long hash(const char* key);
 
-    void* mMap;
+    MapEntry** mBuckets;
+    int mBucketCount;
+    int mCount;
 
 };
 
@@ -0,0 +1,427 @@
+/*
+ * Copyright (c) 2010 Jeffrey S. Larson  <jeff@circularlabs.com>
+ * All rights reserved.
+ * See the LICENSE file for the full copyright and license declaration.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Debugging aid to find things the audio interrupt should not be doing.
+ * See RealTime.h for the overview.
+ *
+ * Violations are recorded in a fixed table of sites.  A site is
+ * identified by a hash of the hazard and the return addresses on the
+ * stack.  The first thread to find an empty slot claims it with
+ * a compare and swap and fills in the stack, after that everyone just
+ * increments the count.  Nothing here allocates or locks, since that
+ * would be one of the things we're looking for.
+ *
+ * Memory is watched by replacing the global operator new and delete.
+ * With the Windows debug runtime we install an allocation hook instead,
+ * which also sees malloc and free.  Locks are checked in
+ * CriticalSection::enter.  File access is checked by redirecting the
+ * common stdio functions with macros in RealTime.h, which is included
+ * by Trace.h so it reaches almost everything.
+ *
+ */
+
+// keep our own stdio calls from being redirected
+#define RT_SANITIZE_IMPL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+// std::bad_alloc for the replacement operator new
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#ifdef _DEBUG
+#include <crtdbg.h>
+#endif
+#else
+#include <execinfo.h>
+#endif
+
+#include "port.h"
+#include "RealTime.h"
+
+/****************************************************************************
+ *                                                                          *
+ *                                   STATE                                  *
+ *                                                                          *
+ ****************************************************************************/
+
+#ifdef _WIN32
+#define RT_THREAD_LOCAL __declspec(thread)
+#else
+#define RT_THREAD_LOCAL __thread
+#endif
+
+/**
+ * One distinct call stack that did something it shouldn't.
+ */
+class RealTimeSite {
+
+  public:
+
+    // zero until claimed
+    volatile long hash;
+
+    // set after the stack has been filled in
+    volatile long ready;
+
+    volatile long count;
+    RealTimeHazard hazard;
+    int frames;
+    void* stack[RT_SANITIZE_MAX_FRAMES];
+
+};
+
+/**
+ * Nesting depth of RealTimeEnter on this thread.
+ */
+RT_THREAD_LOCAL int RealTimeDepth = 0;
+
+/**
+ * Set while we're recording a violation so anything the stack
+ * capture does doesn't come back in here.
+ */
+RT_THREAD_LOCAL int RealTimeRecording = 0;
+
+#ifdef RT_SANITIZE
+
+RealTimeSite RealTimeSites[RT_SANITIZE_MAX_SITES];
+
+/**
+ * Total number of violations, and the number we couldn't record
+ * because the site table was full.
+ */
+volatile long RealTimeViolations = 0;
+volatile long RealTimeDropped = 0;
+
+#ifdef _WIN32
+
+PRIVATE bool RealTimeCas(volatile long* p, long oldval, long newval)
+{
+    return (InterlockedCompareExchange(p, newval, oldval) == oldval);
+}
+
+PRIVATE void RealTimeIncrement(volatile long* p)
+{
+    InterlockedIncrement(p);
+}
+
+#else
+
+PRIVATE bool RealTimeCas(volatile long* p, long oldval, long newval)
+{
+    return __sync_bool_compare_and_swap(p, oldval, newval);
+}
+
+PRIVATE void RealTimeIncrement(volatile long* p)
+{
+    __sync_add_and_fetch(p, 1);
+}
+
+#endif
+
+/****************************************************************************
+ *                                                                          *
+ *                                 RECORDING                                *
+ *                                                                          *
+ ****************************************************************************/
+
+PRIVATE int RealTimeCaptureStack(void** stack)
+{
+#ifdef _WIN32
+    // skip ourselves and RealTimeCheck
+    return (int)CaptureStackBackTrace(2, RT_SANITIZE_MAX_FRAMES, stack, NULL);
+#else
+    return backtrace(stack, RT_SANITIZE_MAX_FRAMES);
+#endif
+}
+
+PRIVATE long RealTimeHash(RealTimeHazard hazard, void** stack, int frames)
+{
+    // FNV-1a over the hazard and the return addresses
+    unsigned long hash = 2166136261UL;
+
+    hash = (hash ^ (unsigned long)hazard) * 16777619UL;
+    for (int i = 0 ; i < frames ; i++) {
+        unsigned long addr = (unsigned long)(size_t)stack[i];
+        hash = (hash ^ addr) * 16777619UL;
+    }
+
+    // zero means an empty slot
+    if (hash == 0)
+      hash = 1;
+
+    return (long)hash;
+}
+
+PRIVATE void RealTimeRecord(RealTimeHazard hazard)
+{
+    void* stack[RT_SANITIZE_MAX_FRAMES];
+    int frames = RealTimeCaptureStack(stack);
+    long hash = RealTimeHash(hazard, stack, frames);
+    unsigned long start = (unsigned long)hash % RT_SANITIZE_MAX_SITES;
+    bool recorded = false;
+
+    RealTimeIncrement(&RealTimeViolations);
+
+    for (int i = 0 ; i < RT_SANITIZE_MAX_SITES && !recorded ; i++) {
+        RealTimeSite* site = &RealTimeSites[(start + i) % RT_SANITIZE_MAX_SITES];
+
+        if (site->hash == 0 && RealTimeCas(&site->hash, 0, hash)) {
+            // it's ours, other threads won't look at the stack
+            // until ready is set
+            site->hazard = hazard;
+            site->frames = frames;
+            for (int f = 0 ; f < frames ; f++)
+              site->stack[f] = stack[f];
+            site->ready = 1;
+        }
+
+        if (site->hash == hash) {
+            RealTimeIncrement(&site->count);
+            recorded = true;
+        }
+    }
+
+    if (!recorded)
+      RealTimeIncrement(&RealTimeDropped);
+}
+
+#endif
+
+/****************************************************************************
+ *                                                                          *
+ *                                 INTERFACE                                *
+ *                                                                          *
+ ****************************************************************************/
+
+#if defined(RT_SANITIZE) && defined(_WIN32) && defined(_DEBUG)
+
+/**
+ * Debug runtime allocation hook, this sees everything that goes
+ * through the CRT heap including operator new.
+ */
+PRIVATE int RealTimeAllocHook(int type, void* data, size_t size, int block,
+                              long request, const unsigned char* file,
+                              int line)
+{
+    // the runtime's own blocks aren't interesting
+    if (block != _CRT_BLOCK) {
+        if (type == _HOOK_FREE)
+          RealTimeCheck(RT_HAZARD_FREE);
+        else
+          RealTimeCheck(RT_HAZARD_ALLOC);
+    }
+    return TRUE;
+}
+
+bool RealTimeHookInstalled = false;
+
+#endif
+
+/**
+ * Called by the interrupt handler on entry.
+ */
+PUBLIC void RealTimeEnter()
+{
+#if defined(RT_SANITIZE) && defined(_WIN32) && defined(_DEBUG)
+    if (!RealTimeHookInstalled) {
+        RealTimeHookInstalled = true;
+        _CrtSetAllocHook(RealTimeAllocHook);
+    }
+#endif
+    RealTimeDepth++;
+}
+
+/**
+ * Called by the interrupt handler on exit.
+ */
+PUBLIC void RealTimeExit()
+{
+    if (RealTimeDepth > 0)
+      RealTimeDepth--;
+}
+
+PUBLIC bool RealTimeIsMarked()
+{
+    return (RealTimeDepth > 0);
+}
+
+/**
+ * Called by anything that would be a problem in the interrupt.
+ */
+PUBLIC void RealTimeCheck(RealTimeHazard hazard)
+{
+#ifdef RT_SANITIZE
+    if (RealTimeDepth > 0 && !RealTimeRecording) {
+        RealTimeRecording = 1;
+        RealTimeRecord(hazard);
+        RealTimeRecording = 0;
+    }
+#endif
+}
+
+PUBLIC long RealTimeGetViolations()
+{
+#ifdef RT_SANITIZE
+    return RealTimeViolations;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Print the recorded sites.  This may allocate, don't call it
+ * from the interrupt.
+ */
+PUBLIC void RealTimeDump(FILE* fp)
+{
+#ifdef RT_SANITIZE
+    static const char* names[] = {"alloc", "free", "lock", "file"};
+
+    fprintf(fp, "*** Real Time Violations ***\n");
+    fprintf(fp, "%ld violations, %ld not recorded\n",
+            (long)RealTimeViolations, (long)RealTimeDropped);
+
+    for (int i = 0 ; i < RT_SANITIZE_MAX_SITES ; i++) {
+        RealTimeSite* site = &RealTimeSites[i];
+        if (site->ready) {
+            fprintf(fp, "%ld %s\n", (long)site->count, names[site->hazard]);
+#ifdef _WIN32
+            for (int f = 0 ; f < site->frames ; f++)
+              fprintf(fp, "  %p\n", site->stack[f]);
+#else
+            char** symbols = backtrace_symbols(site->stack, site->frames);
+            for (int f = 0 ; f < site->frames ; f++) {
+                if (symbols != NULL)
+                  fprintf(fp, "  %s\n", symbols[f]);
+                else
+                  fprintf(fp, "  %p\n", site->stack[f]);
+            }
+            ::free(symbols);
+#endif
+        }
+    }
+    fflush(fp);
+#endif
+}
+
+/****************************************************************************
+ *                                                                          *
+ *                                  MEMORY                                  *
+ *                                                                          *
+ ****************************************************************************/
+
+#if defined(RT_SANITIZE) && !(defined(_WIN32) && defined(_DEBUG))
+
+void* operator new(size_t size)
+{
+    RealTimeCheck(RT_HAZARD_ALLOC);
+    void* p = malloc(size);
+    if (p == NULL)
+      throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    RealTimeCheck(RT_HAZARD_ALLOC);
+    void* p = malloc(size);
+    if (p == NULL)
+      throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) throw()
+{
+    // deleting NULL is common and harmless
+    if (p != NULL) {
+        RealTimeCheck(RT_HAZARD_FREE);
+        free(p);
+    }
+}
+
+void operator delete[](void* p) throw()
+{
+    if (p != NULL) {
+        RealTimeCheck(RT_HAZARD_FREE);
+        free(p);
+    }
+}
+
+#endif
+
+/****************************************************************************
+ *                                                                          *
+ *                                   STDIO                                  *
+ *                                                                          *
+ ****************************************************************************/
+
+#ifdef RT_SANITIZE
+
+PUBLIC FILE* RealTimeFopen(const char* name, const char* mode)
+{
+    RealTimeCheck(RT_HAZARD_FILE);
+    return fopen(name, mode);
+}
+
+PUBLIC int RealTimeFclose(FILE* fp)
+{
+    RealTimeCheck(RT_HAZARD_FILE);
+    return fclose(fp);
+}
+
+PUBLIC size_t RealTimeFread(void* buf, size_t size, size_t count, FILE* fp)
+{
+    RealTimeCheck(RT_HAZARD_FILE);
+    return fread(buf, size, count, fp);
+}
+
+PUBLIC size_t RealTimeFwrite(const void* buf, size_t size, size_t count, FILE* fp)
+{
+    RealTimeCheck(RT_HAZARD_FILE);
+    return fwrite(buf, size, count, fp);
+}
+
+PUBLIC int RealTimeFflush(FILE* fp)
+{
+    RealTimeCheck(RT_HAZARD_FILE);
+    return fflush(fp);
+}
+
+PUBLIC int RealTimeFprintf(FILE* fp, const char* format, ...)
+{
+    va_list args;
+    int result;
+
+    RealTimeCheck(RT_HAZARD_FILE);
+    va_start(args, format);
+    result = vfprintf(fp, format, args);
+    va_end(args);
+    return result;
+}
+
+PUBLIC int RealTimePrintf(const char* format, ...)
+{
+    va_list args;
+    int result;
+
+    RealTimeCheck(RT_HAZARD_FILE);
+    va_start(args, format);
+    result = vprintf(format, args);
+    va_end(args);
+    return result;
+}
+
+#endif
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
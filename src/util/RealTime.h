@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2010 Jeffrey S. Larson  <jeff@circularlabs.com>
+ * All rights reserved.
+ * See the LICENSE file for the full copyright and license declaration.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Debugging aid to find things the audio interrupt should not be doing.
+ *
+ * The interrupt handler marks the thread with RealTimeEnter and
+ * RealTimeExit.  When built with RT_SANITIZE, anything that allocates
+ * or frees memory, enters a CriticalSection, or does stdio on a marked
+ * thread is recorded along with the call stack that did it.
+ * Identical stacks are counted rather than recorded twice, and
+ * RealTimeDump prints the list.
+ *
+ * Without RT_SANITIZE the marking functions do nothing and nothing is
+ * intercepted.
+ *
+ */
+
+#ifndef REAL_TIME_H
+#define REAL_TIME_H
+
+#include <stdio.h>
+
+/****************************************************************************
+ *                                                                          *
+ *                                 CONSTANTS                                *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Maximum number of distinct call stacks we remember.
+ * Violations beyond this are counted but not recorded.
+ */
+#define RT_SANITIZE_MAX_SITES 256
+
+/**
+ * Maximum depth of the captured stacks.
+ */
+#define RT_SANITIZE_MAX_FRAMES 16
+
+/**
+ * The things we look for.
+ */
+typedef enum {
+
+    RT_HAZARD_ALLOC,
+    RT_HAZARD_FREE,
+    RT_HAZARD_LOCK,
+    RT_HAZARD_FILE
+
+} RealTimeHazard;
+
+/****************************************************************************
+ *                                                                          *
+ *                                 INTERFACE                                *
+ *                                                                          *
+ ****************************************************************************/
+
+void RealTimeEnter();
+void RealTimeExit();
+bool RealTimeIsMarked();
+
+void RealTimeCheck(RealTimeHazard hazard);
+
+long RealTimeGetViolations();
+void RealTimeDump(FILE* fp);
+
+/****************************************************************************
+ *                                                                          *
+ *                                   STDIO                                  *
+ *                                                                          *
+ ****************************************************************************/
+
+#if defined(RT_SANITIZE) && !defined(RT_SANITIZE_IMPL)
+
+// stdio.h has already been included so these only change the calls
+FILE* RealTimeFopen(const char* name, const char* mode);
+int RealTimeFclose(FILE* fp);
+size_t RealTimeFread(void* buf, size_t size, size_t count, FILE* fp);
+size_t RealTimeFwrite(const void* buf, size_t size, size_t count, FILE* fp);
+int RealTimeFflush(FILE* fp);
+int RealTimeFprintf(FILE* fp, const char* format, ...);
+int RealTimePrintf(const char* format, ...);
+
+#define fopen RealTimeFopen
+#define fclose RealTimeFclose
+#define fread RealTimeFread
+#define fwrite RealTimeFwrite
+#define fflush RealTimeFflush
+#define fprintf RealTimeFprintf
+#define printf RealTimePrintf
+
+#endif
+
+#endif
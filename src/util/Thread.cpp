@@ -44,6 +44,7 @@ extern "C" {
 #endif
 
 #include "util.h"
+#include "RealTime.h"
 #include "Thread.h"
 
 #define DEFAULT_TIMEOUT 1000
@@ -154,6 +155,9 @@ INTERFACE void CriticalSection::enter()
 
 INTERFACE void CriticalSection::enter(const char* reason)
 {
+#ifdef RT_SANITIZE
+	RealTimeCheck(RT_HAZARD_LOCK);
+#endif
 	trace("enter", reason);
 #ifdef _WIN32
 	if (this)
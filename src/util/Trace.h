@@ -14,6 +14,7 @@
 
 #include <stdarg.h>
 #include "port.h"
+#include "RealTime.h"
 
 extern bool TraceToDebug;
 extern bool TraceToStdout;